@@ -90,11 +90,105 @@ SPAN_DECLARE(const char *) signal_status_to_str(int status)
 }
 /*- End of function --------------------------------------------------------*/
 
+/* The parity of each 8 bit value - 1 for an odd number of ones */
+static const uint8_t parity_table[256] =
+{
+    0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0,
+    1, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1,
+    1, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1,
+    0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0,
+    1, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1,
+    0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0,
+    0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0,
+    1, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1,
+    1, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1,
+    0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0,
+    0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0,
+    1, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1,
+    0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0,
+    1, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1,
+    1, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1,
+    0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0
+};
+
+static void set_parity(int parity, uint8_t *parity_mask, uint8_t *parity_invert)
+{
+    /* Every type of parity bit is the data's parity, masked to nothing or not, then
+       inverted or not. */
+    switch (parity)
+    {
+    case ASYNC_PARITY_EVEN:
+        *parity_mask = 1;
+        *parity_invert = 0;
+        break;
+    case ASYNC_PARITY_ODD:
+        *parity_mask = 1;
+        *parity_invert = 1;
+        break;
+    case ASYNC_PARITY_MARK:
+        *parity_mask = 0;
+        *parity_invert = 1;
+        break;
+    default:
+        *parity_mask = 0;
+        *parity_invert = 0;
+        break;
+    }
+    /*endswitch*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static __inline__ int parity_bit(uint8_t parity_mask, uint8_t parity_invert, int data)
+{
+    /* Characters may be up to 9 bits */
+    return ((parity_table[data & 0xFF] ^ (data >> 8)) & parity_mask) ^ parity_invert;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void rx_frame_complete(async_rx_state_t *s)
+{
+    int data;
+
+    /* The frame holds the data bits, any parity bit, and the first stop bit */
+    if ((s->frame_in_progress & (1 << s->total_data_bits)) == 0  &&  !s->use_v14)
+    {
+        s->framing_errors++;
+        s->bitpos = 0;
+        return;
+    }
+    /*endif*/
+    data = s->frame_in_progress & (0xFFFF >> (16 - s->data_bits));
+    if (s->parity == ASYNC_PARITY_NONE
+        ||
+        ((s->frame_in_progress >> s->data_bits) & 1) == parity_bit(s->parity_mask, s->parity_invert, data))
+    {
+        s->put_byte(s->user_data, data);
+    }
+    else
+    {
+        s->parity_errors++;
+    }
+    /*endif*/
+    if ((s->frame_in_progress & (1 << s->total_data_bits)))
+    {
+        /* This is the first of any stop bits */
+        s->bitpos = 0;
+    }
+    else
+    {
+        /* There might be a framing error, but we have to assume the stop
+           bit has been dropped by the rate adaption mechanism described in
+           V.14. */
+        s->bitpos = 1;
+        s->frame_in_progress = 0;
+    }
+    /*endif*/
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(void) async_rx_put_bit(void *user_data, int bit)
 {
     async_rx_state_t *s;
-    int parity_bit_a;
-    int parity_bit_b;
 
     s = (async_rx_state_t *) user_data;
     if (bit < 0)
@@ -126,77 +220,57 @@ SPAN_DECLARE(void) async_rx_put_bit(void *user_data, int bit)
             s->bitpos += (bit ^ 1);
             s->frame_in_progress = 0;
         }
-        else if (s->bitpos <= s->total_data_bits)
+        else
         {
-            s->frame_in_progress = (s->frame_in_progress >> 1) | (bit << 15);
-            s->bitpos++;
+            s->frame_in_progress |= ((bit & 1) << (s->bitpos - 1));
+            /* Stop when we have reached the first stop bit */
+            if (++s->bitpos > s->total_data_bits + 1)
+                rx_frame_complete(s);
+            /*endif*/
+        }
+        /*endif*/
+    }
+    /*endif*/
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(void) async_rx_put_bits(void *user_data, uint32_t bits, int nbits)
+{
+    async_rx_state_t *s;
+    int n;
+
+    s = (async_rx_state_t *) user_data;
+    while (nbits > 0)
+    {
+        if (s->bitpos == 0)
+        {
+            /* Skip over any idle bits in one go, looking for the start bit */
+            if ((n = bottom_bit(~bits)) < 0  ||  n >= nbits)
+                return;
+            /*endif*/
+            /* Step past the start bit, too */
+            bits = (bits >> n) >> 1;
+            nbits -= (n + 1);
+            s->bitpos = 1;
+            s->frame_in_progress = 0;
         }
         else
         {
-            /* We should be at the first stop bit */
-            if (bit == 0  &&  !s->use_v14)
-            {
-                s->framing_errors++;
-                s->bitpos = 0;
-            }
-            else
-            {
-                /* Check and remove any parity bit */
-                if (s->parity != ASYNC_PARITY_NONE)
-                {
-                    parity_bit_a = (s->frame_in_progress >> 15) & 0x01;
-                    /* Trim off the parity bit */
-                    s->frame_in_progress &= 0x7FFF;
-                    s->frame_in_progress >>= (16 - s->total_data_bits);
-                    switch (s->parity)
-                    {
-                    case ASYNC_PARITY_ODD:
-                        parity_bit_b = parity8(s->frame_in_progress) ^ 1;
-                        break;
-                    case ASYNC_PARITY_EVEN:
-                        parity_bit_b = parity8(s->frame_in_progress);
-                        break;
-                    case ASYNC_PARITY_MARK:
-                        parity_bit_b = 1;
-                        break;
-                    default:
-                    case ASYNC_PARITY_SPACE:
-                        parity_bit_b = 0;
-                        break;
-                    }
-                    /*endswitch*/
-                    if (parity_bit_a == parity_bit_b)
-                        s->put_byte(s->user_data, s->frame_in_progress);
-                    else
-                        s->parity_errors++;
-                    /*endif*/
-                }
-                else
-                {
-                    s->frame_in_progress >>= (16 - s->total_data_bits);
-                    s->put_byte(s->user_data, s->frame_in_progress);
-                }
-                /*endif*/
-                if (bit == 1)
-                {
-                    /* This is the first of any stop bits */
-                    s->bitpos = 0;
-                }
-                else
-                {
-                    /* There might be a framing error, but we have to assume the stop
-                       bit has been dropped by the rate adaption mechanism described in
-                       V.14. */
-                    s->bitpos = 1;
-                    s->frame_in_progress = 0;
-                }
-                /*endif*/
-            }
+            /* Take as much of the rest of the frame, up to the first stop bit, as we have */
+            n = s->total_data_bits + 2 - s->bitpos;
+            if (n > nbits)
+                n = nbits;
+            /*endif*/
+            s->frame_in_progress |= ((bits & (0xFFFFU >> (16 - n))) << (s->bitpos - 1));
+            bits >>= n;
+            nbits -= n;
+            if ((s->bitpos += n) > s->total_data_bits + 1)
+                rx_frame_complete(s);
             /*endif*/
         }
         /*endif*/
     }
-    /*endif*/
+    /*endwhile*/
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -232,6 +306,9 @@ SPAN_DECLARE(async_rx_state_t *) async_rx_init(async_rx_state_t *s,
                                                span_put_byte_func_t put_byte,
                                                void *user_data)
 {
+    if (data_bits < 1  ||  data_bits > 9)
+        return NULL;
+    /*endif*/
     if (s == NULL)
     {
         if ((s = (async_rx_state_t *) span_alloc(sizeof(*s))) == NULL)
@@ -248,6 +325,7 @@ SPAN_DECLARE(async_rx_state_t *) async_rx_init(async_rx_state_t *s,
         s->total_data_bits++;
     /*endif*/
     s->use_v14 = use_v14;
+    set_parity(parity, &s->parity_mask, &s->parity_invert);
 
     s->put_byte = put_byte;
     s->user_data = user_data;
@@ -274,11 +352,18 @@ SPAN_DECLARE(int) async_rx_free(async_rx_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
+static __inline__ uint16_t tx_frame(async_tx_state_t *s, int data)
+{
+    /* Any upper bits are trimmed off, and the parity and stop bits are added above the data */
+    data &= (0xFFFF >> (16 - s->data_bits));
+    return (uint16_t) (data | (parity_bit(s->parity_mask, s->parity_invert, data) << s->data_bits) | s->stop_bits);
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) async_tx_get_bit(void *user_data)
 {
     async_tx_state_t *s;
     int bit;
-    int parity_bit;
     int32_t next_byte;
 
     s = (async_tx_state_t *) user_data;
@@ -300,27 +385,7 @@ SPAN_DECLARE(int) async_tx_get_bit(void *user_data)
             return 1;
         }
         /*endif*/
-        s->frame_in_progress = next_byte;
-        /* Trim off any upper bits */
-        s->frame_in_progress &= (0xFFFF >> (16 - s->data_bits));
-        /* Now insert any parity bit */
-        switch (s->parity)
-        {
-        case ASYNC_PARITY_MARK:
-            s->frame_in_progress |= (1 << s->data_bits);
-            break;
-        case ASYNC_PARITY_EVEN:
-            parity_bit = parity8(s->frame_in_progress);
-            s->frame_in_progress |= (parity_bit << s->data_bits);
-            break;
-        case ASYNC_PARITY_ODD:
-            parity_bit = parity8(s->frame_in_progress) ^ 1;
-            s->frame_in_progress |= (parity_bit << s->data_bits);
-            break;
-        }
-        /*endswitch*/
-        /* Insert some stop bits above the data and parity ones */
-        s->frame_in_progress |= (0xFFFF << s->total_data_bits);
+        s->frame_in_progress = tx_frame(s, next_byte);
         /* Start bit */
         bit = 0;
         s->bitpos++;
@@ -338,6 +403,67 @@ SPAN_DECLARE(int) async_tx_get_bit(void *user_data)
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) async_tx_get_bits(void *user_data, uint32_t *bits, int nbits)
+{
+    async_tx_state_t *s;
+    int32_t next_byte;
+    int i;
+    int n;
+
+    s = (async_tx_state_t *) user_data;
+    *bits = 0;
+    i = 0;
+    while (i < nbits)
+    {
+        if (s->bitpos == 0)
+        {
+            if (s->presend_bits > 0)
+            {
+                n = nbits - i;
+                if (n > s->presend_bits)
+                    n = s->presend_bits;
+                /*endif*/
+                *bits |= ((0xFFFFFFFFU >> (32 - n)) << i);
+                s->presend_bits -= n;
+                i += n;
+                continue;
+            }
+            /*endif*/
+            if ((next_byte = s->get_byte(s->user_data)) < 0)
+            {
+                if (next_byte != SIG_STATUS_LINK_IDLE)
+                    break;
+                /*endif*/
+                /* Idle for a bit time */
+                *bits |= (1U << i);
+                i++;
+                continue;
+            }
+            /*endif*/
+            s->frame_in_progress = tx_frame(s, next_byte);
+            /* The start bit is a zero, so there is nothing to add to the bits */
+            s->bitpos = 1;
+            i++;
+            continue;
+        }
+        /*endif*/
+        /* Take as much of the rest of the frame as will fit */
+        n = s->total_bits + 1 - s->bitpos;
+        if (n > nbits - i)
+            n = nbits - i;
+        /*endif*/
+        *bits |= ((uint32_t) (s->frame_in_progress & (0xFFFFU >> (16 - n))) << i);
+        s->frame_in_progress >>= n;
+        if ((s->bitpos += n) > s->total_bits)
+            s->bitpos = 0;
+        /*endif*/
+        i += n;
+    }
+    /*endwhile*/
+    return i;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(void) async_tx_presend_bits(async_tx_state_t *s, int bits)
 {
     s->presend_bits = bits;
@@ -352,6 +478,12 @@ SPAN_DECLARE(async_tx_state_t *) async_tx_init(async_tx_state_t *s,
                                                span_get_byte_func_t get_byte,
                                                void *user_data)
 {
+    if (data_bits < 1  ||  data_bits > 9)
+        return NULL;
+    /*endif*/
+    if (data_bits + ((parity == ASYNC_PARITY_NONE)  ?  0  :  1) + stop_bits > 16)
+        return NULL;
+    /*endif*/
     if (s == NULL)
     {
         if ((s = (async_tx_state_t *) span_alloc(sizeof(*s))) == NULL)
@@ -369,6 +501,9 @@ SPAN_DECLARE(async_tx_state_t *) async_tx_init(async_tx_state_t *s,
         s->total_data_bits++;
     /*endif*/
     s->total_bits = s->total_data_bits + stop_bits;
+    set_parity(parity, &s->parity_mask, &s->parity_invert);
+    /* Everything above the data and parity bits is a stop bit */
+    s->stop_bits = (uint16_t) (0xFFFF << s->total_data_bits);
     s->get_byte = get_byte;
     s->user_data = user_data;
 
@@ -673,15 +673,19 @@ SPAN_DECLARE(data_modems_state_t *) data_modems_init(data_modems_state_t *s,
                                                      span_get_msg_func_t get_msg,
                                                      void *user_data)
 {
+    bool alloced;
+
     if (at_tx_handler == NULL  ||  modem_control_handler == NULL)
         return NULL;
     /*endif*/
 
+    alloced = false;
     if (s == NULL)
     {
         if ((s = (data_modems_state_t *) span_alloc(sizeof(*s))) == NULL)
             return NULL;
         /*endif*/
+        alloced = true;
     }
     /*endif*/
     memset(s, 0, sizeof(*s));
@@ -697,7 +701,14 @@ SPAN_DECLARE(data_modems_state_t *) data_modems_init(data_modems_state_t *s,
     s->get_msg = get_msg;
     s->user_data = user_data;
 
-    v42bis_init(&s->v42bis, 3, 512, 6, NULL, s, 512, put_msg, s, 512);
+    if (v42bis_init(&s->v42bis, 3, 512, 6, NULL, s, 512, put_msg, s, 512) == NULL)
+    {
+        if (alloced)
+            span_free(s);
+        /*endif*/
+        return NULL;
+    }
+    /*endif*/
     v42_init(&s->v42, true, true, NULL, (span_put_msg_func_t) v42bis_decompress, &s->v42bis);
 
     data_modems_set_async_mode(s, 8, ASYNC_PARITY_NONE, 1);
@@ -721,6 +732,7 @@ SPAN_DECLARE(data_modems_state_t *) data_modems_init(data_modems_state_t *s,
 
 SPAN_DECLARE(int) data_modems_release(data_modems_state_t *s)
 {
+    v42bis_release(&s->v42bis);
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
@@ -728,7 +740,10 @@ SPAN_DECLARE(int) data_modems_release(data_modems_state_t *s)
 SPAN_DECLARE(int) data_modems_free(data_modems_state_t *s)
 {
     if (s)
+    {
+        data_modems_release(s);
         span_free(s);
+    }
     /*endif*/
     return 0;
 }
@@ -528,6 +528,8 @@ SPAN_DECLARE(fax_state_t *) fax_init(fax_state_t *s, bool calling_party)
                     t30_non_ecm_get_bit,
                     tone_detected,
                     &s->t30);
+    fax_modems_set_put_bits(&s->modems, t30_non_ecm_put_bits, &s->t30);
+    fax_modems_set_get_bits(&s->modems, t30_non_ecm_get_bits, &s->t30);
     t30_init(&s->t30,
              calling_party,
              fax_set_rx_type,
@@ -376,8 +376,12 @@ SPAN_DECLARE(void) fax_modems_start_fast_modem(fax_modems_state_t *s, int which,
 {
     span_put_bit_func_t put_bit;
     span_get_bit_func_t get_bit;
+    span_put_bits_func_t put_bits;
+    span_get_bits_func_t get_bits;
     void *get_bit_user_data;
     void *put_bit_user_data;
+    void *get_bits_user_data;
+    void *put_bits_user_data;
 
     s->bit_rate = bit_rate;
     if (hdlc_mode)
@@ -386,6 +390,10 @@ SPAN_DECLARE(void) fax_modems_start_fast_modem(fax_modems_state_t *s, int which,
         get_bit_user_data = (void *) &s->hdlc_tx;
         put_bit = (span_put_bit_func_t) hdlc_rx_put_bit;
         put_bit_user_data = (void *) &s->hdlc_rx;
+        get_bits = (span_get_bits_func_t) hdlc_tx_get_bits;
+        get_bits_user_data = (void *) &s->hdlc_tx;
+        put_bits = (span_put_bits_func_t) hdlc_rx_put_bits;
+        put_bits_user_data = (void *) &s->hdlc_rx;
         //hdlc_rx_init(&s->hdlc_rx, false, true, HDLC_FRAMING_OK_THRESHOLD, fax_modems_hdlc_accept, s);
     }
     else
@@ -394,6 +402,10 @@ SPAN_DECLARE(void) fax_modems_start_fast_modem(fax_modems_state_t *s, int which,
         get_bit_user_data = s->get_bit_user_data;
         put_bit = s->put_bit;
         put_bit_user_data = s->put_bit_user_data;
+        get_bits = s->get_bits;
+        get_bits_user_data = s->get_bits_user_data;
+        put_bits = s->put_bits;
+        put_bits_user_data = s->put_bits_user_data;
     }
     /*endif*/
 
@@ -408,32 +420,38 @@ SPAN_DECLARE(void) fax_modems_start_fast_modem(fax_modems_state_t *s, int which,
         {
         case FAX_MODEM_V27TER_RX:
             v27ter_rx_init(&s->fast_modems.v27ter_rx, s->bit_rate, put_bit, put_bit_user_data);
+            v27ter_rx_set_put_bits(&s->fast_modems.v27ter_rx, put_bits, put_bits_user_data);
             v27ter_rx_set_modem_status_handler(&s->fast_modems.v27ter_rx, v27ter_rx_status_handler, s);
             fax_modems_set_rx_handler(s, (span_rx_handler_t) &fax_modems_v27ter_v21_rx, s, (span_rx_fillin_handler_t) &fax_modems_v27ter_v21_rx_fillin, s);
             break;
         case FAX_MODEM_V29_RX:
             v29_rx_init(&s->fast_modems.v29_rx, s->bit_rate, put_bit, put_bit_user_data);
+            v29_rx_set_put_bits(&s->fast_modems.v29_rx, put_bits, put_bits_user_data);
             v29_rx_set_signal_cutoff(&s->fast_modems.v29_rx, -45.5f);
             v29_rx_set_modem_status_handler(&s->fast_modems.v29_rx, v29_rx_status_handler, s);
             fax_modems_set_rx_handler(s, (span_rx_handler_t) &fax_modems_v29_v21_rx, s, (span_rx_fillin_handler_t) &fax_modems_v29_v21_rx_fillin, s);
             break;
         case FAX_MODEM_V17_RX:
             v17_rx_init(&s->fast_modems.v17_rx, s->bit_rate, put_bit, put_bit_user_data);
+            v17_rx_set_put_bits(&s->fast_modems.v17_rx, put_bits, put_bits_user_data);
             v17_rx_set_modem_status_handler(&s->fast_modems.v17_rx, v17_rx_status_handler, s);
             fax_modems_set_rx_handler(s, (span_rx_handler_t) &fax_modems_v17_v21_rx, s, (span_rx_fillin_handler_t) &fax_modems_v17_v21_rx_fillin, s);
             break;
         case FAX_MODEM_V27TER_TX:
             v27ter_tx_init(&s->fast_modems.v27ter_tx, s->bit_rate, s->use_tep, get_bit, get_bit_user_data);
+            v27ter_tx_set_get_bits(&s->fast_modems.v27ter_tx, get_bits, get_bits_user_data);
             fax_modems_set_tx_handler(s, (span_tx_handler_t) &v27ter_tx, &s->fast_modems.v27ter_tx);
             fax_modems_set_next_tx_handler(s, (span_tx_handler_t) NULL, NULL);
             break;
         case FAX_MODEM_V29_TX:
             v29_tx_init(&s->fast_modems.v29_tx, s->bit_rate, s->use_tep, get_bit, get_bit_user_data);
+            v29_tx_set_get_bits(&s->fast_modems.v29_tx, get_bits, get_bits_user_data);
             fax_modems_set_tx_handler(s, (span_tx_handler_t) &v29_tx, &s->fast_modems.v29_tx);
             fax_modems_set_next_tx_handler(s, (span_tx_handler_t) NULL, NULL);
             break;
         case FAX_MODEM_V17_TX:
             v17_tx_init(&s->fast_modems.v17_tx, s->bit_rate, s->use_tep, get_bit, get_bit_user_data);
+            v17_tx_set_get_bits(&s->fast_modems.v17_tx, get_bits, get_bits_user_data);
             fax_modems_set_tx_handler(s, (span_tx_handler_t) &v17_tx, &s->fast_modems.v17_tx);
             fax_modems_set_next_tx_handler(s, (span_tx_handler_t) NULL, NULL);
             break;
@@ -460,36 +478,42 @@ SPAN_DECLARE(void) fax_modems_start_fast_modem(fax_modems_state_t *s, int which,
         case FAX_MODEM_V27TER_RX:
             v27ter_rx_restart(&s->fast_modems.v27ter_rx, s->bit_rate, false);
             v27ter_rx_set_put_bit(&s->fast_modems.v27ter_rx, put_bit, put_bit_user_data);
+            v27ter_rx_set_put_bits(&s->fast_modems.v27ter_rx, put_bits, put_bits_user_data);
             v27ter_rx_set_modem_status_handler(&s->fast_modems.v27ter_rx, v27ter_rx_status_handler, s);
             fax_modems_set_rx_handler(s, (span_rx_handler_t) &fax_modems_v27ter_v21_rx, s, (span_rx_fillin_handler_t) &fax_modems_v27ter_v21_rx_fillin, s);
             break;
         case FAX_MODEM_V29_RX:
             v29_rx_restart(&s->fast_modems.v29_rx, s->bit_rate, false);
             v29_rx_set_put_bit(&s->fast_modems.v29_rx, put_bit, put_bit_user_data);
+            v29_rx_set_put_bits(&s->fast_modems.v29_rx, put_bits, put_bits_user_data);
             v29_rx_set_modem_status_handler(&s->fast_modems.v29_rx, v29_rx_status_handler, s);
             fax_modems_set_rx_handler(s, (span_rx_handler_t) &fax_modems_v29_v21_rx, s, (span_rx_fillin_handler_t) &fax_modems_v29_v21_rx_fillin, s);
             break;
         case FAX_MODEM_V17_RX:
             v17_rx_restart(&s->fast_modems.v17_rx, s->bit_rate, s->short_train);
             v17_rx_set_put_bit(&s->fast_modems.v17_rx, put_bit, put_bit_user_data);
+            v17_rx_set_put_bits(&s->fast_modems.v17_rx, put_bits, put_bits_user_data);
             v17_rx_set_modem_status_handler(&s->fast_modems.v17_rx, v17_rx_status_handler, s);
             fax_modems_set_rx_handler(s, (span_rx_handler_t) &fax_modems_v17_v21_rx, s, (span_rx_fillin_handler_t) &fax_modems_v17_v21_rx_fillin, s);
             break;
         case FAX_MODEM_V27TER_TX:
             v27ter_tx_restart(&s->fast_modems.v27ter_tx, s->bit_rate, s->use_tep);
             v27ter_tx_set_get_bit(&s->fast_modems.v27ter_tx, get_bit, get_bit_user_data);
+            v27ter_tx_set_get_bits(&s->fast_modems.v27ter_tx, get_bits, get_bits_user_data);
             fax_modems_set_tx_handler(s, (span_tx_handler_t) &v27ter_tx, &s->fast_modems.v27ter_tx);
             fax_modems_set_next_tx_handler(s, (span_tx_handler_t) NULL, NULL);
             break;
         case FAX_MODEM_V29_TX:
             v29_tx_restart(&s->fast_modems.v29_tx, s->bit_rate, s->use_tep);
             v29_tx_set_get_bit(&s->fast_modems.v29_tx, get_bit, get_bit_user_data);
+            v29_tx_set_get_bits(&s->fast_modems.v29_tx, get_bits, get_bits_user_data);
             fax_modems_set_tx_handler(s, (span_tx_handler_t) &v29_tx, &s->fast_modems.v29_tx);
             fax_modems_set_next_tx_handler(s, (span_tx_handler_t) NULL, NULL);
             break;
         case FAX_MODEM_V17_TX:
             v17_tx_restart(&s->fast_modems.v17_tx, s->bit_rate, s->use_tep, s->short_train);
             v17_tx_set_get_bit(&s->fast_modems.v17_tx, get_bit, get_bit_user_data);
+            v17_tx_set_get_bits(&s->fast_modems.v17_tx, get_bits, get_bits_user_data);
             fax_modems_set_tx_handler(s, (span_tx_handler_t) &v17_tx, &s->fast_modems.v17_tx);
             fax_modems_set_next_tx_handler(s, (span_tx_handler_t) NULL, NULL);
             break;
@@ -517,6 +541,15 @@ SPAN_DECLARE(void) fax_modems_set_put_bit(fax_modems_state_t *s, span_put_bit_fu
 {
     s->put_bit = put_bit;
     s->put_bit_user_data = user_data;
+    s->put_bits = NULL;
+    s->put_bits_user_data = NULL;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(void) fax_modems_set_put_bits(fax_modems_state_t *s, span_put_bits_func_t put_bits, void *user_data)
+{
+    s->put_bits = put_bits;
+    s->put_bits_user_data = user_data;
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -524,6 +557,15 @@ SPAN_DECLARE(void) fax_modems_set_get_bit(fax_modems_state_t *s, span_get_bit_fu
 {
     s->get_bit = get_bit;
     s->get_bit_user_data = user_data;
+    s->get_bits = NULL;
+    s->get_bits_user_data = NULL;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(void) fax_modems_set_get_bits(fax_modems_state_t *s, span_get_bits_func_t get_bits, void *user_data)
+{
+    s->get_bits = get_bits;
+    s->get_bits_user_data = user_data;
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -313,6 +313,20 @@ SPAN_DECLARE(void) hdlc_rx_put_bit(hdlc_rx_state_t *s, int new_bit)
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(void) hdlc_rx_put_bits(hdlc_rx_state_t *s, uint32_t bits, int nbits)
+{
+    int i;
+
+    for (i = 0;  i < nbits;  i++)
+    {
+        s->raw_bit_stream = (s->raw_bit_stream << 1) | ((bits << 8) & 0x100);
+        hdlc_rx_put_bit_core(s);
+        bits >>= 1;
+    }
+    /*endfor*/
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(void) hdlc_rx_put_byte(hdlc_rx_state_t *s, int new_byte)
 {
     int i;
@@ -656,6 +670,29 @@ SPAN_DECLARE(int) hdlc_tx_get_bit(hdlc_tx_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) hdlc_tx_get_bits(hdlc_tx_state_t *s, uint32_t *bits, int nbits)
+{
+    int i;
+
+    *bits = 0;
+    for (i = 0;  i < nbits;  i++)
+    {
+        if (s->bits == 0)
+        {
+            if ((s->byte = hdlc_tx_get_byte(s)) < 0)
+                break;
+            /*endif*/
+            s->bits = 8;
+        }
+        /*endif*/
+        s->bits--;
+        *bits |= (uint32_t) ((s->byte >> s->bits) & 0x01) << i;
+    }
+    /*endfor*/
+    return i;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) hdlc_tx_get(hdlc_tx_state_t *s, uint8_t buf[], size_t max_len)
 {
     size_t i;
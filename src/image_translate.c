@@ -83,7 +83,7 @@
 #include "spandsp/private/t4_rx.h"
 #include "spandsp/private/t4_tx.h"
 
-static int image_colour16_to_colour8_row(uint8_t colour8[], uint16_t colour16[], int pixels)
+static int image_colour16_to_colour8_row(uint8_t colour8[], const uint16_t colour16[], int pixels)
 {
     int i;
 
@@ -94,7 +94,7 @@ static int image_colour16_to_colour8_row(uint8_t colour8[], uint16_t colour16[],
 }
 /*- End of function --------------------------------------------------------*/
 
-static int image_colour16_to_gray16_row(uint16_t gray16[], uint16_t colour16[], int pixels)
+static int image_colour16_to_gray16_row(uint16_t gray16[], const uint16_t colour16[], int pixels)
 {
     int i;
     uint32_t gray;
@@ -109,7 +109,7 @@ static int image_colour16_to_gray16_row(uint16_t gray16[], uint16_t colour16[],
 }
 /*- End of function --------------------------------------------------------*/
 
-static int image_colour16_to_gray8_row(uint8_t gray8[], uint16_t colour16[], int pixels)
+static int image_colour16_to_gray8_row(uint8_t gray8[], const uint16_t colour16[], int pixels)
 {
     int i;
     uint32_t gray;
@@ -124,7 +124,7 @@ static int image_colour16_to_gray8_row(uint8_t gray8[], uint16_t colour16[], int
 }
 /*- End of function --------------------------------------------------------*/
 
-static int image_colour8_to_gray16_row(uint16_t gray16[], uint8_t colour8[], int pixels)
+static int image_colour8_to_gray16_row(uint16_t gray16[], const uint8_t colour8[], int pixels)
 {
     int i;
     uint32_t gray;
@@ -139,7 +139,7 @@ static int image_colour8_to_gray16_row(uint16_t gray16[], uint8_t colour8[], int
 }
 /*- End of function --------------------------------------------------------*/
 
-static int image_colour8_to_gray8_row(uint8_t gray8[], uint8_t colour8[], int pixels)
+static int image_colour8_to_gray8_row(uint8_t gray8[], const uint8_t colour8[], int pixels)
 {
     int i;
     uint32_t gray;
@@ -154,7 +154,7 @@ static int image_colour8_to_gray8_row(uint8_t gray8[], uint8_t colour8[], int pi
 }
 /*- End of function --------------------------------------------------------*/
 
-static int image_colour8_to_colour16_row(uint16_t colour16[], uint8_t colour8[], int pixels)
+static int image_colour8_to_colour16_row(uint16_t colour16[], const uint8_t colour8[], int pixels)
 {
     int i;
 
@@ -165,37 +165,41 @@ static int image_colour8_to_colour16_row(uint16_t colour16[], uint8_t colour8[],
 }
 /*- End of function --------------------------------------------------------*/
 
-static int image_gray16_to_colour16_row(uint16_t colour16[], uint16_t gray16[], int pixels)
+static int image_gray16_to_colour16_row(uint16_t colour16[], const uint16_t gray16[], int pixels)
 {
     int i;
+    uint32_t gray;
 
     for (i = pixels - 1;  i >= 0;  i--)
     {
-        colour16[3*i] = saturateu16((gray16[i]*36532U) >> 15);
-        colour16[3*i + 1] = saturateu16((gray16[i]*37216U) >> 16);
-        colour16[3*i + 2] = saturateu16((gray16[i]*47900U) >> 14);
+        gray = gray16[i];
+        colour16[3*i] = saturateu16((gray*36532U) >> 15);
+        colour16[3*i + 1] = saturateu16((gray*37216U) >> 16);
+        colour16[3*i + 2] = saturateu16((gray*47900U) >> 14);
     }
     /*endfor*/
     return pixels;
 }
 /*- End of function --------------------------------------------------------*/
 
-static int image_gray16_to_colour8_row(uint8_t colour8[], uint16_t gray16[], int pixels)
+static int image_gray16_to_colour8_row(uint8_t colour8[], const uint16_t gray16[], int pixels)
 {
     int i;
+    uint32_t gray;
 
     for (i = pixels - 1;  i >= 0;  i--)
     {
-        colour8[3*i] = saturateu8((gray16[i]*36532U) >> 23);
-        colour8[3*i + 1] = saturateu8((gray16[i]*37216U) >> 24);
-        colour8[3*i + 2] = saturateu8((gray16[i]*47900U) >> 22);
+        gray = gray16[i];
+        colour8[3*i] = saturateu8((gray*36532U) >> 23);
+        colour8[3*i + 1] = saturateu8((gray*37216U) >> 24);
+        colour8[3*i + 2] = saturateu8((gray*47900U) >> 22);
     }
     /*endfor*/
     return pixels;
 }
 /*- End of function --------------------------------------------------------*/
 
-static int image_gray16_to_gray8_row(uint8_t gray8[], uint16_t gray16[], int pixels)
+static int image_gray16_to_gray8_row(uint8_t gray8[], const uint16_t gray16[], int pixels)
 {
     int i;
 
@@ -206,37 +210,41 @@ static int image_gray16_to_gray8_row(uint8_t gray8[], uint16_t gray16[], int pix
 }
 /*- End of function --------------------------------------------------------*/
 
-static int image_gray8_to_colour16_row(uint16_t colour16[], uint8_t gray8[], int pixels)
+static int image_gray8_to_colour16_row(uint16_t colour16[], const uint8_t gray8[], int pixels)
 {
     int i;
+    uint32_t gray;
 
     for (i = pixels - 1;  i >= 0;  i--)
     {
-        colour16[3*i] = saturateu16((gray8[i]*36532U) >> 7);
-        colour16[3*i + 1] = saturateu16((gray8[i]*37216U) >> 8);
-        colour16[3*i + 2] = saturateu16((gray8[i]*47900U) >> 6);
+        gray = gray8[i];
+        colour16[3*i] = saturateu16((gray*36532U) >> 7);
+        colour16[3*i + 1] = saturateu16((gray*37216U) >> 8);
+        colour16[3*i + 2] = saturateu16((gray*47900U) >> 6);
     }
     /*endfor*/
     return pixels;
 }
 /*- End of function --------------------------------------------------------*/
 
-static int image_gray8_to_colour8_row(uint8_t colour8[], uint8_t gray8[], int pixels)
+static int image_gray8_to_colour8_row(uint8_t colour8[], const uint8_t gray8[], int pixels)
 {
     int i;
+    uint32_t gray;
 
     for (i = pixels - 1;  i >= 0;  i--)
     {
-        colour8[3*i] = saturateu8((gray8[i]*36532U) >> 15);
-        colour8[3*i + 1] = saturateu8((gray8[i]*37216U) >> 16);
-        colour8[3*i + 2] = saturateu8((gray8[i]*47900U) >> 14);
+        gray = gray8[i];
+        colour8[3*i] = saturateu8((gray*36532U) >> 15);
+        colour8[3*i + 1] = saturateu8((gray*37216U) >> 16);
+        colour8[3*i + 2] = saturateu8((gray*47900U) >> 14);
     }
     /*endfor*/
     return pixels;
 }
 /*- End of function --------------------------------------------------------*/
 
-static int image_gray8_to_gray16_row(uint16_t gray16[], uint8_t gray8[], int pixels)
+static int image_gray8_to_gray16_row(uint16_t gray16[], const uint8_t gray8[], int pixels)
 {
     int i;
 
@@ -247,15 +255,10 @@ static int image_gray8_to_gray16_row(uint16_t gray16[], uint8_t gray8[], int pix
 }
 /*- End of function --------------------------------------------------------*/
 
-static int get_and_scrunch_row(image_translate_state_t *s, uint8_t buf[])
+static void convert_row(image_translate_state_t *s, uint8_t buf[], const uint8_t in[])
 {
-    int input_row_len;
-
-    input_row_len = (*s->row_read_handler)(s->row_read_user_data, buf, s->input_width*s->input_bytes_per_pixel);
-    if (input_row_len != s->input_width*s->input_bytes_per_pixel)
-        return 0;
-    /*endif*/
-    /* Scrunch colour down to gray, or vice versa. Scrunch 16 bit pixels down to 8 bit pixels, or vice versa. */
+    /* Scrunch colour down to gray, or vice versa. Scrunch 16 bit pixels down to 8 bit pixels, or vice versa.
+       The conversions work correctly in place, as well as from one buffer to another. */
     switch (s->input_format)
     {
     case T4_IMAGE_TYPE_GRAY_12BIT:
@@ -263,15 +266,15 @@ static int get_and_scrunch_row(image_translate_state_t *s, uint8_t buf[])
         {
         case T4_IMAGE_TYPE_BILEVEL:
         case T4_IMAGE_TYPE_GRAY_8BIT:
-            image_gray16_to_gray8_row(buf, (uint16_t *) buf, s->input_width);
-            break;
+            image_gray16_to_gray8_row(buf, (const uint16_t *) in, s->input_width);
+            return;
         case T4_IMAGE_TYPE_COLOUR_12BIT:
-            image_gray16_to_colour16_row((uint16_t *) buf, (uint16_t *) buf, s->input_width);
-            break;
+            image_gray16_to_colour16_row((uint16_t *) buf, (const uint16_t *) in, s->input_width);
+            return;
         case T4_IMAGE_TYPE_COLOUR_BILEVEL:
         case T4_IMAGE_TYPE_COLOUR_8BIT:
-            image_gray16_to_colour8_row(buf, (uint16_t *) buf, s->input_width);
-            break;
+            image_gray16_to_colour8_row(buf, (const uint16_t *) in, s->input_width);
+            return;
         }
         /*endswitch*/
         break;
@@ -279,15 +282,15 @@ static int get_and_scrunch_row(image_translate_state_t *s, uint8_t buf[])
         switch (s->output_format)
         {
         case T4_IMAGE_TYPE_GRAY_12BIT:
-            image_gray8_to_gray16_row((uint16_t *) buf, buf, s->input_width);
-            break;
+            image_gray8_to_gray16_row((uint16_t *) buf, in, s->input_width);
+            return;
         case T4_IMAGE_TYPE_COLOUR_12BIT:
-            image_gray8_to_colour16_row((uint16_t *) buf, buf, s->input_width);
-            break;
+            image_gray8_to_colour16_row((uint16_t *) buf, in, s->input_width);
+            return;
         case T4_IMAGE_TYPE_COLOUR_BILEVEL:
         case T4_IMAGE_TYPE_COLOUR_8BIT:
-            image_gray8_to_colour8_row(buf, buf, s->input_width);
-            break;
+            image_gray8_to_colour8_row(buf, in, s->input_width);
+            return;
         }
         /*endswitch*/
         break;
@@ -295,16 +298,16 @@ static int get_and_scrunch_row(image_translate_state_t *s, uint8_t buf[])
         switch (s->output_format)
         {
         case T4_IMAGE_TYPE_GRAY_12BIT:
-            image_colour16_to_gray16_row((uint16_t *) buf, (uint16_t *) buf, s->input_width);
-            break;
+            image_colour16_to_gray16_row((uint16_t *) buf, (const uint16_t *) in, s->input_width);
+            return;
         case T4_IMAGE_TYPE_BILEVEL:
         case T4_IMAGE_TYPE_GRAY_8BIT:
-            image_colour16_to_gray8_row(buf, (uint16_t *) buf, s->input_width);
-            break;
+            image_colour16_to_gray8_row(buf, (const uint16_t *) in, s->input_width);
+            return;
         case T4_IMAGE_TYPE_COLOUR_BILEVEL:
         case T4_IMAGE_TYPE_COLOUR_8BIT:
-            image_colour16_to_colour8_row(buf, (uint16_t *) buf, s->input_width);
-            break;
+            image_colour16_to_colour8_row(buf, (const uint16_t *) in, s->input_width);
+            return;
         }
         /*endswitch*/
         break;
@@ -313,20 +316,118 @@ static int get_and_scrunch_row(image_translate_state_t *s, uint8_t buf[])
         switch (s->output_format)
         {
         case T4_IMAGE_TYPE_GRAY_12BIT:
-            image_colour8_to_gray16_row((uint16_t *) buf, buf, s->input_width);
-            break;
+            image_colour8_to_gray16_row((uint16_t *) buf, in, s->input_width);
+            return;
         case T4_IMAGE_TYPE_BILEVEL:
         case T4_IMAGE_TYPE_GRAY_8BIT:
-            image_colour8_to_gray8_row(buf, buf, s->input_width);
-            break;
+            image_colour8_to_gray8_row(buf, in, s->input_width);
+            return;
         case T4_IMAGE_TYPE_COLOUR_12BIT:
-            image_colour8_to_colour16_row((uint16_t *) buf, buf, s->input_width);
-            break;
+            image_colour8_to_colour16_row((uint16_t *) buf, in, s->input_width);
+            return;
         }
         /*endswitch*/
         break;
     }
     /*endswitch*/
+    /* No conversion is needed */
+    if (buf != in)
+        memcpy(buf, in, s->input_width*s->input_bytes_per_pixel);
+    /*endif*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static const uint8_t *read_strip_row(image_translate_state_t *s)
+{
+    uint8_t *strip;
+    int input_row_len;
+    int max_rows;
+    int size;
+
+    input_row_len = s->input_width*s->input_bytes_per_pixel;
+    if (s->strip_row >= s->strip_rows)
+    {
+        size = T4_STRIP_ROWS*input_row_len;
+        if (size > s->strip_buf_size)
+        {
+            if ((strip = (uint8_t *) span_realloc(s->strip_buf, size)) == NULL)
+                return NULL;
+            /*endif*/
+            s->strip_buf = strip;
+            s->strip_buf_size = size;
+        }
+        /*endif*/
+        if ((max_rows = s->input_length - s->strip_input_rows) > T4_STRIP_ROWS)
+            max_rows = T4_STRIP_ROWS;
+        /*endif*/
+        if (max_rows <= 0)
+            return NULL;
+        /*endif*/
+        s->strip_rows = s->strip_read_handler(s->strip_read_user_data, s->strip_buf, input_row_len, input_row_len, max_rows);
+        if (s->strip_rows <= 0)
+        {
+            s->strip_rows = 0;
+            return NULL;
+        }
+        /*endif*/
+        if (s->strip_rows < max_rows)
+            s->strip_input_rows = s->input_length;
+        else
+            s->strip_rows = max_rows;
+        /*endif*/
+        s->strip_input_rows += s->strip_rows;
+        s->strip_row = 0;
+    }
+    /*endif*/
+    return &s->strip_buf[input_row_len*s->strip_row++];
+}
+/*- End of function --------------------------------------------------------*/
+
+static const uint8_t *read_row(image_translate_state_t *s, uint8_t buf[])
+{
+    const uint8_t *in;
+    int input_row_len;
+
+    if (s->image_source)
+    {
+        /* The whole image is already in memory, so convert straight from there into buf,
+           without the row being copied out first. */
+        if (s->image_source_row >= s->input_length)
+            return NULL;
+        /*endif*/
+        in = s->image_source + s->image_source_row*s->image_source_stride;
+        s->image_source_row++;
+        return in;
+    }
+    /*endif*/
+    if (s->strip_read_handler)
+        return read_strip_row(s);
+    /*endif*/
+    input_row_len = s->input_width*s->input_bytes_per_pixel;
+    if ((*s->row_read_handler)(s->row_read_user_data, buf, input_row_len) != input_row_len)
+        return NULL;
+    /*endif*/
+    return buf;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int get_and_scrunch_row(image_translate_state_t *s, uint8_t buf[])
+{
+    const uint8_t *in;
+
+    if ((in = read_row(s, buf)) == NULL)
+        return 0;
+    /*endif*/
+    convert_row(s, buf, in);
+    return s->output_width;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int skip_row(image_translate_state_t *s, uint8_t buf[])
+{
+    if (read_row(s, buf) == NULL)
+        return 0;
+    /*endif*/
     return s->output_width;
 }
 /*- End of function --------------------------------------------------------*/
@@ -337,7 +438,6 @@ static int image_resize_row(image_translate_state_t *s, uint8_t buf[])
     int j;
     int output_width;
     int output_length;
-    int input_width;
     int input_length;
     int x;
 #if defined(SPANDSP_USE_FIXED_POINT)
@@ -351,13 +451,14 @@ static int image_resize_row(image_translate_state_t *s, uint8_t buf[])
     double int_part;
     double frac_row;
     double frac_col;
-    double width_scaling;
 #endif
-    uint8_t *row8[2];
-    uint16_t *row16[2];
+    const int *col_pixel;
+    const uint8_t *row8[2];
+    const uint16_t *row16[2];
     uint16_t *buf16;
     int row_len;
     int skip;
+    int last;
     uint8_t *p;
 
     if (s->raw_output_row < 0)
@@ -365,18 +466,24 @@ static int image_resize_row(image_translate_state_t *s, uint8_t buf[])
     /*endif*/
     output_width = s->output_width - 1;
     output_length = s->output_length - 1;
-    input_width = s->input_width - 1;
     input_length = s->input_length - 1;
 
     skip = s->raw_output_row*input_length/output_length + 1;
     if (skip >= s->raw_input_row)
     {
+        /* Only the last two rows read are used. When the image is being shrunk, any rows
+           before those are stepped over, without being converted. */
+        last = (skip < input_length)  ?  skip  :  input_length;
         while (skip >= s->raw_input_row)
         {
             if (s->raw_input_row >= s->input_length)
                 break;
             /*endif*/
-            row_len = get_and_scrunch_row(s, s->raw_pixel_row[0]);
+            if (s->raw_input_row < last - 1)
+                row_len = skip_row(s, s->raw_pixel_row[0]);
+            else
+                row_len = get_and_scrunch_row(s, s->raw_pixel_row[0]);
+            /*endif*/
             if (row_len != s->output_width)
             {
                 s->raw_output_row = -1;
@@ -396,9 +503,11 @@ static int image_resize_row(image_translate_state_t *s, uint8_t buf[])
     frac_row = ((s->raw_output_row*256*input_length)/output_length) & 0xFF;
 #else
     frac_row = modf((double) s->raw_output_row*input_length/output_length, &int_part);
-    width_scaling = (double) input_width/output_width;
 #endif
 
+    /* The source pixel and the weighting for each output column were worked out when
+       the translation was started, so each row is just a sweep of multiply-adds. */
+    col_pixel = s->col_pixel;
     switch (s->output_format)
     {
     case T4_IMAGE_TYPE_COLOUR_BILEVEL:
@@ -407,29 +516,21 @@ static int image_resize_row(image_translate_state_t *s, uint8_t buf[])
         row8[1] = s->raw_pixel_row[1];
         for (i = 0;  i < output_width;  i++)
         {
-#if defined(SPANDSP_USE_FIXED_POINT)
-            x = i*256*input_width/output_width;
-            frac_col = x & 0xFF;
-            x >>= 8;
-            x = 3*x;
+            x = 3*col_pixel[i];
+            frac_col = s->col_frac[i];
             for (j = 0;  j < 3;  j++)
             {
+#if defined(SPANDSP_USE_FIXED_POINT)
                 c1 = row8[0][x + j] + (((row8[0][x + j + 3] - row8[0][x + j])*frac_col) >> 8);
                 c2 = row8[1][x + j] + (((row8[1][x + j + 3] - row8[1][x + j])*frac_col) >> 8);
                 buf[3*i + j] = saturateu8(c1 + (((c2 - c1)*frac_row) >> 8));
-            }
-            /*endfor*/
 #else
-            frac_col = modf(width_scaling*i, &int_part);
-            x = 3*int_part;
-            for (j = 0;  j < 3;  j++)
-            {
                 c1 = row8[0][x + j] + (row8[0][x + j + 3] - row8[0][x + j])*frac_col;
                 c2 = row8[1][x + j] + (row8[1][x + j + 3] - row8[1][x + j])*frac_col;
                 buf[3*i + j] = saturateu8(c1 + (c2 - c1)*frac_row);
+#endif
             }
             /*endfor*/
-#endif
         }
         /*endfor*/
         break;
@@ -439,29 +540,21 @@ static int image_resize_row(image_translate_state_t *s, uint8_t buf[])
         buf16 = (uint16_t *) buf;
         for (i = 0;  i < output_width;  i++)
         {
-#if defined(SPANDSP_USE_FIXED_POINT)
-            x = i*256*input_width/output_width;
-            frac_col = x & 0xFF;
-            x >>= 8;
-            x = 3*x;
+            x = 3*col_pixel[i];
+            frac_col = s->col_frac[i];
             for (j = 0;  j < 3;  j++)
             {
+#if defined(SPANDSP_USE_FIXED_POINT)
                 c1 = row16[0][x + j] + (((row16[0][x + j + 3] - row16[0][x + j])*frac_col) >> 8);
                 c2 = row16[1][x + j] + (((row16[1][x + j + 3] - row16[1][x + j])*frac_col) >> 8);
                 buf16[3*i + j] = saturateu16(c1 + (((c2 - c1)*frac_row) >> 8));
-            }
-            /*endfor*/
 #else
-            frac_col = modf(width_scaling*i, &int_part);
-            x = 3*int_part;
-            for (j = 0;  j < 3;  j++)
-            {
                 c1 = row16[0][x + j] + (row16[0][x + j + 3] - row16[0][x + j])*frac_col;
                 c2 = row16[1][x + j] + (row16[1][x + j + 3] - row16[1][x + j])*frac_col;
                 buf16[3*i + j] = saturateu16(c1 + (c2 - c1)*frac_row);
+#endif
             }
             /*endfor*/
-#endif
         }
         /*endfor*/
         break;
@@ -471,16 +564,13 @@ static int image_resize_row(image_translate_state_t *s, uint8_t buf[])
         row8[1] = s->raw_pixel_row[1];
         for (i = 0;  i < output_width;  i++)
         {
+            x = col_pixel[i];
+            frac_col = s->col_frac[i];
 #if defined(SPANDSP_USE_FIXED_POINT)
-            x = i*256*input_width/output_width;
-            frac_col = x & 0xFF;
-            x >>= 8;
             c1 = row8[0][x] + (((row8[0][x + 1] - row8[0][x])*frac_col) >> 8);
             c2 = row8[1][x] + (((row8[1][x + 1] - row8[1][x])*frac_col) >> 8);
             buf[i] = saturateu8(c1 + (((c2 - c1)*frac_row) >> 8));
 #else
-            frac_col = modf(width_scaling*i, &int_part);
-            x = int_part;
             c1 = row8[0][x] + (row8[0][x + 1] - row8[0][x])*frac_col;
             c2 = row8[1][x] + (row8[1][x + 1] - row8[1][x])*frac_col;
             buf[i] = saturateu8(c1 + (c2 - c1)*frac_row);
@@ -493,16 +583,13 @@ static int image_resize_row(image_translate_state_t *s, uint8_t buf[])
         row16[1] = (uint16_t *) s->raw_pixel_row[1];
         for (i = 0;  i < output_width;  i++)
         {
+            x = col_pixel[i];
+            frac_col = s->col_frac[i];
 #if defined(SPANDSP_USE_FIXED_POINT)
-            x = i*256*input_width/output_width;
-            frac_col = x & 0xFF;
-            x >>= 8;
             c1 = row16[0][x] + (((row16[0][x + 1] - row16[0][x])*frac_col) >> 8);
             c2 = row16[1][x] + (((row16[1][x + 1] - row16[1][x])*frac_col) >> 8);
             buf[i] = saturateu8(c1 + (((c2 - c1)*frac_row) >> 8));
 #else
-            frac_col = modf(width_scaling*i, &int_part);
-            x = int_part;
             c1 = row16[0][x] + (row16[0][x + 1] - row16[0][x])*frac_col;
             c2 = row16[1][x] + (row16[1][x + 1] - row16[1][x])*frac_col;
             buf[i] = saturateu8(c1 + (c2 - c1)*frac_row);
@@ -519,24 +606,146 @@ static int image_resize_row(image_translate_state_t *s, uint8_t buf[])
 }
 /*- End of function --------------------------------------------------------*/
 
+static int make_resize_columns(image_translate_state_t *s)
+{
+    int i;
+    int output_width;
+    int input_width;
+#if defined(SPANDSP_USE_FIXED_POINT)
+    int x;
+#else
+    double int_part;
+    double width_scaling;
+#endif
+
+    if (s->col_pixel == NULL)
+    {
+        if ((s->col_pixel = (int *) span_alloc(s->output_width*sizeof(s->col_pixel[0]))) == NULL)
+            return -1;
+        /*endif*/
+    }
+    /*endif*/
+    if (s->col_frac == NULL)
+    {
+        if ((s->col_frac = span_alloc(s->output_width*sizeof(s->col_frac[0]))) == NULL)
+            return -1;
+        /*endif*/
+    }
+    /*endif*/
+    output_width = s->output_width - 1;
+    input_width = s->input_width - 1;
+#if !defined(SPANDSP_USE_FIXED_POINT)
+    width_scaling = (double) input_width/output_width;
+#endif
+    for (i = 0;  i < output_width;  i++)
+    {
+#if defined(SPANDSP_USE_FIXED_POINT)
+        x = i*256*input_width/output_width;
+        s->col_frac[i] = x & 0xFF;
+        s->col_pixel[i] = x >> 8;
+#else
+        s->col_frac[i] = modf(width_scaling*i, &int_part);
+        s->col_pixel[i] = int_part;
+#endif
+    }
+    /*endfor*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 static __inline__ uint8_t find_closest_palette_color(int in)
 {
     return (in >= 128)  ?  255  :  0;
 }
 /*- End of function --------------------------------------------------------*/
 
+static int get_output_row(image_translate_state_t *s, uint8_t buf[])
+{
+    if (s->resize)
+        return image_resize_row(s, buf);
+    /*endif*/
+    return get_and_scrunch_row(s, buf);
+}
+/*- End of function --------------------------------------------------------*/
+
+static int pack_bilevel_row(image_translate_state_t *s, uint8_t buf[], const uint8_t pixels[], const uint8_t threshold[8])
+{
+    int i;
+    int j;
+    int x;
+    int limit;
+    uint8_t xx;
+
+    /* Bit pack the pixel per byte row into a pixel per bit row. A pixel becomes black
+       if it is at or below the threshold for its column. */
+    for (i = 0, x = 0;  x <= s->output_width - 8;  i++, x += 8)
+    {
+        xx = 0;
+        for (j = 0;  j < 8;  j++)
+            xx |= ((pixels[x + j] <= threshold[j])  ?  0x80  :  0) >> j;
+        /*endfor*/
+        buf[i] = xx;
+    }
+    /*endfor*/
+    if (x < s->output_width)
+    {
+        /* Allow for the possibility that the width is not a multiple of 8 */
+        xx = 0;
+        limit = s->output_width - x;
+        for (j = 0;  j < limit;  j++)
+            xx |= ((pixels[x + j] <= threshold[j])  ?  0x80  :  0) >> j;
+        /*endfor*/
+        buf[i++] = xx;
+    }
+    /*endif*/
+    return i;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int ordered_dither_row(image_translate_state_t *s, uint8_t buf[])
+{
+    /* An 8x8 Bayer matrix, scaled to thresholds spread evenly over 0 to 255 */
+    static const uint8_t bayer[8][8] =
+    {
+        {  1, 129,  33, 161,   9, 137,  41, 169},
+        {193,  65, 225,  97, 201,  73, 233, 105},
+        { 49, 177,  17, 145,  57, 185,  25, 153},
+        {241, 113, 209,  81, 249, 121, 217,  89},
+        { 13, 141,  45, 173,   5, 133,  37, 165},
+        {205,  77, 237, 109, 197,  69, 229, 101},
+        { 61, 189,  29, 157,  53, 181,  21, 149},
+        {253, 125, 221,  93, 245, 117, 213,  85}
+    };
+    int y;
+
+    /* Each pixel is simply compared with a threshold which depends on its position, so
+       no state passes from pixel to pixel, or from row to row. */
+    y = s->output_row++;
+    if (get_output_row(s, s->pixel_row[0]) != s->output_width)
+    {
+        s->output_row = -1;
+        return 0;
+    }
+    /*endif*/
+    return pack_bilevel_row(s, buf, s->pixel_row[0], bayer[y & 7]);
+}
+/*- End of function --------------------------------------------------------*/
+
 static int floyd_steinberg_dither_row(image_translate_state_t *s, uint8_t buf[])
 {
+    static const uint8_t threshold[8] =
+    {
+        128, 128, 128, 128, 128, 128, 128, 128
+    };
     int x;
     int y;
     int i;
-    int j;
-    int limit;
     int old_pixel;
     int new_pixel;
     int quant_error;
-    uint8_t xx;
     uint8_t *p;
+    uint8_t *p0;
+    uint8_t *p1;
 
     y = s->output_row++;
     /* This algorithm works over two rows, and outputs the earlier of the two. To
@@ -554,18 +763,8 @@ static int floyd_steinberg_dither_row(image_translate_state_t *s, uint8_t buf[])
         /* If this is the end of the image just ignore that there is now rubbish in pixel_row[1].
            Mark that the end has occurred. This row will be properly output, and the next one
            will fail, with the end of image condition (i.e. returning zero length) */
-        if (s->resize)
-        {
-            if (image_resize_row(s, s->pixel_row[1]) != s->output_width)
-                s->output_row = -1;
-            /*endif*/
-        }
-        else
-        {
-            if (get_and_scrunch_row(s, s->pixel_row[1]) != s->output_width)
-                s->output_row = -1;
-            /*endif*/
-        }
+        if (get_output_row(s, s->pixel_row[1]) != s->output_width)
+            s->output_row = -1;
         /*endif*/
     }
     /*endfor*/
@@ -573,81 +772,70 @@ static int floyd_steinberg_dither_row(image_translate_state_t *s, uint8_t buf[])
        scan, to reduce the grayscale image to pure black and white */
     /* The first and last pixels in each row need special treatment, so we do not
        step outside the row. */
+    /* Work through local pointers. Stores through s->pixel_row[] could alias s itself,
+       which would force the compiler to reload the row pointers after every pixel. */
+    p0 = s->pixel_row[0];
+    p1 = s->pixel_row[1];
     if ((y & 1))
     {
         x = s->output_width - 1;
-        old_pixel = s->pixel_row[0][x];
+        old_pixel = p0[x];
         new_pixel = find_closest_palette_color(old_pixel);
         quant_error = old_pixel - new_pixel;
-        s->pixel_row[0][x + 0] = new_pixel;
-        s->pixel_row[0][x - 1] = saturateu8(s->pixel_row[0][x - 1] + (7*quant_error)/16);
-        s->pixel_row[1][x + 0] = saturateu8(s->pixel_row[1][x + 0] + (5*quant_error)/16);
-        s->pixel_row[1][x - 1] = saturateu8(s->pixel_row[1][x - 1] + (1*quant_error)/16);
+        p0[x + 0] = new_pixel;
+        p0[x - 1] = saturateu8(p0[x - 1] + (7*quant_error)/16);
+        p1[x + 0] = saturateu8(p1[x + 0] + (5*quant_error)/16);
+        p1[x - 1] = saturateu8(p1[x - 1] + (1*quant_error)/16);
         while (--x > 0)
         {
-            old_pixel = s->pixel_row[0][x];
+            old_pixel = p0[x];
             new_pixel = find_closest_palette_color(old_pixel);
             quant_error = old_pixel - new_pixel;
-            s->pixel_row[0][x + 0] = new_pixel;
-            s->pixel_row[0][x - 1] = saturateu8(s->pixel_row[0][x - 1] + (7*quant_error)/16);
-            s->pixel_row[1][x + 1] = saturateu8(s->pixel_row[1][x + 1] + (3*quant_error)/16);
-            s->pixel_row[1][x + 0] = saturateu8(s->pixel_row[1][x + 0] + (5*quant_error)/16);
-            s->pixel_row[1][x - 1] = saturateu8(s->pixel_row[1][x - 1] + (1*quant_error)/16);
+            p0[x + 0] = new_pixel;
+            p0[x - 1] = saturateu8(p0[x - 1] + (7*quant_error)/16);
+            p1[x + 1] = saturateu8(p1[x + 1] + (3*quant_error)/16);
+            p1[x + 0] = saturateu8(p1[x + 0] + (5*quant_error)/16);
+            p1[x - 1] = saturateu8(p1[x - 1] + (1*quant_error)/16);
         }
         /*endwhile*/
-        old_pixel = s->pixel_row[0][x];
+        old_pixel = p0[x];
         new_pixel = find_closest_palette_color(old_pixel);
         quant_error = old_pixel - new_pixel;
-        s->pixel_row[0][x + 0] = new_pixel;
-        s->pixel_row[1][x + 1] = saturateu8(s->pixel_row[1][x + 1] + (3*quant_error)/16);
-        s->pixel_row[1][x + 0] = saturateu8(s->pixel_row[1][x + 0] + (5*quant_error)/16);
+        p0[x + 0] = new_pixel;
+        p1[x + 1] = saturateu8(p1[x + 1] + (3*quant_error)/16);
+        p1[x + 0] = saturateu8(p1[x + 0] + (5*quant_error)/16);
     }
     else
     {
         x = 0;
-        old_pixel = s->pixel_row[0][x];
+        old_pixel = p0[x];
         new_pixel = find_closest_palette_color(old_pixel);
         quant_error = old_pixel - new_pixel;
-        s->pixel_row[0][x + 0] = new_pixel;
-        s->pixel_row[0][x + 1] = saturateu8(s->pixel_row[0][x + 1] + (7*quant_error)/16);
-        s->pixel_row[1][x + 0] = saturateu8(s->pixel_row[1][x + 0] + (5*quant_error)/16);
-        s->pixel_row[1][x + 1] = saturateu8(s->pixel_row[1][x + 1] + (1*quant_error)/16);
+        p0[x + 0] = new_pixel;
+        p0[x + 1] = saturateu8(p0[x + 1] + (7*quant_error)/16);
+        p1[x + 0] = saturateu8(p1[x + 0] + (5*quant_error)/16);
+        p1[x + 1] = saturateu8(p1[x + 1] + (1*quant_error)/16);
         while (++x < s->output_width - 1)
         {
-            old_pixel = s->pixel_row[0][x];
+            old_pixel = p0[x];
             new_pixel = find_closest_palette_color(old_pixel);
             quant_error = old_pixel - new_pixel;
-            s->pixel_row[0][x + 0] = new_pixel;
-            s->pixel_row[0][x + 1] = saturateu8(s->pixel_row[0][x + 1] + (7*quant_error)/16);
-            s->pixel_row[1][x - 1] = saturateu8(s->pixel_row[1][x - 1] + (3*quant_error)/16);
-            s->pixel_row[1][x + 0] = saturateu8(s->pixel_row[1][x + 0] + (5*quant_error)/16);
-            s->pixel_row[1][x + 1] = saturateu8(s->pixel_row[1][x + 1] + (1*quant_error)/16);
+            p0[x + 0] = new_pixel;
+            p0[x + 1] = saturateu8(p0[x + 1] + (7*quant_error)/16);
+            p1[x - 1] = saturateu8(p1[x - 1] + (3*quant_error)/16);
+            p1[x + 0] = saturateu8(p1[x + 0] + (5*quant_error)/16);
+            p1[x + 1] = saturateu8(p1[x + 1] + (1*quant_error)/16);
         }
         /*endwhile*/
-        old_pixel = s->pixel_row[0][x];
+        old_pixel = p0[x];
         new_pixel = find_closest_palette_color(old_pixel);
         quant_error = old_pixel - new_pixel;
-        s->pixel_row[0][x + 0] = new_pixel;
-        s->pixel_row[1][x - 1] = saturateu8(s->pixel_row[1][x - 1] + (3*quant_error)/16);
-        s->pixel_row[1][x + 0] = saturateu8(s->pixel_row[1][x + 0] + (5*quant_error)/16);
+        p0[x + 0] = new_pixel;
+        p1[x - 1] = saturateu8(p1[x - 1] + (3*quant_error)/16);
+        p1[x + 0] = saturateu8(p1[x + 0] + (5*quant_error)/16);
     }
-    /* Now bit pack the pixel per byte row into a pixel per bit row. */
-    for (i = 0, x = 0;  x < s->output_width;  i++, x += 8)
-    {
-        xx = 0;
-        /* Allow for the possibility that the width is not a multiple of 8 */
-        limit = (8 <= s->output_width - x)  ?  8  :  (s->output_width - x);
-        for (j = 0;  j < limit;  j++)
-        {
-            if (s->pixel_row[0][x + j] <= 128)
-                xx |= (1 << (7 - j));
-            /*endif*/
-        }
-        /*endfor*/
-        buf[i] = xx;
-    }
-    /*endfor*/
-    return i;
+    /*endif*/
+    return pack_bilevel_row(s, buf, p0, threshold);
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -662,22 +850,16 @@ SPAN_DECLARE(int) image_translate_row(image_translate_state_t *s, uint8_t buf[],
     case T4_IMAGE_TYPE_BILEVEL:
     case T4_IMAGE_TYPE_COLOUR_BILEVEL:
     case T4_IMAGE_TYPE_4COLOUR_BILEVEL:
-        i = floyd_steinberg_dither_row(s, buf);
+        if (s->dither == IMAGE_TRANSLATE_DITHER_ORDERED)
+            i = ordered_dither_row(s, buf);
+        else
+            i = floyd_steinberg_dither_row(s, buf);
+        /*endif*/
         break;
     default:
         s->output_row++;
-        if (s->resize)
-        {
-            if (image_resize_row(s, buf) != s->output_width)
-                s->output_row = -1;
-            /*endif*/
-        }
-        else
-        {
-            if (get_and_scrunch_row(s, buf) != s->output_width)
-                s->output_row = -1;
-            /*endif*/
-        }
+        if (get_output_row(s, buf) != s->output_width)
+            s->output_row = -1;
         /*endif*/
         if (s->output_row < 0)
             return 0;
@@ -690,6 +872,22 @@ SPAN_DECLARE(int) image_translate_row(image_translate_state_t *s, uint8_t buf[],
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) image_translate_strip(image_translate_state_t *s, uint8_t buf[], size_t len, size_t stride, int max_rows)
+{
+    int rows;
+
+    for (rows = 0;  rows < max_rows;  rows++)
+    {
+        if (image_translate_row(s, buf, len) == 0)
+            break;
+        /*endif*/
+        buf += stride;
+    }
+    /*endfor*/
+    return rows;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) image_translate_get_output_width(image_translate_state_t *s)
 {
     return s->output_width;
@@ -702,10 +900,46 @@ SPAN_DECLARE(int) image_translate_get_output_length(image_translate_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) image_translate_set_dither(image_translate_state_t *s, int dither)
+{
+    switch (dither)
+    {
+    case IMAGE_TRANSLATE_DITHER_FLOYD_STEINBERG:
+    case IMAGE_TRANSLATE_DITHER_ORDERED:
+        s->dither = dither;
+        return 0;
+    }
+    /*endswitch*/
+    return -1;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) image_translate_set_row_read_handler(image_translate_state_t *s, t4_row_read_handler_t row_read_handler, void *row_read_user_data)
 {
     s->row_read_handler = row_read_handler;
     s->row_read_user_data = row_read_user_data;
+    s->strip_read_handler = NULL;
+    s->image_source = NULL;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) image_translate_set_strip_read_handler(image_translate_state_t *s, t4_strip_read_handler_t strip_read_handler, void *strip_read_user_data)
+{
+    s->strip_read_handler = strip_read_handler;
+    s->strip_read_user_data = strip_read_user_data;
+    s->strip_rows = 0;
+    s->strip_row = 0;
+    s->image_source = NULL;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) image_translate_set_image_source(image_translate_state_t *s, const uint8_t image[], int stride)
+{
+    s->image_source = image;
+    s->image_source_stride = (stride > 0)  ?  stride  :  s->input_width*s->input_bytes_per_pixel;
+    s->image_source_row = 0;
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
@@ -768,6 +1002,9 @@ SPAN_DECLARE(int) image_translate_restart(image_translate_state_t *s, int input_
             memset(s->raw_pixel_row[i], 0, raw_row_size);
         }
         /*endfor*/
+        if (make_resize_columns(s))
+            return -1;
+        /*endif*/
     }
     /*endif*/
     switch (s->output_format)
@@ -796,6 +1033,12 @@ SPAN_DECLARE(int) image_translate_restart(image_translate_state_t *s, int input_
     s->raw_input_row = 0;
     s->raw_output_row = 0;
     s->output_row = 0;
+    /* Any in memory source belonged to the previous image */
+    s->image_source = NULL;
+    s->image_source_row = 0;
+    s->strip_rows = 0;
+    s->strip_row = 0;
+    s->strip_input_rows = 0;
 
     return 0;
 }
@@ -868,6 +1111,25 @@ SPAN_DECLARE(int) image_translate_release(image_translate_state_t *s)
             s->pixel_row[i] = NULL;
         }
     }
+    if (s->col_pixel)
+    {
+        span_free(s->col_pixel);
+        s->col_pixel = NULL;
+    }
+    /*endif*/
+    if (s->col_frac)
+    {
+        span_free(s->col_frac);
+        s->col_frac = NULL;
+    }
+    /*endif*/
+    if (s->strip_buf)
+    {
+        span_free(s->strip_buf);
+        s->strip_buf = NULL;
+        s->strip_buf_size = 0;
+    }
+    /*endif*/
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
@@ -40,11 +40,23 @@ typedef struct
     float b;
 } cielab_t;
 
+#define CIELAB_F_STEPS  4096
+#define CIELAB_F_RANGE  2.0f
+
 int main(int argc, char *argv[])
 {
+    static const float m[3][3] =
+    {
+        {0.4124f, 0.3576f, 0.1805f},
+        {0.2126f, 0.7152f, 0.0722f},
+        {0.0193f, 0.1192f, 0.9505f}
+    };
+    char buf[32];
     float r;
+    float t;
     uint8_t srgb;
     int i;
+    int j;
 
     printf("/* THIS FILE WAS AUTOMATICALLY GENERATED - ANY MODIFICATIONS MADE TO THIS\n");
     printf("   FILE MAY BE OVERWRITTEN DURING FUTURE BUILDS OF THE SOFTWARE */\n");
@@ -65,6 +77,28 @@ int main(int argc, char *argv[])
     /*endfor*/
     printf("};\n");
 
+    /* Linear RGB to XYZ is a matrix multiply, so each of R, G and B makes a separate
+       contribution to X, Y and Z, which can be tabulated. */
+    printf("static const float srgb_to_xyz[3][256][3] =\n");
+    printf("{\n");
+    for (j = 0;  j < 3;  j++)
+    {
+        printf("    {\n");
+        for (i = 0;  i < 256;  i++)
+        {
+            r = i/256.0f;
+            r = (r > 0.04045f)  ?  powf((r + 0.055f)/1.055f, 2.4f)  :  r/12.92f;
+            /* Use the linear value exactly as it appears in srgb_to_linear[] */
+            sprintf(buf, "%f", r);
+            r = strtof(buf, NULL);
+            printf("        {%.9ef, %.9ef, %.9ef}%s\n", m[0][j]*r, m[1][j]*r, m[2][j]*r, (i < 255)  ?  ","  :  "");
+        }
+        /*endfor*/
+        printf((j < 2)  ?  "    },\n"  :  "    }\n");
+    }
+    /*endfor*/
+    printf("};\n");
+
     printf("static const uint8_t linear_to_srgb[4096] =\n");
     printf("{\n");
     for (i = 0;  i < 4096;  i++)
@@ -83,6 +117,20 @@ int main(int argc, char *argv[])
     }
     /*endfor*/
     printf("};\n");
+
+    /* The CIELAB f(t) function, for linear interpolation over 0 <= t < 2.0 */
+    printf("#define CIELAB_F_STEPS %d\n", CIELAB_F_STEPS);
+    printf("#define CIELAB_F_RANGE %.1ff\n", CIELAB_F_RANGE);
+    printf("static const float cielab_f[%d] =\n", CIELAB_F_STEPS + 1);
+    printf("{\n");
+    for (i = 0;  i <= CIELAB_F_STEPS;  i++)
+    {
+        t = i*(CIELAB_F_RANGE/CIELAB_F_STEPS);
+        t = (t <= 0.008856f)  ?  (7.787f*t + 0.1379f)  :  cbrtf(t);
+        printf((i < CIELAB_F_STEPS)  ?  "    %.8f,\n"  :  "    %.8f\n", t);
+    }
+    /*endfor*/
+    printf("};\n");
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
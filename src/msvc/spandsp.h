@@ -121,6 +121,7 @@
 #include <spandsp/ssl_fax.h>
 #include <spandsp/t4_rx.h>
 #include <spandsp/t4_tx.h>
+#include <spandsp/t4_convert.h>
 #include <spandsp/image_translate.h>
 #include <spandsp/t4_t6_decode.h>
 #include <spandsp/t4_t6_encode.h>
@@ -141,6 +142,7 @@
 #include <spandsp/t38_non_ecm_buffer.h>
 #include <spandsp/t38_gateway.h>
 #include <spandsp/t38_terminal.h>
+#include <spandsp/udptl.h>
 #include <spandsp/t31.h>
 #include <spandsp/adsi.h>
 #include <spandsp/ademco_contactid.h>
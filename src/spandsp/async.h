@@ -41,6 +41,12 @@ data burst. This is needed to make inherently synchronous modems, like V.22 up t
 V.34, behave like an asynchronous modem, and interface to the "RS232C" world.
 Currently it only supports this for bit stream to character conversion.
 
+Bits may be exchanged one at a time, or as packed groups of up to 32 bits. The
+packed interfaces handle the idle time between characters, and each part of a
+character which fits within the group, in single steps. Parity comes from a
+table shared by all contexts, so framing a character costs a single table look up,
+with the stop bits ORed in from a template set up when a context is initialised.
+
 Soft bit processing is outside the scope of this module. For truly asynchronous
 modems, such as V.21, soft bit processing can produce more robust results, and
 may be preferrable.
@@ -127,6 +133,16 @@ typedef void (*put_bit_func_t)(void *user_data, int bit);   /* For backward comp
 typedef int (*span_get_bit_func_t)(void *user_data);
 typedef int (*get_bit_func_t)(void *user_data);   /* For backward compatibility */
 
+/*! Packed bits put function for data pumps. The bits are packed with the earliest bit in
+    the least significant position. Status changes are not passed through this function. */
+typedef void (*span_put_bits_func_t)(void *user_data, uint32_t bits, int nbits);
+
+/*! Packed bits get function for data pumps. The bits are packed with the earliest bit in
+    the least significant position. The return value is the number of bits supplied. If
+    this is less than the number requested, the data has ended, and the caller should act
+    as if SIG_STATUS_END_OF_DATA had been returned after the bits supplied. */
+typedef int (*span_get_bits_func_t)(void *user_data, uint32_t *bits, int nbits);
+
 /*! Status change callback function for data pumps */
 typedef void (*span_modem_status_func_t)(void *user_data, int status);
 typedef void (*modem_status_func_t)(void *user_data, int status);   /* For backward compatibility */
@@ -179,6 +195,13 @@ SPAN_DECLARE(const char *) signal_status_to_str(int status);
         - SIG_STATUS_END_OF_DATA */
 SPAN_DECLARE(void) async_rx_put_bit(void *user_data, int bit);
 
+/*! Accept a group of bits from a received serial bit stream
+    \brief Accept a group of bits from a received serial bit stream
+    \param user_data An opaque point which must point to a receiver context.
+    \param bits The bits, with the earliest in the least significant position.
+    \param nbits The number of bits. */
+SPAN_DECLARE(void) async_rx_put_bits(void *user_data, uint32_t bits, int nbits);
+
 SPAN_DECLARE(int) async_rx_get_parity_errors(async_rx_state_t *s, bool reset);
 
 SPAN_DECLARE(int) async_rx_get_framing_errors(async_rx_state_t *s, bool reset);
@@ -186,7 +209,7 @@ SPAN_DECLARE(int) async_rx_get_framing_errors(async_rx_state_t *s, bool reset);
 /*! Initialise an asynchronous data receiver context.
     \brief Initialise an asynchronous data receiver context.
     \param s The receiver context.
-    \param data_bits The number of data bits.
+    \param data_bits The number of data bits, from 1 to 9.
     \param parity The type of parity.
     \param stop_bits The number of stop bits.
     \param use_v14 True if V.14 rate adaption processing should be used.
@@ -218,10 +241,19 @@ SPAN_DECLARE(void) async_tx_presend_bits(async_tx_state_t *s, int bits);
             gets the data bytes. */
 SPAN_DECLARE(int) async_tx_get_bit(void *user_data);
 
+/*! Get the next group of bits of a transmitted serial bit stream.
+    \brief Get the next group of bits of a transmitted serial bit stream.
+    \param user_data An opaque point which must point to a transmitter context.
+    \param bits The bits, with the earliest in the least significant position.
+    \param nbits The number of bits wanted.
+    \return The number of bits supplied. This is less than nbits if the routine which
+            gets the data bytes reported the end of the data, or another status. */
+SPAN_DECLARE(int) async_tx_get_bits(void *user_data, uint32_t *bits, int nbits);
+
 /*! Initialise an asynchronous data transmit context.
     \brief Initialise an asynchronous data transmit context.
     \param s The transmitter context.
-    \param data_bits The number of data bit.
+    \param data_bits The number of data bits, from 1 to 9.
     \param parity The type of parity.
     \param stop_bits The number of stop bits.
     \param use_v14 True if V.14 rate adaption processing should be used.
@@ -98,12 +98,14 @@
 #include <spandsp/private/t43.h>
 #include <spandsp/private/t4_rx.h>
 #include <spandsp/private/t4_tx.h>
+#include <spandsp/private/t4_convert.h>
 #include <spandsp/private/t30.h>
 #include <spandsp/private/fax.h>
 #include <spandsp/private/t38_core.h>
 #include <spandsp/private/t38_non_ecm_buffer.h>
 #include <spandsp/private/t38_gateway.h>
 #include <spandsp/private/t38_terminal.h>
+#include <spandsp/private/udptl.h>
 #include <spandsp/private/t31.h>
 #include <spandsp/private/v18.h>
 #include <spandsp/private/adsi.h>
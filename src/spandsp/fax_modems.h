@@ -94,6 +94,22 @@ SPAN_DECLARE(void) fax_modems_set_put_bit(fax_modems_state_t *s, span_put_bit_fu
 
 SPAN_DECLARE(void) fax_modems_set_get_bit(fax_modems_state_t *s, span_get_bit_func_t get_bit, void *user_data);
 
+/*! Set a function which accepts the bits of each received symbol as a group, for use by
+    the fast modems in non-HDLC mode. This is cleared by fax_modems_set_put_bit.
+    \brief Set a put_bits function for the fast modems.
+    \param s The FAX modems context.
+    \param put_bits The callback routine used to handle received groups of bits, or NULL.
+    \param user_data An opaque pointer. */
+SPAN_DECLARE(void) fax_modems_set_put_bits(fax_modems_state_t *s, span_put_bits_func_t put_bits, void *user_data);
+
+/*! Set a function which supplies the bits for each transmitted symbol as a group, for use
+    by the fast modems in non-HDLC mode. This is cleared by fax_modems_set_get_bit.
+    \brief Set a get_bits function for the fast modems.
+    \param s The FAX modems context.
+    \param get_bits The callback routine used to get groups of bits to be transmitted, or NULL.
+    \param user_data An opaque pointer. */
+SPAN_DECLARE(void) fax_modems_set_get_bits(fax_modems_state_t *s, span_get_bits_func_t get_bits, void *user_data);
+
 SPAN_DECLARE(void) fax_modems_set_rx_handler(fax_modems_state_t *s,
                                              span_rx_handler_t rx_handler,
                                              void *rx_user_data,
@@ -162,6 +162,13 @@ SPAN_DECLARE(int) hdlc_rx_get_stats(hdlc_rx_state_t *s,
 */
 SPAN_DECLARE(void) hdlc_rx_put_bit(hdlc_rx_state_t *s, int new_bit);
 
+/*! \brief Put a group of bits of data to an HDLC receiver.
+    \param s A pointer to an HDLC receiver context.
+    \param bits The bits, with the earliest in the least significant position.
+    \param nbits The number of bits.
+*/
+SPAN_DECLARE(void) hdlc_rx_put_bits(hdlc_rx_state_t *s, uint32_t bits, int nbits);
+
 /*! \brief Put a byte of data to an HDLC receiver.
     \param s A pointer to an HDLC receiver context.
     \param new_byte The byte of data.
@@ -252,6 +259,15 @@ SPAN_DECLARE(int) hdlc_tx_abort(hdlc_tx_state_t *s);
 */
 SPAN_DECLARE(int) hdlc_tx_get_bit(hdlc_tx_state_t *s);
 
+/*! \brief Get the next group of bits for transmission.
+    \param s A pointer to an HDLC transmitter context.
+    \param bits The bits, with the earliest in the least significant position.
+    \param nbits The number of bits wanted.
+    \return The number of bits supplied. This is less than nbits if the end of the data
+            was reached.
+*/
+SPAN_DECLARE(int) hdlc_tx_get_bits(hdlc_tx_state_t *s, uint32_t *bits, int nbits);
+
 /*! \brief Get the next byte for transmission.
     \param s A pointer to an HDLC transmitter context.
     \return The next byte for transmission.
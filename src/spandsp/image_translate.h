@@ -46,6 +46,16 @@ to be sent as traditional bi-level FAX pages.
 
 typedef struct image_translate_state_s image_translate_state_t;
 
+/*! The methods which may be used to reduce a gray scale or colour image to bi-level */
+enum
+{
+    /*! Floyd-Steinberg error diffusion. This gives the best looking results, and is the default. */
+    IMAGE_TRANSLATE_DITHER_FLOYD_STEINBERG = 0,
+    /*! Ordered dithering, with an 8x8 Bayer matrix. This is much faster, but the results are
+        coarser, and do not compress as well. */
+    IMAGE_TRANSLATE_DITHER_ORDERED = 1
+};
+
 #if defined(__cplusplus)
 extern "C"
 {
@@ -56,6 +66,15 @@ extern "C"
     \return the length of the row buffer, in bytes */
 SPAN_DECLARE(int) image_translate_row(image_translate_state_t *s, uint8_t buf[], size_t len);
 
+/*! \brief Get the next strip of rows of a translated image.
+    \param s The image translation context.
+    \param buf The buffer for the rows.
+    \param len The length of each row in buf, in bytes.
+    \param stride The distance between the starts of successive rows in buf, in bytes.
+    \param max_rows The maximum number of rows to be produced.
+    \return The number of rows produced. This is less than max_rows only at the end of the image. */
+SPAN_DECLARE(int) image_translate_strip(image_translate_state_t *s, uint8_t buf[], size_t len, size_t stride, int max_rows);
+
 /*! \brief Get the width of the image being produced by an image translation context.
     \param s The image translation context.
     \return The width of the output image, in pixel. */
@@ -74,6 +93,33 @@ SPAN_DECLARE(int) image_translate_get_output_length(image_translate_state_t *s);
     \return 0 for success, else -1. */
 SPAN_DECLARE(int) image_translate_set_row_read_handler(image_translate_state_t *s, t4_row_read_handler_t row_read_handler, void *row_read_user_data);
 
+/*! \brief Set a callback routine which supplies the source image up to T4_STRIP_ROWS rows at
+           a time. This is used instead of the row read callback routine, until a row read
+           callback routine is set again.
+    \param s The image translation context.
+    \param strip_read_handler A callback routine used to pull strips of rows of pixels from the
+           source image into the translation process.
+    \param strip_read_user_data An opaque pointer passed to strip_read_handler
+    \return 0 for success, else -1. */
+SPAN_DECLARE(int) image_translate_set_strip_read_handler(image_translate_state_t *s, t4_strip_read_handler_t strip_read_handler, void *strip_read_user_data);
+
+/*! \brief Take the source image straight from memory, rather than through the row read
+           callback routine. Each row is converted, scaled and dithered in a single pass
+           from the image itself, with no intermediate copy. The source applies until the
+           next restart, or until a row read callback routine is set.
+    \param s The image translation context.
+    \param image The source image, in the input format given when the context was initialised.
+    \param stride The distance between the starts of successive rows, in bytes, or 0 if the
+           rows are packed end to end.
+    \return 0 for success, else -1. */
+SPAN_DECLARE(int) image_translate_set_image_source(image_translate_state_t *s, const uint8_t image[], int stride);
+
+/*! \brief Select the method used to reduce gray scale or colour images to bi-level.
+    \param s The image translation context.
+    \param dither The method - IMAGE_TRANSLATE_DITHER_FLOYD_STEINBERG or IMAGE_TRANSLATE_DITHER_ORDERED.
+    \return 0 for success, else -1. */
+SPAN_DECLARE(int) image_translate_set_dither(image_translate_state_t *s, int dither);
+
 SPAN_DECLARE(int) image_translate_restart(image_translate_state_t *s, int input_length);
 
 /*! \brief Initialise an image translation context for rescaling and squashing a gray scale
@@ -52,6 +52,13 @@ struct async_tx_state_s
     uint16_t frame_in_progress;
     /*! \brief The current bit position within a partially transmitted character. */
     int16_t bitpos;
+
+    /*! \brief The mask applied to a character's parity, to start forming its parity bit. */
+    uint8_t parity_mask;
+    /*! \brief The value XORed with the masked parity, to complete the parity bit. */
+    uint8_t parity_invert;
+    /*! \brief The stop bits, in place above the data and any parity bit, to complete a frame. */
+    uint16_t stop_bits;
 };
 
 /*!
@@ -74,11 +81,17 @@ struct async_rx_state_s
     /*! \brief An opaque pointer passed when calling put_byte. */
     void *user_data;
 
-    /*! \brief A current, partially complete, character. */
+    /*! \brief A current, partially complete, character. The first bit received after the
+               start bit is the least significant. */
     uint16_t frame_in_progress;
     /*! \brief The current bit position within a partially complete character. */
     int16_t bitpos;
 
+    /*! \brief The mask applied to a character's parity, to start forming its parity bit. */
+    uint8_t parity_mask;
+    /*! \brief The value XORed with the masked parity, to complete the parity bit. */
+    uint8_t parity_invert;
+
     /*! A count of the number of parity errors seen. */
     int parity_errors;
     /*! A count of the number of character framing errors seen. */
@@ -111,6 +111,18 @@ struct fax_modems_state_s
     /*! \brief A user specified opaque pointer passed to the get_bit function. */
     void *get_bit_user_data;
 
+    /*! \brief The callback function used to put the bits of each symbol received, as a
+               group, or NULL. */
+    span_put_bits_func_t put_bits;
+    /*! \brief A user specified opaque pointer passed to the put_bits routine. */
+    void *put_bits_user_data;
+
+    /*! \brief The callback function used to get the bits for each symbol to be
+               transmitted, as a group, or NULL. */
+    span_get_bits_func_t get_bits;
+    /*! \brief A user specified opaque pointer passed to the get_bits function. */
+    void *get_bits_user_data;
+
     hdlc_frame_handler_t hdlc_accept;
     void *hdlc_accept_user_data;
 
@@ -42,12 +42,43 @@ struct image_translate_state_s
     int raw_input_row;
     int raw_output_row;
     int output_row;
+    /*! \brief The method used to reduce images to bi-level */
+    int dither;
 
     uint8_t *raw_pixel_row[2];
     uint8_t *pixel_row[2];
 
+    /*! \brief When resizing, the left hand source pixel for each output column */
+    int *col_pixel;
+    /*! \brief When resizing, the weighting of the right hand source pixel for each output column */
+#if defined(SPANDSP_USE_FIXED_POINT)
+    int *col_frac;
+#else
+    double *col_frac;
+#endif
+
     t4_row_read_handler_t row_read_handler;
     void *row_read_user_data;
+    /*! \brief The source of the image when it arrives a strip of rows at a time. When this
+               is set it is used instead of row_read_handler. */
+    t4_strip_read_handler_t strip_read_handler;
+    void *strip_read_user_data;
+    /*! \brief The most recent strip taken from strip_read_handler */
+    uint8_t *strip_buf;
+    int strip_buf_size;
+    /*! \brief The number of rows in strip_buf */
+    int strip_rows;
+    /*! \brief The next row of strip_buf to be used */
+    int strip_row;
+    /*! \brief The total number of rows taken from strip_read_handler */
+    int strip_input_rows;
+
+    /*! \brief The image, when it is already in memory, and the row handler is bypassed */
+    const uint8_t *image_source;
+    /*! \brief The distance between the starts of rows in image_source, in bytes */
+    int image_source_stride;
+    /*! \brief The next row to be taken from image_source */
+    int image_source_row;
 };
 
 #endif
@@ -73,7 +73,9 @@ typedef struct
 
     uint8_t max_tries;
 
-    /* Only used for the reliable channels */
+    /* Only used for the reliable channels. The buffers are allocated to suit the window size
+       and maximum payload bytes currently set for the channel, and are reallocated if those
+       change. tr03_timer is only used for the transmit channels. */
     volatile int buff_in_ptr;
     volatile int buff_acked_out_ptr;
     uint8_t *buff;
@@ -133,35 +135,6 @@ struct sprt_state_s
     } tx;
     /*! \brief Error and flow logging control */
     logging_state_t logging;
-#if defined(SPANDSP_FULLY_DEFINE_SPRT_STATE_T)
-    /* TODO: This stuff is currently defined as the maximum possible sizes. It could be
-             allocated in a more adaptive manner. */
-    /*! \brief The data buffer, sized at the time the structure is created. */
-    /* TODO: make this buffer area adapt, rather than always being the maximum possible
-       size. */
-
-    /* Make these buffers statically as big as they could ever need to be. We may be using
-       smaller windows, or a limited maximum payload, and not need all this buffer space.
-       However, if we change these values after initialisation we could be in trouble if
-       we dynamically allocate just the amount of buffer space we need. */
-    uint8_t tc1_rx_buff[(SPRT_MAX_TC1_WINDOWS_SIZE + 1)*SPRT_MAX_TC1_PAYLOAD_BYTES];
-    uint16_t tc1_rx_buff_len[SPRT_MAX_TC1_WINDOWS_SIZE + 1];
-
-    uint8_t tc2_rx_buff[(SPRT_MAX_TC2_WINDOWS_SIZE + 1)*SPRT_MAX_TC2_PAYLOAD_BYTES];
-    uint16_t tc2_rx_buff_len[SPRT_MAX_TC2_WINDOWS_SIZE + 1];
-
-    /* Make these buffers statically as big as they could ever need to be. We may be using
-       smaller windows, or a limited maximum payload, and not need all this buffer space.
-       However, if we change these values after initialisation we could be in trouble if
-       we dynamically allocate just the amount of buffer space we need. */
-    uint8_t tc1_tx_buff[(SPRT_MAX_TC1_WINDOWS_SIZE + 1)*SPRT_MAX_TC1_PAYLOAD_BYTES];
-    uint16_t tc1_tx_buff_len[SPRT_MAX_TC1_WINDOWS_SIZE + 1];
-    span_timestamp_t tc1_tx_tr03_timer[SPRT_MAX_TC1_WINDOWS_SIZE + 1];
-
-    uint8_t tc2_tx_buff[(SPRT_MAX_TC2_WINDOWS_SIZE + 1)*SPRT_MAX_TC2_PAYLOAD_BYTES];
-    uint16_t tc2_tx_buff_len[SPRT_MAX_TC2_WINDOWS_SIZE + 1];
-    span_timestamp_t tc2_tx_tr03_timer[SPRT_MAX_TC2_WINDOWS_SIZE + 1];
-#endif
 };
 
 /* For packet buffer sizing purposes we need the maximum length of a constructed SPRT packet. */
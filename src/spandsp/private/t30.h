@@ -294,6 +294,13 @@ struct t30_state_s
     int ecm_block;
     /*! \brief The number of frames in the current block number, in ECM mode */
     int ecm_frames;
+    /*! \brief The number of frames of the current block which have already been passed on for
+               decoding, during ECM reception. A block is passed on whole, either when its PPS
+               is accepted, or as soon as a resent frame completes it. */
+    int ecm_frames_delivered;
+    /*! \brief True once a PPS has confirmed the page and block the frames in the ECM buffer
+               belong to, during ECM reception. */
+    bool ecm_block_identified;
     /*! \brief The number of frames sent in the current burst of image transmission, in ECM mode */
     int ecm_frames_this_tx_burst;
     /*! \brief The current ECM frame, during ECM transmission. */
@@ -312,12 +319,30 @@ struct t30_state_s
     char rx_file[256];
     /*! \brief The last page we are prepared accept for a received image file. -1 means no restriction. */
     int rx_stop_page;
+    /*! \brief Callback function to take the TIFF file image of a document received to memory,
+               in place of a named file. NULL if there is none. */
+    t4_rx_tiff_write_handler_t rx_tiff_write_handler;
+    /*! \brief Opaque pointer passed to rx_tiff_write_handler. */
+    void *rx_tiff_write_user_data;
     /*! \brief Image file name to be sent. */
     char tx_file[256];
     /*! \brief The first page to be sent from the image file. -1 means no restriction. */
     int tx_start_page;
     /*! \brief The last page to be sent from the image file. -1 means no restriction. */
     int tx_stop_page;
+    /*! \brief A page index for the image file to be sent, supplied by the application. NULL
+               if there is none. */
+    const t4_tx_page_index_t *tx_page_index;
+    /*! \brief A TIFF file image in memory to be sent, in place of a named file. NULL if there
+               is none. */
+    const uint8_t *tx_memory_buf;
+    /*! \brief The length of the TIFF file image in memory, in bytes. */
+    size_t tx_memory_len;
+    /*! \brief Callback function to supply the pages to be sent already compressed, in place of
+               an image file. NULL if there is none. */
+    t4_tx_pre_encoded_page_handler_t tx_pre_encoded_page_handler;
+    /*! \brief Opaque pointer passed to tx_pre_encoded_page_handler. */
+    void *tx_pre_encoded_page_user_data;
     /*! \brief The current completion status. */
     int current_status;
 
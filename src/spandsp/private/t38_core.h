@@ -37,6 +37,10 @@ struct t38_core_state_s
     t38_tx_packet_handler_t tx_packet_handler;
     /*! \brief An opaque pointer passed to tx_packet_handler */
     void *tx_packet_user_data;
+    /*! \brief Optional handler routine to supply the buffers in which IFP packets are built */
+    t38_tx_buffer_handler_t tx_buffer_handler;
+    /*! \brief An opaque pointer passed to tx_buffer_handler */
+    void *tx_buffer_user_data;
 
     /*! \brief Handler routine to process received indicator packets */
     t38_rx_indicator_handler_t rx_indicator_handler;
@@ -47,6 +47,9 @@ struct lab_params_s
     float x_rn;
     float y_rn;
     float z_rn;
+
+    /* Use the slower direct calculations, rather than the table driven ones */
+    bool precise;
 };
 
 /* State of a working instance of the T.42 JPEG FAX encoder */
@@ -56,6 +59,11 @@ struct t42_encode_state_s
     t4_row_read_handler_t row_read_handler;
     /*! \brief Opaque pointer passed to row_read_handler. */
     void *row_read_user_data;
+    /*! \brief Callback function to read a strip of rows of pixels from the image source.
+               When this is set it is used instead of row_read_handler. */
+    t4_strip_read_handler_t strip_read_handler;
+    /*! \brief Opaque pointer passed to strip_read_handler. */
+    void *strip_read_user_data;
     uint32_t image_width;
     uint32_t image_length;
     uint16_t samples_per_pixel;
@@ -72,20 +80,24 @@ struct t42_encode_state_s
     uint8_t illuminant_code[4];
     int illuminant_colour_temperature;
 
-    /*! \brief The size of the compressed image, in bytes. */
+    /*! \brief The size of the compressed image, in bytes. While the image is being
+               compressed, this is the amount produced so far. */
     int compressed_image_size;
+    /*! \brief The offset in compressed_buf of the next byte to be sent. */
     int compressed_image_ptr;
+    /*! \brief The offset within the compressed image of the start of compressed_buf. */
+    int buf_offset;
+    /*! \brief How far the compression of the current image has progressed. */
+    int stage;
 
     int buf_size;
     uint8_t *compressed_buf;
 
-    FILE *out;
-#if defined(HAVE_OPEN_MEMSTREAM)
-    size_t outsize;
-#endif
     jmp_buf escape;
     char error_message[JMSG_LENGTH_MAX];
     struct jpeg_compress_struct compressor;
+    /*! \brief The libjpeg destination manager, which writes into compressed_buf */
+    struct jpeg_destination_mgr destination;
 
     JSAMPROW scan_line_out;
     JSAMPROW scan_line_in;
@@ -101,6 +113,11 @@ struct t42_decode_state_s
     t4_row_write_handler_t row_write_handler;
     /*! An opaque pointer passed to row_write_handler() */
     void *row_write_user_data;
+    /*! A callback routine to handle strips of decoded pixel rows. When this is set
+        it is used instead of row_write_handler. */
+    t4_strip_write_handler_t strip_write_handler;
+    /*! An opaque pointer passed to strip_write_handler() */
+    void *strip_write_user_data;
     /*! A callback routine to handle decoded comments */
     t4_row_write_handler_t comment_handler;
     /*! An opaque pointer passed to comment_handler() */
@@ -134,10 +151,11 @@ struct t42_decode_state_s
     int buf_size;
     uint8_t *compressed_buf;
 
-    FILE *in;
     jmp_buf escape;
     char error_message[JMSG_LENGTH_MAX];
     struct jpeg_decompress_struct decompressor;
+    /*! \brief The libjpeg source manager, which reads from compressed_buf */
+    struct jpeg_source_mgr source;
 
     /*! Flag that the data to be decoded has run out. */
     int end_of_data;
@@ -33,6 +33,11 @@ struct t43_encode_state_s
     t4_row_read_handler_t row_read_handler;
     /*! \brief Opaque pointer passed to row_read_handler. */
     void *row_read_user_data;
+    /*! \brief Callback function to read a strip of rows of pixels from the image source.
+               When this is set it is used instead of row_read_handler. */
+    t4_strip_read_handler_t strip_read_handler;
+    /*! \brief Opaque pointer passed to strip_read_handler. */
+    void *strip_read_user_data;
 
     struct lab_params_s lab;
     struct t85_encode_state_s t85;
@@ -64,6 +69,11 @@ struct t43_decode_state_s
     t4_row_write_handler_t row_write_handler;
     /*! An opaque pointer passed to row_write_handler() */
     void *row_write_user_data;
+    /*! A callback routine to handle strips of decoded pixel rows. When this is set
+        it is used instead of row_write_handler. */
+    t4_strip_write_handler_t strip_write_handler;
+    /*! An opaque pointer passed to strip_write_handler() */
+    void *strip_write_user_data;
 
     struct lab_params_s lab;
     struct t85_decode_state_s t85;
@@ -84,9 +94,14 @@ struct t43_decode_state_s
     int spatial_resolution;
     int samples_per_pixel;
 
+    /*! The image, as one byte of colour map index per pixel while the bit-planes are being
+        collected, and then in its final form after the colour map has been applied. */
     uint8_t *buf;
-    int ptr;
+    /*! The next row of the current bit-plane */
     int row;
+    /*! For each value of a byte of a bit-plane, the 8 bytes of 0x00 or 0xFF which spread
+        its bits across 8 pixels. */
+    uint64_t plane_spread[256];
 
     /*! \brief Error and flow logging control */
     logging_state_t logging;
@@ -0,0 +1,47 @@
+/*
+ * SpanDSP - a series of DSP components for telephony
+ *
+ * private/t4_convert.h - Offline conversion of multi-page FAX image files
+ *
+ * Copyright (C) 2026 The SpanDSP contributors
+ *
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 2.1,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(_SPANDSP_PRIVATE_T4_CONVERT_H_)
+#define _SPANDSP_PRIVATE_T4_CONVERT_H_
+
+/*!
+    Multi-page FAX image conversion descriptor. The working state of a conversion in
+    progress, including the threads, is kept by t4_convert_run() itself.
+*/
+struct t4_convert_state_s
+{
+    /*! \brief The name of the file to be converted. */
+    const char *in_file;
+    /*! \brief The name of the new file. */
+    const char *out_file;
+    /*! \brief The compression to be used for the new file. */
+    int output_compression;
+    /*! \brief The number of worker threads to use. */
+    int threads;
+
+    /*! \brief Error and flow logging control */
+    logging_state_t logging;
+};
+
+#endif
+/*- End of file ------------------------------------------------------------*/
@@ -37,6 +37,27 @@ typedef struct
     const char *file;
     /*! \brief The libtiff context for the current TIFF file */
     TIFF *tiff_file;
+    /*! \brief True if the TIFF file is being written to memory, rather than to a named file. */
+    bool in_memory;
+    /*! \brief The TIFF file image, when it is being written to memory. */
+    uint8_t *mem_buf;
+    /*! \brief The length of the TIFF file image in memory, in bytes. */
+    size_t mem_len;
+    /*! \brief The current size of the memory buffer, in bytes. */
+    size_t mem_buf_size;
+    /*! \brief The current write position in the TIFF file image in memory. */
+    size_t mem_pos;
+    /*! \brief The start of the part of the TIFF file image in memory which has not yet been
+               passed to the TIFF write handler. */
+    size_t dirty_start;
+    /*! \brief The end of the part of the TIFF file image in memory which has not yet been
+               passed to the TIFF write handler. */
+    size_t dirty_end;
+    /*! \brief The largest the TIFF file image in memory is allowed to grow, in bytes. */
+    size_t mem_limit;
+    /*! \brief True if a write was refused because it would have taken the TIFF file image
+               in memory past mem_limit. */
+    bool mem_limit_reached;
 
     /*! Image type - bilevel, gray, colour */
     int image_type;
@@ -59,6 +80,10 @@ typedef struct
     int image_size;
     /*! \brief The current size of the image buffer. */
     int image_buffer_size;
+
+    /*! \brief A buffer of bi-level rows in run-length form, used when a T.4 or T.6 image is
+               transcoded to T.6 for the file without being expanded to a bitmap. */
+    t4_runs_buffer_t runs;
 } t4_rx_tiff_state_t;
 
 /*!
@@ -73,6 +98,9 @@ typedef struct
     uint32_t image_width;
     /*! \brief The length of the current page, in pixels. */
     uint32_t image_length;
+    /*! \brief The length of the next page, in pixels, when this is known before the page
+               is received, or zero. */
+    uint32_t known_image_length;
     /*! \brief Column-to-column (X) resolution in pixels per metre. */
     int x_resolution;
     /*! \brief Row-to-row (Y) resolution in pixels per metre. */
@@ -109,6 +137,12 @@ struct t4_rx_state_s
     /*! \brief Opaque pointer passed to row_write_handler. */
     void *row_handler_user_data;
 
+    /*! \brief Callback function to stream out the TIFF file image, when it is being written
+               to memory. */
+    t4_rx_tiff_write_handler_t tiff_write_handler;
+    /*! \brief Opaque pointer passed to tiff_write_handler. */
+    void *tiff_write_user_data;
+
     /*! \brief A bit mask of the currently supported image compression modes for writing
                to the TIFF file. */
     int supported_tiff_compressions;
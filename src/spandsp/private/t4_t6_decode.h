@@ -26,6 +26,23 @@
 #if !defined(_SPANDSP_PRIVATE_T4_T6_DECODE_H_)
 #define _SPANDSP_PRIVATE_T4_T6_DECODE_H_
 
+/*!
+    A buffer of bi-level rows in run-length form. Each row is stored as a count of its
+    changing elements, followed by those elements, just as they are passed to a
+    t4_run_write_handler_t.
+*/
+typedef struct
+{
+    /*! \brief The buffer. */
+    uint32_t *buf;
+    /*! \brief The number of entries in use in the buffer. */
+    int len;
+    /*! \brief The current size of the buffer, in entries. */
+    int size;
+    /*! \brief Pointer into the buffer, for playing out the rows. */
+    int ptr;
+} t4_runs_buffer_t;
+
 /*!
     T.4 1D, T4 2D and T6 decompressor state.
 */
@@ -35,6 +52,15 @@ struct t4_t6_decode_state_s
     t4_row_write_handler_t row_write_handler;
     /*! \brief Opaque pointer passed to row_write_handler. */
     void *row_write_user_data;
+    /*! \brief Callback function to write a row of the image destination as run-lengths. */
+    t4_run_write_handler_t run_write_handler;
+    /*! \brief Opaque pointer passed to run_write_handler. */
+    void *run_write_user_data;
+    /*! \brief Callback function to write the image destination a strip of rows at a time.
+               When this is set it is used instead of row_write_handler. */
+    t4_strip_write_handler_t strip_write_handler;
+    /*! \brief Opaque pointer passed to strip_write_handler. */
+    void *strip_write_user_data;
 
     /*! \brief The type of compression used between the FAX machines. */
     int encoding;
@@ -50,6 +76,12 @@ struct t4_t6_decode_state_s
     int row_bits;
     /*! \brief Pointer to the buffer for the current pixel row. */
     uint8_t *row_buf;
+    /*! \brief The rows waiting to be passed to strip_write_handler. */
+    uint8_t *strip_buf;
+    /*! \brief The allocated size of strip_buf, in bytes. */
+    int strip_buf_size;
+    /*! \brief The number of rows in strip_buf. */
+    int strip_rows;
 
     /*! \brief True if we are treating the current row as a 2D encoded one. */
     bool row_is_2d;
@@ -60,6 +92,10 @@ struct t4_t6_decode_state_s
     uint32_t *cur_runs;
     /*! \brief Black and white run-lengths for the reference row. */
     uint32_t *ref_runs;
+    /*! \brief The changing element positions of a row, as passed to run_write_handler. */
+    uint32_t *run_positions;
+    /*! \brief The number of entries in run_positions. */
+    int run_positions_steps;
 
     /*! \brief This variable is used to count the consecutive EOLS we have seen. If it
                reaches six, this is the end of the image. It is initially set to -1 for
@@ -35,6 +35,16 @@ struct t4_t6_encode_state_s
     t4_row_read_handler_t row_read_handler;
     /*! \brief Opaque pointer passed to row_read_handler. */
     void *row_read_user_data;
+    /*! \brief Callback function to read a row of the image source as run-lengths. When
+               this is set it is used in preference to row_read_handler. */
+    t4_run_read_handler_t run_read_handler;
+    /*! \brief Opaque pointer passed to run_read_handler. */
+    void *run_read_user_data;
+    /*! \brief Callback function to read the image source a strip of rows at a time. When
+               this is set it is used in preference to row_read_handler. */
+    t4_strip_read_handler_t strip_read_handler;
+    /*! \brief Opaque pointer passed to strip_read_handler. */
+    void *strip_read_user_data;
 
     /*! \brief The type of compression used. */
     int encoding;
@@ -51,6 +61,17 @@ struct t4_t6_encode_state_s
     /*! \brief The current number of bytes per row of uncompressed image data. */
     int bytes_per_row;
 
+    /*! \brief The strip of rows most recently read through strip_read_handler. */
+    uint8_t *strip_buf;
+    /*! \brief The allocated size of strip_buf, in bytes. */
+    int strip_buf_size;
+    /*! \brief The number of rows in strip_buf. */
+    int strip_rows;
+    /*! \brief The next row to be taken from strip_buf. */
+    int strip_row;
+    /*! \brief True once strip_read_handler has returned a short strip, ending the image. */
+    bool strip_ended;
+
     /*! \brief Number of rows left that can be 2D encoded, before a 1D encoded row
                must be used. */
     int rows_to_next_1d_row;
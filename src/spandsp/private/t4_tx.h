@@ -28,6 +28,45 @@
 
 typedef int (*t4_image_get_handler_t)(void *user_data, uint8_t buf[], size_t len);
 
+/*!
+    The format of one page of a TIFF file, as recorded in a page index.
+*/
+typedef struct
+{
+    /*! \brief The offset of the page's directory in the file. */
+    toff_t dir_offset;
+    /*! \brief The compression type used for the page. */
+    uint16_t compression;
+    /*! \brief The TIFF photometric setting for the page. */
+    uint16_t photo_metric;
+    /*! \brief Image type - bi-level, gray, colour, etc. -1 if the page is of a type
+               we cannot handle. */
+    int image_type;
+    /*! \brief Width of the page, in pixels. */
+    uint32_t image_width;
+    /*! \brief Length of the page, in pixels. */
+    uint32_t image_length;
+    /*! \brief Column-to-column (X) resolution in pixels per metre. */
+    int x_resolution;
+    /*! \brief Row-to-row (Y) resolution in pixels per metre. */
+    int y_resolution;
+} t4_tx_page_info_t;
+
+/*!
+    An index of the pages of a TIFF file, made by a single pass through its directories.
+    Once built it is never changed, so one index may serve any number of T.4 contexts
+    sending the same file.
+*/
+struct t4_tx_page_index_s
+{
+    /*! \brief The number of pages in the file. */
+    int pages;
+    /*! \brief The number of entries allocated in page. */
+    int pages_allocated;
+    /*! \brief The format of each page. */
+    t4_tx_page_info_t *page;
+};
+
 /*!
     TIFF specific state information to go with T.4 compression or decompression handling.
 */
@@ -37,6 +76,13 @@ typedef struct
     const char *file;
     /*! \brief The libtiff context for the current TIFF file */
     TIFF *tiff_file;
+    /*! \brief The TIFF file image, when the file is supplied as a block of memory, rather than
+               by name. */
+    const uint8_t *mem_buf;
+    /*! \brief The length of the TIFF file image in memory, in bytes. */
+    size_t mem_len;
+    /*! \brief The current read position in the TIFF file image in memory. */
+    size_t mem_pos;
 
     /*! \brief The compression type used in the TIFF file */
     uint16_t compression;
@@ -60,6 +106,12 @@ typedef struct
 
     /*! \brief The number of pages in the current image file. */
     int pages_in_file;
+    /*! \brief The index of the pages in the file. This is either local_page_index, or an
+               index supplied by the application. NULL until it is first needed. */
+    const t4_tx_page_index_t *page_index;
+    /*! \brief An index of the pages in the file, built by this context when the application
+               has not supplied one. */
+    t4_tx_page_index_t local_page_index;
 
     /*! \brief A pointer to the image buffer. */
     uint8_t *image_buffer;
@@ -71,6 +123,10 @@ typedef struct
     int row;
     /*! \brief Row counter used when the image is resized or dithered flat. */
     int raw_row;
+
+    /*! \brief A buffer of bi-level rows in run-length form, used when a T.4 or T.6 image can
+               be transcoded without being expanded to a bitmap. */
+    t4_runs_buffer_t runs;
 } t4_tx_tiff_state_t;
 
 /*!
@@ -106,6 +162,8 @@ typedef struct
     int buf_len;
     int buf_ptr;
     int bit;
+    /*! \brief True if buf belongs to the application, rather than being allocated by us. */
+    bool external_buf;
 } no_encoder_state_t;
 
 /*!
@@ -118,6 +176,24 @@ struct t4_tx_state_s
     t4_row_read_handler_t row_handler;
     /*! \brief Opaque pointer passed to row_read_handler. */
     void *row_handler_user_data;
+    /*! \brief Callback function to read a row of the image source as run-lengths, if the
+               source can supply them. This shares row_handler_user_data. */
+    t4_run_read_handler_t run_handler;
+    /*! \brief Callback function to read the image source a strip of rows at a time, if the
+               source can supply them that way. This shares row_handler_user_data. */
+    t4_strip_read_handler_t strip_handler;
+
+    /*! \brief An already compressed page image, supplied by the application, which will be
+               sent as it is. NULL if there is none. */
+    const uint8_t *pre_encoded_buf;
+    /*! \brief The length of the pre-encoded page image, in bytes. */
+    int pre_encoded_len;
+    /*! \brief The compression used for the pre-encoded page image. */
+    int pre_encoded_compression;
+    /*! \brief Callback function to fetch each page of the document pre-encoded. */
+    t4_tx_pre_encoded_page_handler_t pre_encoded_page_handler;
+    /*! \brief Opaque pointer passed to pre_encoded_page_handler. */
+    void *pre_encoded_page_user_data;
 
     /*! \brief When superfine and fine resolution images need to be squahed vertically
                to a lower resolution, this value sets the number of source rows which
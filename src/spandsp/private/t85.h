@@ -54,6 +54,11 @@ struct t85_encode_state_s
     t4_row_read_handler_t row_read_handler;
     /*! \brief Opaque pointer passed to row_read_handler. */
     void *row_read_user_data;
+    /*! \brief Callback function to read the image source a strip of rows at a time. When
+               this is set it is used in preference to row_read_handler. */
+    t4_strip_read_handler_t strip_read_handler;
+    /*! \brief Opaque pointer passed to strip_read_handler. */
+    void *strip_read_user_data;
 
     /*! The number of bit planes. Always 1 for true T.85 */
     uint8_t bit_planes;
@@ -96,6 +101,16 @@ struct t85_encode_state_s
     /*! Pointer to a block of allocated memory 3 rows long, which
         we divide up for the 3 row buffers. */
     uint8_t *row_buf;
+    /*! The strip of rows most recently read through strip_read_handler */
+    uint8_t *strip_buf;
+    /*! The allocated size of strip_buf, in bytes */
+    int strip_buf_size;
+    /*! The number of rows in strip_buf */
+    int strip_rows;
+    /*! The next row to be taken from strip_buf */
+    int strip_row;
+    /*! True once strip_read_handler has returned a short strip, ending the image */
+    bool strip_ended;
     uint8_t *bitstream;
     int bitstream_len;
     int bitstream_iptr;
@@ -119,6 +134,11 @@ struct t85_decode_state_s
     t4_row_write_handler_t row_write_handler;
     /*! An opaque pointer passed to row_write_handler() */
     void *row_write_user_data;
+    /*! A callback routine to handle decoded pixel rows a strip at a time. When this
+        is set it is used instead of row_write_handler() */
+    t4_strip_write_handler_t strip_write_handler;
+    /*! An opaque pointer passed to strip_write_handler() */
+    void *strip_write_user_data;
     /*! A callback routine to handle decoded comments */
     t4_row_write_handler_t comment_handler;
     /*! An opaque pointer passed to comment_handler() */
@@ -157,6 +177,12 @@ struct t85_decode_state_s
     uint8_t *row_buf;
     /*! The length of the row buffer */
     int row_buf_len;
+    /*! The rows waiting to be passed to strip_write_handler() */
+    uint8_t *strip_buf;
+    /*! The allocated size of strip_buf, in bytes */
+    int strip_buf_size;
+    /*! The number of rows in strip_buf */
+    int strip_rows;
     /*! Bytes per pixel row */
     size_t bytes_per_row;
     /*! X-offset of AT pixel */
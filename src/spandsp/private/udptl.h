@@ -0,0 +1,91 @@
+/*
+ * SpanDSP - a series of DSP components for telephony
+ *
+ * private/udptl.h - An implementation of the UDPTL protocol defined in
+ *                   ITU T.38, less the packet exchange part.
+ *
+ * Written by Steve Underwood <steveu@coppice.org>
+ *
+ * Copyright (C) 2009, 2022 Steve Underwood
+ *
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*! \file */
+
+#if !defined(_SPANDSP_PRIVATE_UDPTL_H_)
+#define _SPANDSP_PRIVATE_UDPTL_H_
+
+/*! The number of packets of history kept for each direction, less one. This must be
+    one less than a power of 2. */
+#define UDPTL_BUF_MASK              15
+
+typedef struct
+{
+    int buf_len;
+    uint8_t buf[UDPTL_MAX_DATAGRAM];
+} udptl_fec_tx_buffer_t;
+
+typedef struct
+{
+    int buf_len;
+    uint8_t buf[UDPTL_MAX_DATAGRAM];
+    int fec_len[UDPTL_MAX_FEC_ENTRIES];
+    uint8_t fec[UDPTL_MAX_FEC_ENTRIES][UDPTL_MAX_DATAGRAM];
+    int fec_span;
+    int fec_entries;
+} udptl_fec_rx_buffer_t;
+
+struct udptl_state_s
+{
+    udptl_rx_packet_handler_t rx_packet_handler;
+    void *user_data;
+
+    /*! This option indicates the error correction scheme used in transmitted UDPTL
+        packets. */
+    int error_correction_scheme;
+
+    /*! This option indicates the number of error correction entries transmitted in
+        UDPTL packets. */
+    int error_correction_entries;
+
+    /*! This option indicates the span of the error correction entries in transmitted
+        UDPTL packets (FEC only). */
+    int error_correction_span;
+
+    /*! This option indicates the maximum size of a datagram that can be accepted by
+        the remote device. */
+    int far_max_datagram_size;
+
+    /*! This option indicates the maximum size of a datagram that we are prepared to
+        accept. */
+    int local_max_datagram_size;
+
+    int verbose;
+
+    int tx_seq_no;
+    int rx_seq_no;
+    int rx_expected_seq_no;
+
+    udptl_fec_tx_buffer_t tx[UDPTL_BUF_MASK + 1];
+    udptl_fec_rx_buffer_t rx[UDPTL_BUF_MASK + 1];
+
+    /*! \brief Error and flow logging control */
+    logging_state_t logging;
+};
+
+#endif
+/*- End of file ------------------------------------------------------------*/
@@ -43,6 +43,11 @@ struct v17_tx_state_s
     span_get_bit_func_t get_bit;
     /*! \brief A user specified opaque pointer passed to the get_bit function. */
     void *get_bit_user_data;
+    /*! \brief The callback function used to get the bits for each symbol to be transmitted,
+               as a group. When this is set, it is used for data instead of get_bit. */
+    span_get_bits_func_t get_bits;
+    /*! \brief A user specified opaque pointer passed to the get_bits function. */
+    void *get_bits_user_data;
 
     /*! \brief The callback function used to report modem status changes. */
     span_modem_status_func_t status_handler;
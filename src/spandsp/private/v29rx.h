@@ -48,6 +48,11 @@ struct v29_rx_state_s
     span_put_bit_func_t put_bit;
     /*! \brief A user specified opaque pointer passed to the put_bit routine. */
     void *put_bit_user_data;
+    /*! \brief The callback function used to put the bits of each symbol received, as a
+               group. When this is set, it is used for data instead of put_bit. */
+    span_put_bits_func_t put_bits;
+    /*! \brief A user specified opaque pointer passed to the put_bits routine. */
+    void *put_bits_user_data;
 
     /*! \brief The callback function used to report modem status changes. */
     span_modem_status_func_t status_handler;
@@ -37,10 +37,10 @@ typedef struct
     uint8_t node_octet;
     /*! \brief The parent of this node */
     uint16_t parent;
-    /*! \brief The first child of this node */
-    uint16_t child;
-    /*! \brief The next node at the same depth */
-    uint16_t next;
+    /*! \brief The number of children of this node */
+    uint16_t children;
+    /*! \brief The next node in the same hash chain */
+    uint16_t hash_next;
 } v42bis_dict_node_t;
 
 /*!
@@ -78,11 +78,16 @@ typedef struct
     int v42bis_parm_n2;
     /*! \brief Maximum permitted string length */
     int v42bis_parm_n7;
-    /*! \brief The dictionary */
-    v42bis_dict_node_t dict[V42BIS_MAX_CODEWORDS];
+    /*! \brief The dictionary, of N2 nodes */
+    v42bis_dict_node_t *dict;
+    /*! \brief The heads of the hash chains, which link each non-root dictionary node into
+               the chain selected by its parent and octet value */
+    uint16_t *hash;
+    /*! \brief The number of hash chains, less one. The number of chains is a power of 2. */
+    int hash_mask;
 
-    /*! \brief The octet string in progress */
-    uint8_t string[V42BIS_MAX_STRING_SIZE];
+    /*! \brief The octet string in progress, of up to N7 octets */
+    uint8_t *string;
     /*! \brief The current length of the octet string in progress */
     int string_length;
     /*! \brief The amount of the octet string in progress which has already
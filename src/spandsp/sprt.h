@@ -138,8 +138,20 @@ extern "C" {
     \return A pointer to a short string name for the channel, or NULL for an invalid channel. */
 SPAN_DECLARE(const char *) sprt_transmission_channel_to_str(int channel);
 
+/*! \brief Process the expiry of the timer most recently requested through the timer handler.
+           If a packet has used its last try, SPRT_STATUS_EXCESS_RETRIES is reported through
+           the status handler as the very last step, so the handler may free the context.
+    \param s The SPRT context.
+    \param now The current time.
+    \return 0 for OK. */
 SPAN_DECLARE(int) sprt_timer_expired(sprt_state_t *s, span_timestamp_t now);
 
+/*! \brief Find the time at which sprt_timer_expired() next needs to be called. This is the
+           same time last passed to the timer handler.
+    \param s The SPRT context.
+    \return The time of the earliest pending timeout, or 0 if no timeout is pending. */
+SPAN_DECLARE(span_timestamp_t) sprt_get_next_timeout(sprt_state_t *s);
+
 /*! \brief Process a packet arriving from the far end. If the packet validates as an SPRT
            packet 0 is returned. If the packet does not follow the structure of an SPRT
            packet, or its packet type field does not contain the expected value, -1 is
@@ -578,6 +578,14 @@ SPAN_DECLARE(void) t30_front_end_status(void *user_data, int status);
     \return The next bit to transmit. */
 SPAN_DECLARE(int) t30_non_ecm_get_bit(void *user_data);
 
+/*! Get a group of bits of non-ECM image data to transmit.
+    \brief Get a group of bits of non-ECM image data to transmit.
+    \param user_data An opaque pointer, which must point to the T.30 context.
+    \param bits The bits, with the first to be sent in the least significant position.
+    \param nbits The number of bits wanted.
+    \return The number of bits supplied. This is less than nbits at the end of the data. */
+SPAN_DECLARE(int) t30_non_ecm_get_bits(void *user_data, uint32_t *bits, int nbits);
+
 /*! Get a chunk of received non-ECM image data.
     \brief Get a bit of received non-ECM image data.
     \param user_data An opaque pointer, which must point to the T.30 context.
@@ -592,6 +600,13 @@ SPAN_DECLARE(int) t30_non_ecm_get(void *user_data, uint8_t buf[], int max_len);
     \param bit The received bit. */
 SPAN_DECLARE(void) t30_non_ecm_put_bit(void *user_data, int bit);
 
+/*! Process a group of bits of received non-ECM image data.
+    \brief Process a group of bits of received non-ECM image data
+    \param user_data An opaque pointer, which must point to the T.30 context.
+    \param bits The received bits, with the first received in the least significant position.
+    \param nbits The number of bits. */
+SPAN_DECLARE(void) t30_non_ecm_put_bits(void *user_data, uint32_t bits, int nbits);
+
 /*! Process a chunk of received non-ECM image data.
     \brief Process a chunk of received non-ECM image data
     \param user_data An opaque pointer, which must point to the T.30 context.
@@ -613,6 +628,12 @@ SPAN_DECLARE(void) t30_hdlc_accept(void *user_data, const uint8_t msg[], int len
     \param samples The time change in 1/8000th second steps. */
 SPAN_DECLARE(void) t30_timer_update(t30_state_t *s, int samples);
 
+/*! Find how long it will be before the next T.30 timer expires.
+    \brief Find how long it will be before the next T.30 timer expires.
+    \param s The T.30 context.
+    \return The time until the next expiry, in 1/8000th second steps, or -1 if no timer is running. */
+SPAN_DECLARE(int) t30_timer_next_expiry(t30_state_t *s);
+
 /*! Get the current transfer statistics for the file being sent or received.
     \brief Get the current transfer statistics.
     \param s The T.30 context.
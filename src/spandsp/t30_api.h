@@ -442,6 +442,19 @@ SPAN_DECLARE(const char *) t30_get_rx_model(t30_state_t *s);
     \param stop_page The maximum page to receive. -1 for no restriction. */
 SPAN_DECLARE(void) t30_set_rx_file(t30_state_t *s, const char *file, int stop_page);
 
+/*! Specify that the next document received by a T.30 context is to be built as a TIFF file
+    image in memory, in place of a named file, and streamed out a page at a time through a
+    handler (see t4_rx_set_tiff_write_handler). This keeps file I/O out of the real time path.
+    The image is limited to T4_RX_DEFAULT_MEMORY_LIMIT bytes. If it outgrows that, or the
+    handler does not accept the end of the file, the call ends with T30_ERR_FILEERROR.
+    This replaces any receive file set by t30_set_rx_file.
+    \brief Set next receive document, to memory.
+    \param s The T.30 context.
+    \param handler The handler which takes the TIFF file image. NULL for no document.
+    \param user_data An opaque pointer passed to the handler.
+    \param stop_page The maximum page to receive. -1 for no restriction. */
+SPAN_DECLARE(void) t30_set_rx_memory(t30_state_t *s, t4_rx_tiff_write_handler_t handler, void *user_data, int stop_page);
+
 /*! Specify the file name of the next TIFF file to be transmitted by a T.30
     context.
     \brief Set next transmit file name.
@@ -451,6 +464,41 @@ SPAN_DECLARE(void) t30_set_rx_file(t30_state_t *s, const char *file, int stop_pa
     \param stop_page The last page to send. -1 for no restriction. */
 SPAN_DECLARE(void) t30_set_tx_file(t30_state_t *s, const char *file, int start_page, int stop_page);
 
+/*! Supply a page index, made by t4_tx_page_index_init, for the file set by t30_set_tx_file.
+    This saves the T.30 context scanning the file for itself, and one index may be shared
+    by many contexts sending the same file. Setting a new transmit file clears the index.
+    \brief Set the page index for the transmit file.
+    \param s The T.30 context.
+    \param index The page index. This must remain valid until the document has been sent. */
+SPAN_DECLARE(void) t30_set_tx_page_index(t30_state_t *s, const t4_tx_page_index_t *index);
+
+/*! Specify a TIFF file image held in memory as the next document to be transmitted by a T.30
+    context, in place of a named file. This replaces any transmit file set by t30_set_tx_file.
+    \brief Set next transmit document, from memory.
+    \param s The T.30 context.
+    \param buf The TIFF file image. This must remain valid until the document has been sent.
+    \param len The length of the TIFF file image, in bytes.
+    \param start_page The first page to send. -1 for no restriction.
+    \param stop_page The last page to send. -1 for no restriction. */
+SPAN_DECLARE(void) t30_set_tx_memory(t30_state_t *s, const uint8_t buf[], size_t len, int start_page, int stop_page);
+
+/*! Specify a callback which supplies the pages of the next document to be transmitted by a
+    T.30 context already compressed, in place of an image file. Each page is sent exactly as
+    it is (see t4_tx_set_pre_encoded_page), so the call fails if the far end cannot accept
+    its compression, width and resolution. This replaces any transmit file set by
+    t30_set_tx_file or t30_set_tx_memory.
+    \brief Set next transmit document, as pre-encoded pages.
+    \param s The T.30 context.
+    \param handler The callback function. NULL for no document.
+    \param user_data An opaque pointer passed to the callback function.
+    \param start_page The first page to send. -1 for no restriction.
+    \param stop_page The last page to send. -1 for no restriction. */
+SPAN_DECLARE(void) t30_set_tx_pre_encoded_page_handler(t30_state_t *s,
+                                                       t4_tx_pre_encoded_page_handler_t handler,
+                                                       void *user_data,
+                                                       int start_page,
+                                                       int stop_page);
+
 /*! Set Internet aware FAX (IAF) mode.
     \brief Set Internet aware FAX (IAF) mode.
     \param s The T.30 context.
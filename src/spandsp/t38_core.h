@@ -217,6 +217,11 @@ typedef struct t38_core_state_s t38_core_state_t;
 
 typedef int (*t38_tx_packet_handler_t)(t38_core_state_t *s, void *user_data, const uint8_t *buf, int len, int count);
 
+/*! \brief A handler which supplies a buffer of at least len bytes, in which the next IFP
+           packet to be sent will be built. The same buffer is then passed to the tx packet
+           handler. NULL should be returned if no buffer is available. */
+typedef uint8_t *(*t38_tx_buffer_handler_t)(t38_core_state_t *s, void *user_data, int len);
+
 typedef int (*t38_rx_indicator_handler_t)(t38_core_state_t *s, void *user_data, int indicator);
 typedef int (*t38_rx_data_handler_t)(t38_core_state_t *s, void *user_data, int data_type, int field_type, const uint8_t *buf, int len);
 typedef int (*t38_rx_missing_handler_t)(t38_core_state_t *s, void *user_data, int rx_seq_no, int expected_seq_no);
@@ -276,6 +281,30 @@ SPAN_DECLARE(int) t38_core_send_flags_delay(t38_core_state_t *s, int indicator);
     \return The delay to allow for modem training after this indicator is sent. */
 SPAN_DECLARE(int) t38_core_send_training_delay(t38_core_state_t *s, int indicator);
 
+/*! \brief Encode an indicator IFP packet into a buffer supplied by the caller. Nothing is
+           sent, and the context's sequence number and indicator state are unchanged.
+    \param s The T.38 context.
+    \param buf The buffer for the packet. If this is NULL, nothing is encoded, and the length
+           the packet would have is returned.
+    \param max_len The length of buf.
+    \param indicator The indicator to encode.
+    \return The length of the packet, or -1 if the indicator is invalid or the packet will not
+            fit in max_len bytes. */
+SPAN_DECLARE(int) t38_core_encode_indicator(t38_core_state_t *s, uint8_t buf[], int max_len, int indicator);
+
+/*! \brief Encode a data IFP packet into a buffer supplied by the caller. Nothing is sent, and
+           the context's sequence number is unchanged.
+    \param s The T.38 context.
+    \param buf The buffer for the packet. If this is NULL, nothing is encoded, and the length
+           the packet would have is returned.
+    \param max_len The length of buf.
+    \param data_type The packet's data type.
+    \param field The list of fields.
+    \param fields The number of fields in the list.
+    \return The length of the packet, or -1 if the packet is invalid or will not fit in
+            max_len bytes. */
+SPAN_DECLARE(int) t38_core_encode_data(t38_core_state_t *s, uint8_t buf[], int max_len, int data_type, const t38_data_field_t field[], int fields);
+
 /*! \brief Send a data packet
     \param s The T.38 context.
     \param data_type The packet's data type.
@@ -304,6 +333,18 @@ SPAN_DECLARE(int) t38_core_send_data_multi_field(t38_core_state_t *s, int data_t
     \return 0 for OK, else -1. */
 SPAN_DECLARE(int) t38_core_rx_ifp_packet(t38_core_state_t *s, const uint8_t *buf, int len, uint16_t seq_no);
 
+/*! \brief Process a batch of received T.38 IFP packets from an unreliable packet stream (e.g. UDPTL
+           or RTP), such as all the packets for one T.38 context from a single recvmmsg() call. The
+           packets are put in sequence number order, and redundant copies are dropped, before they
+           are processed, so packets reordered within the batch are not treated as lost.
+    \param s The T.38 context.
+    \param bufs The packet contents.
+    \param lens The lengths of the packet contents.
+    \param seq_nos The packet sequence numbers.
+    \param packets The number of packets.
+    \return The number of packets successfully processed, including dropped repeats. */
+SPAN_DECLARE(int) t38_core_rx_ifp_packets(t38_core_state_t *s, const uint8_t *bufs[], const int lens[], const uint16_t seq_nos[], int packets);
+
 /*! \brief Process a received T.38 IFP packet from a reliable stream (e.g. TCP).
     \param s The T.38 context.
     \param buf The packet contents.
@@ -394,6 +435,14 @@ SPAN_DECLARE(void) t38_set_tep_handling(t38_core_state_t *s, bool allow_for_tep)
 */
 SPAN_DECLARE(void) t38_set_tx_packet_interval(t38_core_state_t *s, int microseconds);
 
+/*! Set a handler to supply the buffers in which transmitted IFP packets are built. Without
+    one, packets are built in a temporary buffer before being passed to the tx packet handler.
+    \param s The T.38 context.
+    \param handler The buffer handler, or NULL to use a temporary buffer.
+    \param user_data An opaque pointer passed to the handler.
+*/
+SPAN_DECLARE(void) t38_set_tx_buffer_handler(t38_core_state_t *s, t38_tx_buffer_handler_t handler, void *user_data);
+
 /*! Get the time between packet transmissions.
     \param s The T.38 context.
 */
@@ -126,6 +126,13 @@ SPAN_DECLARE(void) t38_non_ecm_buffer_report_output_status(t38_non_ecm_buffer_st
     \return The next bit, or one of the values indicating a change of modem status. */
 SPAN_DECLARE(int) t38_non_ecm_buffer_get_bit(void *user_data);
 
+/*! \brief Get the next group of bits of data from a T.38 rate adapting non-ECM buffer context.
+    \param user_data The buffer context, cast to a void pointer.
+    \param bits The bits, with the earliest in the least significant position.
+    \param nbits The number of bits wanted.
+    \return The number of bits supplied. This is less than nbits at the end of the data. */
+SPAN_DECLARE(int) t38_non_ecm_buffer_get_bits(void *user_data, uint32_t *bits, int nbits);
+
 #if defined(__cplusplus)
 }
 #endif
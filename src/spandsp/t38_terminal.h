@@ -62,6 +62,19 @@ extern "C"
 
 SPAN_DECLARE(int) t38_terminal_send_timeout(t38_terminal_state_t *s, int samples);
 
+/*! Find how long the terminal can be left before t38_terminal_send_timeout() must next be called.
+    An application serving many terminals can use this to arm a timer for each one, rather than
+    polling them all at short intervals. The terminal only learns the time through
+    t38_terminal_send_timeout(), so an application working this way should also call that, with
+    the time elapsed since its previous call, before passing each arriving IFP packet to the
+    terminal. The answer can change whenever the terminal is given an arriving IFP packet, or is
+    instructed through its T.30 context, so it should be checked again after those events.
+    \brief Find how long until the terminal next needs servicing.
+    \param s The T.38 context.
+    \return The time until t38_terminal_send_timeout() should next be called, in samples, 0 if it
+            should be called as soon as possible, or -1 if nothing is timed. */
+SPAN_DECLARE(int) t38_terminal_next_send_timeout(t38_terminal_state_t *s);
+
 /*! Set configuration options.
     \brief Set configuration options.
     \param s The T.38 context.
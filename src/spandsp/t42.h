@@ -68,6 +68,13 @@ SPAN_DECLARE(void) srgb_to_lab(lab_params_t *s, uint8_t lab[], const uint8_t srg
     \param pixel The number of pixels in the row. */
 SPAN_DECLARE(void) lab_to_srgb(lab_params_t *s, uint8_t srgb[], const uint8_t lab[], int pixels);
 
+/*! \brief Select between the table driven conversions between sRGB and Lab, which are
+           the default, and slower direct calculation of every pixel. The table driven
+           conversions may occasionally give a result 1 away from the direct calculation.
+    \param s The Lab parameters context.
+    \param precise True to calculate every pixel directly. */
+SPAN_DECLARE(void) set_lab_precise_conversion(lab_params_t *s, bool precise);
+
 SPAN_DECLARE(void) set_lab_illuminant(lab_params_t *s, float new_xn, float new_yn, float new_zn);
 
 SPAN_DECLARE(void) set_lab_gamut(lab_params_t *s, int L_min, int L_max, int a_min, int a_max, int b_min, int b_max, int ab_are_signed);
@@ -95,6 +102,14 @@ SPAN_DECLARE(void) t42_encode_comment(t42_encode_state_t *s, const uint8_t comme
     \return 0 for more data to come. SIG_STATUS_END_OF_DATA for no more data. */
 SPAN_DECLARE(int) t42_encode_image_complete(t42_encode_state_t *s);
 
+/*! \brief Get the next chunk of the current document page. The image is only compressed
+           as far as is needed to fill each chunk, so the first chunks are available long
+           before the whole page has been compressed.
+    \param s The T.42 context.
+    \param buf The buffer into which the chunk is to written.
+    \param max_len The maximum length of the chunk.
+    \return The actual length of the chunk. If this is less than max_len it
+            indicates that the end of the document has been reached. */
 SPAN_DECLARE(int) t42_encode_get(t42_encode_state_t *s, uint8_t buf[], size_t max_len);
 
 SPAN_DECLARE(uint32_t) t42_encode_get_image_width(t42_encode_state_t *s);
@@ -108,6 +123,16 @@ SPAN_DECLARE(int) t42_encode_get_compressed_image_size(t42_encode_state_t *s);
 
 SPAN_DECLARE(int) t42_encode_set_row_read_handler(t42_encode_state_t *s, t4_row_read_handler_t handler, void *user_data);
 
+/*! \brief Set a handler to supply the image up to T4_STRIP_ROWS rows at a time. While a
+           strip handler is set it is used instead of the row handler. The handler may not
+           be changed while an image is being compressed.
+    \param s The T.42 context.
+    \param handler A callback routine to supply strips of image rows, or NULL to go back
+           to reading single rows.
+    \param user_data An opaque pointer passed to handler.
+    \return 0 for OK, or -1 if compression of the image is already under way. */
+SPAN_DECLARE(int) t42_encode_set_strip_read_handler(t42_encode_state_t *s, t4_strip_read_handler_t handler, void *user_data);
+
 /*! Get the logging context associated with a T.42 encode context.
     \brief Get the logging context associated with a T.42 encode context.
     \param s The T.42 encode context.
@@ -162,6 +187,19 @@ SPAN_DECLARE(int) t42_decode_set_row_write_handler(t42_decode_state_t *s,
                                                    t4_row_write_handler_t handler,
                                                    void *user_data);
 
+/*! \brief Set the strip handler routine. This passes on the decoded image T4_STRIP_ROWS
+           rows at a time, and any remaining rows at the end of the image. The handler is
+           then called with rows set to zero, to mark the end of the image. While a strip
+           handler is set it is used instead of the row handler.
+    \param s The T.42 context.
+    \param handler A callback routine to handle strips of decoded image rows, or NULL to
+           go back to handling single rows.
+    \param user_data An opaque pointer passed to handler.
+    \return 0 for OK. */
+SPAN_DECLARE(int) t42_decode_set_strip_write_handler(t42_decode_state_t *s,
+                                                     t4_strip_write_handler_t handler,
+                                                     void *user_data);
+
 /*! \brief Set the comment handler routine.
     \param s The T.42 context.
     \param max_comment_len The maximum length of comment to be passed to the handler.
@@ -91,6 +91,17 @@ SPAN_DECLARE(int) t43_encode_set_row_read_handler(t43_encode_state_t *s,
                                                   t4_row_read_handler_t handler,
                                                   void *user_data);
 
+/*! \brief Set a handler to supply the image up to T4_STRIP_ROWS rows at a time. While a
+           strip handler is set it is used instead of the row handler.
+    \param s The T.43 context.
+    \param handler A callback routine to supply strips of image rows, or NULL to go back
+           to reading single rows.
+    \param user_data An opaque pointer passed to handler.
+    \return 0 for OK. */
+SPAN_DECLARE(int) t43_encode_set_strip_read_handler(t43_encode_state_t *s,
+                                                    t4_strip_read_handler_t handler,
+                                                    void *user_data);
+
 /*! Get the logging context associated with a T.43 encode context.
     \brief Get the logging context associated with a T.43 encode context.
     \param s The T.43 encode context.
@@ -145,6 +156,18 @@ SPAN_DECLARE(int) t43_decode_set_row_write_handler(t43_decode_state_t *s,
                                                    t4_row_write_handler_t handler,
                                                    void *user_data);
 
+/*! \brief Set the strip handler routine. The image is passed on T4_STRIP_ROWS rows at a
+           time, with any remaining rows in a final shorter strip. While a strip handler
+           is set it is used instead of the row handler.
+    \param s The T.43 context.
+    \param handler A callback routine to handle strips of decoded image rows, or NULL to
+           go back to handling single rows.
+    \param user_data An opaque pointer passed to handler.
+    \return 0 for OK. */
+SPAN_DECLARE(int) t43_decode_set_strip_write_handler(t43_decode_state_t *s,
+                                                     t4_strip_write_handler_t handler,
+                                                     void *user_data);
+
 /*! \brief Set the comment handler routine.
     \param s The T.43 context.
     \param max_comment_len The maximum length of comment to be passed to the handler.
@@ -0,0 +1,107 @@
+/*
+ * SpanDSP - a series of DSP components for telephony
+ *
+ * t4_convert.h - Offline conversion of multi-page FAX image files
+ *
+ * Copyright (C) 2026 The SpanDSP contributors
+ *
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 2.1,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*! \file */
+
+#if !defined(_SPANDSP_T4_CONVERT_H_)
+#define _SPANDSP_T4_CONVERT_H_
+
+/*! \page t4_convert_page Multi-page FAX image conversion
+
+\section t4_convert_page_sec_1 What does it do?
+This module converts a multi-page TIFF FAX image file to a new file, with all its pages
+recoded using one of the bi-level FAX compressions (T.4 1D, T.4 2D, T.6 or T.85). Gray-scale
+and colour pages are flattened to bi-level. This is the kind of job needed to put received
+FAXes into an archival format, or to prepare documents for sending. The pages are independent
+of each other, so they are converted concurrently, by a pool of worker threads. The pages
+are always written to the new file in their original order.
+
+\section t4_convert_page_sec_2 How does it work?
+The source file is scanned once, to make an index of its pages, which all the threads share.
+Each worker thread repeatedly claims the next page which has not been started, and uses its
+own T.4 transmit context to go straight to that page, through the index, and encode it. The
+calling thread writes the encoded pages to the new file through a T.4 receive context, as they
+become available, strictly in page order. As the pages are already in the file's compression,
+they are written without being decoded and recoded again. The workers are only allowed a few
+pages ahead of the page being written, so the number of encoded pages held in memory stays
+small, however long the file is.
+
+Where threads are not available, the pages are converted one by one in the calling thread.
+*/
+
+/*!
+    Multi-page FAX image conversion descriptor.
+*/
+typedef struct t4_convert_state_s t4_convert_state_t;
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/*! \brief Set the number of worker threads to be used for a conversion.
+    \param s The conversion context.
+    \param threads The number of threads. Zero, or less, selects one per online processor.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t4_convert_set_threads(t4_convert_state_t *s, int threads);
+
+/*! \brief Convert the file.
+    \param s The conversion context.
+    \return The number of pages written to the new file, or -1 if the conversion failed.
+            If a page fails, the pages before it are still written. */
+SPAN_DECLARE(int) t4_convert_run(t4_convert_state_t *s);
+
+/*! Get the logging context associated with a conversion context.
+    \brief Get the logging context associated with a conversion context.
+    \param s The conversion context.
+    \return A pointer to the logging context */
+SPAN_DECLARE(logging_state_t *) t4_convert_get_logging_state(t4_convert_state_t *s);
+
+/*! \brief Prepare to convert a multi-page TIFF FAX image file.
+    \param s The conversion context.
+    \param in_file The name of the file to be converted.
+    \param out_file The name of the new file.
+    \param output_compression The compression to be used for the new file - T4_COMPRESSION_T4_1D,
+           T4_COMPRESSION_T4_2D, T4_COMPRESSION_T6, T4_COMPRESSION_T85, or T4_COMPRESSION_T85_L0.
+    \return A pointer to the context, or NULL if there was a problem. */
+SPAN_DECLARE(t4_convert_state_t *) t4_convert_init(t4_convert_state_t *s,
+                                                   const char *in_file,
+                                                   const char *out_file,
+                                                   int output_compression);
+
+/*! \brief Release a conversion context.
+    \param s The conversion context.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t4_convert_release(t4_convert_state_t *s);
+
+/*! \brief Free a conversion context.
+    \param s The conversion context.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t4_convert_free(t4_convert_state_t *s);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
+/*- End of file ------------------------------------------------------------*/
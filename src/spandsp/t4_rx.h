@@ -45,6 +45,37 @@ for FAX transmission.
     \return 0 for OK, or non-zero for a problem that requires the image be interrupted. */
 typedef int (*t4_row_write_handler_t)(void *user_data, const uint8_t buf[], size_t len);
 
+/*! This function is a callback from the image decoders, to write the decoded image a strip
+    of several rows at a time. buf holds rows rows, each len bytes long, with each row starting
+    stride bytes after the start of the previous one. A decoder which tells a row write handler
+    about the end of the image, by calling it with len set to zero, tells a strip write handler
+    by calling it with rows set to zero.
+    \return 0 for OK, or non-zero for a problem that requires the image be interrupted. */
+typedef int (*t4_strip_write_handler_t)(void *user_data, const uint8_t buf[], size_t len, size_t stride, int rows);
+
+/*! This function is a callback from the T.4/T.6 decoder, to write the decoded bi-level image,
+    row by row, as run-lengths rather than pixels. runs[] holds the positions of the changing
+    elements in the row. runs[0] is the end of the first (white) run, so it is zero if the row
+    starts with black, and the last entry is always the width of the image. At the end of the
+    image it is called with runs set to NULL and steps set to zero.
+    \return 0 for OK, or non-zero for a problem that requires the image be interrupted. */
+typedef int (*t4_run_write_handler_t)(void *user_data, const uint32_t runs[], int steps);
+
+/*! This function is a callback used when a document is being received to memory, to pass on
+    the parts of the TIFF file image which have been written, page by page, so the application
+    can store them away from the real time processing (e.g. by queueing them for a background
+    thread). buf holds len bytes which belong at the given offset in the file. Most calls append
+    to the file, but earlier parts of the file are sometimes rewritten. buf is only valid for
+    the duration of the call.
+    \return 0 if the data was accepted, or -1 if it could not be accepted now (e.g. because
+            the application's queue is full). Data which is not accepted is offered again, along
+            with anything newer, at the end of the next page. When the document is closed the
+            rest of the file is offered for the last time, and must be accepted. */
+typedef int (*t4_rx_tiff_write_handler_t)(void *user_data, const uint8_t buf[], size_t len, size_t offset);
+
+/*! The default limit on the size of a TIFF file image being received to memory. */
+#define T4_RX_DEFAULT_MEMORY_LIMIT  (64*1024*1024)
+
 /*! Supported compression modes. */
 typedef enum
 {
@@ -411,6 +442,14 @@ SPAN_DECLARE(int) t4_rx_start_page(t4_rx_state_t *s);
     \return Decode status. */
 SPAN_DECLARE(int) t4_rx_put_bit(t4_rx_state_t *s, int bit);
 
+/*! \brief Put a group of bits of the current document page.
+    \param s The T.4 context.
+    \param bits The data bits, with the earliest in the least significant position.
+    \param nbits The number of bits.
+    \return Decode status. Any bits following the one which completed the image are
+            ignored. */
+SPAN_DECLARE(int) t4_rx_put_bits(t4_rx_state_t *s, uint32_t bits, int nbits);
+
 /*! \brief Put a byte of the current document page.
     \param s The T.4 context.
     \param buf The buffer containing the chunk.
@@ -441,6 +480,15 @@ SPAN_DECLARE(int) t4_rx_set_rx_encoding(t4_rx_state_t *s, int encoding);
     \param width The number of pixels across the image. */
 SPAN_DECLARE(void) t4_rx_set_image_width(t4_rx_state_t *s, int width);
 
+/*! \brief Set the length of the next image to be received, in pixel rows, when this is
+           known in advance. A T.4 or T.6 image can then be written to a TIFF file which
+           uses the same compression exactly as it is received, without being decoded and
+           recoded. This only applies to the next page, and must be set before
+           t4_rx_set_rx_encoding is called for that page.
+    \param s The T.4 context.
+    \param length The number of rows in the image. */
+SPAN_DECLARE(void) t4_rx_set_image_length(t4_rx_state_t *s, int length);
+
 /*! \brief Set the row-to-row (y) resolution to expect for a received image.
     \param s The T.4 context.
     \param resolution The resolution, in pixels per metre. */
@@ -513,10 +561,47 @@ SPAN_DECLARE(logging_state_t *) t4_rx_get_logging_state(t4_rx_state_t *s);
     \return A pointer to the context, or NULL if there was a problem. */
 SPAN_DECLARE(t4_rx_state_t *) t4_rx_init(t4_rx_state_t *s, const char *file, int supported_output_compressions);
 
+/*! \brief Prepare for reception of a document, to be stored as a TIFF file image in memory,
+           rather than in a named file. The image is collected with t4_rx_get_memory_image,
+           or streamed out a page at a time through t4_rx_set_tiff_write_handler. libtiff
+           may go back to any part of the file until the document is complete, so the
+           whole image is held in memory, up to the limit set by t4_rx_set_memory_limit.
+    \param s The T.4 context.
+    \param supported_output_compressions The compression schemes supported for output to the TIFF file.
+    \return A pointer to the context, or NULL if there was a problem. */
+SPAN_DECLARE(t4_rx_state_t *) t4_rx_init_to_memory(t4_rx_state_t *s, int supported_output_compressions);
+
+/*! \brief Complete a document being received to memory, and take the resulting TIFF file
+           image. No more pages can be received after this.
+    \param s The T.4 context.
+    \param buf The TIFF file image. This becomes the caller's, and should be freed with
+           span_free. NULL if no pages were received.
+    \param len The length of the TIFF file image, in bytes.
+    \return 0 for success, otherwise -1, if the image could not be completed (e.g. because
+            it outgrew the memory limit, or the TIFF write handler did not accept its end). */
+SPAN_DECLARE(int) t4_rx_get_memory_image(t4_rx_state_t *s, uint8_t **buf, size_t *len);
+
+/*! \brief Set the largest TIFF file image which may be built up in memory for a document
+           being received to memory. A page which would take the image past the limit is not
+           stored, and the document is then treated as incomplete when it is closed.
+    \param s The T.4 context.
+    \param max_len The limit, in bytes. The default is T4_RX_DEFAULT_MEMORY_LIMIT.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t4_rx_set_memory_limit(t4_rx_state_t *s, size_t max_len);
+
+/*! \brief Set a handler to stream out the TIFF file image of a document being received to
+           memory, a page at a time. This allows the file to be written to disc without any
+           file I/O in the real time path.
+    \param s The T.4 context.
+    \param handler A pointer to the handler routine.
+    \param user_data An opaque pointer passed to the handler routine.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t4_rx_set_tiff_write_handler(t4_rx_state_t *s, t4_rx_tiff_write_handler_t handler, void *user_data);
+
 /*! \brief End reception of a document. Tidy up and close the file.
            This should be used to end T.4 reception started with t4_rx_init.
     \param s The T.4 receive context.
-    \return 0 for success, otherwise -1. */
+    \return 0 for success, otherwise -1, if the document could not be stored completely. */
 SPAN_DECLARE(int) t4_rx_release(t4_rx_state_t *s);
 
 /*! \brief End reception of a document. Tidy up, close the file and
@@ -65,6 +65,27 @@ SPAN_DECLARE(int) t4_t6_decode_put(t4_t6_decode_state_t *s, const uint8_t buf[],
     \return 0 for success, otherwise -1. */
 SPAN_DECLARE(int) t4_t6_decode_set_row_write_handler(t4_t6_decode_state_t *s, t4_row_write_handler_t handler, void *user_data);
 
+/*! \brief Set the strip write handler for a T.4/T.6 decode context. This passes on the decoded
+           image T4_STRIP_ROWS rows at a time, and any remaining rows at the end of the image.
+           While a strip write handler is set it is used instead of the row write handler.
+    \param s The T.4/T.6 context.
+    \param handler A pointer to the handler routine, or NULL to go back to writing single rows.
+    \param user_data An opaque pointer passed to the handler routine.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t4_t6_decode_set_strip_write_handler(t4_t6_decode_state_t *s, t4_strip_write_handler_t handler, void *user_data);
+
+/*! \brief Set the run write handler for a T.4/T.6 decode context. This delivers each decoded
+           row as the positions of its changing elements, which is the form the T.4/T.6 encoder
+           works from, so an image can be transcoded without being expanded to a bitmap.
+           It may be used alongside, or instead of, the row write handler. If there is no row
+           write handler the rows are never converted to pixels. A row which cannot be decoded
+           is delivered as a copy of the last good row, just as it is to the row write handler.
+    \param s The T.4/T.6 context.
+    \param handler A pointer to the handler routine, or NULL to stop delivering runs.
+    \param user_data An opaque pointer passed to the handler routine.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t4_t6_decode_set_run_write_handler(t4_t6_decode_state_t *s, t4_run_write_handler_t handler, void *user_data);
+
 /*! \brief Set the encoding for the encoded data.
     \param s The T.4/T.6 context.
     \param encoding The encoding.
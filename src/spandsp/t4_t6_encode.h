@@ -65,6 +65,29 @@ SPAN_DECLARE(int) t4_t6_encode_set_row_read_handler(t4_t6_encode_state_t *s,
                                                     t4_row_read_handler_t handler,
                                                     void *user_data);
 
+/*! \brief Set the strip read handler for a T.4/T.6 encode context. This reads the image
+           T4_STRIP_ROWS rows at a time. While a strip read handler is set it is used
+           instead of the row read handler.
+    \param s The T.4/T.6 context.
+    \param handler A pointer to the handler routine, or NULL to go back to reading single rows.
+    \param user_data An opaque pointer passed to the handler routine.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t4_t6_encode_set_strip_read_handler(t4_t6_encode_state_t *s,
+                                                      t4_strip_read_handler_t handler,
+                                                      void *user_data);
+
+/*! \brief Set the run read handler for a T.4/T.6 encode context. This takes each row as the
+           positions of its changing elements, as delivered by a T.4/T.6 decoder's run write
+           handler, so an image can be transcoded without being expanded to a bitmap. While a
+           run read handler is set it is used instead of the row read handler.
+    \param s The T.4/T.6 context.
+    \param handler A pointer to the handler routine, or NULL to go back to reading rows of pixels.
+    \param user_data An opaque pointer passed to the handler routine.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t4_t6_encode_set_run_read_handler(t4_t6_encode_state_t *s,
+                                                    t4_run_read_handler_t handler,
+                                                    void *user_data);
+
 /*! \brief Set the encoding for the encoded data.
     \param s The T.4/T.6 context.
     \param encoding The encoding.
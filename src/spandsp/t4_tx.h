@@ -33,12 +33,53 @@
     \return len for OK, or zero to indicate the end of the image data. */
 typedef int (*t4_row_read_handler_t)(void *user_data, uint8_t buf[], size_t len);
 
+/*! The number of rows the image encoders and decoders aim to move in each call to a strip
+    read or strip write handler. */
+#define T4_STRIP_ROWS   16
+
+/*! This function is a callback from the image encoders, to read the unencoded image a strip
+    of several rows at a time. Up to max_rows rows, each len bytes long, are placed in buf,
+    with each row starting stride bytes after the start of the previous one. Returning fewer
+    than max_rows rows indicates the image ends with those rows.
+    \return The number of rows placed in buf, or zero to indicate the end of the image data. */
+typedef int (*t4_strip_read_handler_t)(void *user_data, uint8_t buf[], size_t len, size_t stride, int max_rows);
+
+/*! This function is a callback from the T.4/T.6 encoder, to read the unencoded bi-level image,
+    row by row, as run-lengths rather than pixels. runs[] is filled with the positions of the
+    changing elements in the row, in the form described for t4_run_write_handler_t. It may hold
+    up to max_steps entries.
+    \return The number of entries placed in runs[], zero to indicate the end of the image data,
+            or -1 for an error, which also ends the image. */
+typedef int (*t4_run_read_handler_t)(void *user_data, uint32_t runs[], int max_steps);
+
+/*! This function is a callback to the application, to fetch an already compressed bi-level
+    page, when the pages of a document are supplied pre-encoded rather than from a TIFF file.
+    The page's description and image are returned in the same form as the arguments of
+    t4_tx_set_pre_encoded_page. It may be asked about a page more than once, and may be asked
+    about the page after the one being sent, to see if its format is the same.
+    \return 0 if the page exists, otherwise -1. */
+typedef int (*t4_tx_pre_encoded_page_handler_t)(void *user_data,
+                                                int page,
+                                                int *compression,
+                                                int *image_width,
+                                                int *image_length,
+                                                int *resolution_code,
+                                                const uint8_t **buf,
+                                                size_t *len);
+
 /*!
     T.4 FAX compression/decompression descriptor. This defines the working state
     for a single instance of a T.4 FAX compression or decompression channel.
 */
 typedef struct t4_tx_state_s t4_tx_state_t;
 
+/*!
+    T.4 page index descriptor. This holds the format of every page of a TIFF file, found
+    by a single scan of the file, so the pages can be counted, compared and found without
+    going back to the file's directories.
+*/
+typedef struct t4_tx_page_index_s t4_tx_page_index_t;
+
 /* TIFF-FX related extensions to the TIFF tag set */
 
 /*
@@ -267,6 +308,14 @@ SPAN_DECLARE(int) t4_tx_image_complete(t4_tx_state_t *s);
     \return The next bit (i.e. 0 or 1). SIG_STATUS_END_OF_DATA for no more data. */
 SPAN_DECLARE(int) t4_tx_get_bit(t4_tx_state_t *s);
 
+/*! \brief Get the next group of bits of the current document page. The document will
+           be padded for the current minimum scan line time.
+    \param s The T.4 context.
+    \param bits The bits, with the earliest in the least significant position.
+    \param nbits The number of bits wanted.
+    \return The number of bits supplied. This is less than nbits at the end of the data. */
+SPAN_DECLARE(int) t4_tx_get_bits(t4_tx_state_t *s, uint32_t *bits, int nbits);
+
 /*! \brief Get the next chunk of the current document page. The document will
            be padded for the current minimum scan line time.
     \param s The T.4 context.
@@ -376,6 +425,37 @@ SPAN_DECLARE(int) t4_tx_set_row_read_handler(t4_tx_state_t *s, t4_row_read_handl
     \return The number of pages, or -1 if there is an error. */
 SPAN_DECLARE(int) t4_tx_get_pages_in_file(t4_tx_state_t *s);
 
+/*! \brief Use a page index, made by t4_tx_page_index_init, rather than have the context
+           scan the file to build its own. The index must have been made from the same
+           file, and must not be freed until the context is released. An index is never
+           changed once it is made, so it may be shared by any number of contexts, in
+           any number of threads, sending the same file at the same time.
+    \param s The T.4 context.
+    \param index The page index.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t4_tx_set_page_index(t4_tx_state_t *s, const t4_tx_page_index_t *index);
+
+/*! \brief Make an index of the pages in a TIFF file.
+    \param s The page index context.
+    \param file The name of the file.
+    \return A pointer to the context, or NULL if there was a problem. */
+SPAN_DECLARE(t4_tx_page_index_t *) t4_tx_page_index_init(t4_tx_page_index_t *s, const char *file);
+
+/*! \brief Get the number of pages in a page index.
+    \param s The page index context.
+    \return The number of pages. */
+SPAN_DECLARE(int) t4_tx_page_index_get_pages(const t4_tx_page_index_t *s);
+
+/*! \brief Release a page index.
+    \param s The page index context.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t4_tx_page_index_release(t4_tx_page_index_t *s);
+
+/*! \brief Release and free a page index.
+    \param s The page index context.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t4_tx_page_index_free(t4_tx_page_index_t *s);
+
 /*! \brief Get the currnet page number in the file.
     \param s The T.4 context.
     \return The page number, or -1 if there is an error. */
@@ -401,6 +481,74 @@ SPAN_DECLARE(logging_state_t *) t4_tx_get_logging_state(t4_tx_state_t *s);
     \return A pointer to the context, or NULL if there was a problem. */
 SPAN_DECLARE(t4_tx_state_t *) t4_tx_init(t4_tx_state_t *s, const char *file, int start_page, int stop_page);
 
+/*! \brief Prepare for transmission of a document, using a page index, made by
+           t4_tx_page_index_init, rather than have the context scan the file to build
+           its own. Unlike t4_tx_set_page_index, this goes straight to the start page
+           through the index, so starting part way through a long file costs no more
+           than starting at its beginning.
+    \param s The T.4 context.
+    \param file The name of the file to be sent.
+    \param index The page index. This must have been made from the same file, and must
+           not be freed until the context is released.
+    \param start_page The first page to send. -1 for no restriction.
+    \param stop_page The last page to send. -1 for no restriction.
+    \return A pointer to the context, or NULL if there was a problem. */
+SPAN_DECLARE(t4_tx_state_t *) t4_tx_init_with_page_index(t4_tx_state_t *s,
+                                                         const char *file,
+                                                         const t4_tx_page_index_t *index,
+                                                         int start_page,
+                                                         int stop_page);
+
+/*! \brief Prepare for transmission of a document held in memory as a TIFF file image.
+           libtiff works directly from the buffer, so a file the application has already
+           mapped into memory, or a document received over the network, can be sent
+           without first being written to disc.
+    \param s The T.4 context.
+    \param buf The TIFF file image. This must remain valid until the context is released.
+    \param len The length of the TIFF file image, in bytes.
+    \param start_page The first page to send. -1 for no restriction.
+    \param stop_page The last page to send. -1 for no restriction.
+    \return A pointer to the context, or NULL if there was a problem. */
+SPAN_DECLARE(t4_tx_state_t *) t4_tx_init_from_memory(t4_tx_state_t *s, const uint8_t buf[], size_t len, int start_page, int stop_page);
+
+/*! \brief Supply an already compressed bi-level image as the next page to be sent. The
+           image is sent exactly as it is, bypassing both libtiff and the encoder, so
+           no page header can be added to it, and the far end must accept its compression,
+           width and resolution, exactly as they are. This is for use with a context started
+           by t4_tx_init with no file name. It should be called before t4_tx_set_tx_image_format
+           for each page.
+    \param s The T.4 context.
+    \param compression The compression used for the image - T4_COMPRESSION_T4_1D,
+           T4_COMPRESSION_T4_2D, T4_COMPRESSION_T6, T4_COMPRESSION_T85 or
+           T4_COMPRESSION_T85_L0. The image should be exactly as it is to appear on the
+           line, in LSB first bit order, including any RTC or EOFB.
+    \param image_width The width of the image, in pixels.
+    \param image_length The length of the image, in rows.
+    \param resolution_code The resolution of the image (a T4_RESOLUTION_xxx value).
+    \param buf The compressed image. This must remain valid until t4_tx_end_page is called.
+    \param len The length of the compressed image, in bytes.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t4_tx_set_pre_encoded_page(t4_tx_state_t *s,
+                                             int compression,
+                                             int image_width,
+                                             int image_length,
+                                             int resolution_code,
+                                             const uint8_t buf[],
+                                             size_t len);
+
+/*! \brief Set a callback which supplies every page of the document already compressed, as
+           t4_tx_set_pre_encoded_page does for a single page. This lets the pages be fetched
+           as they are needed, and lets t4_tx_next_page_has_different_format look ahead to
+           the next page. This is for use with a context started by t4_tx_init with no file
+           name.
+    \param s The T.4 context.
+    \param handler The callback function.
+    \param user_data An opaque pointer passed to the callback function.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t4_tx_set_pre_encoded_page_handler(t4_tx_state_t *s,
+                                                     t4_tx_pre_encoded_page_handler_t handler,
+                                                     void *user_data);
+
 /*! \brief End the transmission of a document. Tidy up and close the file.
            This should be used to end T.4 transmission started with t4_tx_init.
     \param s The T.4 context.
@@ -89,6 +89,17 @@ SPAN_DECLARE(int) t85_encode_set_row_read_handler(t85_encode_state_t *s,
                                                   t4_row_read_handler_t handler,
                                                   void *user_data);
 
+/*! \brief Set the strip read handler for a T.85 encode context. This reads the image
+           T4_STRIP_ROWS rows at a time. While a strip read handler is set it is used
+           instead of the row read handler.
+    \param s The T.85 context.
+    \param handler A pointer to the handler routine, or NULL to go back to reading single rows.
+    \param user_data An opaque pointer passed to the handler routine.
+    \return 0 for success, otherwise -1. */
+SPAN_DECLARE(int) t85_encode_set_strip_read_handler(t85_encode_state_t *s,
+                                                    t4_strip_read_handler_t handler,
+                                                    void *user_data);
+
 /*! Get the logging context associated with a T.85 encode context.
     \brief Get the logging context associated with a T.85 encode context.
     \param s The T.85 encode context.
@@ -211,6 +222,19 @@ SPAN_DECLARE(int) t85_decode_set_row_write_handler(t85_decode_state_t *s,
                                                    t4_row_write_handler_t handler,
                                                    void *user_data);
 
+/*! \brief Set the strip handler routine. This passes on the decoded image T4_STRIP_ROWS
+           rows at a time, and any remaining rows at the end of the image. While a strip
+           handler is set it is used instead of the row handler. An interrupt requested by
+           the strip handler takes effect at the end of the strip.
+    \param s The T.85 context.
+    \param handler A callback routine to handle strips of decoded image rows, or NULL to
+           go back to handling single rows.
+    \param user_data An opaque pointer passed to handler.
+    \return 0 for OK. */
+SPAN_DECLARE(int) t85_decode_set_strip_write_handler(t85_decode_state_t *s,
+                                                     t4_strip_write_handler_t handler,
+                                                     void *user_data);
+
 /*! \brief Set the comment handler routine.
     \param s The T.85 context.
     \param max_comment_len The maximum length of comment to be passed to the handler.
@@ -24,70 +24,42 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+/*! \file */
+
 #if !defined(_SPANDSP_UDPTL_H_)
 #define _SPANDSP_UDPTL_H_
 
-#define LOCAL_FAX_MAX_DATAGRAM      400
-#define LOCAL_FAX_MAX_FEC_PACKETS   5
-
-#define UDPTL_BUF_MASK              15
+/*! \page udptl_page UDPTL packet handling
+\section udptl_page_sec_1 What does it do?
+This module implements the UDPTL packet format defined in ITU T.38, which carries the
+IFP packets of a T.38 session over UDP. It adds the sequence numbering, and either
+redundant copies of recent IFP packets or XOR based forward error correction (FEC)
+information, to each outgoing IFP packet. For arriving UDPTL packets it uses the same
+information to recover lost IFP packets, before passing each IFP packet to the
+application, in sequence number order.
+
+\section udptl_page_sec_2 How does it work?
+The sending and receiving of the UDP datagrams is left to the application. Packets are
+built directly into buffers the application supplies, and arriving IFP packets are
+passed to the application as pointers into the arriving datagram wherever possible, so
+IFP data is only copied into the context's own buffers when it may be needed to repair
+later losses. For applications which move many datagrams per system call, such as those
+using recvmmsg() and sendmmsg(), whole batches of packets can be built or processed in a
+single call.
+*/
+
+/*! The maximum length of an IFP packet which can be sent or received. */
+#define UDPTL_MAX_DATAGRAM              400
+/*! The maximum number of FEC entries in a UDPTL packet. */
+#define UDPTL_MAX_FEC_ENTRIES           5
+
+/*! The largest number of bytes, beyond the length of the IFP packet, that a UDPTL packet
+    may contain if its error recovery information has to be dropped to fit the far end's
+    maximum datagram size. */
+#define UDPTL_MAX_PACKET_OVERHEAD       8
 
 typedef int (*udptl_rx_packet_handler_t) (void *user_data, const uint8_t msg[], int len, int seq_no);
 
-typedef struct
-{
-    int buf_len;
-    uint8_t buf[LOCAL_FAX_MAX_DATAGRAM];
-} udptl_fec_tx_buffer_t;
-
-typedef struct
-{
-    int buf_len;
-    uint8_t buf[LOCAL_FAX_MAX_DATAGRAM];
-    int fec_len[LOCAL_FAX_MAX_FEC_PACKETS];
-    uint8_t fec[LOCAL_FAX_MAX_FEC_PACKETS][LOCAL_FAX_MAX_DATAGRAM];
-    int fec_span;
-    int fec_entries;
-} udptl_fec_rx_buffer_t;
-
-struct udptl_state_s
-{
-    udptl_rx_packet_handler_t rx_packet_handler;
-    void *user_data;
-
-    /*! This option indicates the error correction scheme used in transmitted UDPTL
-        packets. */
-    int error_correction_scheme;
-
-    /*! This option indicates the number of error correction entries transmitted in
-        UDPTL packets. */
-    int error_correction_entries;
-
-    /*! This option indicates the span of the error correction entries in transmitted
-        UDPTL packets (FEC only). */
-    int error_correction_span;
-
-    /*! This option indicates the maximum size of a datagram that can be accepted by
-        the remote device. */
-    int far_max_datagram_size;
-
-    /*! This option indicates the maximum size of a datagram that we are prepared to
-        accept. */
-    int local_max_datagram_size;
-
-    int verbose;
-
-    int tx_seq_no;
-    int rx_seq_no;
-    int rx_expected_seq_no;
-
-    udptl_fec_tx_buffer_t tx[UDPTL_BUF_MASK + 1];
-    udptl_fec_rx_buffer_t rx[UDPTL_BUF_MASK + 1];
-
-    /*! \brief Error and flow logging control */
-    logging_state_t logging;
-};
-
 enum
 {
     UDPTL_ERROR_CORRECTION_NONE,
@@ -95,6 +67,10 @@ enum
     UDPTL_ERROR_CORRECTION_REDUNDANCY
 };
 
+/*!
+    UDPTL descriptor. This defines the working state for a single instance of
+    UDPTL packet handling.
+*/
 typedef struct udptl_state_s udptl_state_t;
 
 #if defined(__cplusplus)
@@ -108,14 +84,40 @@ extern "C" {
     \return 0 for OK. */
 SPAN_DECLARE(int) udptl_rx_packet(udptl_state_t *s, const uint8_t buf[], int len);
 
+/*! \brief Process a batch of arriving UDPTL packets, in the order they arrived.
+           Bad packets are logged and skipped.
+    \param s The UDPTL context.
+    \param bufs The UDPTL packet buffers.
+    \param lens The lengths of the packets.
+    \param packets The number of packets.
+    \return The number of packets successfully processed. */
+SPAN_DECLARE(int) udptl_rx_packets(udptl_state_t *s, const uint8_t *bufs[], const int lens[], int packets);
+
 /*! \brief Construct a UDPTL packet, ready for transmission.
     \param s The UDPTL context.
-    \param buf The UDPTL packet buffer.
+    \param buf The UDPTL packet buffer. This must be at least the larger of the far end's
+           maximum datagram size, and msg_len + UDPTL_MAX_PACKET_OVERHEAD bytes long.
     \param msg The primary packet.
     \param msg_len The length of the primary packet.
-    \return The length of the constructed UDPTL packet. */
+    \return The length of the constructed UDPTL packet, or -1 for an error. */
 SPAN_DECLARE(int) udptl_build_packet(udptl_state_t *s, uint8_t buf[], const uint8_t msg[], int msg_len);
 
+/*! \brief Construct a batch of UDPTL packets, ready for transmission.
+    \param s The UDPTL context.
+    \param bufs The UDPTL packet buffers, each sized as for udptl_build_packet.
+    \param lens The lengths of the constructed UDPTL packets.
+    \param msgs The primary packets.
+    \param msg_lens The lengths of the primary packets.
+    \param packets The number of packets.
+    \return The number of UDPTL packets constructed. This will be less than packets if one
+            of the primary packets could not be sent. */
+SPAN_DECLARE(int) udptl_build_packets(udptl_state_t *s,
+                                      uint8_t *bufs[],
+                                      int lens[],
+                                      const uint8_t *msgs[],
+                                      const int msg_lens[],
+                                      int packets);
+
 /*! \brief Change the error correction settings of a UDPTL context.
     \param s The UDPTL context.
     \param ec_scheme One of the optional error correction schemes.
@@ -132,12 +134,26 @@ SPAN_DECLARE(int) udptl_set_error_correction(udptl_state_t *s, int ec_scheme, in
     \return 0 for OK. */
 SPAN_DECLARE(int) udptl_get_error_correction(udptl_state_t *s, int *ec_scheme, int *span, int *entries);
 
+/*! \brief Set the maximum size of datagram we are prepared to accept.
+    \param s The UDPTL context.
+    \param max_datagram The maximum size, in bytes.
+    \return 0 for OK. */
 SPAN_DECLARE(int) udptl_set_local_max_datagram(udptl_state_t *s, int max_datagram);
 
+/*! \brief Get the maximum size of datagram we are prepared to accept.
+    \param s The UDPTL context.
+    \return The maximum size, in bytes. */
 SPAN_DECLARE(int) udptl_get_local_max_datagram(udptl_state_t *s);
 
+/*! \brief Set the maximum size of datagram the far end is prepared to accept.
+    \param s The UDPTL context.
+    \param max_datagram The maximum size, in bytes.
+    \return 0 for OK. */
 SPAN_DECLARE(int) udptl_set_far_max_datagram(udptl_state_t *s, int max_datagram);
 
+/*! \brief Get the maximum size of datagram the far end is prepared to accept.
+    \param s The UDPTL context.
+    \return The maximum size, in bytes. */
 SPAN_DECLARE(int) udptl_get_far_max_datagram(udptl_state_t *s);
 
 /*! Get the logging context associated with a UDPTL context.
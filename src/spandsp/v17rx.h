@@ -264,12 +264,24 @@ SPAN_DECLARE(int) v17_rx_free(v17_rx_state_t *s);
 SPAN_DECLARE(logging_state_t *) v17_rx_get_logging_state(v17_rx_state_t *s);
 
 /*! Change the put_bit function associated with a V.17 modem receive context.
+    Any put_bits function set with v17_rx_set_put_bits() is cleared, so this must be called first
+    if both are to be changed.
     \brief Change the put_bit function associated with a V.17 modem receive context.
     \param s The modem context.
     \param put_bit The callback routine used to handle received bits.
     \param user_data An opaque pointer. */
 SPAN_DECLARE(void) v17_rx_set_put_bit(v17_rx_state_t *s, span_put_bit_func_t put_bit, void *user_data);
 
+/*! Set a put_bits function for a V.17 modem receive context. When this is set, the data
+    bits of each received symbol are delivered to it in a single call, instead of through
+    the put_bit function. Status changes are still reported through the status handler, or
+    the put_bit function.
+    \brief Set a put_bits function for a V.17 modem receive context.
+    \param s The modem context.
+    \param put_bits The callback routine used to handle received groups of bits, or NULL.
+    \param user_data An opaque pointer. */
+SPAN_DECLARE(void) v17_rx_set_put_bits(v17_rx_state_t *s, span_put_bits_func_t put_bits, void *user_data);
+
 /*! Change the modem status report function associated with a V.17 modem receive context.
     \brief Change the modem status report function associated with a V.17 modem receive context.
     \param s The modem context.
@@ -116,12 +116,24 @@ SPAN_DECLARE(int) v27ter_tx_free(v27ter_tx_state_t *s);
 SPAN_DECLARE(logging_state_t *) v27ter_tx_get_logging_state(v27ter_tx_state_t *s);
 
 /*! Change the get_bit function associated with a V.27ter modem transmit context.
+    Any get_bits function set with v27ter_tx_set_get_bits() is cleared, so this must be called first
+    if both are to be changed.
     \brief Change the get_bit function associated with a V.27ter modem transmit context.
     \param s The modem context.
     \param get_bit The callback routine used to get the data to be transmitted.
     \param user_data An opaque pointer. */
 SPAN_DECLARE(void) v27ter_tx_set_get_bit(v27ter_tx_state_t *s, span_get_bit_func_t get_bit, void *user_data);
 
+/*! Set a get_bits function for a V.27ter modem transmit context. When this is set, the data
+    bits for each transmitted symbol are obtained from it in a single call, instead of
+    through the get_bit function. Returning fewer bits than were requested marks the end
+    of the data.
+    \brief Set a get_bits function for a V.27ter modem transmit context.
+    \param s The modem context.
+    \param get_bits The callback routine used to get groups of bits to be transmitted, or NULL.
+    \param user_data An opaque pointer. */
+SPAN_DECLARE(void) v27ter_tx_set_get_bits(v27ter_tx_state_t *s, span_get_bits_func_t get_bits, void *user_data);
+
 /*! Change the modem status report function associated with a V.27ter modem transmit context.
     \brief Change the modem status report function associated with a V.27ter modem transmit context.
     \param s The modem context.
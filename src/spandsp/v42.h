@@ -68,6 +68,21 @@ SPAN_DECLARE(void) v42_rx_bit(void *user_data, int bit);
 
 SPAN_DECLARE(int) v42_tx_bit(void *user_data);
 
+/*! Process a block of received octets, for modems which deliver their data an octet at a
+    time. The first bit received is the most significant bit of each octet.
+    \param user_data The V.42 context.
+    \param buf The octets.
+    \param len The number of octets. */
+SPAN_DECLARE(void) v42_rx_put(void *user_data, const uint8_t buf[], int len);
+
+/*! Get a block of octets for transmission, for modems which take their data an octet at a
+    time. The first bit to be sent is the most significant bit of each octet.
+    \param user_data The V.42 context.
+    \param buf The buffer for the octets.
+    \param max_len The maximum number of octets to get.
+    \return The number of octets returned. */
+SPAN_DECLARE(int) v42_tx_get(void *user_data, uint8_t buf[], int max_len);
+
 SPAN_DECLARE(void) v42_set_status_callback(v42_state_t *s, span_modem_status_func_t callback, void *user_data);
 
 /*! Get the logging context associated with a V.42 context.
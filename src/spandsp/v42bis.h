@@ -108,7 +108,9 @@ SPAN_DECLARE(logging_state_t *) v42bis_get_logging_state(v42bis_state_t *s);
 /*! Initialise a V.42bis context.
     \param s The V.42bis context.
     \param negotiated_p0 The negotiated P0 parameter, from the V.42bis spec.
-    \param negotiated_p1 The negotiated P1 parameter, from the V.42bis spec.
+    \param negotiated_p1 The negotiated P1 parameter, from the V.42bis spec. This must be in
+           the range V42BIS_MIN_DICTIONARY_SIZE to V42BIS_MAX_CODEWORDS. The dictionaries are
+           allocated to this size.
     \param negotiated_p2 The negotiated P2 parameter, from the V.42bis spec.
     \param encode_handler Encode callback handler.
     \param encode_user_data An opaque pointer passed to the encode callback handler.
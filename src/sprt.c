@@ -39,8 +39,6 @@
 #include <spandsp/stdbool.h>
 #endif
 
-#define SPANDSP_FULLY_DEFINE_SPRT_STATE_T
-
 #include "spandsp/telephony.h"
 #include "spandsp/alloc.h"
 #include "spandsp/unaligned.h"
@@ -213,6 +211,11 @@ static int update_timer(sprt_state_t *s)
         /*endif*/
     }
     /*endif*/
+    /* This is called after every packet sent, but the application only needs to hear about
+       changes to the earliest timeout. */
+    if (shortest == s->latest_timer)
+        return 0;
+    /*endif*/
     span_log(&s->logging, SPAN_LOG_FLOW, "Update timer to %lu (%d)\n", shortest, shortest_is);
     s->latest_timer = shortest;
     if (s->timer_handler)
@@ -227,6 +230,11 @@ static void delete_timer_queue_entry(sprt_state_t *s, int channel, int slot)
     if (s->tx.chan[channel].first_in_time == TR03_QUEUE_FREE_SLOT_TAG  ||  slot == TR03_QUEUE_FREE_SLOT_TAG)
         return;
     /*endif*/
+    /* The slot may not be in the queue, if it ran out of retries, or its ACK arrived while it
+       was being retransmitted. */
+    if (s->tx.chan[channel].first_in_time != slot  &&  s->tx.chan[channel].prev_in_time[slot] == TR03_QUEUE_FREE_SLOT_TAG)
+        return;
+    /*endif*/
 
     if (s->tx.chan[channel].first_in_time == slot)
     {
@@ -379,7 +387,7 @@ static int queue_acknowledgement(sprt_state_t *s, int channel, uint16_t sequence
 }
 /*- End of function --------------------------------------------------------*/
 
-static bool retransmit_the_unacknowledged(sprt_state_t *s, int channel, span_timestamp_t now)
+static bool retransmit_the_unacknowledged(sprt_state_t *s, int channel, span_timestamp_t now, bool *excess_retries)
 {
     uint8_t first;
     sprt_chan_t *chan;
@@ -400,6 +408,25 @@ static bool retransmit_the_unacknowledged(sprt_state_t *s, int channel, span_tim
                 diff += chan->window_size;
             /*endif*/
             seq_no = chan->queuing_sequence_no - diff;
+            /* Requeue the slot before sending, as the packet handler might feed an ACK for it
+               straight back to us. Every deadline in the queue was set no later than now, so
+               putting this one at the end keeps the queue in deadline order, and expiry only
+               ever has to look at its head. */
+            delete_timer_queue_entry(s, channel, first);
+            chan->remaining_tries[first]--;
+            if (chan->remaining_tries[first] <= 0)
+            {
+                /* This is the last try. The application is told once we have finished with the
+                   context, as it may well tear it down in response. */
+                *excess_retries = true;
+            }
+            else
+            {
+                /* Update the timestamp, and requeue the packet */
+                chan->tr03_timer[first] = now + chan->tr03_timeout;
+                add_timer_queue_last_entry(s, channel, first);
+            }
+            /*endif*/
             if (chan->buff_len[first] != SPRT_LEN_SLOT_FREE)
             {
                 build_and_send_packet(s,
@@ -414,22 +441,6 @@ static bool retransmit_the_unacknowledged(sprt_state_t *s, int channel, span_tim
                 span_log(&s->logging, SPAN_LOG_ERROR, "Empty slot scheduled %d %d\n", first, chan->buff_len[first]);
             }
             /*endif*/
-            delete_timer_queue_entry(s, channel, first);
-            chan->remaining_tries[first]--;
-            if (chan->remaining_tries[first] <= 0)
-            {
-                /* TODO: take action on too many retries */
-                if (s->status_handler)
-                    s->status_handler(s->status_user_data, SPRT_STATUS_EXCESS_RETRIES);
-                /*endif*/
-            }
-            else
-            {
-                /* Update the timestamp, and requeue the packet */
-                chan->tr03_timer[first] += chan->tr03_timeout;
-                add_timer_queue_last_entry(s, channel, first);
-            }
-            /*endif*/
         }
         /*endif*/
     }
@@ -573,6 +584,7 @@ SPAN_DECLARE(int) sprt_timer_expired(sprt_state_t *s, span_timestamp_t now)
     int i;
     bool something_was_sent_for_channel;
     bool something_was_sent;
+    bool excess_retries;
 
     span_log(&s->logging, SPAN_LOG_FLOW, "Timer expired at %lu\n", now);
 
@@ -588,6 +600,7 @@ SPAN_DECLARE(int) sprt_timer_expired(sprt_state_t *s, span_timestamp_t now)
     /*endif*/
 
     something_was_sent = false;
+    excess_retries = false;
 
     if (s->tx.immediate_timer)
     {
@@ -598,7 +611,7 @@ SPAN_DECLARE(int) sprt_timer_expired(sprt_state_t *s, span_timestamp_t now)
 
     for (i = SPRT_TCID_MIN_RELIABLE;  i <= SPRT_TCID_MAX_RELIABLE;  i++)
     {
-        something_was_sent_for_channel = retransmit_the_unacknowledged(s, i, now);
+        something_was_sent_for_channel = retransmit_the_unacknowledged(s, i, now, &excess_retries);
         /* There's a keepalive timer for each reliable channel. We only need to send a keepalive if we
            didn't just send a retransmit for this channel. */
         if (s->tx.chan[i].ta02_timer != 0)
@@ -641,11 +654,24 @@ SPAN_DECLARE(int) sprt_timer_expired(sprt_state_t *s, span_timestamp_t now)
         /*endif*/
     }
     /*endif*/
+    /* The application's timer has been used up, so it must be set again, even if the earliest
+       timeout is unchanged. */
+    s->latest_timer = 0;
     update_timer(s);
+    /* Nothing may touch the context after this report. */
+    if (excess_retries  &&  s->status_handler)
+        s->status_handler(s->status_user_data, SPRT_STATUS_EXCESS_RETRIES);
+    /*endif*/
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(span_timestamp_t) sprt_get_next_timeout(sprt_state_t *s)
+{
+    return s->latest_timer;
+}
+/*- End of function --------------------------------------------------------*/
+
 static void sprt_rx_reinit(sprt_state_t *s)
 {
     /* TODO */
@@ -975,6 +1001,100 @@ SPAN_DECLARE(int) sprt_tx(sprt_state_t *s, int channel, const uint8_t payload[],
 }
 /*- End of function --------------------------------------------------------*/
 
+static bool chan_buffers_in_use(sprt_chan_t *chan)
+{
+    int i;
+
+    if (chan->buff_len == NULL)
+        return false;
+    /*endif*/
+    for (i = 0;  i < chan->window_size;  i++)
+    {
+        if (chan->buff_len[i] != SPRT_LEN_SLOT_FREE)
+            return true;
+        /*endif*/
+    }
+    /*endfor*/
+    return false;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int alloc_chan_buffers(sprt_chan_t *chan, bool tx)
+{
+    uint8_t *block;
+    size_t timers_size;
+    size_t lens_size;
+    int i;
+
+    /* The TR03 timers, the slot lengths, and the slot contents for a channel are carved from
+       a single block. The timers go first, to keep them aligned. */
+    timers_size = (tx)  ?  chan->window_size*sizeof(span_timestamp_t)  :  0;
+    lens_size = chan->window_size*sizeof(uint16_t);
+    if ((block = (uint8_t *) span_alloc(timers_size + lens_size + chan->window_size*chan->max_payload_bytes)) == NULL)
+        return -1;
+    /*endif*/
+    if (chan->buff_len)
+        span_free(chan->tr03_timer  ?  (void *) chan->tr03_timer  :  (void *) chan->buff_len);
+    /*endif*/
+    chan->tr03_timer = (tx)  ?  (span_timestamp_t *) block  :  NULL;
+    chan->buff_len = (uint16_t *) (block + timers_size);
+    chan->buff = block + timers_size + lens_size;
+    for (i = 0;  i < chan->window_size;  i++)
+    {
+        chan->buff_len[i] = SPRT_LEN_SLOT_FREE;
+        if (tx)
+            chan->tr03_timer[i] = 0;
+        /*endif*/
+        chan->prev_in_time[i] = TR03_QUEUE_FREE_SLOT_TAG;
+        chan->next_in_time[i] = TR03_QUEUE_FREE_SLOT_TAG;
+    }
+    /*endfor*/
+    chan->first_in_time = TR03_QUEUE_FREE_SLOT_TAG;
+    chan->last_in_time = TR03_QUEUE_FREE_SLOT_TAG;
+    chan->buff_in_ptr = 0;
+    chan->buff_acked_out_ptr = 0;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void free_chan_buffers(sprt_chan_t *chan)
+{
+    if (chan->buff_len)
+        span_free(chan->tr03_timer  ?  (void *) chan->tr03_timer  :  (void *) chan->buff_len);
+    /*endif*/
+    chan->tr03_timer = NULL;
+    chan->buff_len = NULL;
+    chan->buff = NULL;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int resize_chan_buffers(sprt_chan_t *chan, bool tx, int window_size, int max_payload_bytes)
+{
+    int old_window_size;
+    int old_max_payload_bytes;
+
+    if (window_size == chan->window_size  &&  max_payload_bytes == chan->max_payload_bytes)
+        return 0;
+    /*endif*/
+    /* Resizing would lose anything stored in the buffers */
+    if (chan_buffers_in_use(chan))
+        return -1;
+    /*endif*/
+    old_window_size = chan->window_size;
+    old_max_payload_bytes = chan->max_payload_bytes;
+    chan->window_size = window_size;
+    chan->max_payload_bytes = max_payload_bytes;
+    if (alloc_chan_buffers(chan, tx))
+    {
+        chan->window_size = old_window_size;
+        chan->max_payload_bytes = old_max_payload_bytes;
+        return -1;
+    }
+    /*endif*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) sprt_set_local_tc_windows_size(sprt_state_t *s, int channel, int size)
 {
     if (channel < SPRT_TCID_MIN_RELIABLE  ||  channel > SPRT_TCID_MAX_RELIABLE)
@@ -987,8 +1107,7 @@ SPAN_DECLARE(int) sprt_set_local_tc_windows_size(sprt_state_t *s, int channel, i
         return -1;
     }
     /*endif*/
-    s->rx.chan[channel].window_size = size;
-    return 0;
+    return resize_chan_buffers(&s->rx.chan[channel], false, size, s->rx.chan[channel].max_payload_bytes);
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -1013,6 +1132,9 @@ SPAN_DECLARE(int) sprt_set_local_tc_payload_bytes(sprt_state_t *s, int channel,
         return -1;
     }
     /*endif*/
+    if (channel >= SPRT_TCID_MIN_RELIABLE  &&  channel <= SPRT_TCID_MAX_RELIABLE)
+        return resize_chan_buffers(&s->rx.chan[channel], false, s->rx.chan[channel].window_size, max_len);
+    /*endif*/
     s->rx.chan[channel].max_payload_bytes = max_len;
     return 0;
 }
@@ -1065,8 +1187,7 @@ SPAN_DECLARE(int) sprt_set_far_tc_windows_size(sprt_state_t *s, int channel, int
         return -1;
     }
     /*endif*/
-    s->tx.chan[channel].window_size = size;
-    return 0;
+    return resize_chan_buffers(&s->tx.chan[channel], true, size, s->tx.chan[channel].max_payload_bytes);
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -1091,6 +1212,9 @@ SPAN_DECLARE(int) sprt_set_far_tc_payload_bytes(sprt_state_t *s, int channel, in
         return -1;
     }
     /*endif*/
+    if (channel >= SPRT_TCID_MIN_RELIABLE  &&  channel <= SPRT_TCID_MAX_RELIABLE)
+        return resize_chan_buffers(&s->tx.chan[channel], true, s->tx.chan[channel].window_size, max_len);
+    /*endif*/
     s->tx.chan[channel].max_payload_bytes = max_len;
     return 0;
 }
@@ -1216,8 +1340,8 @@ SPAN_DECLARE(sprt_state_t *) sprt_init(sprt_state_t *s,
                                        span_modem_status_func_t status_handler,
                                        void *status_user_data)
 {
+    bool alloced;
     int i;
-    int j;
 
     if (rx_delivery_handler == NULL  ||  tx_packet_handler == NULL  ||  timer_handler == NULL  ||  status_handler == NULL)
         return NULL;
@@ -1248,11 +1372,13 @@ SPAN_DECLARE(sprt_state_t *) sprt_init(sprt_state_t *s,
         /*endfor*/
     }
     /*endif*/
+    alloced = false;
     if (s == NULL)
     {
         if ((s = (sprt_state_t *) span_alloc(sizeof(*s))) == NULL)
             return NULL;
         /*endif*/
+        alloced = true;
     }
     /*endif*/
     memset(s, 0, sizeof(*s));
@@ -1260,36 +1386,23 @@ SPAN_DECLARE(sprt_state_t *) sprt_init(sprt_state_t *s,
     span_log_init(&s->logging, SPAN_LOG_NONE, NULL);
     span_log_set_protocol(&s->logging, "SPRT");
 
-    /* Set up all the pointers to buffers */
-    s->tx.chan[SPRT_TCID_RELIABLE_SEQUENCED].buff = s->tc1_tx_buff;
-    s->tx.chan[SPRT_TCID_RELIABLE_SEQUENCED].buff_len = s->tc1_tx_buff_len;
-    s->tx.chan[SPRT_TCID_RELIABLE_SEQUENCED].tr03_timer = s->tc1_tx_tr03_timer;
-    s->tx.chan[SPRT_TCID_EXPEDITED_RELIABLE_SEQUENCED].buff = s->tc2_tx_buff;
-    s->tx.chan[SPRT_TCID_EXPEDITED_RELIABLE_SEQUENCED].buff_len = s->tc2_tx_buff_len;
-    s->tx.chan[SPRT_TCID_EXPEDITED_RELIABLE_SEQUENCED].tr03_timer = s->tc2_tx_tr03_timer;
-
-    s->rx.chan[SPRT_TCID_RELIABLE_SEQUENCED].buff = s->tc1_rx_buff;
-    s->rx.chan[SPRT_TCID_RELIABLE_SEQUENCED].buff_len = s->tc1_rx_buff_len;
-    s->rx.chan[SPRT_TCID_EXPEDITED_RELIABLE_SEQUENCED].buff = s->tc2_rx_buff;
-    s->rx.chan[SPRT_TCID_EXPEDITED_RELIABLE_SEQUENCED].buff_len = s->tc2_rx_buff_len;
-
     s->rx.subsession_id = 0xFF;
     s->tx.subsession_id = subsession_id;
     s->rx.payload_type = rx_payload_type;
     s->tx.payload_type = tx_payload_type;
 
-    s->tx.ta01_timeout = default_channel_parms[SPRT_TCID_RELIABLE_SEQUENCED].timer_ta01;
+    s->tx.ta01_timeout = parms[SPRT_TCID_RELIABLE_SEQUENCED].timer_ta01;
     for (i = SPRT_TCID_MIN;  i <= SPRT_TCID_MAX;  i++)
     {
-        s->rx.chan[i].max_payload_bytes = default_channel_parms[i].payload_bytes;
-        s->rx.chan[i].window_size = default_channel_parms[i].window_size;
-        s->rx.chan[i].ta02_timeout = default_channel_parms[i].timer_ta02;
-        s->rx.chan[i].tr03_timeout = default_channel_parms[i].timer_tr03;
+        s->rx.chan[i].max_payload_bytes = parms[i].payload_bytes;
+        s->rx.chan[i].window_size = parms[i].window_size;
+        s->rx.chan[i].ta02_timeout = parms[i].timer_ta02;
+        s->rx.chan[i].tr03_timeout = parms[i].timer_tr03;
 
-        s->tx.chan[i].max_payload_bytes = default_channel_parms[i].payload_bytes;
-        s->tx.chan[i].window_size = default_channel_parms[i].window_size;
-        s->tx.chan[i].ta02_timeout = default_channel_parms[i].timer_ta02;
-        s->tx.chan[i].tr03_timeout = default_channel_parms[i].timer_tr03;
+        s->tx.chan[i].max_payload_bytes = parms[i].payload_bytes;
+        s->tx.chan[i].window_size = parms[i].window_size;
+        s->tx.chan[i].ta02_timeout = parms[i].timer_ta02;
+        s->tx.chan[i].tr03_timeout = parms[i].timer_tr03;
 
         s->tx.chan[i].max_tries = SPRT_DEFAULT_MAX_TRIES;
 
@@ -1297,20 +1410,21 @@ SPAN_DECLARE(sprt_state_t *) sprt_init(sprt_state_t *s,
     }
     /*endfor*/
 
+    /* Only the reliable channels need buffers, and they are sized for the channel parameters
+       in use. If these are changed the buffers will be reallocated. */
     for (i = SPRT_TCID_MIN_RELIABLE;  i <= SPRT_TCID_MAX_RELIABLE;  i++)
     {
-        /* Initialise the sorted TR03 timeout queues */
-        s->tx.chan[i].first_in_time = TR03_QUEUE_FREE_SLOT_TAG;
-        s->tx.chan[i].last_in_time = TR03_QUEUE_FREE_SLOT_TAG;
-
-        for (j = 0;  j < channel_parm_limits[i].max_window_size;  j++)
+        if (alloc_chan_buffers(&s->rx.chan[i], false)
+            ||
+            alloc_chan_buffers(&s->tx.chan[i], true))
         {
-            s->rx.chan[i].buff_len[j] = SPRT_LEN_SLOT_FREE;
-            s->tx.chan[i].buff_len[j] = SPRT_LEN_SLOT_FREE;
-            s->tx.chan[i].prev_in_time[j] = TR03_QUEUE_FREE_SLOT_TAG;
-            s->tx.chan[i].next_in_time[j] = TR03_QUEUE_FREE_SLOT_TAG;
+            sprt_release(s);
+            if (alloced)
+                span_free(s);
+            /*endif*/
+            return NULL;
         }
-        /*endfor*/
+        /*endif*/
     }
     /*endfor*/
 
@@ -1329,6 +1443,14 @@ SPAN_DECLARE(sprt_state_t *) sprt_init(sprt_state_t *s,
 
 SPAN_DECLARE(int) sprt_release(sprt_state_t *s)
 {
+    int i;
+
+    for (i = SPRT_TCID_MIN_RELIABLE;  i <= SPRT_TCID_MAX_RELIABLE;  i++)
+    {
+        free_chan_buffers(&s->rx.chan[i]);
+        free_chan_buffers(&s->tx.chan[i]);
+    }
+    /*endfor*/
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
@@ -635,7 +635,12 @@ static int terminate_operation_in_progress(t30_state_t *s)
         s->operation_in_progress = OPERATION_IN_PROGRESS_POST_T4_TX;
         break;
     case OPERATION_IN_PROGRESS_T4_RX:
-        t4_rx_release(&s->t4.rx);
+        if (t4_rx_release(&s->t4.rx)  &&  s->current_status == T30_ERR_OK)
+        {
+            span_log(&s->logging, SPAN_LOG_WARNING, "The received document could not be stored completely\n");
+            t30_set_status(s, T30_ERR_FILEERROR);
+        }
+        /*endif*/
         s->operation_in_progress = OPERATION_IN_PROGRESS_POST_T4_RX;
         break;
     }
@@ -644,6 +649,18 @@ static int terminate_operation_in_progress(t30_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
+static bool have_rx_destination(t30_state_t *s)
+{
+    return (s->rx_file[0]  ||  s->rx_tiff_write_handler);
+}
+/*- End of function --------------------------------------------------------*/
+
+static bool have_tx_document(t30_state_t *s)
+{
+    return (s->tx_file[0]  ||  s->tx_memory_buf  ||  s->tx_pre_encoded_page_handler);
+}
+/*- End of function --------------------------------------------------------*/
+
 static int tx_start_page(t30_state_t *s)
 {
     if (t4_tx_start_page(&s->t4.tx))
@@ -672,10 +689,22 @@ static int tx_end_page(t30_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
-static int rx_start_page(t30_state_t *s)
+static void clear_rx_ecm_block(t30_state_t *s)
 {
     int i;
 
+    /* Clear the ECM buffer */
+    for (i = 0;  i < 256;  i++)
+        s->ecm_len[i] = -1;
+    /*endfor*/
+    s->ecm_frames = -1;
+    s->ecm_frames_delivered = 0;
+    s->ecm_block_identified = false;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int rx_start_page(t30_state_t *s)
+{
     t4_rx_set_image_width(&s->t4.rx, s->image_width);
     t4_rx_set_sub_address(&s->t4.rx, s->rx_info.sub_address);
     t4_rx_set_dcs(&s->t4.rx, s->rx_dcs_string);
@@ -690,12 +719,8 @@ static int rx_start_page(t30_state_t *s)
     if (t4_rx_start_page(&s->t4.rx))
         return -1;
     /*endif*/
-    /* Clear the ECM buffer */
-    for (i = 0;  i < 256;  i++)
-        s->ecm_len[i] = -1;
-    /*endfor*/
+    clear_rx_ecm_block(s);
     s->ecm_block = 0;
-    s->ecm_frames = -1;
     s->ecm_frames_this_tx_burst = 0;
     s->error_correcting_mode_retries = 0;
     return 0;
@@ -1529,7 +1554,7 @@ int t30_build_dis_or_dtc(t30_state_t *s)
     /* Superfine minimum scan line time pattern follows fine */
 
     /* Ready to transmit a data file (polling) */
-    if (s->tx_file[0])
+    if (have_tx_document(s))
         set_ctrl_bit(s->local_dis_dtc_frame, T30_DIS_BIT_READY_TO_TRANSMIT_DATA_FILE);
     /*endif*/
 
@@ -1661,14 +1686,14 @@ static int set_dis_or_dtc(t30_state_t *s)
     /* Whether we use a DIS or a DTC is determined by whether we have received a DIS.
        We just need to edit the prebuilt message. */
     s->local_dis_dtc_frame[2] = (uint8_t) (T30_DIS | s->dis_received);
-    /* If we have a file name to receive into, then we are receive capable */
-    if (s->rx_file[0])
+    /* If we have somewhere to receive into, then we are receive capable */
+    if (have_rx_destination(s))
         set_ctrl_bit(s->local_dis_dtc_frame, T30_DIS_BIT_READY_TO_RECEIVE_FAX_DOCUMENT);
     else
         clr_ctrl_bit(s->local_dis_dtc_frame, T30_DIS_BIT_READY_TO_RECEIVE_FAX_DOCUMENT);
     /*endif*/
-    /* If we have a file name to transmit, then we are ready to transmit (polling) */
-    if (s->tx_file[0])
+    /* If we have a document to transmit, then we are ready to transmit (polling) */
+    if (have_tx_document(s))
         set_ctrl_bit(s->local_dis_dtc_frame, T30_DIS_BIT_READY_TO_TRANSMIT_FAX_DOCUMENT);
     else
         clr_ctrl_bit(s->local_dis_dtc_frame, T30_DIS_BIT_READY_TO_TRANSMIT_FAX_DOCUMENT);
@@ -2978,7 +3003,7 @@ static int start_sending_document(t30_state_t *s)
 {
     int res;
 
-    if (s->tx_file[0] == '\0')
+    if (!have_tx_document(s))
     {
         /* There is nothing to send */
         span_log(&s->logging, SPAN_LOG_FLOW, "No document to send\n");
@@ -2986,14 +3011,36 @@ static int start_sending_document(t30_state_t *s)
     }
     /*endif*/
     span_log(&s->logging, SPAN_LOG_FLOW, "Start sending document\n");
-    if (t4_tx_init(&s->t4.tx, s->tx_file, s->tx_start_page, s->tx_stop_page) == NULL)
+    if (s->tx_file[0])
     {
-        span_log(&s->logging, SPAN_LOG_WARNING, "Cannot open source TIFF file '%s'\n", s->tx_file);
-        t30_set_status(s, T30_ERR_FILEERROR);
-        return -1;
+        if (t4_tx_init(&s->t4.tx, s->tx_file, s->tx_start_page, s->tx_stop_page) == NULL)
+        {
+            span_log(&s->logging, SPAN_LOG_WARNING, "Cannot open source TIFF file '%s'\n", s->tx_file);
+            t30_set_status(s, T30_ERR_FILEERROR);
+            return -1;
+        }
+        /*endif*/
+    }
+    else if (s->tx_memory_buf)
+    {
+        if (t4_tx_init_from_memory(&s->t4.tx, s->tx_memory_buf, s->tx_memory_len, s->tx_start_page, s->tx_stop_page) == NULL)
+        {
+            span_log(&s->logging, SPAN_LOG_WARNING, "Cannot open source TIFF image in memory\n");
+            t30_set_status(s, T30_ERR_FILEERROR);
+            return -1;
+        }
+        /*endif*/
+    }
+    else
+    {
+        t4_tx_init(&s->t4.tx, NULL, s->tx_start_page, s->tx_stop_page);
+        t4_tx_set_pre_encoded_page_handler(&s->t4.tx, s->tx_pre_encoded_page_handler, s->tx_pre_encoded_page_user_data);
     }
     /*endif*/
     s->operation_in_progress = OPERATION_IN_PROGRESS_T4_TX;
+    if (s->tx_page_index)
+        t4_tx_set_page_index(&s->t4.tx, s->tx_page_index);
+    /*endif*/
 
     t4_tx_set_local_ident(&s->t4.tx, s->tx_info.ident);
     t4_tx_set_header_info(&s->t4.tx, s->header_info);
@@ -3083,7 +3130,7 @@ static int restart_sending_document(t30_state_t *s)
 
 static int start_receiving_document(t30_state_t *s)
 {
-    if (s->rx_file[0] == '\0')
+    if (!have_rx_destination(s))
     {
         /* There is nothing to receive to */
         span_log(&s->logging, SPAN_LOG_FLOW, "No document to receive\n");
@@ -3152,7 +3199,7 @@ static int process_rx_dis_dtc(t30_state_t *s, const uint8_t *msg, int len)
     }
     /*endif*/
     /* Try to send something */
-    if (s->tx_file[0])
+    if (have_tx_document(s))
     {
         span_log(&s->logging, SPAN_LOG_FLOW, "Trying to send file '%s'\n", s->tx_file);
         if (!test_ctrl_bit(s->far_dis_dtc_frame, T30_DIS_BIT_READY_TO_RECEIVE_FAX_DOCUMENT))
@@ -3190,7 +3237,7 @@ static int process_rx_dis_dtc(t30_state_t *s, const uint8_t *msg, int len)
     /*endif*/
     span_log(&s->logging, SPAN_LOG_FLOW, "%s - nothing to send\n", t30_frametype(msg[2]));
     /* ... then try to receive something */
-    if (s->rx_file[0])
+    if (have_rx_destination(s))
     {
         span_log(&s->logging, SPAN_LOG_FLOW, "Trying to receive file '%s'\n", s->rx_file);
         if (!test_ctrl_bit(s->far_dis_dtc_frame, T30_DIS_BIT_READY_TO_TRANSMIT_FAX_DOCUMENT))
@@ -3258,7 +3305,7 @@ static int process_rx_dcs(t30_state_t *s, const uint8_t *msg, int len)
              fallback_sequence[s->current_fallback].modem_type,
              t30_modem_to_str(fallback_sequence[s->current_fallback].modem_type),
              fallback_sequence[s->current_fallback].bit_rate);
-    if (s->rx_file[0] == '\0')
+    if (!have_rx_destination(s))
     {
         span_log(&s->logging, SPAN_LOG_FLOW, "No document to receive\n");
         t30_set_status(s, T30_ERR_FILEERROR);
@@ -3268,12 +3315,28 @@ static int process_rx_dcs(t30_state_t *s, const uint8_t *msg, int len)
     /*endif*/
     if (s->operation_in_progress != OPERATION_IN_PROGRESS_T4_RX)
     {
-        if (t4_rx_init(&s->t4.rx, s->rx_file, s->supported_output_compressions) == NULL)
+        if (s->rx_file[0])
         {
-            span_log(&s->logging, SPAN_LOG_WARNING, "Cannot open target TIFF file '%s'\n", s->rx_file);
-            t30_set_status(s, T30_ERR_FILEERROR);
-            send_dcn(s);
-            return -1;
+            if (t4_rx_init(&s->t4.rx, s->rx_file, s->supported_output_compressions) == NULL)
+            {
+                span_log(&s->logging, SPAN_LOG_WARNING, "Cannot open target TIFF file '%s'\n", s->rx_file);
+                t30_set_status(s, T30_ERR_FILEERROR);
+                send_dcn(s);
+                return -1;
+            }
+            /*endif*/
+        }
+        else
+        {
+            if (t4_rx_init_to_memory(&s->t4.rx, s->supported_output_compressions) == NULL)
+            {
+                span_log(&s->logging, SPAN_LOG_WARNING, "Cannot open target TIFF image in memory\n");
+                t30_set_status(s, T30_ERR_FILEERROR);
+                send_dcn(s);
+                return -1;
+            }
+            /*endif*/
+            t4_rx_set_tiff_write_handler(&s->t4.rx, s->rx_tiff_write_handler, s->rx_tiff_write_user_data);
         }
         /*endif*/
         s->operation_in_progress = OPERATION_IN_PROGRESS_T4_RX;
@@ -3364,6 +3427,73 @@ static int send_response_to_pps(t30_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
+static int put_ecm_frame(t30_state_t *s, const uint8_t buf[], int len)
+{
+    int res;
+
+    if (s->document_put_handler)
+        res = s->document_put_handler(s->document_put_user_data, buf, len);
+    else
+        res = t4_rx_put(&s->t4.rx, buf, len);
+    /*endif*/
+    if (res != T4_DECODE_MORE_DATA)
+    {
+        /* This is the end of the document, so nothing more from this block is wanted */
+        if (res != T4_DECODE_OK)
+            span_log(&s->logging, SPAN_LOG_FLOW, "Document ended with status %d\n", res);
+        /*endif*/
+        s->ecm_frames_delivered = 256;
+        return -1;
+    }
+    /*endif*/
+    s->ecm_frames_delivered++;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void put_ecm_block(t30_state_t *s)
+{
+    int i;
+
+    /* Deliver whatever ECM data has not already been passed on */
+    for (i = s->ecm_frames_delivered;  i < s->ecm_frames;  i++)
+    {
+        if (put_ecm_frame(s, s->ecm_data[i], s->ecm_len[i]))
+            break;
+        /*endif*/
+    }
+    /*endfor*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static int ecm_block_is_complete(t30_state_t *s)
+{
+    int expected_len;
+    int i;
+
+    /* Until a PPS has told us which page and block is being sent, and how many frames it
+       has, nothing can be passed on. The frames might be a repeat of a block we have
+       already accepted, or be abandoned by an EOR. Once we know the block, and every
+       frame is present with the lengths the PPS processing will check for, it is certain
+       to be accepted, and can be passed on without waiting for the next PPS. */
+    if (!s->ecm_block_identified)
+        return false;
+    /*endif*/
+    expected_len = (s->ecm_len[0] == 64)  ?  64  :  256;
+    for (i = 0;  i < s->ecm_frames;  i++)
+    {
+        if (s->ecm_len[i] < 0)
+            return false;
+        /*endif*/
+        if (i < s->ecm_frames - 1  &&  s->ecm_len[i] != expected_len)
+            return false;
+        /*endif*/
+    }
+    /*endfor*/
+    return true;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int process_rx_pps(t30_state_t *s, const uint8_t *msg, int len)
 {
     int page;
@@ -3375,7 +3505,6 @@ static int process_rx_pps(t30_state_t *s, const uint8_t *msg, int len)
     int first_bad_frame;
     int first;
     int expected_len;
-    int res;
 
     if (len < 7)
     {
@@ -3442,11 +3571,8 @@ static int process_rx_pps(t30_state_t *s, const uint8_t *msg, int len)
             /* This must be a repeat of the last thing the far end sent, while we are expecting
                the first transfer of a new block. */
             span_log(&s->logging, SPAN_LOG_FLOW, "Looks like a repeat from the previous page/block - send MCF again.\n");
-            /* Clear the ECM buffer */
-            for (i = 0;  i < 256;  i++)
-                s->ecm_len[i] = -1;
-            /*endfor*/
-            s->ecm_frames = -1;
+            /* Anything received since the MCF is from the repeat, and none of it has been passed on */
+            clear_rx_ecm_block(s);
             queue_phase(s, T30_PHASE_D_TX);
             set_state(s, T30_STATE_F_POST_RCP_MCF);
             send_simple_frame(s, T30_MCF);
@@ -3461,6 +3587,8 @@ static int process_rx_pps(t30_state_t *s, const uint8_t *msg, int len)
         return 0;
     }
     /*endif*/
+    /* Now we know which block the stored frames belong to */
+    s->ecm_block_identified = true;
 
     /* Build a bit map of which frames we now have stored OK */
     first_bad_frame = 256;
@@ -3525,30 +3653,9 @@ static int process_rx_pps(t30_state_t *s, const uint8_t *msg, int len)
     if (s->rx_ecm_block_ok)
     {
         span_log(&s->logging, SPAN_LOG_FLOW, "Partial page OK - committing block %d, %d frames\n", s->ecm_block, s->ecm_frames);
-        /* Deliver the ECM data */
-        for (i = 0;  i < s->ecm_frames;  i++)
-        {
-            if (s->document_put_handler)
-                res = s->document_put_handler(s->document_put_user_data, s->ecm_data[i], s->ecm_len[i]);
-            else
-                res = t4_rx_put(&s->t4.rx, s->ecm_data[i], s->ecm_len[i]);
-            /*endif*/
-            if (res != T4_DECODE_MORE_DATA)
-            {
-                /* This is the end of the document */
-                if (res != T4_DECODE_OK)
-                    span_log(&s->logging, SPAN_LOG_FLOW, "Document ended with status %d\n", res);
-                break;
-            }
-            /*endif*/
-        }
-        /*endfor*/
-        /* Clear the ECM buffer */
-        for (i = 0;  i < 256;  i++)
-            s->ecm_len[i] = -1;
-        /*endfor*/
+        put_ecm_block(s);
+        clear_rx_ecm_block(s);
         s->ecm_block++;
-        s->ecm_frames = -1;
 
         switch (s->last_pps_fcf2)
         {
@@ -3742,10 +3849,27 @@ static void process_rx_fcd(t30_state_t *s, const uint8_t *msg, int len)
         else
         {
             frame_no = msg[3];
-            /* Just store the actual image data, and record its length */
-            span_log(&s->logging, SPAN_LOG_FLOW, "Storing ECM frame %d, length %d\n", frame_no, len - 4);
-            memcpy(&s->ecm_data[frame_no][0], &msg[4], len - 4);
-            s->ecm_len[frame_no] = (int16_t) (len - 4);
+            if (frame_no < s->ecm_frames_delivered)
+            {
+                /* The whole block has already been passed on, or the document has ended */
+                span_log(&s->logging, SPAN_LOG_FLOW, "Ignoring ECM frame %d, length %d\n", frame_no, len - 4);
+            }
+            else
+            {
+                /* Just store the actual image data, and record its length */
+                span_log(&s->logging, SPAN_LOG_FLOW, "Storing ECM frame %d, length %d\n", frame_no, len - 4);
+                memcpy(&s->ecm_data[frame_no][0], &msg[4], len - 4);
+                s->ecm_len[frame_no] = (int16_t) (len - 4);
+                if (s->ecm_frames_delivered == 0  &&  ecm_block_is_complete(s))
+                {
+                    /* A resent frame has completed the block, so it can be decoded while the
+                       rest of the burst, and the PPS, arrive. */
+                    span_log(&s->logging, SPAN_LOG_FLOW, "Block %d complete - passing on %d frames\n", s->ecm_block, s->ecm_frames);
+                    put_ecm_block(s);
+                }
+                /*endif*/
+            }
+            /*endif*/
             /* In case we are just after a CTC/CTR exchange, which kicked us back to long training */
             s->short_train = true;
         }
@@ -4409,6 +4533,9 @@ static void process_state_f_doc_and_post_doc_ecm(t30_state_t *s, const uint8_t *
         case T30_EOM:
         case T30_EOS:
         case T30_MPS:
+            /* The far end has given up on this block. None of it has been passed on, and
+               whatever is sent next starts afresh. */
+            clear_rx_ecm_block(s);
             s->image_carrier_attempted = false;
             s->next_rx_step = fcf2;
             queue_phase(s, T30_PHASE_D_TX);
@@ -4434,6 +4561,8 @@ static void process_state_f_doc_and_post_doc_ecm(t30_state_t *s, const uint8_t *
         }
         /*endif*/
         s->image_carrier_attempted = false;
+        /* Hold any frames which follow until a PPS confirms which block they belong to */
+        s->ecm_block_identified = false;
         /* T.30 says we change back to long training here, whether or not the far end changed the modem type. */
         s->short_train = false;
         queue_phase(s, T30_PHASE_D_TX);
@@ -6667,6 +6796,39 @@ SPAN_DECLARE(void) t30_non_ecm_put_bit(void *user_data, int bit)
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(void) t30_non_ecm_put_bits(void *user_data, uint32_t bits, int nbits)
+{
+    t30_state_t *s;
+    int i;
+    int res;
+
+    s = (t30_state_t *) user_data;
+    if (s->state == T30_STATE_F_DOC_NON_ECM)
+    {
+        /* Image transfer */
+        if ((res = t4_rx_put_bits(&s->t4.rx, bits, nbits)) != T4_DECODE_MORE_DATA)
+        {
+            /* This is the end of the image */
+            if (res != T4_DECODE_OK)
+                span_log(&s->logging, SPAN_LOG_FLOW, "Page ended with status %d\n", res);
+            /*endif*/
+            set_state(s, T30_STATE_F_POST_DOC_NON_ECM);
+            queue_phase(s, T30_PHASE_D_RX);
+            timer_t2_start(s);
+        }
+        /*endif*/
+        return;
+    }
+    /*endif*/
+    for (i = 0;  i < nbits;  i++)
+    {
+        t30_non_ecm_put_bit(user_data, bits & 1);
+        bits >>= 1;
+    }
+    /*endfor*/
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(void) t30_non_ecm_put(void *user_data, const uint8_t buf[], int len)
 {
     t30_state_t *s;
@@ -6759,6 +6921,32 @@ SPAN_DECLARE(int) t30_non_ecm_get_bit(void *user_data)
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t30_non_ecm_get_bits(void *user_data, uint32_t *bits, int nbits)
+{
+    t30_state_t *s;
+    int i;
+    int bit;
+
+    s = (t30_state_t *) user_data;
+    if (s->state == T30_STATE_I)
+    {
+        /* Transferring real data. */
+        return t4_tx_get_bits(&s->t4.tx, bits, nbits);
+    }
+    /*endif*/
+    *bits = 0;
+    for (i = 0;  i < nbits;  i++)
+    {
+        if ((bit = t30_non_ecm_get_bit(user_data)) < 0)
+            break;
+        /*endif*/
+        *bits |= (uint32_t) bit << i;
+    }
+    /*endfor*/
+    return i;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) t30_non_ecm_get(void *user_data, uint8_t buf[], int max_len)
 {
     int len;
@@ -7429,6 +7617,27 @@ SPAN_DECLARE(void) t30_timer_update(t30_state_t *s, int samples)
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t30_timer_next_expiry(t30_state_t *s)
+{
+    int next;
+
+    next = -1;
+    if (s->timer_t0_t1 > 0)
+        next = s->timer_t0_t1;
+    /*endif*/
+    if (s->timer_t3 > 0  &&  (next < 0  ||  s->timer_t3 < next))
+        next = s->timer_t3;
+    /*endif*/
+    if (s->timer_t2_t4 > 0  &&  (next < 0  ||  s->timer_t2_t4 < next))
+        next = s->timer_t2_t4;
+    /*endif*/
+    if (s->timer_t5 > 0  &&  (next < 0  ||  s->timer_t5 < next))
+        next = s->timer_t5;
+    /*endif*/
+    return next;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(void) t30_terminate(t30_state_t *s)
 {
     if (s->phase != T30_PHASE_CALL_FINISHED)
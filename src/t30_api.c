@@ -765,6 +765,16 @@ SPAN_DECLARE(void) t30_set_rx_file(t30_state_t *s, const char *file, int stop_pa
     strncpy(s->rx_file, file, sizeof(s->rx_file));
     s->rx_file[sizeof(s->rx_file) - 1] = '\0';
     s->rx_stop_page = stop_page;
+    s->rx_tiff_write_handler = NULL;
+    s->rx_tiff_write_user_data = NULL;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(void) t30_set_rx_memory(t30_state_t *s, t4_rx_tiff_write_handler_t handler, void *user_data, int stop_page)
+{
+    t30_set_rx_file(s, "", stop_page);
+    s->rx_tiff_write_handler = handler;
+    s->rx_tiff_write_user_data = user_data;
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -774,6 +784,38 @@ SPAN_DECLARE(void) t30_set_tx_file(t30_state_t *s, const char *file, int start_p
     s->tx_file[sizeof(s->tx_file) - 1] = '\0';
     s->tx_start_page = start_page;
     s->tx_stop_page = stop_page;
+    /* Any page index was for the previous file */
+    s->tx_page_index = NULL;
+    s->tx_memory_buf = NULL;
+    s->tx_memory_len = 0;
+    s->tx_pre_encoded_page_handler = NULL;
+    s->tx_pre_encoded_page_user_data = NULL;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(void) t30_set_tx_memory(t30_state_t *s, const uint8_t buf[], size_t len, int start_page, int stop_page)
+{
+    t30_set_tx_file(s, "", start_page, stop_page);
+    s->tx_memory_buf = buf;
+    s->tx_memory_len = len;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(void) t30_set_tx_pre_encoded_page_handler(t30_state_t *s,
+                                                       t4_tx_pre_encoded_page_handler_t handler,
+                                                       void *user_data,
+                                                       int start_page,
+                                                       int stop_page)
+{
+    t30_set_tx_file(s, "", start_page, stop_page);
+    s->tx_pre_encoded_page_handler = handler;
+    s->tx_pre_encoded_page_user_data = user_data;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(void) t30_set_tx_page_index(t30_state_t *s, const t4_tx_page_index_t *index)
+{
+    s->tx_page_index = index;
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -62,6 +62,8 @@
 #include "spandsp/private/t38_core.h"
 
 #define ACCEPTABLE_SEQ_NO_OFFSET                2000
+/*! The largest number of packets t38_core_rx_ifp_packets() puts into sequence order at one time */
+#define MAX_RX_BATCH                            64
 
 /* This is the target time per transmission chunk. The actual
    packet timing will sync to the data octets. */
@@ -768,6 +770,207 @@ SPAN_DECLARE(int) t38_core_rx_ifp_packet(t38_core_state_t *s, const uint8_t *buf
 }
 /*- End of function --------------------------------------------------------*/
 
+static int rx_ifp_batch(t38_core_state_t *s, const uint8_t *bufs[], const int lens[], const uint16_t seq_nos[], int packets)
+{
+    uint16_t key[MAX_RX_BATCH];
+    int order[MAX_RX_BATCH];
+    int base;
+    int ok;
+    int i;
+    int j;
+    int k;
+
+    /* Put the packets in sequence number order, measured from the packet we expect next, so
+       packets reordered within the batch are not lost as late, and the missing packet handler
+       only sees real gaps. Sorting is stable, so duplicates keep their arrival order. */
+    if (s->rx_expected_seq_no >= 0)
+        base = s->rx_expected_seq_no;
+    else
+        base = (seq_nos[0] - ACCEPTABLE_SEQ_NO_OFFSET) & 0xFFFF;
+    /*endif*/
+    for (i = 0;  i < packets;  i++)
+    {
+        key[i] = (uint16_t) (seq_nos[i] - base);
+        for (j = i;  j > 0  &&  key[order[j - 1]] > key[i];  j--)
+            order[j] = order[j - 1];
+        /*endfor*/
+        order[j] = i;
+    }
+    /*endfor*/
+    ok = 0;
+    for (i = 0;  i < packets;  i++)
+    {
+        k = order[i];
+        if (i > 0  &&  key[order[i - 1]] == key[k])
+        {
+            /* A redundant copy of the packet we have just processed */
+            span_log(&s->logging, SPAN_LOG_FLOW, "Rx %5d: Repeat packet number\n", seq_nos[k]);
+            ok++;
+            continue;
+        }
+        /*endif*/
+        if (t38_core_rx_ifp_packet(s, bufs[k], lens[k], seq_nos[k]) >= 0)
+            ok++;
+        /*endif*/
+    }
+    /*endfor*/
+    return ok;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t38_core_rx_ifp_packets(t38_core_state_t *s, const uint8_t *bufs[], const int lens[], const uint16_t seq_nos[], int packets)
+{
+    int chunk;
+    int ok;
+    int i;
+
+    ok = 0;
+    if (!s->check_sequence_numbers)
+    {
+        /* The packets are simply processed in the order they arrived */
+        for (i = 0;  i < packets;  i++)
+        {
+            if (t38_core_rx_ifp_packet(s, bufs[i], lens[i], seq_nos[i]) >= 0)
+                ok++;
+            /*endif*/
+        }
+        /*endfor*/
+        return ok;
+    }
+    /*endif*/
+    for (i = 0;  i < packets;  i += chunk)
+    {
+        chunk = (packets - i < MAX_RX_BATCH)  ?  (packets - i)  :  MAX_RX_BATCH;
+        ok += rx_ifp_batch(s, &bufs[i], &lens[i], &seq_nos[i], chunk);
+    }
+    /*endfor*/
+    return ok;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int t38_indicator_len(t38_core_state_t *s, int indicator)
+{
+    int len;
+
+    len = (s->data_transport_protocol == T38_TRANSPORT_TCP_TPKT)  ?  4  :  0;
+    if (indicator <= T38_IND_V17_14400_LONG_TRAINING)
+        return len + 1;
+    /*endif*/
+    if (s->t38_version != 0  &&  indicator <= T38_IND_V33_14400_TRAINING)
+        return len + 2;
+    /*endif*/
+    return -1;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int t38_data_field_len(t38_core_state_t *s, const t38_data_field_t *q)
+{
+    int len;
+
+    if (s->t38_version == 0)
+    {
+        /* Original version of T.38 with a typo */
+        if (q->field_type > T38_FIELD_T4_NON_ECM_SIG_END)
+            return -1;
+        /*endif*/
+        len = 1;
+    }
+    else
+    {
+        if (q->field_type <= T38_FIELD_T4_NON_ECM_SIG_END)
+            len = 1;
+        else if (q->field_type <= T38_FIELD_V34RATE)
+            len = 2;
+        else
+            return -1;
+        /*endif*/
+    }
+    /*endif*/
+    if (q->field_len > 0)
+    {
+        if (q->field_len > 65535)
+            return -1;
+        /*endif*/
+        len += 2 + q->field_len;
+    }
+    /*endif*/
+    return len;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int t38_data_len(t38_core_state_t *s, int data_type, const t38_data_field_t field[], int fields)
+{
+    int len;
+    int i;
+    int field_len;
+    int data_field_no;
+    unsigned int encoded_len;
+    unsigned int fragment_len;
+    unsigned int value;
+
+    /* This must follow the encoding steps of t38_encode_data exactly, as the encoder relies
+       on it to vet the packet, and to be sure the packet will fit its buffer. */
+    len = (s->data_transport_protocol == T38_TRANSPORT_TCP_TPKT)  ?  4  :  0;
+    if (data_type <= T38_DATA_V17_14400)
+        len += 1;
+    else if (s->t38_version != 0  &&  data_type <= T38_DATA_V33_14400)
+        len += 2;
+    else
+        return -1;
+    /*endif*/
+    if (fields > 0)
+    {
+        encoded_len = 0;
+        data_field_no = 0;
+        do
+        {
+            value = fields - encoded_len;
+            if (value < 0x80)
+            {
+                len += 1;
+                fragment_len = value;
+            }
+            else if (value < 0x4000)
+            {
+                len += 2;
+                fragment_len = value;
+            }
+            else
+            {
+                len += 1;
+                fragment_len = 0x4000*((value/0x4000 < 4)  ?  value/0x4000  :  4);
+            }
+            /*endif*/
+            encoded_len += fragment_len;
+            for (i = 0;  i < (int) fragment_len;  i++)
+            {
+                if ((field_len = t38_data_field_len(s, &field[data_field_no++])) < 0)
+                    return -1;
+                /*endif*/
+                len += field_len;
+            }
+            /*endfor*/
+        }
+        while ((int) encoded_len != fields  ||  fragment_len >= 16384);
+    }
+    /*endif*/
+    return len;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void t38_fill_tpkt_header(uint8_t buf[], int len)
+{
+    /* Fill in the TPKT header (see RFC1006) */
+    /* Version */
+    buf[0] = 3;
+    /* Reserved */
+    buf[1] = 0;
+    /* Packet length - this includes the length of the header itself */
+    put_net_unaligned_uint16(&buf[2], len);
+}
+/*- End of function --------------------------------------------------------*/
+
+/* The packet must already have been vetted by t38_indicator_len(). */
 static int t38_encode_indicator(t38_core_state_t *s, uint8_t buf[], int indicator)
 {
     int len;
@@ -788,31 +991,20 @@ static int t38_encode_indicator(t38_core_state_t *s, uint8_t buf[], int indicato
     {
         buf[len++] = (uint8_t) (indicator << 1);
     }
-    else if (s->t38_version != 0  &&  indicator <= T38_IND_V33_14400_TRAINING)
+    else
     {
         put_net_unaligned_uint16(&buf[len], 0x2000 | ((indicator - T38_IND_V8_ANSAM) << 6));
         len += 2;
     }
-    else
-    {
-        len = -1;
-    }
     /*endif*/
     if (s->data_transport_protocol == T38_TRANSPORT_TCP_TPKT)
-    {
-        /* Fill in the TPKT header (see RFC1006) */
-        /* Version */
-        buf[0] = 3;
-        /* Reserved */
-        buf[1] = 0;
-        /* Packet length - this includes the length of the header itself */
-        put_net_unaligned_uint16(&buf[2], len);
-    }
+        t38_fill_tpkt_header(buf, len);
     /*endif*/
     return len;
 }
 /*- End of function --------------------------------------------------------*/
 
+/* The packet must already have been vetted by t38_data_len(). */
 static int t38_encode_data(t38_core_state_t *s, uint8_t buf[], int data_type, const t38_data_field_t field[], int fields)
 {
     int len;
@@ -826,7 +1018,6 @@ static int t38_encode_data(t38_core_state_t *s, uint8_t buf[], int data_type, co
     unsigned int value;
     uint8_t data_field_present;
     uint8_t field_data_present;
-    char tag[20];
 
     /* Build the IFP packet */
     len = 0;
@@ -847,15 +1038,11 @@ static int t38_encode_data(t38_core_state_t *s, uint8_t buf[], int data_type, co
     {
         buf[len++] = (uint8_t) (data_field_present | 0x40 | (data_type << 1));
     }
-    else if (s->t38_version != 0  &&  data_type <= T38_DATA_V33_14400)
+    else
     {
         put_net_unaligned_uint16(&buf[len], (data_field_present << 8) | 0x6000 | ((data_type - T38_DATA_V8) << 6));
         len += 2;
     }
-    else
-    {
-        return -1;
-    }
     /*endif*/
 
     if (data_field_present)
@@ -890,7 +1077,7 @@ static int t38_encode_data(t38_core_state_t *s, uint8_t buf[], int data_type, co
             fragment_len = enclen;
             encoded_len += fragment_len;
             /* Encode the elements */
-            for (i = 0;  i < (int) encoded_len;  i++)
+            for (i = 0;  i < (int) fragment_len;  i++)
             {
                 q = &field[data_field_no];
                 field_data_present = (uint8_t) (q->field_len > 0);
@@ -898,35 +1085,21 @@ static int t38_encode_data(t38_core_state_t *s, uint8_t buf[], int data_type, co
                 if (s->t38_version == 0)
                 {
                     /* Original version of T.38 with a typo */
-                    if (q->field_type > T38_FIELD_T4_NON_ECM_SIG_END)
-                        return -1;
-                    /*endif*/
                     buf[len++] = (uint8_t) ((field_data_present << 7) | (q->field_type << 4));
                 }
+                else if (q->field_type <= T38_FIELD_T4_NON_ECM_SIG_END)
+                {
+                    buf[len++] = (uint8_t) ((field_data_present << 7) | (q->field_type << 3));
+                }
                 else
                 {
-                    if (q->field_type <= T38_FIELD_T4_NON_ECM_SIG_END)
-                    {
-                        buf[len++] = (uint8_t) ((field_data_present << 7) | (q->field_type << 3));
-                    }
-                    else if (q->field_type <= T38_FIELD_V34RATE)
-                    {
-                        buf[len++] = (uint8_t) ((field_data_present << 7) | 0x40 | ((q->field_type - T38_FIELD_CM_MESSAGE) >> 2));
-                        buf[len++] = (uint8_t) (((q->field_type - T38_FIELD_CM_MESSAGE) << 6) & 0xC0);
-                    }
-                    else
-                    {
-                        return -1;
-                    }
-                    /*endif*/
+                    buf[len++] = (uint8_t) ((field_data_present << 7) | 0x40 | ((q->field_type - T38_FIELD_CM_MESSAGE) >> 2));
+                    buf[len++] = (uint8_t) (((q->field_type - T38_FIELD_CM_MESSAGE) << 6) & 0xC0);
                 }
                 /*endif*/
                 /* Encode field_data */
                 if (field_data_present)
                 {
-                    if (q->field_len < 1  ||  q->field_len > 65535)
-                        return -1;
-                    /*endif*/
                     put_net_unaligned_uint16(&buf[len], q->field_len - 1);
                     len += 2;
                     memcpy(&buf[len], q->field, q->field_len);
@@ -941,44 +1114,56 @@ static int t38_encode_data(t38_core_state_t *s, uint8_t buf[], int data_type, co
     }
     /*endif*/
 
-    for (data_field_no = 0;  data_field_no < fields;  data_field_no++)
-    {
-        span_log(&s->logging,
-                 SPAN_LOG_FLOW,
-                 "Tx %5d: (%d) data %s/%s + %d byte(s)\n",
-                 s->tx_seq_no,
-                 data_field_no,
-                 t38_data_type_to_str(data_type),
-                 t38_field_type_to_str(field[data_field_no].field_type),
-                 field[data_field_no].field_len);
-    }
-    /*endfor*/
-
     if (s->data_transport_protocol == T38_TRANSPORT_TCP_TPKT)
-    {
-        /* Fill in the TPKT header (see RFC1006) */
-        /* Version */
-        buf[0] = 3;
-        /* Reserved */
-        buf[1] = 0;
-        /* Packet length - this includes the length of the header itself */
-        put_net_unaligned_uint16(&buf[2], len);
-    }
+        t38_fill_tpkt_header(buf, len);
     /*endif*/
+    return len;
+}
+/*- End of function --------------------------------------------------------*/
 
-    if (span_log_test(&s->logging, SPAN_LOG_FLOW))
-    {
-        sprintf(tag, "Tx %5d: IFP", s->tx_seq_no);
-        span_log_buf(&s->logging, SPAN_LOG_FLOW, tag, buf, len);
-    }
+SPAN_DECLARE(int) t38_core_encode_indicator(t38_core_state_t *s, uint8_t buf[], int max_len, int indicator)
+{
+    int len;
+
+    if ((len = t38_indicator_len(s, indicator)) < 0  ||  buf == NULL)
+        return len;
     /*endif*/
-    return len;
+    if (len > max_len)
+        return -1;
+    /*endif*/
+    return t38_encode_indicator(s, buf, indicator);
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t38_core_encode_data(t38_core_state_t *s, uint8_t buf[], int max_len, int data_type, const t38_data_field_t field[], int fields)
+{
+    int len;
+
+    if ((len = t38_data_len(s, data_type, field, fields)) < 0  ||  buf == NULL)
+        return len;
+    /*endif*/
+    if (len > max_len)
+        return -1;
+    /*endif*/
+    return t38_encode_data(s, buf, data_type, field, fields);
+}
+/*- End of function --------------------------------------------------------*/
+
+static uint8_t *get_tx_buffer(t38_core_state_t *s, uint8_t local_buf[], int local_buf_len, int len)
+{
+    /* If the application supplies the buffers, the IFP packet is built directly in
+       the place it will be sent from. */
+    if (s->tx_buffer_handler)
+        return s->tx_buffer_handler(s, s->tx_buffer_user_data, len);
+    /*endif*/
+    return (len <= local_buf_len)  ?  local_buf  :  NULL;
 }
 /*- End of function --------------------------------------------------------*/
 
 SPAN_DECLARE(int) t38_core_send_indicator(t38_core_state_t *s, int indicator)
 {
-    uint8_t buf[100];
+    uint8_t local_buf[100];
+    uint8_t *buf;
     int len;
     int delay;
     int transmissions;
@@ -994,12 +1179,19 @@ SPAN_DECLARE(int) t38_core_send_indicator(t38_core_state_t *s, int indicator)
         indicator &= 0xFF;
         if (s->category_control[T38_PACKET_CATEGORY_INDICATOR])
         {
-            if ((len = t38_encode_indicator(s, buf, indicator)) < 0)
+            if ((len = t38_indicator_len(s, indicator)) < 0)
             {
                 span_log(&s->logging, SPAN_LOG_FLOW, "T.38 indicator len is %d\n", len);
                 return len;
             }
             /*endif*/
+            if ((buf = get_tx_buffer(s, local_buf, sizeof(local_buf), len)) == NULL)
+            {
+                span_log(&s->logging, SPAN_LOG_PROTOCOL_WARNING, "No Tx buffer for %d bytes\n", len);
+                return -1;
+            }
+            /*endif*/
+            len = t38_encode_indicator(s, buf, indicator);
             span_log(&s->logging, SPAN_LOG_FLOW, "Tx %5d: indicator %s\n", s->tx_seq_no, t38_indicator_to_str(indicator));
             if (s->tx_packet_handler(s, s->tx_packet_user_data, buf, len, transmissions) < 0)
             {
@@ -1046,40 +1238,53 @@ SPAN_DECLARE(int) t38_core_send_training_delay(t38_core_state_t *s, int indicato
 SPAN_DECLARE(int) t38_core_send_data(t38_core_state_t *s, int data_type, int field_type, const uint8_t field[], int field_len, int category)
 {
     t38_data_field_t field0;
-    uint8_t buf[1000];
-    int len;
 
     field0.field_type = field_type;
     field0.field = field;
     field0.field_len = field_len;
-    if ((len = t38_encode_data(s, buf, data_type, &field0, 1)) < 0)
-    {
-        span_log(&s->logging, SPAN_LOG_FLOW, "T.38 data len is %d\n", len);
-        return len;
-    }
-    /*endif*/
-    if (s->tx_packet_handler(s, s->tx_packet_user_data, buf, len, s->category_control[category]) < 0)
-    {
-        span_log(&s->logging, SPAN_LOG_PROTOCOL_WARNING, "Tx packet handler failure\n");
-        return -1;
-    }
-    /*endif*/
-    s->tx_seq_no = (s->tx_seq_no + 1) & 0xFFFF;
-    return 0;
+    return t38_core_send_data_multi_field(s, data_type, &field0, 1, category);
 }
 /*- End of function --------------------------------------------------------*/
 
 SPAN_DECLARE(int) t38_core_send_data_multi_field(t38_core_state_t *s, int data_type, const t38_data_field_t field[], int fields, int category)
 {
-    uint8_t buf[1000];
+    uint8_t local_buf[1000];
+    uint8_t *buf;
+    char tag[20];
     int len;
+    int i;
 
-    if ((len = t38_encode_data(s, buf, data_type, field, fields)) < 0)
+    if ((len = t38_data_len(s, data_type, field, fields)) < 0)
     {
         span_log(&s->logging, SPAN_LOG_FLOW, "T.38 data len is %d\n", len);
         return len;
     }
     /*endif*/
+    if ((buf = get_tx_buffer(s, local_buf, sizeof(local_buf), len)) == NULL)
+    {
+        span_log(&s->logging, SPAN_LOG_PROTOCOL_WARNING, "No Tx buffer for %d bytes\n", len);
+        return -1;
+    }
+    /*endif*/
+    len = t38_encode_data(s, buf, data_type, field, fields);
+    if (span_log_test(&s->logging, SPAN_LOG_FLOW))
+    {
+        for (i = 0;  i < fields;  i++)
+        {
+            span_log(&s->logging,
+                     SPAN_LOG_FLOW,
+                     "Tx %5d: (%d) data %s/%s + %d byte(s)\n",
+                     s->tx_seq_no,
+                     i,
+                     t38_data_type_to_str(data_type),
+                     t38_field_type_to_str(field[i].field_type),
+                     field[i].field_len);
+        }
+        /*endfor*/
+        sprintf(tag, "Tx %5d: IFP", s->tx_seq_no);
+        span_log_buf(&s->logging, SPAN_LOG_FLOW, tag, buf, len);
+    }
+    /*endif*/
     if (s->tx_packet_handler(s, s->tx_packet_user_data, buf, len, s->category_control[category]) < 0)
     {
         span_log(&s->logging, SPAN_LOG_PROTOCOL_WARNING, "Tx packet handler failure\n");
@@ -1181,6 +1386,13 @@ SPAN_DECLARE(void) t38_set_tx_packet_interval(t38_core_state_t *s, int microseco
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(void) t38_set_tx_buffer_handler(t38_core_state_t *s, t38_tx_buffer_handler_t handler, void *user_data)
+{
+    s->tx_buffer_handler = handler;
+    s->tx_buffer_user_data = user_data;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) t38_get_tx_packet_interval(t38_core_state_t *s)
 {
     return s->microseconds_per_tx_chunk;
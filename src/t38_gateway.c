@@ -305,12 +305,14 @@ static int set_next_tx_type(t38_gateway_state_t *s)
         span_log(&s->logging, SPAN_LOG_FLOW, "HDLC mode\n");
         hdlc_tx_init(&t->hdlc_tx, false, 2, true, hdlc_underflow_handler, s);
         fax_modems_set_get_bit(t, (span_get_bit_func_t) hdlc_tx_get_bit, &t->hdlc_tx);
+        fax_modems_set_get_bits(t, (span_get_bits_func_t) hdlc_tx_get_bits, &t->hdlc_tx);
         use_hdlc = true;
     }
     else
     {
         span_log(&s->logging, SPAN_LOG_FLOW, "Non-ECM mode\n");
         fax_modems_set_get_bit(t, (span_get_bit_func_t) t38_non_ecm_buffer_get_bit, &s->core.non_ecm_to_modem);
+        fax_modems_set_get_bits(t, (span_get_bits_func_t) t38_non_ecm_buffer_get_bits, &s->core.non_ecm_to_modem);
         use_hdlc = false;
     }
     /*endif*/
@@ -1729,6 +1731,32 @@ static void non_ecm_remove_fill_and_put_bit(void *user_data, int bit)
 }
 /*- End of function --------------------------------------------------------*/
 
+static void non_ecm_put_bits(void *user_data, uint32_t bits, int nbits)
+{
+    int i;
+
+    for (i = 0;  i < nbits;  i++)
+    {
+        non_ecm_put_bit(user_data, bits & 1);
+        bits >>= 1;
+    }
+    /*endfor*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static void non_ecm_remove_fill_and_put_bits(void *user_data, uint32_t bits, int nbits)
+{
+    int i;
+
+    for (i = 0;  i < nbits;  i++)
+    {
+        non_ecm_remove_fill_and_put_bit(user_data, bits & 1);
+        bits >>= 1;
+    }
+    /*endfor*/
+}
+/*- End of function --------------------------------------------------------*/
+
 static void hdlc_rx_status(hdlc_rx_state_t *t, int status)
 {
     t38_gateway_state_t *s;
@@ -2101,9 +2129,15 @@ static int restart_rx_modem(t38_gateway_state_t *s)
     else
     {
         if (s->core.image_data_mode  &&  s->core.to_t38.fill_bit_removal)
+        {
             fax_modems_set_put_bit(t, (span_put_bit_func_t) non_ecm_remove_fill_and_put_bit, s);
+            fax_modems_set_put_bits(t, non_ecm_remove_fill_and_put_bits, s);
+        }
         else
+        {
             fax_modems_set_put_bit(t, (span_put_bit_func_t) non_ecm_put_bit, s);
+            fax_modems_set_put_bits(t, non_ecm_put_bits, s);
+        }
         /*endif*/
     }
     /*endif*/
@@ -127,6 +127,24 @@ SPAN_DECLARE(int) t38_non_ecm_buffer_get_bit(void *user_data)
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t38_non_ecm_buffer_get_bits(void *user_data, uint32_t *bits, int nbits)
+{
+    int i;
+    int bit;
+
+    *bits = 0;
+    for (i = 0;  i < nbits;  i++)
+    {
+        if ((bit = t38_non_ecm_buffer_get_bit(user_data)) < 0)
+            break;
+        /*endif*/
+        *bits |= (uint32_t) bit << i;
+    }
+    /*endfor*/
+    return i;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(void) t38_non_ecm_buffer_push(t38_non_ecm_buffer_state_t *s)
 {
     /* Don't flow control the data any more. Just push out the remainder of the data
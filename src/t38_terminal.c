@@ -1215,6 +1215,46 @@ SPAN_DECLARE(int) t38_terminal_send_timeout(t38_terminal_state_t *s, int samples
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t38_terminal_next_send_timeout(t38_terminal_state_t *s)
+{
+    t38_terminal_front_end_state_t *fe;
+    span_sample_timer_t due;
+    int next;
+
+    fe = &s->t38_fe;
+    /* Let t38_terminal_send_timeout() report the end of the call promptly */
+    if (fe->current_rx_type == T30_MODEM_DONE  ||  fe->current_tx_type == T30_MODEM_DONE)
+        return 0;
+    /*endif*/
+    next = t30_timer_next_expiry(&s->t30);
+    if (fe->timeout_rx_samples)
+    {
+        /* The receive timeout fires when the sample count passes it */
+        due = fe->timeout_rx_samples + 1 - fe->samples;
+        if (due < 0)
+            due = 0;
+        /*endif*/
+        if (next < 0  ||  due < next)
+            next = (int) due;
+        /*endif*/
+    }
+    /*endif*/
+    if (fe->timed_step != T38_TIMED_STEP_NONE)
+    {
+        /* Without pacing, the next step is due at once */
+        due = (fe->t38.pace_transmission)  ?  fe->next_tx_samples - fe->samples  :  0;
+        if (due < 0)
+            due = 0;
+        /*endif*/
+        if (next < 0  ||  due < next)
+            next = (int) due;
+        /*endif*/
+    }
+    /*endif*/
+    return next;
+}
+/*- End of function --------------------------------------------------------*/
+
 static void set_rx_type(void *user_data, int type, int bit_rate, int short_train, int use_hdlc)
 {
     t38_terminal_state_t *s;
@@ -73,13 +73,19 @@
 #include "spandsp/private/t85.h"
 #include "spandsp/private/t42.h"
 
-/* The open_memstream() and fmemopen() in older versions of glibc seem quirky */
-#if defined(__GLIBC__)  &&  (__GLIBC__ < 2  ||  (__GLIBC__ == 2  &&  __GLIBC_MINOR__ < 12))
-#undef OPEN_MEMSTREAM
-#endif
-
 #define T42_USE_LUTS
 
+/* The starting size of the buffer for a compressed image. It doubles each time it fills. */
+#define T42_INITIAL_BUF_SIZE    65536
+
+enum
+{
+    T42_ENCODE_NOT_STARTED = 0,
+    T42_ENCODE_RUNNING,
+    T42_ENCODE_FINISHED,
+    T42_ENCODE_FAILED
+};
+
 #include "t42_t43_local.h"
 #if defined(T42_USE_LUTS)
 #include "cielab_luts.h"
@@ -311,6 +317,47 @@ SPAN_DECLARE(int) colour_temp_to_xyz(float xyz[3], float temp)
 }
 /*- End of function --------------------------------------------------------*/
 
+static __inline__ void itu_to_lab(lab_params_t *s, cielab_t *lab, const uint8_t in[3])
+{
+    uint8_t a;
+    uint8_t b;
+
+    /* T.4 E.6.4 */
+    lab->L = s->range_L*(in[0] - s->offset_L);
+    a = in[1];
+    b = in[2];
+    if (s->ab_are_signed)
+    {
+        a += 128;
+        b += 128;
+    }
+    /*endif*/
+    lab->a = s->range_a*(a - s->offset_a);
+    lab->b = s->range_b*(b - s->offset_b);
+}
+/*- End of function --------------------------------------------------------*/
+
+static __inline__ void lab_to_itu(lab_params_t *s, uint8_t out[3], const cielab_t *lab)
+{
+    /* T.4 E.6.4 */
+    out[0] = saturateu8(floorf(lab->L/s->range_L + s->offset_L));
+    out[1] = saturateu8(floorf(lab->a/s->range_a + s->offset_a));
+    out[2] = saturateu8(floorf(lab->b/s->range_b + s->offset_b));
+    if (s->ab_are_signed)
+    {
+        out[1] -= 128;
+        out[2] -= 128;
+    }
+    /*endif*/
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(void) set_lab_precise_conversion(lab_params_t *lab, bool precise)
+{
+    lab->precise = precise;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(void) set_lab_illuminant(lab_params_t *lab, float new_xn, float new_yn, float new_zn)
 {
     if (new_yn > 10.0f)
@@ -430,40 +477,135 @@ void set_gamut_from_code(logging_state_t *logging, lab_params_t *s, const uint8_
 }
 /*- End of function --------------------------------------------------------*/
 
-static __inline__ void itu_to_lab(lab_params_t *s, cielab_t *lab, const uint8_t in[3])
+#if defined(T42_USE_LUTS)
+static __inline__ float lab_f(float t)
 {
-    uint8_t a;
-    uint8_t b;
+    float pos;
+    int i;
 
-    /* T.4 E.6.4 */
-    lab->L = s->range_L*(in[0] - s->offset_L);
-    a = in[1];
-    b = in[2];
-    if (s->ab_are_signed)
+    /* CIELAB f(t), by linear interpolation in a table, instead of a cube root */
+    if (t >= CIELAB_F_RANGE)
+        return cbrtf(t);
+    /*endif*/
+    pos = t*(CIELAB_F_STEPS/CIELAB_F_RANGE);
+    i = (int) pos;
+    return cielab_f[i] + (pos - i)*(cielab_f[i + 1] - cielab_f[i]);
+}
+/*- End of function --------------------------------------------------------*/
+
+static __inline__ float lab_f_inverse(float t)
+{
+    return (t <= 0.2068f)  ?  (0.1284f*(t - 0.1379f))  :  t*t*t;
+}
+/*- End of function --------------------------------------------------------*/
+
+static __inline__ int linear_to_srgb_index(float v)
+{
+    int val;
+
+    val = v*4096.0f;
+    return (val < 0)  ?  0  :  (val < 4095)  ?  val  :  4095;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void srgb_to_lab_fast(lab_params_t *s, uint8_t lab[], const uint8_t srgb[], int pixels)
+{
+    const float *r;
+    const float *g;
+    const float *b;
+    float xx;
+    float yy;
+    float zz;
+    float x_rn;
+    float y_rn;
+    float z_rn;
+    float scale_L;
+    float scale_a;
+    float scale_b;
+    float offset_L;
+    uint8_t sign;
+    int i;
+
+    /* Fold the Lab scaling and the ITU gamut mapping together. Truncation to integer
+       saturates to the same values as flooring would. */
+    x_rn = s->x_rn;
+    y_rn = s->y_rn;
+    z_rn = s->z_rn;
+    scale_L = 116.0f/s->range_L;
+    offset_L = s->offset_L - 16.0f/s->range_L;
+    scale_a = 500.0f/s->range_a;
+    scale_b = 200.0f/s->range_b;
+    sign = (s->ab_are_signed)  ?  128  :  0;
+    for (i = 0;  i < pixels;  i++)
     {
-        a += 128;
-        b += 128;
+        r = srgb_to_xyz[0][srgb[0]];
+        g = srgb_to_xyz[1][srgb[1]];
+        b = srgb_to_xyz[2][srgb[2]];
+        xx = lab_f((r[0] + g[0] + b[0])*x_rn);
+        yy = lab_f((r[1] + g[1] + b[1])*y_rn);
+        zz = lab_f((r[2] + g[2] + b[2])*z_rn);
+        lab[0] = saturateu8((int32_t) (yy*scale_L + offset_L));
+        lab[1] = saturateu8((int32_t) ((xx - yy)*scale_a + s->offset_a)) - sign;
+        lab[2] = saturateu8((int32_t) ((yy - zz)*scale_b + s->offset_b)) - sign;
+        srgb += 3;
+        lab += 3;
     }
-    /*endif*/
-    lab->a = s->range_a*(a - s->offset_a);
-    lab->b = s->range_b*(b - s->offset_b);
+    /*endfor*/
 }
 /*- End of function --------------------------------------------------------*/
 
-static __inline__ void lab_to_itu(lab_params_t *s, uint8_t out[3], const cielab_t *lab)
+static void lab_to_srgb_fast(lab_params_t *s, uint8_t srgb[], const uint8_t lab[], int pixels)
 {
-    /* T.4 E.6.4 */
-    out[0] = saturateu8(floorf(lab->L/s->range_L + s->offset_L));
-    out[1] = saturateu8(floorf(lab->a/s->range_a + s->offset_a));
-    out[2] = saturateu8(floorf(lab->b/s->range_b + s->offset_b));
-    if (s->ab_are_signed)
+    float m[3][3];
+    float lab_from_itu[3][256];
+    cielab_t l;
+    uint8_t in[3];
+    float ll;
+    float x;
+    float y;
+    float z;
+    int i;
+
+    /* Fold the illuminant into the XYZ to linear RGB matrix */
+    m[0][0] =  3.2406f*s->x_n;
+    m[0][1] = -1.5372f*s->y_n;
+    m[0][2] = -0.4986f*s->z_n;
+    m[1][0] = -0.9689f*s->x_n;
+    m[1][1] =  1.8758f*s->y_n;
+    m[1][2] =  0.0415f*s->z_n;
+    m[2][0] =  0.0557f*s->x_n;
+    m[2][1] = -0.2040f*s->y_n;
+    m[2][2] =  1.0570f*s->z_n;
+    /* Tabulate the (L + 16)/116, a/500 and b/200 terms of the Lab to XYZ conversion
+       contributed by each ITU value of L, a and b. */
+    for (i = 0;  i < 256;  i++)
     {
-        out[1] -= 128;
-        out[2] -= 128;
+        in[0] =
+        in[1] =
+        in[2] = (uint8_t) i;
+        itu_to_lab(s, &l, in);
+        lab_from_itu[0][i] = (1.0f/116.0f)*(l.L + 16.0f);
+        lab_from_itu[1][i] = (1.0f/500.0f)*l.a;
+        lab_from_itu[2][i] = (1.0f/200.0f)*l.b;
     }
-    /*endif*/
+    /*endfor*/
+    for (i = 0;  i < pixels;  i++)
+    {
+        ll = lab_from_itu[0][lab[0]];
+        x = lab_f_inverse(ll + lab_from_itu[1][lab[1]]);
+        y = lab_f_inverse(ll);
+        z = lab_f_inverse(ll - lab_from_itu[2][lab[2]]);
+        lab += 3;
+        /* The input and output may be the same buffer, so only write after reading */
+        srgb[0] = linear_to_srgb[linear_to_srgb_index(m[0][0]*x + m[0][1]*y + m[0][2]*z)];
+        srgb[1] = linear_to_srgb[linear_to_srgb_index(m[1][0]*x + m[1][1]*y + m[1][2]*z)];
+        srgb[2] = linear_to_srgb[linear_to_srgb_index(m[2][0]*x + m[2][1]*y + m[2][2]*z)];
+        srgb += 3;
+    }
+    /*endfor*/
 }
 /*- End of function --------------------------------------------------------*/
+#endif
 
 SPAN_DECLARE(void) srgb_to_lab(lab_params_t *s, uint8_t lab[], const uint8_t srgb[], int pixels)
 {
@@ -479,6 +621,14 @@ SPAN_DECLARE(void) srgb_to_lab(lab_params_t *s, uint8_t lab[], const uint8_t srg
     cielab_t l;
     int i;
 
+#if defined(T42_USE_LUTS)
+    if (!s->precise)
+    {
+        srgb_to_lab_fast(s, lab, srgb, pixels);
+        return;
+    }
+    /*endif*/
+#endif
     for (i = 0;  i < 3*pixels;  i += 3)
     {
 #if defined(T42_USE_LUTS)
@@ -535,6 +685,16 @@ SPAN_DECLARE(void) lab_to_srgb(lab_params_t *s, uint8_t srgb[], const uint8_t la
     int val;
     int i;
 
+#if defined(T42_USE_LUTS)
+    /* Making the table for the fast conversion costs about as much as converting
+       a couple of hundred pixels directly. */
+    if (!s->precise  &&  pixels >= 256)
+    {
+        lab_to_srgb_fast(s, srgb, lab, pixels);
+        return;
+    }
+    /*endif*/
+#endif
     for (i = 0;  i < 3*pixels;  i += 3)
     {
         itu_to_lab(s, &l, lab);
@@ -749,10 +909,19 @@ SPAN_DECLARE(void) t42_encode_comment(t42_encode_state_t *s, const uint8_t comme
 }
 /*- End of function --------------------------------------------------------*/
 
+static __inline__ int compressed_buf_fill(t42_encode_state_t *s)
+{
+    return s->buf_size - s->destination.free_in_buffer;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) t42_encode_image_complete(t42_encode_state_t *s)
 {
-    //if (????)
-    //    return SIG_STATUS_END_OF_DATA;
+    if (s->stage == T42_ENCODE_FAILED)
+        return SIG_STATUS_END_OF_DATA;
+    /*endif*/
+    if (s->stage == T42_ENCODE_FINISHED  &&  s->compressed_image_ptr >= compressed_buf_fill(s))
+        return SIG_STATUS_END_OF_DATA;
     /*endif*/
     return 0;
 }
@@ -782,38 +951,107 @@ static struct jpeg_error_mgr encode_error_handler =
 #endif
 };
 
-static int t42_srgb_to_itulab_jpeg(t42_encode_state_t *s)
+/* The compressed image is written straight into a buffer, which grows as needed */
+static void grow_compressed_buf(t42_encode_state_t *s, int new_size)
 {
-    int i;
+    uint8_t *buf;
 
-    if (setjmp(s->escape))
+    if ((buf = (uint8_t *) span_realloc(s->compressed_buf, new_size)) == NULL)
     {
-        if (s->error_message[0])
-            span_log(&s->logging, SPAN_LOG_FLOW, "%s\n", s->error_message);
-        else
-            span_log(&s->logging, SPAN_LOG_FLOW, "Unspecified libjpeg error.\n");
-        /*endif*/
-        if (s->scan_line_out)
-        {
-            span_free(s->scan_line_out);
-            s->scan_line_out = NULL;
-        }
-        /*endif*/
-        if (s->out)
-        {
-            fclose(s->out);
-            s->out = NULL;
-        }
-        /*endif*/
-        return -1;
+        strcpy(s->error_message, "Insufficient memory for the compressed image");
+        longjmp(s->escape, 1);
     }
     /*endif*/
+    s->compressed_buf = buf;
+    s->buf_size = new_size;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void jpg_init_destination(j_compress_ptr cinfo)
+{
+    t42_encode_state_t *s;
+
+    /* libjpeg writes a byte before checking for space, so the buffer must never be empty */
+    s = (t42_encode_state_t *) cinfo->client_data;
+    if (s->buf_size == 0)
+        grow_compressed_buf(s, T42_INITIAL_BUF_SIZE);
+    /*endif*/
+    cinfo->dest->next_output_byte = s->compressed_buf;
+    cinfo->dest->free_in_buffer = s->buf_size;
+}
+/*- End of function --------------------------------------------------------*/
+
+static boolean jpg_empty_output_buffer(j_compress_ptr cinfo)
+{
+    t42_encode_state_t *s;
+    int used;
+
+    /* This is only called when the buffer is completely full */
+    s = (t42_encode_state_t *) cinfo->client_data;
+    used = s->buf_size;
+    grow_compressed_buf(s, 2*s->buf_size);
+    cinfo->dest->next_output_byte = &s->compressed_buf[used];
+    cinfo->dest->free_in_buffer = s->buf_size - used;
+    return true;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void jpg_term_destination(j_compress_ptr cinfo)
+{
+}
+/*- End of function --------------------------------------------------------*/
+
+static void discard_sent_data(t42_encode_state_t *s)
+{
+    int unsent;
+
+    /* Once at least half the data in the buffer has been sent, move what is left back
+       to the start of the buffer. This keeps the buffer to about the size of the chunks
+       being requested, plus the output from one row of MCUs. */
+    unsent = compressed_buf_fill(s) - s->compressed_image_ptr;
+    if (s->compressed_image_ptr == 0  ||  unsent > s->compressed_image_ptr)
+        return;
+    /*endif*/
+    if (unsent > 0)
+        memmove(s->compressed_buf, &s->compressed_buf[s->compressed_image_ptr], unsent);
+    /*endif*/
+    s->buf_offset += s->compressed_image_ptr;
+    s->destination.next_output_byte -= s->compressed_image_ptr;
+    s->destination.free_in_buffer += s->compressed_image_ptr;
+    s->compressed_image_ptr = 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void free_scan_lines(t42_encode_state_t *s)
+{
+    if (s->scan_line_in)
+    {
+        span_free(s->scan_line_in);
+        s->scan_line_in = NULL;
+    }
+    /*endif*/
+    if (s->scan_line_out)
+    {
+        span_free(s->scan_line_out);
+        s->scan_line_out = NULL;
+    }
+    /*endif*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static int start_compression(t42_encode_state_t *s)
+{
+    int rows;
 
     s->compressor.err = jpeg_std_error(&encode_error_handler);
     s->compressor.client_data = (void *) s;
 
     jpeg_create_compress(&s->compressor);
-    jpeg_stdio_dest(&s->compressor, s->out);
+    s->destination.init_destination = jpg_init_destination;
+    s->destination.empty_output_buffer = jpg_empty_output_buffer;
+    s->destination.term_destination = jpg_term_destination;
+    s->compressor.dest = &s->destination;
+    s->stage = T42_ENCODE_RUNNING;
 
     /* Force the destination colour space */
     if (s->image_type == T4_IMAGE_TYPE_COLOUR_8BIT)
@@ -860,80 +1098,138 @@ static int t42_srgb_to_itulab_jpeg(t42_encode_state_t *s)
 
     set_itu_fax(s);
 
-    if ((s->scan_line_in = (JSAMPROW) span_alloc(s->samples_per_pixel*s->image_width)) == NULL)
+    /* When the image arrives in strips, the scan line buffers hold a whole strip */
+    rows = (s->strip_read_handler)  ?  T4_STRIP_ROWS  :  1;
+    if ((s->scan_line_in = (JSAMPROW) span_alloc(rows*s->samples_per_pixel*s->image_width)) == NULL)
         return -1;
     /*endif*/
-
     if (s->image_type == T4_IMAGE_TYPE_COLOUR_8BIT)
     {
-        if ((s->scan_line_out = (JSAMPROW) span_alloc(s->samples_per_pixel*s->image_width)) == NULL)
+        if ((s->scan_line_out = (JSAMPROW) span_alloc(rows*s->samples_per_pixel*s->image_width)) == NULL)
             return -1;
         /*endif*/
-
-        for (i = 0;  i < s->compressor.image_height;  i++)
-        {
-            s->row_read_handler(s->row_read_user_data, s->scan_line_in, s->samples_per_pixel*s->image_width);
-            srgb_to_lab(&s->lab, s->scan_line_out, s->scan_line_in, s->image_width);
-            jpeg_write_scanlines(&s->compressor, &s->scan_line_out, 1);
-        }
-        /*endfor*/
-    }
-    else
-    {
-        for (i = 0;  i < s->compressor.image_height;  i++)
-        {
-            s->row_read_handler(s->row_read_user_data, s->scan_line_in, s->image_width);
-            jpeg_write_scanlines(&s->compressor, &s->scan_line_in, 1);
-        }
-        /*endfor*/
     }
     /*endif*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
 
-    if (s->scan_line_out)
-    {
-        span_free(s->scan_line_out);
-        s->scan_line_out = NULL;
-    }
+static void stop_compression(t42_encode_state_t *s)
+{
+    free_scan_lines(s);
+    if (s->stage == T42_ENCODE_RUNNING)
+        jpeg_destroy_compress(&s->compressor);
     /*endif*/
-    jpeg_finish_compress(&s->compressor);
-    jpeg_destroy_compress(&s->compressor);
+}
+/*- End of function --------------------------------------------------------*/
 
-#if defined(HAVE_OPEN_MEMSTREAM)
-    fclose(s->out);
-    s->buf_size =
-    s->compressed_image_size = s->outsize;
-#else
-    s->buf_size =
-    s->compressed_image_size = ftell(s->out);
-    if ((s->compressed_buf = span_alloc(s->compressed_image_size)) == NULL)
+static int write_strip(t42_encode_state_t *s)
+{
+    JSAMPROW row_pointers[T4_STRIP_ROWS];
+    JSAMPROW strip;
+    size_t len;
+    int max_rows;
+    int rows;
+    int i;
+
+    len = s->samples_per_pixel*s->image_width;
+    max_rows = s->compressor.image_height - s->compressor.next_scanline;
+    if (max_rows > T4_STRIP_ROWS)
+        max_rows = T4_STRIP_ROWS;
+    /*endif*/
+    if ((rows = s->strip_read_handler(s->strip_read_user_data, s->scan_line_in, len, len, max_rows)) <= 0)
         return -1;
     /*endif*/
-    if (fseek(s->out, 0, SEEK_SET) != 0)
+    if (rows > max_rows)
+        rows = max_rows;
+    /*endif*/
+    if (s->image_type == T4_IMAGE_TYPE_COLOUR_8BIT)
     {
-        fclose(s->out);
-        s->out = NULL;
-        span_free(s->compressed_buf);
-        s->compressed_buf = NULL;
-        return -1;
+        /* The strip is contiguous, so the whole of it can be converted in one go */
+        srgb_to_lab(&s->lab, s->scan_line_out, s->scan_line_in, rows*s->image_width);
+        strip = s->scan_line_out;
+    }
+    else
+    {
+        strip = s->scan_line_in;
     }
     /*endif*/
-    if (fread(s->compressed_buf, 1, s->compressed_image_size, s->out) != s->compressed_image_size)
+    for (i = 0;  i < rows;  i++)
+        row_pointers[i] = strip + i*len;
+    /*endfor*/
+    jpeg_write_scanlines(&s->compressor, row_pointers, rows);
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int t42_srgb_to_itulab_jpeg(t42_encode_state_t *s, int wanted)
+{
+    if (setjmp(s->escape))
     {
-        fclose(s->out);
-        s->out = NULL;
-        span_free(s->compressed_buf);
-        s->compressed_buf = NULL;
+        if (s->error_message[0])
+            span_log(&s->logging, SPAN_LOG_FLOW, "%s\n", s->error_message);
+        else
+            span_log(&s->logging, SPAN_LOG_FLOW, "Unspecified libjpeg error.\n");
+        /*endif*/
+        stop_compression(s);
+        s->stage = T42_ENCODE_FAILED;
         return -1;
     }
     /*endif*/
-    if (s->out)
+
+    if (s->stage == T42_ENCODE_NOT_STARTED)
     {
-        fclose(s->out);
-        s->out = NULL;
+        if (start_compression(s))
+        {
+            stop_compression(s);
+            s->stage = T42_ENCODE_FAILED;
+            return -1;
+        }
+        /*endif*/
     }
     /*endif*/
-#endif
-
+    /* Only compress enough rows to satisfy the current request, so the data can start
+       flowing long before the whole image has been compressed. libjpeg releases its
+       output a row of MCUs at a time. */
+    while (s->stage == T42_ENCODE_RUNNING  &&  compressed_buf_fill(s) - s->compressed_image_ptr < wanted)
+    {
+        if (s->compressor.next_scanline < s->compressor.image_height)
+        {
+            if (s->strip_read_handler)
+            {
+                if (write_strip(s))
+                {
+                    span_log(&s->logging, SPAN_LOG_FLOW, "Image source ran out after %d rows.\n", s->compressor.next_scanline);
+                    stop_compression(s);
+                    s->stage = T42_ENCODE_FAILED;
+                    return -1;
+                }
+                /*endif*/
+            }
+            else if (s->image_type == T4_IMAGE_TYPE_COLOUR_8BIT)
+            {
+                s->row_read_handler(s->row_read_user_data, s->scan_line_in, s->samples_per_pixel*s->image_width);
+                srgb_to_lab(&s->lab, s->scan_line_out, s->scan_line_in, s->image_width);
+                jpeg_write_scanlines(&s->compressor, &s->scan_line_out, 1);
+            }
+            else
+            {
+                s->row_read_handler(s->row_read_user_data, s->scan_line_in, s->image_width);
+                jpeg_write_scanlines(&s->compressor, &s->scan_line_in, 1);
+            }
+            /*endif*/
+        }
+        else
+        {
+            free_scan_lines(s);
+            jpeg_finish_compress(&s->compressor);
+            jpeg_destroy_compress(&s->compressor);
+            s->stage = T42_ENCODE_FINISHED;
+        }
+        /*endif*/
+    }
+    /*endwhile*/
+    s->compressed_image_size = s->buf_offset + compressed_buf_fill(s);
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
@@ -942,23 +1238,22 @@ SPAN_DECLARE(int) t42_encode_get(t42_encode_state_t *s, uint8_t buf[], size_t ma
 {
     int len;
 
-    if (s->compressed_image_size == 0)
+    if (s->stage == T42_ENCODE_FAILED)
+        return -1;
+    /*endif*/
+    if (t42_srgb_to_itulab_jpeg(s, max_len))
     {
-        if (t42_srgb_to_itulab_jpeg(s))
-        {
-            span_log(&s->logging, SPAN_LOG_FLOW, "Failed to convert to ITULAB.\n");
-            return -1;
-        }
-        /*endif*/
+        span_log(&s->logging, SPAN_LOG_FLOW, "Failed to convert to ITULAB.\n");
+        return -1;
     }
     /*endif*/
-    if (s->compressed_image_size >= s->compressed_image_ptr + max_len)
+    len = compressed_buf_fill(s) - s->compressed_image_ptr;
+    if (len > max_len)
         len = max_len;
-    else
-        len = s->compressed_image_size - s->compressed_image_ptr;
     /*endif*/
     memcpy(buf, &s->compressed_buf[s->compressed_image_ptr], len);
     s->compressed_image_ptr += len;
+    discard_sent_data(s);
     return len;
 }
 /*- End of function --------------------------------------------------------*/
@@ -991,6 +1286,20 @@ SPAN_DECLARE(int) t42_encode_set_row_read_handler(t42_encode_state_t *s,
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t42_encode_set_strip_read_handler(t42_encode_state_t *s,
+                                                    t4_strip_read_handler_t handler,
+                                                    void *user_data)
+{
+    /* The scan line buffers are sized when compression starts */
+    if (s->stage == T42_ENCODE_RUNNING)
+        return -1;
+    /*endif*/
+    s->strip_read_handler = handler;
+    s->strip_read_user_data = user_data;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(logging_state_t *) t42_encode_get_logging_state(t42_encode_state_t *s)
 {
     return &s->logging;
@@ -1018,30 +1327,16 @@ SPAN_DECLARE(int) t42_encode_restart(t42_encode_state_t *s, uint32_t image_width
         set_lab_illuminant(&s->lab, 100.0f, 100.0f, 100.0f);
         set_lab_gamut(&s->lab, 0, 100, -85, 85, -75, 125, false);
     }
+    stop_compression(s);
+    s->stage = T42_ENCODE_NOT_STARTED;
     s->compressed_image_size = 0;
     s->compressed_image_ptr = 0;
+    s->buf_offset = 0;
 
     s->spatial_resolution = 200;
 
     s->error_message[0] = '\0';
 
-#if defined(HAVE_OPEN_MEMSTREAM)
-    s->outsize = 0;
-    if ((s->out = open_memstream((char **) &s->compressed_buf, &s->outsize)) == NULL)
-    {
-        span_log(&s->logging, SPAN_LOG_FLOW, "Failed to open_memstream().\n");
-        return -1;
-    }
-    /*endif*/
-#else
-    if ((s->out = tmpfile()) == NULL)
-    {
-        span_log(&s->logging, SPAN_LOG_FLOW, "Failed to tmpfile().\n");
-        return -1;
-        /*endif*/
-    }
-    /*endif*/
-#endif
     s->scan_line_out = NULL;
 
     return 0;
@@ -1079,6 +1374,15 @@ SPAN_DECLARE(t42_encode_state_t *) t42_encode_init(t42_encode_state_t *s,
 
 SPAN_DECLARE(int) t42_encode_release(t42_encode_state_t *s)
 {
+    stop_compression(s);
+    s->stage = T42_ENCODE_NOT_STARTED;
+    if (s->compressed_buf)
+    {
+        span_free(s->compressed_buf);
+        s->compressed_buf = NULL;
+    }
+    /*endif*/
+    s->buf_size = 0;
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
@@ -1117,43 +1421,99 @@ static struct jpeg_error_mgr decode_error_handler =
 #endif
 };
 
-static int t42_itulab_jpeg_to_srgb(t42_decode_state_t *s)
+/* The compressed image is read straight from the buffer it was collected in */
+static void jpg_init_source(j_decompress_ptr cinfo)
 {
-    int i;
+}
+/*- End of function --------------------------------------------------------*/
 
-    if (s->compressed_buf == NULL)
-        return -1;
-    /*endif*/
+static boolean jpg_fill_input_buffer(j_decompress_ptr cinfo)
+{
+    static const JOCTET eoi[2] =
+    {
+        0xFF, JPEG_EOI
+    };
+
+    /* All the data was supplied at the start, so the image has been truncated. Let
+       libjpeg finish with what it has, by feeding it an end of image marker. */
+    cinfo->src->next_input_byte = eoi;
+    cinfo->src->bytes_in_buffer = 2;
+    return true;
+}
+/*- End of function --------------------------------------------------------*/
 
-#if defined(HAVE_OPEN_MEMSTREAM)
-    if ((s->in = fmemopen(s->compressed_buf, s->compressed_image_size, "r")) == NULL)
+static void jpg_skip_input_data(j_decompress_ptr cinfo, long int num_bytes)
+{
+    if (num_bytes <= 0)
+        return;
+    /*endif*/
+    if ((size_t) num_bytes > cinfo->src->bytes_in_buffer)
     {
-        span_log(&s->logging, SPAN_LOG_FLOW, "Failed to fmemopen().\n");
-        return -1;
+        jpg_fill_input_buffer(cinfo);
+        return;
     }
     /*endif*/
-#else
-    if ((s->in = tmpfile()) == NULL)
-    {
-        span_log(&s->logging, SPAN_LOG_FLOW, "Failed to tmpfile().\n");
+    cinfo->src->next_input_byte += num_bytes;
+    cinfo->src->bytes_in_buffer -= num_bytes;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void jpg_term_source(j_decompress_ptr cinfo)
+{
+}
+/*- End of function --------------------------------------------------------*/
+
+static int read_strips(t42_decode_state_t *s)
+{
+    JSAMPROW row_pointers[T4_STRIP_ROWS];
+    JSAMPROW strip;
+    size_t len;
+    int rows;
+    int i;
+
+    len = s->samples_per_pixel*s->image_width;
+    if ((s->scan_line_in = span_alloc(T4_STRIP_ROWS*len)) == NULL)
         return -1;
-    }
     /*endif*/
-    if (fwrite(s->compressed_buf, 1, s->compressed_image_size, s->in) != s->compressed_image_size)
+    strip = s->scan_line_in;
+    if (s->samples_per_pixel == 3)
     {
-        fclose(s->in);
-        s->in = NULL;
-        return -1;
+        if ((s->scan_line_out = span_alloc(T4_STRIP_ROWS*len)) == NULL)
+            return -1;
+        /*endif*/
+        strip = s->scan_line_out;
     }
     /*endif*/
-    if (fseek(s->in, 0, SEEK_SET) != 0)
+    for (i = 0;  i < T4_STRIP_ROWS;  i++)
+        row_pointers[i] = s->scan_line_in + i*len;
+    /*endfor*/
+    while (s->decompressor.output_scanline < s->image_length)
     {
-        fclose(s->in);
-        s->in = NULL;
-        return -1;
+        /* libjpeg may return fewer rows than we ask for, but never crosses a row of MCUs */
+        rows = 0;
+        while (rows < T4_STRIP_ROWS  &&  s->decompressor.output_scanline < s->image_length)
+            rows += jpeg_read_scanlines(&s->decompressor, &row_pointers[rows], T4_STRIP_ROWS - rows);
+        /*endwhile*/
+        if (s->samples_per_pixel == 3)
+            lab_to_srgb(&s->lab, s->scan_line_out, s->scan_line_in, rows*s->image_width);
+        /*endif*/
+        s->strip_write_handler(s->strip_write_user_data, strip, len, len, rows);
     }
+    /*endwhile*/
+    /* Tell the handler the image is complete */
+    s->strip_write_handler(s->strip_write_user_data, NULL, 0, 0, 0);
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int t42_itulab_jpeg_to_srgb(t42_decode_state_t *s)
+{
+    int i;
+
+    if (s->compressed_buf == NULL)
+        return -1;
     /*endif*/
-#endif
+
     s->scan_line_out = NULL;
 
     if (setjmp(s->escape))
@@ -1169,12 +1529,6 @@ static int t42_itulab_jpeg_to_srgb(t42_decode_state_t *s)
             s->scan_line_out = NULL;
         }
         /*endif*/
-        if (s->in)
-        {
-            fclose(s->in);
-            s->in = NULL;
-        }
-        /*endif*/
         return -1;
     }
     /* Create input decompressor. */
@@ -1182,7 +1536,14 @@ static int t42_itulab_jpeg_to_srgb(t42_decode_state_t *s)
     s->decompressor.client_data = (void *) s;
 
     jpeg_create_decompress(&s->decompressor);
-    jpeg_stdio_src(&s->decompressor, s->in);
+    s->source.init_source = jpg_init_source;
+    s->source.fill_input_buffer = jpg_fill_input_buffer;
+    s->source.skip_input_data = jpg_skip_input_data;
+    s->source.resync_to_restart = jpeg_resync_to_restart;
+    s->source.term_source = jpg_term_source;
+    s->source.next_input_byte = s->compressed_buf;
+    s->source.bytes_in_buffer = s->compressed_image_size;
+    s->decompressor.src = &s->source;
 
     /* Get the FAX tags */
     for (i = 0;  i < 16;  i++)
@@ -1230,32 +1591,41 @@ static int t42_itulab_jpeg_to_srgb(t42_decode_state_t *s)
 
     jpeg_start_decompress(&s->decompressor);
 
-    if ((s->scan_line_in = span_alloc(s->samples_per_pixel*s->image_width)) == NULL)
-        return -1;
-    /*endif*/
-
-    if (s->samples_per_pixel == 3)
+    if (s->strip_write_handler)
     {
-        if ((s->scan_line_out = span_alloc(s->samples_per_pixel*s->image_width)) == NULL)
+        if (read_strips(s))
             return -1;
         /*endif*/
-
-        while (s->decompressor.output_scanline < s->image_length)
-        {
-            jpeg_read_scanlines(&s->decompressor, &s->scan_line_in, 1);
-            lab_to_srgb(&s->lab, s->scan_line_out, s->scan_line_in, s->image_width);
-            s->row_write_handler(s->row_write_user_data, s->scan_line_out, s->samples_per_pixel*s->image_width);
-        }
-        /*endwhile*/
     }
     else
     {
-        while (s->decompressor.output_scanline < s->image_length)
+        if ((s->scan_line_in = span_alloc(s->samples_per_pixel*s->image_width)) == NULL)
+            return -1;
+        /*endif*/
+        if (s->samples_per_pixel == 3)
         {
-            jpeg_read_scanlines(&s->decompressor, &s->scan_line_in, 1);
-            s->row_write_handler(s->row_write_user_data, s->scan_line_in, s->image_width);
+            if ((s->scan_line_out = span_alloc(s->samples_per_pixel*s->image_width)) == NULL)
+                return -1;
+            /*endif*/
+
+            while (s->decompressor.output_scanline < s->image_length)
+            {
+                jpeg_read_scanlines(&s->decompressor, &s->scan_line_in, 1);
+                lab_to_srgb(&s->lab, s->scan_line_out, s->scan_line_in, s->image_width);
+                s->row_write_handler(s->row_write_user_data, s->scan_line_out, s->samples_per_pixel*s->image_width);
+            }
+            /*endwhile*/
         }
-        /*endwhile*/
+        else
+        {
+            while (s->decompressor.output_scanline < s->image_length)
+            {
+                jpeg_read_scanlines(&s->decompressor, &s->scan_line_in, 1);
+                s->row_write_handler(s->row_write_user_data, s->scan_line_in, s->image_width);
+            }
+            /*endwhile*/
+        }
+        /*endif*/
     }
     /*endif*/
 
@@ -1273,8 +1643,6 @@ static int t42_itulab_jpeg_to_srgb(t42_decode_state_t *s)
     /*endif*/
     jpeg_finish_decompress(&s->decompressor);
     jpeg_destroy_decompress(&s->decompressor);
-    fclose(s->in);
-    s->in = NULL;
 
     return 0;
 }
@@ -1354,6 +1722,16 @@ SPAN_DECLARE(int) t42_decode_set_row_write_handler(t42_decode_state_t *s,
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t42_decode_set_strip_write_handler(t42_decode_state_t *s,
+                                                     t4_strip_write_handler_t handler,
+                                                     void *user_data)
+{
+    s->strip_write_handler = handler;
+    s->strip_write_user_data = user_data;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) t42_decode_set_comment_handler(t42_decode_state_t *s,
                                                  uint32_t max_comment_len,
                                                  t4_row_write_handler_t handler,
@@ -1469,12 +1847,13 @@ SPAN_DECLARE(int) t42_decode_release(t42_decode_state_t *s)
     }
     /*endif*/
     jpeg_destroy_decompress(&s->decompressor);
-    if (s->in)
+    if (s->compressed_buf)
     {
-        fclose(s->in);
-        s->in = NULL;
+        span_free(s->compressed_buf);
+        s->compressed_buf = NULL;
     }
     /*endif*/
+    s->buf_size = 0;
     if (s->comment)
     {
         span_free(s->comment);
@@ -298,6 +298,16 @@ SPAN_DECLARE(int) t43_encode_set_row_read_handler(t43_encode_state_t *s,
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t43_encode_set_strip_read_handler(t43_encode_state_t *s,
+                                                    t4_strip_read_handler_t handler,
+                                                    void *user_data)
+{
+    s->strip_read_handler = handler;
+    s->strip_read_user_data = user_data;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(logging_state_t *) t43_encode_get_logging_state(t43_encode_state_t *s)
 {
     return &s->logging;
@@ -353,7 +363,6 @@ SPAN_DECLARE(int) t43_encode_free(t43_encode_state_t *s)
 {
     int ret;
 
-    t85_encode_release(&s->t85);
     ret = t43_encode_release(s);
     span_free(s);
     return ret;
@@ -680,17 +689,22 @@ static int t43_analyse_header(t43_decode_state_t *s, const uint8_t data[], size_
 }
 /*- End of function --------------------------------------------------------*/
 
-static int t85_row_write_handler(void *user_data, const uint8_t buf[], size_t len)
+static int t85_strip_write_handler(void *user_data, const uint8_t buf[], size_t len, size_t stride, int rows)
 {
     t43_decode_state_t *s;
+    uint8_t *p;
+    uint64_t mask;
+    uint64_t w;
+    int whole_bytes;
+    int image_size;
     int i;
     int j;
-    int image_size;
-    uint8_t mask;
+    int k;
 
-    /* Repack the bit packed T.85 image plane to a 3 x 8 bits per pixel colour image.
-       We use the red entry now. This will be remapped to RGB later, as we apply the
-       colour map. */
+    /* Merge a strip of rows of the current bit-plane into the image. The image is held
+       as one byte per pixel, holding the pixel's colour map index, which is built up a
+       bit at a time as the bit-planes arrive. This will be remapped to the output pixel
+       format later, as we apply the colour map. */
     s = (t43_decode_state_t *) user_data;
 
     if (s->buf == NULL)
@@ -703,46 +717,97 @@ static int t85_row_write_handler(void *user_data, const uint8_t buf[], size_t le
     }
     /*endif*/
 
-    for (i = 0;  i < len;  i++)
+    /* Each byte of the bit-plane spreads to 8 index bytes in one 64 bit operation */
+    mask = s->bit_plane_mask*UINT64_C(0x0101010101010101);
+    whole_bytes = s->t85.xd >> 3;
+    for (k = 0;  k < rows  &&  s->row < s->t85.yd;  k++)
     {
-        mask = 0x80;
-        if (s->samples_per_pixel == 1)
+        p = &s->buf[s->row*s->t85.xd];
+        for (i = 0;  i < whole_bytes;  i++)
         {
-            for (j = 0;  j < 8;  j += s->samples_per_pixel)
+            if (buf[i])
             {
-                if ((buf[i] & mask))
-                    s->buf[s->ptr + j] |= s->bit_plane_mask;
-                /*endif*/
-                mask >>= 1;
+                memcpy(&w, p, sizeof(w));
+                w |= s->plane_spread[buf[i]] & mask;
+                memcpy(p, &w, sizeof(w));
             }
-            /*endfor*/
+            /*endif*/
+            p += 8;
         }
-        else
+        /*endfor*/
+        /* Any odd pixels at the end of the row */
+        for (j = 0;  j < (s->t85.xd & 7);  j++)
         {
-            for (j = 0;  j < s->samples_per_pixel*8;  j += s->samples_per_pixel)
-            {
-                if ((buf[i] & mask))
-                    s->buf[s->ptr + j] |= s->bit_plane_mask;
-                /*endif*/
-                mask >>= 1;
-            }
-            /*endfor*/
+            if ((buf[i] & (0x80 >> j)))
+                p[j] |= s->bit_plane_mask;
+            /*endif*/
         }
-        /*endif*/
-        s->ptr += s->samples_per_pixel*8;
+        /*endfor*/
+        buf += stride;
+        s->row++;
     }
     /*endfor*/
-    s->row++;
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
 
+static void make_plane_spread(t43_decode_state_t *s)
+{
+    uint8_t spread[8];
+    int i;
+    int j;
+
+    /* Build it byte by byte, so the table suits the machine's byte order */
+    for (i = 0;  i < 256;  i++)
+    {
+        for (j = 0;  j < 8;  j++)
+            spread[j] = (i & (0x80 >> j))  ?  0xFF  :  0x00;
+        /*endfor*/
+        memcpy(&s->plane_spread[i], spread, sizeof(spread));
+    }
+    /*endfor*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static void apply_colour_map(t43_decode_state_t *s, int pixels)
+{
+    const uint8_t *entry;
+    uint8_t *p;
+    int i;
+
+    if (s->samples_per_pixel == 1)
+    {
+        for (i = 0;  i < pixels;  i++)
+            s->buf[i] = s->colour_map[s->buf[i]];
+        /*endfor*/
+        return;
+    }
+    /*endif*/
+    /* The output pixels are bigger than the index bytes they replace, so work backwards
+       through the image, to expand it in place. */
+    for (i = pixels - 1;  i >= 0;  i--)
+    {
+        entry = &s->colour_map[3*s->buf[i]];
+        p = &s->buf[s->samples_per_pixel*i];
+        p[0] = entry[0];
+        p[1] = entry[1];
+        p[2] = entry[2];
+        if (s->samples_per_pixel == 4)
+            p[3] = 0;
+        /*endif*/
+    }
+    /*endfor*/
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) t43_decode_put(t43_decode_state_t *s, const uint8_t data[], size_t len)
 {
     int i;
     int j;
+    int rows;
+    int row_len;
     int plane_len;
-    int total_len;
+    int pixels;
     int result;
 
     /* TODO: this isn't allowing for the header arriving in chunks */
@@ -757,16 +822,21 @@ SPAN_DECLARE(int) t43_decode_put(t43_decode_state_t *s, const uint8_t data[], si
         /* There must be at least one bit plane. The real value for this will
            be filled in as the first plane is processed */
         s->t85.bit_planes = 1;
-        s->ptr = 0;
         s->row = 0;
-        s->buf = NULL;
+        if (s->buf)
+        {
+            span_free(s->buf);
+            s->buf = NULL;
+        }
+        /*endif*/
         s->plane_ptr = 0;
         t85_decode_new_plane(&s->t85);
     }
     /*endif*/
 
-    /* Now deal the bit-planes, one after another. */
-    total_len = 0;
+    /* Now deal the bit-planes, one after another. They are sent one after the other, so
+       each must be completely decoded before the next can start. */
+    pixels = 0;
     result = 0;
     while (s->current_bit_plane < s->t85.bit_planes)
     {
@@ -780,39 +850,39 @@ SPAN_DECLARE(int) t43_decode_put(t43_decode_state_t *s, const uint8_t data[], si
         plane_len = t85_decode_get_compressed_image_size(&s->t85);
         data += (plane_len/8 - s->plane_ptr);
         len -= (plane_len/8 - s->plane_ptr);
-        total_len = s->ptr;
+        pixels = s->row*s->t85.xd;
 
         /* Start the next plane */
         s->bit_plane_mask >>= 1;
-        s->ptr = 0;
         s->row = 0;
         s->plane_ptr = 0;
         s->current_bit_plane++;
         t85_decode_new_plane(&s->t85);
     }
     /*endwhile*/
+    if (s->buf == NULL)
+        return result;
+    /*endif*/
     /* Apply the colour map, and produce the RGB data from the collected bit-planes */
-    if (s->samples_per_pixel == 1)
+    apply_colour_map(s, pixels);
+    row_len = s->samples_per_pixel*s->t85.xd;
+    if (s->strip_write_handler)
     {
-        for (j = 0;  j < total_len;  j += s->samples_per_pixel)
-            s->buf[j] = s->colour_map[s->buf[j]];
+        /* The whole image is already in memory, so just pass it on a strip at a time */
+        for (j = 0;  j < s->t85.yd;  j += rows)
+        {
+            rows = (s->t85.yd - j < T4_STRIP_ROWS)  ?  (s->t85.yd - j)  :  T4_STRIP_ROWS;
+            s->strip_write_handler(s->strip_write_user_data, &s->buf[j*row_len], row_len, row_len, rows);
+        }
         /*endfor*/
     }
     else
     {
-        for (j = 0;  j < total_len;  j += s->samples_per_pixel)
-        {
-            i = s->buf[j];
-            s->buf[j] = s->colour_map[3*i];
-            s->buf[j + 1] = s->colour_map[3*i + 1];
-            s->buf[j + 2] = s->colour_map[3*i + 2];
-        }
+        for (j = 0;  j < s->t85.yd;  j++)
+            s->row_write_handler(s->row_write_user_data, &s->buf[j*row_len], row_len);
         /*endfor*/
     }
     /*endif*/
-    for (j = 0;  j < s->t85.yd;  j++)
-        s->row_write_handler(s->row_write_user_data, &s->buf[j*s->samples_per_pixel*s->t85.xd], s->samples_per_pixel*s->t85.xd);
-    /*endfor*/
     return result;
 }
 /*- End of function --------------------------------------------------------*/
@@ -823,8 +893,16 @@ SPAN_DECLARE(int) t43_decode_set_row_write_handler(t43_decode_state_t *s,
 {
     s->row_write_handler = handler;
     s->row_write_user_data = user_data;
-    s->t85.row_write_handler = handler;
-    s->t85.row_write_user_data = user_data;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t43_decode_set_strip_write_handler(t43_decode_state_t *s,
+                                                     t4_strip_write_handler_t handler,
+                                                     void *user_data)
+{
+    s->strip_write_handler = handler;
+    s->strip_write_user_data = user_data;
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
@@ -906,7 +984,9 @@ SPAN_DECLARE(t43_decode_state_t *) t43_decode_init(t43_decode_state_t *s,
     s->row_write_handler = handler;
     s->row_write_user_data = user_data;
 
-    t85_decode_init(&s->t85, t85_row_write_handler, s);
+    t85_decode_init(&s->t85, NULL, NULL);
+    t85_decode_set_strip_write_handler(&s->t85, t85_strip_write_handler, s);
+    make_plane_spread(s);
 
     /* ITULAB */
     /* Illuminant D50 */
@@ -927,6 +1007,12 @@ SPAN_DECLARE(t43_decode_state_t *) t43_decode_init(t43_decode_state_t *s,
 SPAN_DECLARE(int) t43_decode_release(t43_decode_state_t *s)
 {
     t85_decode_release(&s->t85);
+    if (s->buf)
+    {
+        span_free(s->buf);
+        s->buf = NULL;
+    }
+    /*endif*/
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
@@ -936,7 +1022,6 @@ SPAN_DECLARE(int) t43_decode_free(t43_decode_state_t *s)
     int ret;
 
     ret = t43_decode_release(s);
-    t85_decode_free(&s->t85);
     span_free(s);
     return ret;
 }
@@ -0,0 +1,496 @@
+/*
+ * SpanDSP - a series of DSP components for telephony
+ *
+ * t4_convert.c - Offline conversion of multi-page FAX image files
+ *
+ * Copyright (C) 2026 The SpanDSP contributors
+ *
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 2.1,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*! \file */
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#if defined(HAVE_UNISTD_H)
+#include <unistd.h>
+#endif
+#if defined(HAVE_STDBOOL_H)
+#include <stdbool.h>
+#else
+#include "spandsp/stdbool.h"
+#endif
+#if defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#endif
+
+#include "spandsp/telephony.h"
+#include "spandsp/alloc.h"
+#include "spandsp/logging.h"
+#include "spandsp/timezone.h"
+#include "spandsp/t4_rx.h"
+#include "spandsp/t4_tx.h"
+#include "spandsp/t4_convert.h"
+
+#include "spandsp/private/logging.h"
+#include "spandsp/private/t4_convert.h"
+
+/* The pages of the new file keep their original size and resolution */
+#define ALL_IMAGE_SIZES             (T4_SUPPORT_WIDTH_215MM \
+                                   | T4_SUPPORT_WIDTH_255MM \
+                                   | T4_SUPPORT_WIDTH_303MM \
+                                   | T4_SUPPORT_LENGTH_UNLIMITED)
+
+#define ALL_BILEVEL_RESOLUTIONS     (T4_RESOLUTION_R8_STANDARD \
+                                   | T4_RESOLUTION_R8_FINE \
+                                   | T4_RESOLUTION_R8_SUPERFINE \
+                                   | T4_RESOLUTION_R16_SUPERFINE \
+                                   | T4_RESOLUTION_100_100 \
+                                   | T4_RESOLUTION_200_100 \
+                                   | T4_RESOLUTION_200_200 \
+                                   | T4_RESOLUTION_200_400 \
+                                   | T4_RESOLUTION_300_300 \
+                                   | T4_RESOLUTION_300_600 \
+                                   | T4_RESOLUTION_400_400 \
+                                   | T4_RESOLUTION_400_800 \
+                                   | T4_RESOLUTION_600_600 \
+                                   | T4_RESOLUTION_600_1200 \
+                                   | T4_RESOLUTION_1200_1200)
+
+enum
+{
+    PAGE_PENDING = 0,
+    PAGE_DONE = 1,
+    PAGE_FAILED = 2
+};
+
+/* A page, once it has been encoded for the new file */
+typedef struct
+{
+    int status;
+    uint8_t *buf;
+    int len;
+    int compression;
+    int width;
+    int length;
+    int x_resolution;
+    int y_resolution;
+} converted_page_t;
+
+/* The number of pages, for each worker thread, which may be converted ahead of the
+   page being written. This stops the workers filling memory with converted pages,
+   while the writer is held up by a slow page. */
+#define PAGES_AHEAD_PER_THREAD      2
+
+/* The state shared by the threads working on a conversion */
+typedef struct
+{
+    t4_convert_state_t *s;
+    /*! The index of the pages of the file being converted, shared by all the workers */
+    t4_tx_page_index_t *index;
+    converted_page_t *pages;
+    int page_count;
+    /*! The next page to be claimed by a worker */
+    int next_page;
+    /*! The next page to be written to the new file */
+    int next_page_to_write;
+    /*! The largest number of pages which may be claimed beyond next_page_to_write */
+    int max_pages_ahead;
+    /*! Set when the conversion has failed, to stop the workers starting more pages */
+    bool abort;
+#if defined(HAVE_PTHREAD_H)
+    pthread_mutex_t mutex;
+    pthread_cond_t page_done;
+    pthread_cond_t page_written;
+#endif
+} convert_job_t;
+
+static int convert_page(convert_job_t *job, int page_no, converted_page_t *page)
+{
+    t4_convert_state_t *s;
+    t4_tx_state_t *tx;
+    t4_stats_t stats;
+    uint8_t *buf;
+    int buf_len;
+    int len;
+
+    s = job->s;
+    if ((tx = t4_tx_init_with_page_index(NULL, s->in_file, job->index, page_no, page_no)) == NULL)
+        return -1;
+    /*endif*/
+    if (t4_tx_set_tx_image_format(tx,
+                                  s->output_compression | T4_COMPRESSION_GRAY_TO_BILEVEL | T4_COMPRESSION_COLOUR_TO_BILEVEL,
+                                  ALL_IMAGE_SIZES,
+                                  ALL_BILEVEL_RESOLUTIONS,
+                                  0) != T4_IMAGE_FORMAT_OK
+        ||
+        t4_tx_start_page(tx))
+    {
+        t4_tx_free(tx);
+        return -1;
+    }
+    /*endif*/
+    page->compression = t4_tx_get_tx_compression(tx);
+    page->width = t4_tx_get_tx_image_width(tx);
+    page->x_resolution = t4_tx_get_tx_x_resolution(tx);
+    page->y_resolution = t4_tx_get_tx_y_resolution(tx);
+    page->buf = NULL;
+    page->len = 0;
+    buf_len = 0;
+    do
+    {
+        if (buf_len < page->len + 65536)
+        {
+            buf_len += 65536;
+            if ((buf = (uint8_t *) span_realloc(page->buf, buf_len)) == NULL)
+            {
+                if (page->buf)
+                    span_free(page->buf);
+                /*endif*/
+                page->buf = NULL;
+                t4_tx_free(tx);
+                return -1;
+            }
+            /*endif*/
+            page->buf = buf;
+        }
+        /*endif*/
+        len = t4_tx_get(tx, &page->buf[page->len], buf_len - page->len);
+        page->len += len;
+    }
+    while (len > 0);
+    t4_tx_get_transfer_statistics(tx, &stats);
+    page->length = stats.length;
+    t4_tx_end_page(tx);
+    t4_tx_free(tx);
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int write_page(t4_rx_state_t *rx, converted_page_t *page)
+{
+    /* The page is already in the file's compression, and we know its length, so the receive
+       context can store it just as it is. */
+    t4_rx_set_image_length(rx, page->length);
+    if (t4_rx_set_rx_encoding(rx, page->compression) < 0)
+        return -1;
+    /*endif*/
+    t4_rx_set_image_width(rx, page->width);
+    t4_rx_set_x_resolution(rx, page->x_resolution);
+    t4_rx_set_y_resolution(rx, page->y_resolution);
+    t4_rx_start_page(rx);
+    t4_rx_put(rx, page->buf, page->len);
+    return t4_rx_end_page(rx);
+}
+/*- End of function --------------------------------------------------------*/
+
+static void convert_next_page(convert_job_t *job, int page_no)
+{
+    converted_page_t *page;
+
+    page = &job->pages[page_no];
+    if (convert_page(job, page_no, page) < 0)
+        page->status = PAGE_FAILED;
+    else
+        page->status = PAGE_DONE;
+    /*endif*/
+}
+/*- End of function --------------------------------------------------------*/
+
+#if defined(HAVE_PTHREAD_H)
+static void *convert_worker(void *user_data)
+{
+    convert_job_t *job;
+    converted_page_t page;
+    int page_no;
+
+    job = (convert_job_t *) user_data;
+    for (;;)
+    {
+        pthread_mutex_lock(&job->mutex);
+        /* Don't get too far ahead of the writer */
+        while (!job->abort
+               &&
+               job->next_page < job->page_count
+               &&
+               job->next_page >= job->next_page_to_write + job->max_pages_ahead)
+        {
+            pthread_cond_wait(&job->page_written, &job->mutex);
+        }
+        /*endwhile*/
+        page_no = (job->abort)  ?  job->page_count  :  job->next_page++;
+        pthread_mutex_unlock(&job->mutex);
+        if (page_no >= job->page_count)
+            break;
+        /*endif*/
+        /* Work on a local copy, so the writer never sees a partly filled in page */
+        memset(&page, 0, sizeof(page));
+        page.status = (convert_page(job, page_no, &page) < 0)  ?  PAGE_FAILED  :  PAGE_DONE;
+        pthread_mutex_lock(&job->mutex);
+        job->pages[page_no] = page;
+        pthread_cond_broadcast(&job->page_done);
+        pthread_mutex_unlock(&job->mutex);
+    }
+    /*endfor*/
+    return NULL;
+}
+/*- End of function --------------------------------------------------------*/
+#endif
+
+static int write_pages(convert_job_t *job, t4_rx_state_t *rx, int threads)
+{
+    converted_page_t *page;
+    int page_no;
+
+    for (page_no = 0;  page_no < job->page_count;  page_no++)
+    {
+        page = &job->pages[page_no];
+#if defined(HAVE_PTHREAD_H)
+        if (threads > 1)
+        {
+            pthread_mutex_lock(&job->mutex);
+            while (page->status == PAGE_PENDING)
+                pthread_cond_wait(&job->page_done, &job->mutex);
+            /*endwhile*/
+            pthread_mutex_unlock(&job->mutex);
+        }
+        else
+#endif
+        {
+            convert_next_page(job, page_no);
+        }
+        /*endif*/
+        if (page->status != PAGE_DONE  ||  write_page(rx, page) < 0)
+        {
+            span_log(&job->s->logging, SPAN_LOG_WARNING, "Failed to convert page %d of %s\n", page_no, job->s->in_file);
+            return page_no;
+        }
+        /*endif*/
+        span_log(&job->s->logging, SPAN_LOG_FLOW, "Page %d written - %d bytes\n", page_no, page->len);
+        span_free(page->buf);
+        page->buf = NULL;
+#if defined(HAVE_PTHREAD_H)
+        if (threads > 1)
+        {
+            pthread_mutex_lock(&job->mutex);
+            job->next_page_to_write = page_no + 1;
+            pthread_cond_broadcast(&job->page_written);
+            pthread_mutex_unlock(&job->mutex);
+        }
+        /*endif*/
+#endif
+    }
+    /*endfor*/
+    return page_no;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t4_convert_run(t4_convert_state_t *s)
+{
+    convert_job_t job;
+    t4_rx_state_t *rx;
+    int pages_written;
+    int threads;
+    int i;
+#if defined(HAVE_PTHREAD_H)
+    pthread_t *workers;
+    int started;
+#endif
+
+    memset(&job, 0, sizeof(job));
+    job.s = s;
+    /* Scan the file once, and let every worker go straight to its pages through the index */
+    if ((job.index = t4_tx_page_index_init(NULL, s->in_file)) == NULL)
+    {
+        span_log(&s->logging, SPAN_LOG_WARNING, "Failed to open %s\n", s->in_file);
+        return -1;
+    }
+    /*endif*/
+    job.page_count = t4_tx_page_index_get_pages(job.index);
+    if (job.page_count <= 0
+        ||
+        (job.pages = (converted_page_t *) span_alloc(job.page_count*sizeof(converted_page_t))) == NULL)
+    {
+        t4_tx_page_index_free(job.index);
+        return -1;
+    }
+    /*endif*/
+    memset(job.pages, 0, job.page_count*sizeof(converted_page_t));
+    if ((rx = t4_rx_init(NULL, s->out_file, s->output_compression)) == NULL)
+    {
+        span_log(&s->logging, SPAN_LOG_WARNING, "Failed to create %s\n", s->out_file);
+        span_free(job.pages);
+        t4_tx_page_index_free(job.index);
+        return -1;
+    }
+    /*endif*/
+
+    threads = (s->threads < job.page_count)  ?  s->threads  :  job.page_count;
+    job.max_pages_ahead = PAGES_AHEAD_PER_THREAD*threads;
+    span_log(&s->logging, SPAN_LOG_FLOW, "Converting %d pages with %d threads\n", job.page_count, threads);
+#if defined(HAVE_PTHREAD_H)
+    workers = NULL;
+    if (threads > 1)
+    {
+        pthread_mutex_init(&job.mutex, NULL);
+        pthread_cond_init(&job.page_done, NULL);
+        pthread_cond_init(&job.page_written, NULL);
+        started = 0;
+        if ((workers = (pthread_t *) span_alloc(threads*sizeof(pthread_t))))
+        {
+            while (started < threads  &&  pthread_create(&workers[started], NULL, convert_worker, (void *) &job) == 0)
+                started++;
+            /*endwhile*/
+        }
+        /*endif*/
+        if (started == 0)
+        {
+            /* We could not start any threads, so do everything here */
+            span_log(&s->logging, SPAN_LOG_WARNING, "Failed to start worker threads\n");
+            if (workers)
+                span_free(workers);
+            /*endif*/
+            workers = NULL;
+            pthread_cond_destroy(&job.page_written);
+            pthread_cond_destroy(&job.page_done);
+            pthread_mutex_destroy(&job.mutex);
+            threads = 1;
+        }
+        /*endif*/
+    }
+    /*endif*/
+#else
+    threads = 1;
+#endif
+
+    pages_written = write_pages(&job, rx, threads);
+
+#if defined(HAVE_PTHREAD_H)
+    if (workers)
+    {
+        /* If we stopped early, stop the workers starting any more pages. */
+        pthread_mutex_lock(&job.mutex);
+        job.abort = true;
+        pthread_cond_broadcast(&job.page_written);
+        pthread_mutex_unlock(&job.mutex);
+        for (i = 0;  i < started;  i++)
+            pthread_join(workers[i], NULL);
+        /*endfor*/
+        span_free(workers);
+        pthread_cond_destroy(&job.page_written);
+        pthread_cond_destroy(&job.page_done);
+        pthread_mutex_destroy(&job.mutex);
+    }
+    /*endif*/
+#endif
+    for (i = 0;  i < job.page_count;  i++)
+    {
+        if (job.pages[i].buf)
+            span_free(job.pages[i].buf);
+        /*endif*/
+    }
+    /*endfor*/
+    span_free(job.pages);
+    t4_rx_free(rx);
+    t4_tx_page_index_free(job.index);
+    if (pages_written < job.page_count)
+        return -1;
+    /*endif*/
+    return pages_written;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t4_convert_set_threads(t4_convert_state_t *s, int threads)
+{
+    if (threads <= 0)
+    {
+#if defined(HAVE_UNISTD_H)  &&  defined(_SC_NPROCESSORS_ONLN)
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+        if (threads <= 0)
+            threads = 1;
+        /*endif*/
+    }
+    /*endif*/
+    s->threads = threads;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(logging_state_t *) t4_convert_get_logging_state(t4_convert_state_t *s)
+{
+    return &s->logging;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(t4_convert_state_t *) t4_convert_init(t4_convert_state_t *s,
+                                                   const char *in_file,
+                                                   const char *out_file,
+                                                   int output_compression)
+{
+    switch (output_compression)
+    {
+    case T4_COMPRESSION_T4_1D:
+    case T4_COMPRESSION_T4_2D:
+    case T4_COMPRESSION_T6:
+    case T4_COMPRESSION_T85:
+    case T4_COMPRESSION_T85_L0:
+        break;
+    default:
+        return NULL;
+    }
+    /*endswitch*/
+    if (s == NULL)
+    {
+        if ((s = (t4_convert_state_t *) span_alloc(sizeof(*s))) == NULL)
+            return NULL;
+        /*endif*/
+    }
+    /*endif*/
+    memset(s, 0, sizeof(*s));
+    span_log_init(&s->logging, SPAN_LOG_NONE, NULL);
+    span_log_set_protocol(&s->logging, "T.4");
+
+    s->in_file = in_file;
+    s->out_file = out_file;
+    s->output_compression = output_compression;
+    t4_convert_set_threads(s, 0);
+    return s;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t4_convert_release(t4_convert_state_t *s)
+{
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t4_convert_free(t4_convert_state_t *s)
+{
+    int ret;
+
+    ret = t4_convert_release(s);
+    span_free(s);
+    return ret;
+}
+/*- End of function --------------------------------------------------------*/
+/*- End of file ------------------------------------------------------------*/
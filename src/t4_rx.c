@@ -80,6 +80,8 @@
 #include "spandsp/private/t4_rx.h"
 #include "spandsp/private/t4_tx.h"
 
+#include "t4_t6_runs_local.h"
+
 /*! The number of centimetres in one inch */
 #define CM_PER_INCH                 2.54f
 
@@ -89,6 +91,9 @@ typedef struct
     int ptr;
 } packer_t;
 
+static int tiff_row_write_handler(void *user_data, const uint8_t buf[], size_t len);
+static int tiff_strip_write_handler(void *user_data, const uint8_t buf[], size_t len, size_t stride, int rows);
+
 #if defined(SPANDSP_SUPPORT_TIFF_FX)
 #if TIFFLIB_VERSION >= 20120922  &&  defined(HAVE_TIF_DIR_H)
 extern TIFFFieldArray tiff_fx_field_array;
@@ -308,6 +313,10 @@ static int set_tiff_directory_info(t4_rx_state_t *s)
     }
     /*endswitch*/
 
+    /* T.4 data written as it was received does not have its EOLs byte aligned */
+    if (s->current_decoder == 0)
+        output_t4_options &= ~GROUP3OPT_FILLBITS;
+    /*endif*/
     TIFFSetField(t->tiff_file, TIFFTAG_COMPRESSION, output_compression);
     switch (output_compression)
     {
@@ -429,7 +438,14 @@ static int set_tiff_directory_info(t4_rx_state_t *s)
         case T4_COMPRESSION_T85_L0:
             t85_analyse_header(&width, &length, s->decoder.no_decoder.buf, s->decoder.no_decoder.buf_ptr);
             s->metadata.image_width = width;
-            s->metadata.image_length = length;
+            /* A variable length image only has its true length at the end, so trust
+               the application, if it told us the length. */
+            s->metadata.image_length = (s->metadata.known_image_length)  ?  s->metadata.known_image_length  :  length;
+            break;
+        case T4_COMPRESSION_T4_1D:
+        case T4_COMPRESSION_T4_2D:
+        case T4_COMPRESSION_T6:
+            s->metadata.image_length = s->metadata.known_image_length;
             break;
         }
         /*endswitch*/
@@ -532,6 +548,188 @@ static int open_tiff_output_file(t4_rx_state_t *s, const char *file)
 }
 /*- End of function --------------------------------------------------------*/
 
+static tmsize_t tiff_mem_read(thandle_t handle, void *buf, tmsize_t size)
+{
+    t4_rx_state_t *s;
+
+    s = (t4_rx_state_t *) handle;
+    if (s->tiff.mem_pos >= s->tiff.mem_len)
+        return 0;
+    /*endif*/
+    if (size > (tmsize_t) (s->tiff.mem_len - s->tiff.mem_pos))
+        size = s->tiff.mem_len - s->tiff.mem_pos;
+    /*endif*/
+    memcpy(buf, &s->tiff.mem_buf[s->tiff.mem_pos], size);
+    s->tiff.mem_pos += size;
+    return size;
+}
+/*- End of function --------------------------------------------------------*/
+
+static tmsize_t tiff_mem_write(thandle_t handle, void *buf, tmsize_t size)
+{
+    t4_rx_state_t *s;
+    uint8_t *bufx;
+    size_t new_size;
+    size_t start;
+
+    s = (t4_rx_state_t *) handle;
+    if (s->tiff.mem_pos + size > s->tiff.mem_limit)
+    {
+        if (!s->tiff.mem_limit_reached)
+            span_log(&s->logging, SPAN_LOG_WARNING, "%s: TIFF file image would exceed %lu bytes.\n", s->tiff.file, (unsigned long int) s->tiff.mem_limit);
+        /*endif*/
+        s->tiff.mem_limit_reached = true;
+        return -1;
+    }
+    /*endif*/
+    if (s->tiff.mem_pos + size > s->tiff.mem_buf_size)
+    {
+        /* Grow the buffer geometrically, so a multi-page document does not cause
+           a reallocation for every strip and directory written. */
+        new_size = (s->tiff.mem_buf_size)  ?  s->tiff.mem_buf_size  :  65536;
+        while (new_size < s->tiff.mem_pos + size)
+            new_size <<= 1;
+        /*endwhile*/
+        if (new_size > s->tiff.mem_limit)
+            new_size = s->tiff.mem_limit;
+        /*endif*/
+        if ((bufx = span_realloc(s->tiff.mem_buf, new_size)) == NULL)
+            return -1;
+        /*endif*/
+        s->tiff.mem_buf = bufx;
+        s->tiff.mem_buf_size = new_size;
+    }
+    /*endif*/
+    start = s->tiff.mem_pos;
+    if (s->tiff.mem_pos > s->tiff.mem_len)
+    {
+        /* Fill any hole left by seeking past the end */
+        memset(&s->tiff.mem_buf[s->tiff.mem_len], 0, s->tiff.mem_pos - s->tiff.mem_len);
+        start = s->tiff.mem_len;
+    }
+    /*endif*/
+    memcpy(&s->tiff.mem_buf[s->tiff.mem_pos], buf, size);
+    /* Track the part of the image which the TIFF write handler has yet to see */
+    if (s->tiff.dirty_end <= s->tiff.dirty_start)
+    {
+        s->tiff.dirty_start = start;
+        s->tiff.dirty_end = s->tiff.mem_pos + size;
+    }
+    else
+    {
+        if (start < s->tiff.dirty_start)
+            s->tiff.dirty_start = start;
+        /*endif*/
+        if (s->tiff.mem_pos + size > s->tiff.dirty_end)
+            s->tiff.dirty_end = s->tiff.mem_pos + size;
+        /*endif*/
+    }
+    /*endif*/
+    s->tiff.mem_pos += size;
+    if (s->tiff.mem_pos > s->tiff.mem_len)
+        s->tiff.mem_len = s->tiff.mem_pos;
+    /*endif*/
+    return size;
+}
+/*- End of function --------------------------------------------------------*/
+
+static toff_t tiff_mem_seek(thandle_t handle, toff_t offset, int whence)
+{
+    t4_rx_state_t *s;
+
+    s = (t4_rx_state_t *) handle;
+    switch (whence)
+    {
+    case SEEK_SET:
+        s->tiff.mem_pos = offset;
+        break;
+    case SEEK_CUR:
+        s->tiff.mem_pos += offset;
+        break;
+    case SEEK_END:
+        s->tiff.mem_pos = s->tiff.mem_len + offset;
+        break;
+    }
+    /*endswitch*/
+    return s->tiff.mem_pos;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int tiff_mem_close(thandle_t handle)
+{
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static toff_t tiff_mem_size(thandle_t handle)
+{
+    t4_rx_state_t *s;
+
+    s = (t4_rx_state_t *) handle;
+    return s->tiff.mem_len;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int tiff_mem_map(thandle_t handle, void **base, toff_t *size)
+{
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void tiff_mem_unmap(thandle_t handle, void *base, toff_t size)
+{
+}
+/*- End of function --------------------------------------------------------*/
+
+static void flush_tiff_output_memory(t4_rx_state_t *s)
+{
+    size_t len;
+
+    if (s->tiff_write_handler == NULL  ||  s->tiff.dirty_end <= s->tiff.dirty_start)
+        return;
+    /*endif*/
+    len = s->tiff.dirty_end - s->tiff.dirty_start;
+    if (s->tiff_write_handler(s->tiff_write_user_data, &s->tiff.mem_buf[s->tiff.dirty_start], len, s->tiff.dirty_start) < 0)
+    {
+        /* Keep it, and try again later */
+        span_log(&s->logging, SPAN_LOG_FLOW, "%s: TIFF write handler deferred %lu bytes.\n", s->tiff.file, (unsigned long int) len);
+        return;
+    }
+    /*endif*/
+    s->tiff.dirty_start = 0;
+    s->tiff.dirty_end = 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int open_tiff_output_memory(t4_rx_state_t *s)
+{
+    s->tiff.in_memory = true;
+    s->tiff.mem_buf = NULL;
+    s->tiff.mem_len = 0;
+    s->tiff.mem_buf_size = 0;
+    s->tiff.mem_pos = 0;
+    s->tiff.dirty_start = 0;
+    s->tiff.dirty_end = 0;
+    s->tiff.mem_limit = T4_RX_DEFAULT_MEMORY_LIMIT;
+    s->tiff.mem_limit_reached = false;
+    if ((s->tiff.tiff_file = TIFFClientOpen("<memory>",
+                                            "w",
+                                            (thandle_t) s,
+                                            tiff_mem_read,
+                                            tiff_mem_write,
+                                            tiff_mem_seek,
+                                            tiff_mem_close,
+                                            tiff_mem_size,
+                                            tiff_mem_map,
+                                            tiff_mem_unmap)) == NULL)
+    {
+        return -1;
+    }
+    /*endif*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int row_read_handler(void *user_data, uint8_t row[], size_t len)
 {
     packer_t *s;
@@ -597,6 +795,63 @@ static int write_tiff_t85_image(t4_rx_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
+static int write_tiff_t6_runs_image(t4_rx_state_t *s)
+{
+    uint8_t *buf;
+    uint8_t *buf2;
+    int buf_len;
+    int len;
+    int image_len;
+    t4_t6_encode_state_t t6;
+
+    /* Re-encode the image as T.6 straight from its run-lengths, rather than have libtiff
+       compress a bitmap of the whole page. */
+    s->tiff.runs.ptr = 0;
+    if (t4_t6_encode_init(&t6, T4_COMPRESSION_T6, s->metadata.image_width, s->metadata.image_length, NULL, NULL) == NULL)
+        return -1;
+    /*endif*/
+    t4_t6_encode_set_run_read_handler(&t6, t4_runs_buffer_read_row, &s->tiff.runs);
+    buf = NULL;
+    buf_len = 0;
+    image_len = 0;
+    do
+    {
+        if (buf_len < image_len + 65536)
+        {
+            buf_len += 65536;
+            if ((buf2 = span_realloc(buf, buf_len)) == NULL)
+            {
+                if (buf)
+                    span_free(buf);
+                /*endif*/
+                t4_t6_encode_release(&t6);
+                return -1;
+            }
+            /*endif*/
+            buf = buf2;
+        }
+        /*endif*/
+        len = t4_t6_encode_get(&t6, &buf[image_len], buf_len - image_len);
+        image_len += len;
+    }
+    while (len > 0);
+    t4_t6_encode_release(&t6);
+    if (s->tiff.runs.ptr < s->tiff.runs.len)
+    {
+        /* A row could not be played out, so the image would be truncated */
+        span_log(&s->logging, SPAN_LOG_WARNING, "%s: Bad run-length row in the image.\n", s->tiff.file);
+        span_free(buf);
+        return -1;
+    }
+    /*endif*/
+    if (TIFFWriteRawStrip(s->tiff.tiff_file, 0, buf, image_len) < 0)
+        span_log(&s->logging, SPAN_LOG_WARNING, "%s: Error writing TIFF strip.\n", s->tiff.file);
+    /*endif*/
+    span_free(buf);
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int write_tiff_t43_image(t4_rx_state_t *s)
 {
     uint8_t *buf;
@@ -652,7 +907,7 @@ static int write_tiff_image(t4_rx_state_t *s)
 #endif
 
     t = &s->tiff;
-    if (s->decoder.no_decoder.buf_ptr <= 0  &&  (t->image_buffer == NULL  ||  t->image_size <= 0))
+    if (s->decoder.no_decoder.buf_ptr <= 0  &&  (t->image_buffer == NULL  ||  t->image_size <= 0)  &&  t->runs.len <= 0)
         return -1;
     /*endif*/
     /* Set up the TIFF directory info... */
@@ -699,6 +954,16 @@ static int write_tiff_image(t4_rx_state_t *s)
                 return -1;
             break;
 #endif
+        case T4_COMPRESSION_T6:
+            if (t->runs.len > 0)
+            {
+                if (write_tiff_t6_runs_image(s) < 0)
+                    return -1;
+                /*endif*/
+                break;
+            }
+            /*endif*/
+            /* Fall through */
         default:
             /* Let libtiff do the compression */
             if (TIFFWriteEncodedStrip(t->tiff_file, 0, t->image_buffer, t->image_size) < 0)
@@ -754,8 +1019,10 @@ static int write_tiff_image(t4_rx_state_t *s)
 static int close_tiff_output_file(t4_rx_state_t *s)
 {
     int i;
+    int res;
     t4_rx_tiff_state_t *t;
 
+    res = 0;
     t = &s->tiff;
     /* Perform any operations needed to tidy up a written TIFF file before
        closure. */
@@ -779,11 +1046,29 @@ static int close_tiff_output_file(t4_rx_state_t *s)
     /*endif*/
     TIFFClose(t->tiff_file);
     t->tiff_file = NULL;
+    if (s->tiff.in_memory)
+    {
+        if (s->current_page > 0)
+        {
+            flush_tiff_output_memory(s);
+            if (s->tiff_write_handler  &&  s->tiff.dirty_end > s->tiff.dirty_start)
+            {
+                span_log(&s->logging, SPAN_LOG_WARNING, "%s: TIFF write handler did not accept the end of the file.\n", s->tiff.file);
+                res = -1;
+            }
+            /*endif*/
+        }
+        /*endif*/
+        if (s->tiff.mem_limit_reached)
+            res = -1;
+        /*endif*/
+    }
+    /*endif*/
     if (s->tiff.file)
     {
         /* Try not to leave a file behind, if we didn't receive any pages to
            put in it. */
-        if (s->current_page == 0)
+        if (s->current_page == 0  &&  !s->tiff.in_memory)
         {
             if (remove(s->tiff.file) < 0)
                 span_log(&s->logging, SPAN_LOG_WARNING, "%s: Failed to remove file.\n", s->tiff.file);
@@ -794,14 +1079,17 @@ static int close_tiff_output_file(t4_rx_state_t *s)
     }
     /*endif*/
     s->tiff.file = NULL;
-    return 0;
+    return res;
 }
 /*- End of function --------------------------------------------------------*/
 
-static void tiff_rx_release(t4_rx_state_t *s)
+static int tiff_rx_release(t4_rx_state_t *s)
 {
+    int res;
+
+    res = 0;
     if (s->tiff.tiff_file)
-        close_tiff_output_file(s);
+        res = close_tiff_output_file(s);
     /*endif*/
     if (s->tiff.image_buffer)
     {
@@ -811,6 +1099,16 @@ static void tiff_rx_release(t4_rx_state_t *s)
         s->tiff.image_buffer_size = 0;
     }
     /*endif*/
+    t4_runs_buffer_release(&s->tiff.runs);
+    if (s->tiff.mem_buf)
+    {
+        span_free(s->tiff.mem_buf);
+        s->tiff.mem_buf = NULL;
+        s->tiff.mem_len = 0;
+        s->tiff.mem_buf_size = 0;
+    }
+    /*endif*/
+    return res;
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -822,6 +1120,24 @@ SPAN_DECLARE(int) t4_rx_put_bit(t4_rx_state_t *s, int bit)
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t4_rx_put_bits(t4_rx_state_t *s, uint32_t bits, int nbits)
+{
+    int i;
+    int res;
+
+    for (i = 0;  i < nbits;  i++)
+    {
+        s->line_image_size += 1;
+        if ((res = t4_t6_decode_put_bit(&s->decoder.t4_t6, bits & 1)) != T4_DECODE_MORE_DATA)
+            return res;
+        /*endif*/
+        bits >>= 1;
+    }
+    /*endfor*/
+    return T4_DECODE_MORE_DATA;
+}
+/*- End of function --------------------------------------------------------*/
+
 static void pre_encoded_restart(no_decoder_state_t *s)
 {
     s->buf_ptr = 0;
@@ -940,6 +1256,17 @@ static bool select_tiff_compression(t4_rx_state_t *s, int output_image_type)
         return false;
     }
     /*endif*/
+    /* T.4 and T.6 images give no indication of their length until they have been decoded,
+       but if we have been told the length we can write them as they are too. */
+    if (s->metadata.known_image_length > 0
+        &&
+        (s->metadata.compression & (s->supported_tiff_compressions & (T4_COMPRESSION_T4_1D | T4_COMPRESSION_T4_2D | T4_COMPRESSION_T6))))
+    {
+        span_log(&s->logging, SPAN_LOG_FLOW, "Image of known length can be written without recoding\n");
+        s->tiff.compression = s->metadata.compression;
+        return false;
+    }
+    /*endif*/
 
     if (output_image_type == T4_IMAGE_TYPE_BILEVEL)
     {
@@ -1011,25 +1338,24 @@ SPAN_DECLARE(int) t4_rx_set_rx_encoding(t4_rx_state_t *s, int compression)
     case T4_COMPRESSION_T4_1D:
     case T4_COMPRESSION_T4_2D:
     case T4_COMPRESSION_T6:
-        switch (s->metadata.compression)
-        {
-        case T4_COMPRESSION_T4_1D:
-        case T4_COMPRESSION_T4_2D:
-        case T4_COMPRESSION_T6:
-            break;
-        default:
-            release_current_decoder(s);
-            t4_t6_decode_init(&s->decoder.t4_t6, compression, s->metadata.image_width, s->row_handler, s->row_handler_user_data);
-            s->current_decoder = T4_COMPRESSION_T4_1D | T4_COMPRESSION_T4_2D | T4_COMPRESSION_T6;
-            break;
-        }
-        /*endswitch*/
         s->metadata.compression = compression;
         if (!select_tiff_compression(s, T4_IMAGE_TYPE_BILEVEL))
+        {
+            if (s->current_decoder != 0)
+            {
+                release_current_decoder(s);
+                s->current_decoder = 0;
+                pre_encoded_init(&s->decoder.no_decoder);
+            }
+            /*endif*/
+            return 0;
+        }
+        /*endif*/
+        if (s->current_decoder != (T4_COMPRESSION_T4_1D | T4_COMPRESSION_T4_2D | T4_COMPRESSION_T6))
         {
             release_current_decoder(s);
-            s->current_decoder = 0;
-            pre_encoded_init(&s->decoder.no_decoder);
+            t4_t6_decode_init(&s->decoder.t4_t6, compression, s->metadata.image_width, s->row_handler, s->row_handler_user_data);
+            s->current_decoder = T4_COMPRESSION_T4_1D | T4_COMPRESSION_T4_2D | T4_COMPRESSION_T6;
         }
         /*endif*/
         return t4_t6_decode_set_encoding(&s->decoder.t4_t6, compression);
@@ -1171,6 +1497,41 @@ SPAN_DECLARE(void) t4_rx_set_image_width(t4_rx_state_t *s, int width)
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(void) t4_rx_set_image_length(t4_rx_state_t *s, int length)
+{
+    s->metadata.known_image_length = length;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t4_rx_set_tiff_write_handler(t4_rx_state_t *s, t4_rx_tiff_write_handler_t handler, void *user_data)
+{
+    if (!s->tiff.in_memory)
+        return -1;
+    /*endif*/
+    s->tiff_write_handler = handler;
+    s->tiff_write_user_data = user_data;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t4_rx_set_memory_limit(t4_rx_state_t *s, size_t max_len)
+{
+    if (!s->tiff.in_memory)
+        return -1;
+    /*endif*/
+    s->tiff.mem_limit = max_len;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static t4_strip_write_handler_t strip_write_handler(t4_rx_state_t *s)
+{
+    /* When the image is going into our own buffer, the decoders can pass it on a strip
+       of rows at a time. */
+    return (s->row_handler == tiff_row_write_handler)  ?  tiff_strip_write_handler  :  NULL;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) t4_rx_set_row_write_handler(t4_rx_state_t *s, t4_row_write_handler_t handler, void *user_data)
 {
     s->row_handler = handler;
@@ -1178,16 +1539,22 @@ SPAN_DECLARE(int) t4_rx_set_row_write_handler(t4_rx_state_t *s, t4_row_write_han
     switch (s->current_decoder)
     {
     case T4_COMPRESSION_T4_1D | T4_COMPRESSION_T4_2D | T4_COMPRESSION_T6:
+        t4_t6_decode_set_run_write_handler(&s->decoder.t4_t6, NULL, NULL);
+        s->tiff.runs.len = 0;
+        t4_t6_decode_set_strip_write_handler(&s->decoder.t4_t6, strip_write_handler(s), user_data);
         return t4_t6_decode_set_row_write_handler(&s->decoder.t4_t6, handler, user_data);
     case T4_COMPRESSION_T85 | T4_COMPRESSION_T85_L0:
+        t85_decode_set_strip_write_handler(&s->decoder.t85, strip_write_handler(s), user_data);
         return t85_decode_set_row_write_handler(&s->decoder.t85, handler, user_data);
 #if defined(SPANDSP_SUPPORT_T88)
     case T4_COMPRESSION_T88:
         return t88_decode_set_row_write_handler(&s->decoder.t88, handler, user_data);
 #endif
     case T4_COMPRESSION_T42_T81:
+        t42_decode_set_strip_write_handler(&s->decoder.t42, strip_write_handler(s), user_data);
         return t42_decode_set_row_write_handler(&s->decoder.t42, handler, user_data);
     case T4_COMPRESSION_T43:
+        t43_decode_set_strip_write_handler(&s->decoder.t43, strip_write_handler(s), user_data);
         return t43_decode_set_row_write_handler(&s->decoder.t43, handler, user_data);
 #if defined(SPANDSP_SUPPORT_T45)
     case T4_COMPRESSION_T45:
@@ -1285,10 +1652,26 @@ SPAN_DECLARE(int) t4_rx_start_page(t4_rx_state_t *s)
         break;
     case T4_COMPRESSION_T4_1D | T4_COMPRESSION_T4_2D | T4_COMPRESSION_T6:
         t4_t6_decode_restart(&s->decoder.t4_t6, s->metadata.image_width);
+        if (s->tiff.tiff_file  &&  s->tiff.compression == T4_COMPRESSION_T6  &&  s->row_handler == tiff_row_write_handler)
+        {
+            /* The page is going to the file as T.6, so it can be re-encoded directly from the
+               decoded run-lengths, without ever building a bitmap of the page. */
+            t4_t6_decode_set_row_write_handler(&s->decoder.t4_t6, NULL, NULL);
+            t4_t6_decode_set_strip_write_handler(&s->decoder.t4_t6, NULL, NULL);
+            t4_t6_decode_set_run_write_handler(&s->decoder.t4_t6, t4_runs_buffer_write_row, (void *) &s->tiff.runs);
+        }
+        else
+        {
+            t4_t6_decode_set_row_write_handler(&s->decoder.t4_t6, s->row_handler, s->row_handler_user_data);
+            t4_t6_decode_set_strip_write_handler(&s->decoder.t4_t6, strip_write_handler(s), s->row_handler_user_data);
+            t4_t6_decode_set_run_write_handler(&s->decoder.t4_t6, NULL, NULL);
+        }
+        /*endif*/
         s->image_put_handler = (t4_image_put_handler_t) t4_t6_decode_put;
         break;
     case T4_COMPRESSION_T85 | T4_COMPRESSION_T85_L0:
         t85_decode_restart(&s->decoder.t85);
+        t85_decode_set_strip_write_handler(&s->decoder.t85, strip_write_handler(s), s->row_handler_user_data);
         s->image_put_handler = (t4_image_put_handler_t) t85_decode_put;
         break;
 #if defined(SPANDSP_SUPPORT_T88)
@@ -1299,10 +1682,12 @@ SPAN_DECLARE(int) t4_rx_start_page(t4_rx_state_t *s)
 #endif
     case T4_COMPRESSION_T42_T81:
         t42_decode_restart(&s->decoder.t42);
+        t42_decode_set_strip_write_handler(&s->decoder.t42, strip_write_handler(s), s->row_handler_user_data);
         s->image_put_handler = (t4_image_put_handler_t) t42_decode_put;
         break;
     case T4_COMPRESSION_T43:
         t43_decode_restart(&s->decoder.t43);
+        t43_decode_set_strip_write_handler(&s->decoder.t43, strip_write_handler(s), s->row_handler_user_data);
         s->image_put_handler = (t4_image_put_handler_t) t43_decode_put;
         break;
 #if defined(SPANDSP_SUPPORT_T45)
@@ -1315,6 +1700,7 @@ SPAN_DECLARE(int) t4_rx_start_page(t4_rx_state_t *s)
     /*endswitch*/
     s->line_image_size = 0;
     s->tiff.image_size = 0;
+    s->tiff.runs.len = 0;
 
     time (&s->tiff.page_start_time);
 
@@ -1347,6 +1733,44 @@ static int tiff_row_write_handler(void *user_data, const uint8_t buf[], size_t l
 }
 /*- End of function --------------------------------------------------------*/
 
+static int tiff_strip_write_handler(void *user_data, const uint8_t buf[], size_t len, size_t stride, int rows)
+{
+    t4_rx_state_t *s;
+    uint8_t *t;
+    size_t size;
+    int i;
+
+    s = (t4_rx_state_t *) user_data;
+    if (buf  &&  len > 0  &&  rows > 0)
+    {
+        size = rows*len;
+        if (s->tiff.image_size + size >= s->tiff.image_buffer_size)
+        {
+            if ((t = span_realloc(s->tiff.image_buffer, s->tiff.image_buffer_size + size + 100*len)) == NULL)
+                return -1;
+            /*endif*/
+            s->tiff.image_buffer_size += size + 100*len;
+            s->tiff.image_buffer = t;
+        }
+        /*endif*/
+        if (stride == len)
+        {
+            memcpy(&s->tiff.image_buffer[s->tiff.image_size], buf, size);
+        }
+        else
+        {
+            for (i = 0;  i < rows;  i++)
+                memcpy(&s->tiff.image_buffer[s->tiff.image_size + i*len], &buf[i*stride], len);
+            /*endfor*/
+        }
+        /*endif*/
+        s->tiff.image_size += size;
+    }
+    /*endif*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) t4_rx_end_page(t4_rx_state_t *s)
 {
     int length;
@@ -1393,7 +1817,10 @@ SPAN_DECLARE(int) t4_rx_end_page(t4_rx_state_t *s)
     /*endswitch*/
 
     if (length == 0)
+    {
+        s->metadata.known_image_length = 0;
         return -1;
+    }
     /*endif*/
 
     if (s->tiff.tiff_file)
@@ -1402,12 +1829,18 @@ SPAN_DECLARE(int) t4_rx_end_page(t4_rx_state_t *s)
             s->current_page++;
         /*endif*/
         s->tiff.image_size = 0;
+        s->tiff.runs.len = 0;
+        if (s->tiff.in_memory)
+            flush_tiff_output_memory(s);
+        /*endif*/
     }
     else
     {
         s->current_page++;
     }
     /*endif*/
+    /* Any length we were given only applied to this page */
+    s->metadata.known_image_length = 0;
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
@@ -1418,19 +1851,8 @@ SPAN_DECLARE(logging_state_t *) t4_rx_get_logging_state(t4_rx_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
-SPAN_DECLARE(t4_rx_state_t *) t4_rx_init(t4_rx_state_t *s, const char *file, int supported_output_compressions)
+static void rx_init(t4_rx_state_t *s, int supported_output_compressions)
 {
-    bool alloced;
-
-    alloced = false;
-    if (s == NULL)
-    {
-        if ((s = (t4_rx_state_t *) span_alloc(sizeof(*s))) == NULL)
-            return NULL;
-        /*endif*/
-        alloced = true;
-    }
-    /*endif*/
 #if defined(SPANDSP_SUPPORT_TIFF_FX)
     TIFF_FX_init();
 #endif
@@ -1461,6 +1883,82 @@ SPAN_DECLARE(t4_rx_state_t *) t4_rx_init(t4_rx_state_t *s, const char *file, int
     /* Default handler */
     s->row_handler = tiff_row_write_handler;
     s->row_handler_user_data = s;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t4_rx_get_memory_image(t4_rx_state_t *s, uint8_t **buf, size_t *len)
+{
+    int res;
+
+    if (!s->tiff.in_memory)
+        return -1;
+    /*endif*/
+    /* Finish the TIFF file, so the image in memory is complete */
+    res = 0;
+    if (s->tiff.tiff_file)
+        res = close_tiff_output_file(s);
+    /*endif*/
+    if (res == 0  &&  s->current_page > 0)
+    {
+        *buf = s->tiff.mem_buf;
+        *len = s->tiff.mem_len;
+        s->tiff.mem_buf = NULL;
+    }
+    else
+    {
+        *buf = NULL;
+        *len = 0;
+    }
+    /*endif*/
+    tiff_rx_release(s);
+    s->tiff.in_memory = false;
+    return res;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(t4_rx_state_t *) t4_rx_init_to_memory(t4_rx_state_t *s, int supported_output_compressions)
+{
+    bool alloced;
+
+    alloced = false;
+    if (s == NULL)
+    {
+        if ((s = (t4_rx_state_t *) span_alloc(sizeof(*s))) == NULL)
+            return NULL;
+        /*endif*/
+        alloced = true;
+    }
+    /*endif*/
+    rx_init(s, supported_output_compressions);
+    s->tiff.pages_in_file = 0;
+    if (open_tiff_output_memory(s) < 0)
+    {
+        if (alloced)
+            span_free(s);
+        /*endif*/
+        return NULL;
+    }
+    /*endif*/
+    /* Save a name for logging reports. */
+    s->tiff.file = strdup("<memory>");
+    return s;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(t4_rx_state_t *) t4_rx_init(t4_rx_state_t *s, const char *file, int supported_output_compressions)
+{
+    bool alloced;
+
+    alloced = false;
+    if (s == NULL)
+    {
+        if ((s = (t4_rx_state_t *) span_alloc(sizeof(*s))) == NULL)
+            return NULL;
+        /*endif*/
+        alloced = true;
+    }
+    /*endif*/
+    rx_init(s, supported_output_compressions);
 
     if (file)
     {
@@ -1483,11 +1981,14 @@ SPAN_DECLARE(t4_rx_state_t *) t4_rx_init(t4_rx_state_t *s, const char *file, int
 
 SPAN_DECLARE(int) t4_rx_release(t4_rx_state_t *s)
 {
+    int res;
+
+    res = 0;
     if (s->tiff.file)
-        tiff_rx_release(s);
+        res = tiff_rx_release(s);
     /*endif*/
     release_current_decoder(s);
-    return -1;
+    return res;
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -121,6 +121,7 @@
 #define EOLS_TO_END_T6_RX_PAGE      2
 
 #include "t4_t6_decode_states.h"
+#include "t4_t6_runs_local.h"
 
 #if defined(T4_STATE_DEBUGGING)
 static void STATE_TRACE(const char *format, ...)
@@ -156,6 +157,19 @@ static int free_buffers(t4_t6_decode_state_t *s)
         s->row_buf = NULL;
     }
     /*endif*/
+    if (s->run_positions)
+    {
+        span_free(s->run_positions);
+        s->run_positions = NULL;
+    }
+    /*endif*/
+    if (s->strip_buf)
+    {
+        span_free(s->strip_buf);
+        s->strip_buf = NULL;
+    }
+    /*endif*/
+    s->strip_buf_size = 0;
     s->bytes_per_row = 0;
     return 0;
 }
@@ -188,6 +202,70 @@ static __inline__ void update_row_bit_info(t4_t6_decode_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
+static void set_run_positions(t4_t6_decode_state_t *s, const uint32_t runs[], int len)
+{
+    uint32_t pos;
+    int steps;
+    int x;
+
+    /* Convert the run lengths into changing element positions. The run lengths may include
+       zero length runs, which need to be merged away. */
+    steps = 0;
+    pos = 0;
+    for (x = 0;  x < len  &&  pos < (uint32_t) s->image_width;  x++)
+    {
+        if (runs[x] == 0)
+            continue;
+        /*endif*/
+        if ((x & 1) != (steps & 1))
+            s->run_positions[steps++] = pos;
+        /*endif*/
+        pos += runs[x];
+    }
+    /*endfor*/
+    if (pos < (uint32_t) s->image_width  &&  (steps & 1))
+        s->run_positions[steps++] = pos;
+    /*endif*/
+    s->run_positions[steps++] = s->image_width;
+    s->run_positions_steps = steps;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int flush_strip(t4_t6_decode_state_t *s)
+{
+    int rows;
+
+    if ((rows = s->strip_rows) == 0)
+        return 0;
+    /*endif*/
+    s->strip_rows = 0;
+    return s->strip_write_handler(s->strip_write_user_data, s->strip_buf, s->bytes_per_row, s->bytes_per_row, rows);
+}
+/*- End of function --------------------------------------------------------*/
+
+static int put_strip_row(t4_t6_decode_state_t *s)
+{
+    uint8_t *buf;
+    int size;
+
+    size = T4_STRIP_ROWS*s->bytes_per_row;
+    if (size > s->strip_buf_size)
+    {
+        if ((buf = (uint8_t *) span_realloc(s->strip_buf, size)) == NULL)
+            return -1;
+        /*endif*/
+        s->strip_buf = buf;
+        s->strip_buf_size = size;
+    }
+    /*endif*/
+    memcpy(&s->strip_buf[s->strip_rows*s->bytes_per_row], s->row_buf, s->bytes_per_row);
+    if (++s->strip_rows < T4_STRIP_ROWS)
+        return 0;
+    /*endif*/
+    return flush_strip(s);
+}
+/*- End of function --------------------------------------------------------*/
+
 static int put_decoded_row(t4_t6_decode_state_t *s)
 {
     static const int msbmask[9] =
@@ -200,6 +278,8 @@ static int put_decoded_row(t4_t6_decode_state_t *s)
     int x;
     int j;
     int row_pos;
+    int steps;
+    bool good_row;
 
     if (s->run_length)
         add_run_to_row(s);
@@ -227,7 +307,8 @@ static int put_decoded_row(t4_t6_decode_state_t *s)
     }
 #endif
     row_pos = 0;
-    if (s->row_len == s->image_width)
+    good_row = (s->row_len == s->image_width);
+    if (good_row)
     {
         STATE_TRACE("%d Good row - %d %s\n", s->image_length, s->row_len, (s->row_is_2d)  ?  "2D"  :  "1D");
         if (s->curr_bad_row_run)
@@ -238,10 +319,11 @@ static int put_decoded_row(t4_t6_decode_state_t *s)
             s->curr_bad_row_run = 0;
         }
         /*endif*/
-        /* Convert the runs to a bit image of the row */
+        /* Convert the runs to a bit image of the row, unless the only consumer of the
+           image wants it as runs. */
         /* White/black/white... runs, always starting with white. That means the first run could be
            zero length. */
-        for (x = 0, fudge = 0;  x < s->a_cursor;  x++, fudge ^= 0xFF)
+        for (x = 0, fudge = 0;  x < s->a_cursor  &&  (s->row_write_handler  ||  s->strip_write_handler);  x++, fudge ^= 0xFF)
         {
             i = s->cur_runs[x];
             if ((int) i >= s->pixels)
@@ -312,6 +394,7 @@ static int put_decoded_row(t4_t6_decode_state_t *s)
        step off the end of the list. */
     s->cur_runs[s->a_cursor] = 0;
     s->cur_runs[s->a_cursor + 1] = 0;
+    steps = s->a_cursor;
 
     /* Swap the buffers */
     p = s->cur_runs;
@@ -324,6 +407,21 @@ static int put_decoded_row(t4_t6_decode_state_t *s)
     s->a0 = 0;
 
     s->run_length = 0;
+    if (s->run_write_handler)
+    {
+        /* A bad row is replaced by a copy of the last good row, just as it is in row_buf,
+           although the repaired runs are what the next row is decoded against. */
+        if (good_row)
+            set_run_positions(s, s->ref_runs, steps);
+        /*endif*/
+        if (s->run_write_handler(s->run_write_user_data, s->run_positions, s->run_positions_steps))
+            return -1;
+        /*endif*/
+    }
+    /*endif*/
+    if (s->strip_write_handler)
+        return put_strip_row(s);
+    /*endif*/
     if (s->row_write_handler)
         return s->row_write_handler(s->row_write_user_data, s->row_buf, s->bytes_per_row);
     /*endif*/
@@ -773,8 +871,18 @@ SPAN_DECLARE(int) t4_t6_decode_put(t4_t6_decode_state_t *s, const uint8_t buf[],
         }
         /*endif*/
         /* Don't worry about the return value here. We are finishing anyway. */
-        if (s->row_write_handler)
+        if (s->run_write_handler)
+            s->run_write_handler(s->run_write_user_data, NULL, 0);
+        /*endif*/
+        if (s->strip_write_handler)
+        {
+            flush_strip(s);
+            s->strip_write_handler(s->strip_write_user_data, NULL, 0, 0, 0);
+        }
+        else if (s->row_write_handler)
+        {
             s->row_write_handler(s->row_write_user_data, NULL, 0);
+        }
         /*endif*/
         s->rx_bits = 0;
         s->rx_skip_bits = 0;
@@ -807,6 +915,89 @@ SPAN_DECLARE(int) t4_t6_decode_set_row_write_handler(t4_t6_decode_state_t *s,
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t4_t6_decode_set_strip_write_handler(t4_t6_decode_state_t *s,
+                                                       t4_strip_write_handler_t handler,
+                                                       void *user_data)
+{
+    s->strip_write_handler = handler;
+    s->strip_write_user_data = user_data;
+    s->strip_rows = 0;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+int t4_runs_buffer_read_row(void *user_data, uint32_t runs[], int max_steps)
+{
+    t4_runs_buffer_t *s;
+    int steps;
+
+    s = (t4_runs_buffer_t *) user_data;
+    if (s->ptr >= s->len)
+        return 0;
+    /*endif*/
+    /* Check the whole row fits, in the caller's buffer and in what has been stored,
+       before moving on, so a bad row leaves the play out position where it was. */
+    steps = (int) s->buf[s->ptr];
+    if (steps < 0  ||  steps > max_steps  ||  steps > s->len - s->ptr - 1)
+        return -1;
+    /*endif*/
+    memcpy(runs, &s->buf[s->ptr + 1], steps*sizeof(uint32_t));
+    s->ptr += steps + 1;
+    return steps;
+}
+/*- End of function --------------------------------------------------------*/
+
+int t4_runs_buffer_write_row(void *user_data, const uint32_t runs[], int steps)
+{
+    t4_runs_buffer_t *s;
+    uint32_t *t;
+    int size;
+
+    s = (t4_runs_buffer_t *) user_data;
+    if (runs == NULL)
+        return 0;
+    /*endif*/
+    if (s->len + steps + 1 > s->size)
+    {
+        size = s->size + s->size/2 + 100*(steps + 1);
+        if ((t = (uint32_t *) span_realloc(s->buf, size*sizeof(uint32_t))) == NULL)
+            return -1;
+        /*endif*/
+        s->buf = t;
+        s->size = size;
+    }
+    /*endif*/
+    s->buf[s->len++] = steps;
+    memcpy(&s->buf[s->len], runs, steps*sizeof(uint32_t));
+    s->len += steps;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+void t4_runs_buffer_release(t4_runs_buffer_t *s)
+{
+    if (s->buf)
+    {
+        span_free(s->buf);
+        s->buf = NULL;
+    }
+    /*endif*/
+    s->len = 0;
+    s->size = 0;
+    s->ptr = 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t4_t6_decode_set_run_write_handler(t4_t6_decode_state_t *s,
+                                                     t4_run_write_handler_t handler,
+                                                     void *user_data)
+{
+    s->run_write_handler = handler;
+    s->run_write_user_data = user_data;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) t4_t6_decode_set_encoding(t4_t6_decode_state_t *s, int encoding)
 {
     switch (encoding)
@@ -866,6 +1057,10 @@ SPAN_DECLARE(int) t4_t6_decode_restart(t4_t6_decode_state_t *s, int image_width)
             return -1;
         /*endif*/
         s->ref_runs = bufptr;
+        if ((bufptr = (uint32_t *) span_realloc(s->run_positions, run_space)) == NULL)
+            return -1;
+        /*endif*/
+        s->run_positions = bufptr;
         s->image_width = image_width;
     }
     /*endif*/
@@ -888,6 +1083,7 @@ SPAN_DECLARE(int) t4_t6_decode_restart(t4_t6_decode_state_t *s, int image_width)
     s->max_row_bits = 0;
 
     s->compressed_image_size = 0;
+    s->strip_rows = 0;
     s->bad_rows = 0;
     s->longest_bad_row_run = 0;
     s->curr_bad_row_run = 0;
@@ -921,6 +1117,13 @@ SPAN_DECLARE(int) t4_t6_decode_restart(t4_t6_decode_state_t *s, int image_width)
     if (s->row_buf)
         memset(s->row_buf, 0, s->bytes_per_row);
     /*endif*/
+    /* Until there is a good row to repeat, a bad row is presented as white */
+    if (s->run_positions)
+    {
+        s->run_positions[0] = s->image_width;
+        s->run_positions_steps = 1;
+    }
+    /*endif*/
 
     return 0;
 }
@@ -394,6 +394,13 @@ static int free_buffers(t4_t6_encode_state_t *s)
         s->bitstream = NULL;
     }
     /*endif*/
+    if (s->strip_buf)
+    {
+        span_free(s->strip_buf);
+        s->strip_buf = NULL;
+    }
+    /*endif*/
+    s->strip_buf_size = 0;
     s->bytes_per_row = 0;
     return 0;
 }
@@ -582,8 +589,6 @@ static int row_to_run_lengths(uint32_t list[], const uint8_t row[], int width)
 }
 /*- End of function --------------------------------------------------------*/
 
-#define pixel_is_black(x,bit) (((x)[(bit) >> 3] << ((bit) & 7)) & 0x80)
-
 /*
  * Write an EOL code to the output stream.  We also handle writing the tag
  * bit for the next scanline when doing 2D encoding.
@@ -634,9 +639,10 @@ static void encode_eol(t4_t6_encode_state_t *s)
 /*- End of function --------------------------------------------------------*/
 
 /*
- * 2D-encode a row of pixels. Consult ITU specification T.4 for the algorithm.
+ * 2D-encode a row of pixels, already converted to runs in cur_runs. Consult ITU
+ * specification T.4 for the algorithm.
  */
-static void encode_2d_row(t4_t6_encode_state_t *s, const uint8_t *row_buf)
+static void encode_2d_row(t4_t6_encode_state_t *s, int cur_steps)
 {
     static const t4_run_table_entry_t codes[] =
     {
@@ -667,7 +673,6 @@ static void encode_2d_row(t4_t6_encode_state_t *s, const uint8_t *row_buf)
     int diff;
     int a_cursor;
     int b_cursor;
-    int cur_steps;
     uint32_t *p;
 
     /*
@@ -726,13 +731,8 @@ static void encode_2d_row(t4_t6_encode_state_t *s, const uint8_t *row_buf)
                           Vertical and horizontal modes
      */
     /* The following implements the 2-D encoding section of the flow chart in Figure7/T.4 */
-    cur_steps = row_to_run_lengths(s->cur_runs, row_buf, s->image_width);
-    /* Stretch the row a little, so when we step by 2 we are guaranteed to
-       hit an entry showing the row length. */
-    s->cur_runs[cur_steps] =
-    s->cur_runs[cur_steps + 1] =
-    s->cur_runs[cur_steps + 2] = s->cur_runs[cur_steps - 1];
-
+    /* Note that a0 always lies within run a_cursor of the coding line, so the colour at a0
+       is simply the parity of a_cursor. */
     a0 = 0;
     a1 = s->cur_runs[0];
     b1 = s->ref_runs[0];
@@ -756,7 +756,7 @@ static void encode_2d_row(t4_t6_encode_state_t *s, const uint8_t *row_buf)
                 /* Horizontal mode coding */
                 a2 = s->cur_runs[a_cursor + 1];
                 put_encoded_bits(s, codes[7].code, codes[7].length);
-                if (a0 + a1 == 0  ||  pixel_is_black(row_buf, a0) == 0)
+                if (a0 + a1 == 0  ||  (a_cursor & 1) == 0)
                 {
                     put_1d_span(s, a1 - a0, t4_white_codes);
                     put_1d_span(s, a2 - a1, t4_black_codes);
@@ -794,7 +794,7 @@ static void encode_2d_row(t4_t6_encode_state_t *s, const uint8_t *row_buf)
         /* We need to hunt for the correct position in the reference row, as the
            runs there have no particular alignment with the runs in the current
            row. */
-        if (pixel_is_black(row_buf, a0))
+        if ((a_cursor & 1))
             b_cursor |= 1;
         else
             b_cursor &= ~1;
@@ -836,30 +836,35 @@ static void encode_2d_row(t4_t6_encode_state_t *s, const uint8_t *row_buf)
 /*- End of function --------------------------------------------------------*/
 
 /*
- * 1D-encode a row of pixels. The encoding is a sequence of all-white or
- * all-black spans of pixels encoded with Huffman codes.
+ * 1D-encode a row of pixels, already converted to runs in cur_runs. The encoding
+ * is a sequence of all-white or all-black spans of pixels encoded with Huffman codes.
  */
-static void encode_1d_row(t4_t6_encode_state_t *s, const uint8_t *row_buf)
+static void encode_1d_row(t4_t6_encode_state_t *s, int cur_steps)
 {
+    uint32_t *p;
     int i;
 
-    /* Do our work in the reference row buffer, and it is already in place if
-       we need a reference row for a following 2D encoded row. */
-    s->ref_steps = row_to_run_lengths(s->ref_runs, row_buf, s->image_width);
-    put_1d_span(s, s->ref_runs[0], t4_white_codes);
-    for (i = 1;  i < s->ref_steps;  i++)
-        put_1d_span(s, s->ref_runs[i] - s->ref_runs[i - 1], (i & 1)  ?  t4_black_codes  :  t4_white_codes);
+    put_1d_span(s, s->cur_runs[0], t4_white_codes);
+    for (i = 1;  i < cur_steps;  i++)
+        put_1d_span(s, s->cur_runs[i] - s->cur_runs[i - 1], (i & 1)  ?  t4_black_codes  :  t4_white_codes);
     /*endfor*/
-    /* Stretch the row a little, so when we step by 2 we are guaranteed to
-       hit an entry showing the row length */
-    s->ref_runs[s->ref_steps] =
-    s->ref_runs[s->ref_steps + 1] =
-    s->ref_runs[s->ref_steps + 2] = s->ref_runs[s->ref_steps - 1];
+    /* Swap the buffers, so this row is in place if we need a reference row for a
+       following 2D encoded row. */
+    s->ref_steps = cur_steps;
+    p = s->cur_runs;
+    s->cur_runs = s->ref_runs;
+    s->ref_runs = p;
 }
 /*- End of function --------------------------------------------------------*/
 
-static int encode_row(t4_t6_encode_state_t *s, const uint8_t *row_buf, size_t len)
+static int encode_runs(t4_t6_encode_state_t *s, int cur_steps)
 {
+    /* Stretch the row a little, so when we step by 2 we are guaranteed to
+       hit an entry showing the row length. */
+    s->cur_runs[cur_steps] =
+    s->cur_runs[cur_steps + 1] =
+    s->cur_runs[cur_steps + 2] = s->cur_runs[cur_steps - 1];
+
     switch (s->encoding)
     {
     case T4_COMPRESSION_T6:
@@ -867,18 +872,18 @@ static int encode_row(t4_t6_encode_state_t *s, const uint8_t *row_buf, size_t le
            throw it in here. T.6 is only used with error correction,
            so it does not need independantly compressed (i.e. 1D) lines
            to recover from data errors. It doesn't need EOLs, either. */
-        encode_2d_row(s, row_buf);
+        encode_2d_row(s, cur_steps);
         break;
     case T4_COMPRESSION_T4_2D:
         encode_eol(s);
         if (s->row_is_2d)
         {
-            encode_2d_row(s, row_buf);
+            encode_2d_row(s, cur_steps);
             s->rows_to_next_1d_row--;
         }
         else
         {
-            encode_1d_row(s, row_buf);
+            encode_1d_row(s, cur_steps);
             s->row_is_2d = true;
         }
         /*endif*/
@@ -893,7 +898,7 @@ static int encode_row(t4_t6_encode_state_t *s, const uint8_t *row_buf, size_t le
     default:
     case T4_COMPRESSION_T4_1D:
         encode_eol(s);
-        encode_1d_row(s, row_buf);
+        encode_1d_row(s, cur_steps);
         break;
     }
     /*endswitch*/
@@ -902,6 +907,37 @@ static int encode_row(t4_t6_encode_state_t *s, const uint8_t *row_buf, size_t le
 }
 /*- End of function --------------------------------------------------------*/
 
+static int encode_row(t4_t6_encode_state_t *s, const uint8_t *row_buf, size_t len)
+{
+    return encode_runs(s, row_to_run_lengths(s->cur_runs, row_buf, s->image_width));
+}
+/*- End of function --------------------------------------------------------*/
+
+static int read_next_runs(t4_t6_encode_state_t *s)
+{
+    int steps;
+
+    /* The runs go straight into the current row buffer, leaving room for the
+       stretching done by encode_runs(). */
+    steps = s->run_read_handler(s->run_read_user_data, s->cur_runs, s->image_width + 1);
+    if (steps <= 0)
+    {
+        if (steps < 0)
+            span_log(&s->logging, SPAN_LOG_WARNING, "Failed to read the runs for row %d. Ending the image\n", s->image_length);
+        /*endif*/
+        return 0;
+    }
+    /*endif*/
+    if (steps > s->image_width + 1  ||  s->cur_runs[steps - 1] != (uint32_t) s->image_width)
+    {
+        span_log(&s->logging, SPAN_LOG_WARNING, "Bad run list for row %d. Ending the image\n", s->image_length);
+        return 0;
+    }
+    /*endif*/
+    return steps;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int finalise_page(t4_t6_encode_state_t *s)
 {
     int i;
@@ -931,16 +967,55 @@ static int finalise_page(t4_t6_encode_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
+static const uint8_t *read_next_strip_row(t4_t6_encode_state_t *s)
+{
+    uint8_t *buf;
+    int size;
+
+    if (s->strip_row >= s->strip_rows)
+    {
+        if (s->strip_ended)
+            return NULL;
+        /*endif*/
+        size = T4_STRIP_ROWS*s->bytes_per_row;
+        if (size > s->strip_buf_size)
+        {
+            if ((buf = (uint8_t *) span_realloc(s->strip_buf, size)) == NULL)
+                return NULL;
+            /*endif*/
+            s->strip_buf = buf;
+            s->strip_buf_size = size;
+        }
+        /*endif*/
+        s->strip_row = 0;
+        if ((s->strip_rows = s->strip_read_handler(s->strip_read_user_data, s->strip_buf, s->bytes_per_row, s->bytes_per_row, T4_STRIP_ROWS)) <= 0)
+        {
+            s->strip_rows = 0;
+            return NULL;
+        }
+        /*endif*/
+        if (s->strip_rows < T4_STRIP_ROWS)
+            s->strip_ended = true;
+        else
+            s->strip_rows = T4_STRIP_ROWS;
+        /*endif*/
+    }
+    /*endif*/
+    return &s->strip_buf[s->bytes_per_row*s->strip_row++];
+}
+/*- End of function --------------------------------------------------------*/
+
 static int get_next_row(t4_t6_encode_state_t *s)
 {
     int len;
+    const uint8_t *row;
 #if defined(_MSC_VER)
     uint8_t *row_buf = (uint8_t *) _alloca(s->bytes_per_row);
 #else
     uint8_t row_buf[s->bytes_per_row];
 #endif
 
-    if (s->row_bits < 0  ||  s->row_read_handler == NULL)
+    if (s->row_bits < 0  ||  (s->row_read_handler == NULL  &&  s->run_read_handler == NULL  &&  s->strip_read_handler == NULL))
         return -1;
     /*endif*/
     s->bitstream_iptr = 0;
@@ -951,11 +1026,38 @@ static int get_next_row(t4_t6_encode_state_t *s)
        and can continue outputting. */
     do
     {
-        len = s->row_read_handler(s->row_read_user_data, row_buf, s->bytes_per_row);
-        if (len == s->bytes_per_row)
-            encode_row(s, row_buf, len);
+        if (s->run_read_handler)
+        {
+            /* Runs are preferred, when we have a source for them. */
+            if ((len = read_next_runs(s)) > 0)
+                encode_runs(s, len);
+            else
+                finalise_page(s);
+            /*endif*/
+        }
+        else if (s->strip_read_handler)
+        {
+            if ((row = read_next_strip_row(s)))
+            {
+                len = s->bytes_per_row;
+                encode_row(s, row, len);
+            }
+            else
+            {
+                len = 0;
+                finalise_page(s);
+            }
+            /*endif*/
+        }
         else
-            finalise_page(s);
+        {
+            len = s->row_read_handler(s->row_read_user_data, row_buf, s->bytes_per_row);
+            if (len == s->bytes_per_row)
+                encode_row(s, row_buf, len);
+            else
+                finalise_page(s);
+            /*endif*/
+        }
         /*endif*/
     }
     while (len > 0  &&  s->bitstream_iptr == 0);
@@ -1033,6 +1135,25 @@ SPAN_DECLARE(int) t4_t6_encode_set_row_read_handler(t4_t6_encode_state_t *s, t4_
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t4_t6_encode_set_strip_read_handler(t4_t6_encode_state_t *s, t4_strip_read_handler_t handler, void *user_data)
+{
+    s->strip_read_handler = handler;
+    s->strip_read_user_data = user_data;
+    s->strip_rows = 0;
+    s->strip_row = 0;
+    s->strip_ended = false;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t4_t6_encode_set_run_read_handler(t4_t6_encode_state_t *s, t4_run_read_handler_t handler, void *user_data)
+{
+    s->run_read_handler = handler;
+    s->run_read_user_data = user_data;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) t4_t6_encode_set_encoding(t4_t6_encode_state_t *s, int encoding)
 {
     switch (encoding)
@@ -1195,6 +1316,9 @@ SPAN_DECLARE(int) t4_t6_encode_restart(t4_t6_encode_state_t *s, int image_width,
     s->max_row_bits = 0;
     s->image_length = 0;
     s->compressed_image_size = 0;
+    s->strip_rows = 0;
+    s->strip_row = 0;
+    s->strip_ended = false;
 
     s->ref_runs[0] =
     s->ref_runs[1] =
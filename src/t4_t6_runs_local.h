@@ -0,0 +1,50 @@
+/*
+ * SpanDSP - a series of DSP components for telephony
+ *
+ * t4_t6_runs_local.h - definitions for buffering T.4/T.6 images as run-lengths
+ *
+ * Copyright (C) 2026 The SpanDSP contributors
+ *
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 2.1,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*! \file */
+
+#if !defined(_T4_T6_RUNS_LOCAL_H_)
+#define _T4_T6_RUNS_LOCAL_H_
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/* A t4_run_read_handler_t, which plays out the rows of a t4_runs_buffer_t, passed as
+   user_data, from its current position. It returns -1, without moving on, if the next
+   row does not fit in max_steps or runs past the stored data. */
+int t4_runs_buffer_read_row(void *user_data, uint32_t runs[], int max_steps);
+
+/* A t4_run_write_handler_t, which adds a row to the end of a t4_runs_buffer_t, passed as
+   user_data. */
+int t4_runs_buffer_write_row(void *user_data, const uint32_t runs[], int steps);
+
+void t4_runs_buffer_release(t4_runs_buffer_t *s);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
+/*- End of file ------------------------------------------------------------*/
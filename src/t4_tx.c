@@ -79,6 +79,8 @@
 #include "spandsp/private/t4_rx.h"
 #include "spandsp/private/t4_tx.h"
 
+#include "t4_t6_runs_local.h"
+
 #include "faxfont.h"
 
 #if defined(SPANDSP_SUPPORT_TIFF_FX)  &&  defined(HAVE_TIF_DIR_H)
@@ -412,6 +414,85 @@ static int read_colour_map(t4_tx_state_t *s, int bits_per_sample)
 /*- End of function --------------------------------------------------------*/
 #endif
 
+static void read_page_info(TIFF *tiff_file, t4_tx_page_info_t *info)
+{
+#if defined(SPANDSP_SUPPORT_TIFF_FX)
+    uint16_t parm16;
+#endif
+    uint32_t parm32;
+    float x_resolution;
+    float y_resolution;
+    uint16_t bits_per_sample;
+    uint16_t samples_per_pixel;
+    uint16_t res_unit;
+
+    info->dir_offset = TIFFCurrentDirOffset(tiff_file);
+    bits_per_sample = 1;
+    TIFFGetField(tiff_file, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
+    samples_per_pixel = 1;
+    TIFFGetField(tiff_file, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
+    if (samples_per_pixel == 1  &&  bits_per_sample == 1)
+        info->image_type = T4_IMAGE_TYPE_BILEVEL;
+    else if (samples_per_pixel == 3  &&  bits_per_sample == 1)
+        info->image_type = T4_IMAGE_TYPE_COLOUR_BILEVEL;
+    else if (samples_per_pixel == 4  &&  bits_per_sample == 1)
+        info->image_type = T4_IMAGE_TYPE_COLOUR_BILEVEL;
+    else if (samples_per_pixel == 1  &&  bits_per_sample == 8)
+        info->image_type = T4_IMAGE_TYPE_GRAY_8BIT;
+    else if (samples_per_pixel == 1  &&  bits_per_sample > 8)
+        info->image_type = T4_IMAGE_TYPE_GRAY_12BIT;
+    else if (samples_per_pixel == 3  &&  bits_per_sample == 8)
+        info->image_type = T4_IMAGE_TYPE_COLOUR_8BIT;
+    else if (samples_per_pixel == 3  &&  bits_per_sample > 8)
+        info->image_type = T4_IMAGE_TYPE_COLOUR_12BIT;
+    else
+        info->image_type = -1;
+    /*endif*/
+
+#if defined(SPANDSP_SUPPORT_TIFF_FX)
+    parm16 = 0;
+    if (TIFFGetField(tiff_file, TIFFTAG_INDEXED, &parm16)  &&  parm16 == 1)
+    {
+        /* Its an indexed image, so its really a colour image, even though it may have only one sample per pixel */
+        if (samples_per_pixel == 1  &&  bits_per_sample == 8)
+            info->image_type = T4_IMAGE_TYPE_COLOUR_8BIT;
+        else if (samples_per_pixel == 1  &&  bits_per_sample > 8)
+            info->image_type = T4_IMAGE_TYPE_COLOUR_12BIT;
+        /*endif*/
+    }
+    /*endif*/
+#endif
+
+    parm32 = 0;
+    TIFFGetField(tiff_file, TIFFTAG_IMAGEWIDTH, &parm32);
+    info->image_width = parm32;
+    parm32 = 0;
+    TIFFGetField(tiff_file, TIFFTAG_IMAGELENGTH, &parm32);
+    info->image_length = parm32;
+
+    x_resolution = 0.0f;
+    TIFFGetField(tiff_file, TIFFTAG_XRESOLUTION, &x_resolution);
+    y_resolution = 0.0f;
+    TIFFGetField(tiff_file, TIFFTAG_YRESOLUTION, &y_resolution);
+    res_unit = RESUNIT_INCH;
+    TIFFGetField(tiff_file, TIFFTAG_RESOLUTIONUNIT, &res_unit);
+
+    info->x_resolution = x_resolution*100.0f;
+    info->y_resolution = y_resolution*100.0f;
+    if (res_unit == RESUNIT_INCH)
+    {
+        info->x_resolution /= CM_PER_INCH;
+        info->y_resolution /= CM_PER_INCH;
+    }
+    /*endif*/
+
+    info->photo_metric = PHOTOMETRIC_MINISWHITE;
+    TIFFGetField(tiff_file, TIFFTAG_PHOTOMETRIC, &info->photo_metric);
+    info->compression = -1;
+    TIFFGetField(tiff_file, TIFFTAG_COMPRESSION, &info->compression);
+}
+/*- End of function --------------------------------------------------------*/
+
 static int get_tiff_directory_info(t4_tx_state_t *s)
 {
 #if defined(SPANDSP_SUPPORT_TIFF_FX)
@@ -436,86 +517,37 @@ static int get_tiff_directory_info(t4_tx_state_t *s)
     float bmin;
     float bmax;
     uint8_t parm8;
-#endif
-#if defined(SPANDSP_SUPPORT_TIFF_FX)
     uint16_t parm16;
-#endif
     uint32_t parm32;
+    uint16_t bits_per_sample;
+#endif
     int best_x_entry;
     int best_y_entry;
-    float x_resolution;
-    float y_resolution;
+    t4_tx_page_info_t info;
     t4_tx_tiff_state_t *t;
-    uint16_t bits_per_sample;
-    uint16_t samples_per_pixel;
-    uint16_t res_unit;
     uint16_t YCbCrSubsample_horiz;
     uint16_t YCbCrSubsample_vert;
 
     t = &s->tiff;
-    bits_per_sample = 1;
-    TIFFGetField(t->tiff_file, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
-    samples_per_pixel = 1;
-    TIFFGetField(t->tiff_file, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
-    if (samples_per_pixel == 1  &&  bits_per_sample == 1)
-        t->image_type = T4_IMAGE_TYPE_BILEVEL;
-    else if (samples_per_pixel == 3  &&  bits_per_sample == 1)
-        t->image_type = T4_IMAGE_TYPE_COLOUR_BILEVEL;
-    else if (samples_per_pixel == 4  &&  bits_per_sample == 1)
-        t->image_type = T4_IMAGE_TYPE_COLOUR_BILEVEL;
-    else if (samples_per_pixel == 1  &&  bits_per_sample == 8)
-        t->image_type = T4_IMAGE_TYPE_GRAY_8BIT;
-    else if (samples_per_pixel == 1  &&  bits_per_sample > 8)
-        t->image_type = T4_IMAGE_TYPE_GRAY_12BIT;
-    else if (samples_per_pixel == 3  &&  bits_per_sample == 8)
-        t->image_type = T4_IMAGE_TYPE_COLOUR_8BIT;
-    else if (samples_per_pixel == 3  &&  bits_per_sample > 8)
-        t->image_type = T4_IMAGE_TYPE_COLOUR_12BIT;
-    else
+    read_page_info(t->tiff_file, &info);
+    if (info.image_type < 0)
         return -1;
     /*endif*/
+    t->image_type = info.image_type;
 
 #if defined(SPANDSP_SUPPORT_TIFF_FX)
+    bits_per_sample = 1;
+    TIFFGetField(t->tiff_file, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
     parm16 = 0;
     if (TIFFGetField(t->tiff_file, TIFFTAG_INDEXED, &parm16))
-    {
         span_log(&s->logging, SPAN_LOG_FLOW, "Indexed %s (%u)\n", (parm16)  ?  "palette image"  :  "non-palette image", parm16);
-        if (parm16 == 1)
-        {
-            /* Its an indexed image, so its really a colour image, even though it may have only one sample per pixel */
-            if (samples_per_pixel == 1  &&  bits_per_sample == 8)
-                t->image_type = T4_IMAGE_TYPE_COLOUR_8BIT;
-            else if (samples_per_pixel == 1  &&  bits_per_sample > 8)
-                t->image_type = T4_IMAGE_TYPE_COLOUR_12BIT;
-            /*endif*/
-        }
-        /*endif*/
-    }
     /*endif*/
 #endif
 
-    parm32 = 0;
-    TIFFGetField(t->tiff_file, TIFFTAG_IMAGEWIDTH, &parm32);
-    t->image_width = parm32;
-    parm32 = 0;
-    TIFFGetField(t->tiff_file, TIFFTAG_IMAGELENGTH, &parm32);
-    t->image_length = parm32;
-
-    x_resolution = 0.0f;
-    TIFFGetField(t->tiff_file, TIFFTAG_XRESOLUTION, &x_resolution);
-    y_resolution = 0.0f;
-    TIFFGetField(t->tiff_file, TIFFTAG_YRESOLUTION, &y_resolution);
-    res_unit = RESUNIT_INCH;
-    TIFFGetField(t->tiff_file, TIFFTAG_RESOLUTIONUNIT, &res_unit);
-
-    t->x_resolution = x_resolution*100.0f;
-    t->y_resolution = y_resolution*100.0f;
-    if (res_unit == RESUNIT_INCH)
-    {
-        t->x_resolution /= CM_PER_INCH;
-        t->y_resolution /= CM_PER_INCH;
-    }
-    /*endif*/
+    t->image_width = info.image_width;
+    t->image_length = info.image_length;
+    t->x_resolution = info.x_resolution;
+    t->y_resolution = info.y_resolution;
 
     if (((best_x_entry = match_resolution(t->x_resolution, x_res_table)) >= 0)
         &&
@@ -529,15 +561,13 @@ static int get_tiff_directory_info(t4_tx_state_t *s)
     }
     /*endif*/
 
-    t->photo_metric = PHOTOMETRIC_MINISWHITE;
-    TIFFGetField(t->tiff_file, TIFFTAG_PHOTOMETRIC, &t->photo_metric);
+    t->photo_metric = info.photo_metric;
 
     /* The default luminant is D50 */
     set_lab_illuminant(&s->lab_params, 96.422f, 100.000f,  82.521f);
     set_lab_gamut(&s->lab_params, 0, 100, -85, 85, -75, 125, false);
 
-    t->compression = -1;
-    TIFFGetField(t->tiff_file, TIFFTAG_COMPRESSION, &t->compression);
+    t->compression = info.compression;
     switch (t->compression)
     {
     case COMPRESSION_CCITT_T4:
@@ -700,91 +730,102 @@ static int get_tiff_directory_info(t4_tx_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
-static int test_tiff_directory_info(t4_tx_state_t *s)
+static int build_page_index(t4_tx_page_index_t *index, TIFF *tiff_file)
 {
-    uint16_t res_unit;
-    uint32_t parm32;
-    uint16_t bits_per_sample;
-    uint16_t samples_per_pixel;
-    int image_type;
-    float x_resolution;
-    float y_resolution;
-    t4_tx_tiff_state_t *t;
+    t4_tx_page_info_t *page;
+    int n;
 
-    t = &s->tiff;
-    bits_per_sample = 1;
-    TIFFGetField(t->tiff_file, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
-    samples_per_pixel = 1;
-    TIFFGetField(t->tiff_file, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
-    if (samples_per_pixel == 1  &&  bits_per_sample == 1)
-        image_type = T4_IMAGE_TYPE_BILEVEL;
-    else if (samples_per_pixel == 3  &&  bits_per_sample == 1)
-        image_type = T4_IMAGE_TYPE_COLOUR_BILEVEL;
-    else if (samples_per_pixel == 4  &&  bits_per_sample == 1)
-        image_type = T4_IMAGE_TYPE_COLOUR_BILEVEL;
-    else if (samples_per_pixel == 1  &&  bits_per_sample == 8)
-        image_type = T4_IMAGE_TYPE_GRAY_8BIT;
-    else if (samples_per_pixel == 1  &&  bits_per_sample > 8)
-        image_type = T4_IMAGE_TYPE_GRAY_12BIT;
-    else if (samples_per_pixel == 3  &&  bits_per_sample == 8)
-        image_type = T4_IMAGE_TYPE_COLOUR_8BIT;
-    else if (samples_per_pixel == 3  &&  bits_per_sample > 8)
-        image_type = T4_IMAGE_TYPE_COLOUR_12BIT;
-    else
-        image_type = -1;
-    /*endif*/
-    if (t->image_type != image_type)
-        return 1;
+    /* Walk the directory chain once, from start to finish. Going to each page in turn
+       with TIFFSetDirectory would go back to the start of the chain every time. */
+    index->pages = 0;
+    if (!TIFFSetDirectory(tiff_file, 0))
+        return -1;
     /*endif*/
+    do
+    {
+        if (index->pages >= index->pages_allocated)
+        {
+            n = (index->pages_allocated)  ?  2*index->pages_allocated  :  16;
+            if ((page = (t4_tx_page_info_t *) span_realloc(index->page, n*sizeof(index->page[0]))) == NULL)
+                return -1;
+            /*endif*/
+            index->page = page;
+            index->pages_allocated = n;
+        }
+        /*endif*/
+        read_page_info(tiff_file, &index->page[index->pages++]);
+    }
+    while (TIFFReadDirectory(tiff_file));
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
 
-    parm32 = 0;
-    TIFFGetField(t->tiff_file, TIFFTAG_IMAGEWIDTH, &parm32);
-    if (s->tiff.image_width != (int) parm32)
-        return 2;
+static const t4_tx_page_index_t *get_page_index(t4_tx_state_t *s)
+{
+    if (s->tiff.page_index == NULL)
+    {
+        if (build_page_index(&s->tiff.local_page_index, s->tiff.tiff_file) < 0)
+            return NULL;
+        /*endif*/
+        span_log(&s->logging, SPAN_LOG_FLOW, "Indexed %d pages\n", s->tiff.local_page_index.pages);
+        s->tiff.page_index = &s->tiff.local_page_index;
+        /* Building the index moved libtiff away from the current page */
+        if (s->current_page < s->tiff.page_index->pages
+            &&
+            !TIFFSetSubDirectory(s->tiff.tiff_file, s->tiff.page_index->page[s->current_page].dir_offset))
+        {
+            return NULL;
+        }
+        /*endif*/
+    }
     /*endif*/
+    return s->tiff.page_index;
+}
+/*- End of function --------------------------------------------------------*/
 
-    x_resolution = 0.0f;
-    TIFFGetField(t->tiff_file, TIFFTAG_XRESOLUTION, &x_resolution);
-    y_resolution = 0.0f;
-    TIFFGetField(t->tiff_file, TIFFTAG_YRESOLUTION, &y_resolution);
-    res_unit = RESUNIT_INCH;
-    TIFFGetField(t->tiff_file, TIFFTAG_RESOLUTIONUNIT, &res_unit);
+static int set_tiff_directory(t4_tx_state_t *s, int page)
+{
+    const t4_tx_page_index_t *index;
 
-    x_resolution *= 100.0f;
-    y_resolution *= 100.0f;
-    if (res_unit == RESUNIT_INCH)
-    {
-        x_resolution /= CM_PER_INCH;
-        y_resolution /= CM_PER_INCH;
-    }
+    if ((index = get_page_index(s)) == NULL  ||  page < 0  ||  page >= index->pages)
+        return -1;
+    /*endif*/
+    if (!TIFFSetSubDirectory(s->tiff.tiff_file, index->page[page].dir_offset))
+        return -1;
+    /*endif*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int test_tiff_directory_info(t4_tx_state_t *s, const t4_tx_page_info_t *info)
+{
+    if (s->tiff.image_type != info->image_type)
+        return 1;
     /*endif*/
-    if (s->tiff.x_resolution != (int) x_resolution)
+    if (s->tiff.image_width != info->image_width)
+        return 2;
+    /*endif*/
+    if (s->tiff.x_resolution != info->x_resolution)
         return 3;
     /*endif*/
-    if (s->tiff.y_resolution != (int) y_resolution)
+    if (s->tiff.y_resolution != info->y_resolution)
         return 4;
     /*endif*/
-
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
 
 static int get_tiff_total_pages(t4_tx_state_t *s)
 {
-    int max;
+    const t4_tx_page_index_t *index;
 
     /* Each page *should* contain the total number of pages, but can this be
        trusted? Some files say 0. Actually searching for the last page is
        more reliable. */
-    max = 0;
-    while (TIFFSetDirectory(s->tiff.tiff_file, (tdir_t) max))
-        max++;
-    /*endwhile*/
-    /* Back to the previous page */
-    if (!TIFFSetDirectory(s->tiff.tiff_file, (tdir_t) s->current_page))
+    if ((index = get_page_index(s)) == NULL)
         return -1;
     /*endif*/
-    return max;
+    return index->pages;
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -797,6 +838,108 @@ static int open_tiff_input_file(t4_tx_state_t *s, const char *file)
 }
 /*- End of function --------------------------------------------------------*/
 
+static tmsize_t tiff_mem_read(thandle_t handle, void *buf, tmsize_t size)
+{
+    t4_tx_state_t *s;
+
+    s = (t4_tx_state_t *) handle;
+    if (s->tiff.mem_pos >= s->tiff.mem_len)
+        return 0;
+    /*endif*/
+    if (size > (tmsize_t) (s->tiff.mem_len - s->tiff.mem_pos))
+        size = s->tiff.mem_len - s->tiff.mem_pos;
+    /*endif*/
+    memcpy(buf, &s->tiff.mem_buf[s->tiff.mem_pos], size);
+    s->tiff.mem_pos += size;
+    return size;
+}
+/*- End of function --------------------------------------------------------*/
+
+static tmsize_t tiff_mem_write(thandle_t handle, void *buf, tmsize_t size)
+{
+    /* The image in memory is read only */
+    return -1;
+}
+/*- End of function --------------------------------------------------------*/
+
+static toff_t tiff_mem_seek(thandle_t handle, toff_t offset, int whence)
+{
+    t4_tx_state_t *s;
+
+    s = (t4_tx_state_t *) handle;
+    switch (whence)
+    {
+    case SEEK_SET:
+        s->tiff.mem_pos = offset;
+        break;
+    case SEEK_CUR:
+        s->tiff.mem_pos += offset;
+        break;
+    case SEEK_END:
+        s->tiff.mem_pos = s->tiff.mem_len + offset;
+        break;
+    }
+    /*endswitch*/
+    return s->tiff.mem_pos;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int tiff_mem_close(thandle_t handle)
+{
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static toff_t tiff_mem_size(thandle_t handle)
+{
+    t4_tx_state_t *s;
+
+    s = (t4_tx_state_t *) handle;
+    return s->tiff.mem_len;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int tiff_mem_map(thandle_t handle, void **base, toff_t *size)
+{
+    t4_tx_state_t *s;
+
+    /* The image is already in memory, so libtiff can use it in place, as it would
+       a memory mapped file. */
+    s = (t4_tx_state_t *) handle;
+    *base = (void *) s->tiff.mem_buf;
+    *size = s->tiff.mem_len;
+    return 1;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void tiff_mem_unmap(thandle_t handle, void *base, toff_t size)
+{
+}
+/*- End of function --------------------------------------------------------*/
+
+static int open_tiff_input_memory(t4_tx_state_t *s, const uint8_t buf[], size_t len)
+{
+    s->tiff.mem_buf = buf;
+    s->tiff.mem_len = len;
+    s->tiff.mem_pos = 0;
+    if ((s->tiff.tiff_file = TIFFClientOpen("<memory>",
+                                            "r",
+                                            (thandle_t) s,
+                                            tiff_mem_read,
+                                            tiff_mem_write,
+                                            tiff_mem_seek,
+                                            tiff_mem_close,
+                                            tiff_mem_size,
+                                            tiff_mem_map,
+                                            tiff_mem_unmap)) == NULL)
+    {
+        return -1;
+    }
+    /*endif*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int metadata_row_read_handler(void *user_data, uint8_t buf[], size_t len)
 {
     t4_tx_state_t *s;
@@ -811,6 +954,36 @@ static int metadata_row_read_handler(void *user_data, uint8_t buf[], size_t len)
 }
 /*- End of function --------------------------------------------------------*/
 
+static int metadata_strip_read_handler(void *user_data, uint8_t buf[], size_t len, size_t stride, int max_rows)
+{
+    t4_tx_state_t *s;
+    int rows;
+    int i;
+
+    s = (t4_tx_state_t *) user_data;
+    rows = s->metadata.image_length - s->tiff.row;
+    if (rows > max_rows)
+        rows = max_rows;
+    /*endif*/
+    if (rows <= 0)
+        return 0;
+    /*endif*/
+    if (stride == len)
+    {
+        memcpy(buf, &s->tiff.image_buffer[s->tiff.row*len], rows*len);
+    }
+    else
+    {
+        for (i = 0;  i < rows;  i++)
+            memcpy(&buf[i*stride], &s->tiff.image_buffer[(s->tiff.row + i)*len], len);
+        /*endfor*/
+    }
+    /*endif*/
+    s->tiff.row += rows;
+    return rows;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int tiff_row_read_handler(void *user_data, uint8_t buf[], size_t len)
 {
     t4_tx_state_t *s;
@@ -841,6 +1014,109 @@ static int tiff_row_read_handler(void *user_data, uint8_t buf[], size_t len)
 }
 /*- End of function --------------------------------------------------------*/
 
+static int tiff_strip_read_handler(void *user_data, uint8_t buf[], size_t len, size_t stride, int max_rows)
+{
+    t4_tx_state_t *s;
+    int rows;
+
+    s = (t4_tx_state_t *) user_data;
+    if (s->tiff.image_buffer == NULL)
+        return 0;
+    /*endif*/
+    if (s->row_squashing_ratio == 1  &&  stride == len)
+    {
+        /* The rows are used as they are, so the whole strip can be copied in one go */
+        rows = s->tiff.image_length - s->tiff.row;
+        if (rows > max_rows)
+            rows = max_rows;
+        /*endif*/
+        if (rows <= 0)
+            return 0;
+        /*endif*/
+        memcpy(buf, &s->tiff.image_buffer[s->tiff.row*len], rows*len);
+        s->tiff.row += rows;
+        return rows;
+    }
+    /*endif*/
+    for (rows = 0;  rows < max_rows;  rows++)
+    {
+        if (tiff_row_read_handler(user_data, &buf[rows*stride], len) != len)
+            break;
+        /*endif*/
+    }
+    /*endfor*/
+    return rows;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void set_row_span(uint8_t row[], int from, int to)
+{
+    int first;
+    int last;
+
+    if (from >= to)
+        return;
+    /*endif*/
+    first = from >> 3;
+    last = (to - 1) >> 3;
+    if (first == last)
+    {
+        row[first] |= (0xFF >> (from & 7)) & (0xFF << (7 - ((to - 1) & 7)));
+        return;
+    }
+    /*endif*/
+    row[first] |= (0xFF >> (from & 7));
+    if (last > first + 1)
+        memset(&row[first + 1], 0xFF, last - first - 1);
+    /*endif*/
+    row[last] |= (0xFF << (7 - ((to - 1) & 7)));
+}
+/*- End of function --------------------------------------------------------*/
+
+static int tiff_runs_row_read_handler(void *user_data, uint8_t buf[], size_t len)
+{
+    t4_tx_state_t *s;
+    const uint32_t *runs;
+    int steps;
+    int i;
+    int j;
+
+    s = (t4_tx_state_t *) user_data;
+    if (s->tiff.runs.ptr >= s->tiff.runs.len)
+        return 0;
+    /*endif*/
+    /* Paint the black runs of the row. If this is a bi-level image which has more vertical
+       resolution than the far end will accept, we need to squash it down to size, so we
+       paint several rows on top of each other. */
+    memset(buf, 0, len);
+    for (i = 0;  i < s->row_squashing_ratio  &&  s->tiff.runs.ptr < s->tiff.runs.len;  i++)
+    {
+        steps = s->tiff.runs.buf[s->tiff.runs.ptr++];
+        runs = &s->tiff.runs.buf[s->tiff.runs.ptr];
+        for (j = 1;  j < steps;  j += 2)
+            set_row_span(buf, runs[j - 1], runs[j]);
+        /*endfor*/
+        s->tiff.runs.ptr += steps;
+        s->tiff.row++;
+    }
+    /*endfor*/
+    return len;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int tiff_run_read_handler(void *user_data, uint32_t runs[], int max_steps)
+{
+    t4_tx_state_t *s;
+    int steps;
+
+    s = (t4_tx_state_t *) user_data;
+    if ((steps = t4_runs_buffer_read_row(&s->tiff.runs, runs, max_steps)) > 0)
+        s->tiff.row++;
+    /*endif*/
+    return steps;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int translate_row_read2(void *user_data, uint8_t buf[], size_t len)
 {
     t4_tx_state_t *s;
@@ -935,6 +1211,12 @@ static int read_tiff_raw_image(t4_tx_state_t *s)
     for (i = 0;  i < num_strips;  i++)
         total_len += TIFFRawStripSize(s->tiff.tiff_file, i);
     /*endfor*/
+    if (s->no_encoder.external_buf)
+    {
+        s->no_encoder.buf = NULL;
+        s->no_encoder.external_buf = false;
+    }
+    /*endif*/
     if ((s->no_encoder.buf = span_realloc(s->no_encoder.buf, total_len)) == NULL)
         return -1;
     /*endif*/
@@ -1214,6 +1496,110 @@ static int read_tiff_t42_t81_image(t4_tx_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
+static int read_tiff_t4_t6_runs(t4_tx_state_t *s)
+{
+    t4_t6_decode_state_t dec;
+    uint32_t t4_options;
+    uint16_t fill_order;
+    uint8_t *raw;
+    int encoding;
+    int len;
+    int res;
+    int i;
+    int j;
+
+    /* Decode the image to a list of run-lengths per row. In most cases this lets us
+       transcode between T.4 and T.6 without the image ever being expanded to a bitmap,
+       and the list of runs is much smaller than a bitmap anyway. Each strip of a T.6
+       image is coded independently, so we only try this for single strip images, which
+       is what we write ourselves. Anything unusual is left for libtiff to deal with. */
+    if (s->tiff.photo_metric != PHOTOMETRIC_MINISWHITE  ||  TIFFNumberOfStrips(s->tiff.tiff_file) != 1)
+        return -1;
+    /*endif*/
+    if (s->tiff.compression == COMPRESSION_CCITT_T6)
+    {
+        encoding = T4_COMPRESSION_T6;
+    }
+    else
+    {
+        t4_options = 0;
+        TIFFGetField(s->tiff.tiff_file, TIFFTAG_T4OPTIONS, &t4_options);
+        if ((t4_options & GROUP3OPT_UNCOMPRESSED))
+            return -1;
+        /*endif*/
+        encoding = (t4_options & GROUP3OPT_2DENCODING)  ?  T4_COMPRESSION_T4_2D  :  T4_COMPRESSION_T4_1D;
+    }
+    /*endif*/
+    fill_order = FILLORDER_MSB2LSB;
+    TIFFGetField(s->tiff.tiff_file, TIFFTAG_FILLORDER, &fill_order);
+
+    if ((len = TIFFRawStripSize(s->tiff.tiff_file, 0)) <= 0)
+        return -1;
+    /*endif*/
+    if ((raw = span_alloc(len)) == NULL)
+        return -1;
+    /*endif*/
+    if ((len = TIFFReadRawStrip(s->tiff.tiff_file, 0, raw, len)) < 0)
+    {
+        span_log(&s->logging, SPAN_LOG_WARNING, "%s: TIFFReadRawStrip error.\n", s->tiff.file);
+        span_free(raw);
+        return -1;
+    }
+    /*endif*/
+    /* The decoder expects the bits in the order they go down the line. */
+    if (fill_order != FILLORDER_LSB2MSB)
+        bit_reverse(raw, raw, len);
+    /*endif*/
+
+    s->tiff.runs.len = 0;
+    s->tiff.runs.ptr = 0;
+    if (t4_t6_decode_init(&dec, encoding, s->tiff.image_width, NULL, NULL) == NULL)
+    {
+        span_free(raw);
+        return -1;
+    }
+    /*endif*/
+    t4_t6_decode_set_run_write_handler(&dec, t4_runs_buffer_write_row, &s->tiff.runs);
+    res = t4_t6_decode_put(&dec, raw, len);
+    if (encoding != T4_COMPRESSION_T6)
+    {
+        /* T.4 images in TIFF files do not normally end with an RTC, so the last row is not
+           complete until the decoder sees another EOL. Supply an RTC to finish the image. */
+        for (i = 0;  i < 6  &&  res == T4_DECODE_MORE_DATA;  i++)
+        {
+            for (j = 0;  j < 11;  j++)
+                t4_t6_decode_put_bit(&dec, 0);
+            /*endfor*/
+            res = t4_t6_decode_put_bit(&dec, 1);
+            if (encoding == T4_COMPRESSION_T4_2D  &&  res == T4_DECODE_MORE_DATA)
+                res = t4_t6_decode_put_bit(&dec, 1);
+            /*endif*/
+        }
+        /*endfor*/
+    }
+    /*endif*/
+    if (res == T4_DECODE_MORE_DATA)
+        t4_t6_decode_put(&dec, NULL, 0);
+    /*endif*/
+    /* Bad rows are repaired differently here and in libtiff, so only accept a clean image. */
+    res = (t4_t6_decode_get_image_length(&dec) == s->tiff.image_length  &&  dec.bad_rows == 0)  ?  0  :  -1;
+    t4_t6_decode_release(&dec);
+    span_free(raw);
+    if (res < 0)
+    {
+        span_log(&s->logging, SPAN_LOG_FLOW, "%s: Cannot use the image run-lengths directly.\n", s->tiff.file);
+        return -1;
+    }
+    /*endif*/
+    s->row_handler = tiff_runs_row_read_handler;
+    s->row_handler_user_data = (void *) s;
+    s->strip_handler = NULL;
+    /* The encoder can only take the runs as they are if no rows need to be squashed together. */
+    s->run_handler = (s->row_squashing_ratio == 1)  ?  tiff_run_read_handler  :  NULL;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int read_tiff_decompressed_image(t4_tx_state_t *s)
 {
     int total_len;
@@ -1289,6 +1675,8 @@ static int read_tiff_image(t4_tx_state_t *s)
     s->pack_buf = NULL;
     s->pack_ptr = 0;
     s->pack_row = 0;
+    s->run_handler = NULL;
+    s->strip_handler = NULL;
 
     s->apply_lab = false;
     if (s->tiff.image_type != T4_IMAGE_TYPE_BILEVEL)
@@ -1388,6 +1776,14 @@ static int read_tiff_image(t4_tx_state_t *s)
                 s->tiff.image_buffer = t;
             }
             /*endif*/
+            if (s->pack_buf)
+            {
+                /* The decoded image is already in memory, though it may just have moved. Translate
+                   straight from there, rather than copying each row out through a row handler. */
+                s->pack_buf = s->tiff.image_buffer;
+                image_translate_set_image_source(&s->translator, s->pack_buf, 0);
+            }
+            /*endif*/
             s->tiff.raw_row = 0;
             switch (s->tiff.photo_metric)
             {
@@ -1414,6 +1810,7 @@ static int read_tiff_image(t4_tx_state_t *s)
             image_translate_release(&s->translator);
             s->row_handler = metadata_row_read_handler;
             s->row_handler_user_data = (void *) s;
+            s->strip_handler = metadata_strip_read_handler;
         }
         else
         {
@@ -1421,17 +1818,25 @@ static int read_tiff_image(t4_tx_state_t *s)
             {
                 total_len = 0;
                 s->tiff.image_buffer = span_realloc(s->tiff.image_buffer, s->metadata.image_width*s->metadata.image_length*3);
+                if (s->pack_buf)
+                {
+                    s->pack_buf = s->tiff.image_buffer;
+                    image_translate_set_image_source(&s->translator, s->pack_buf, 0);
+                }
+                /*endif*/
                 for (i = 0;  i < s->metadata.image_length;  i++)
                     total_len += image_translate_row(&s->translator, &s->tiff.image_buffer[total_len], s->metadata.image_width);
                 /*endfor*/
                 image_translate_release(&s->translator);
                 s->row_handler = metadata_row_read_handler;
                 s->row_handler_user_data = (void *) s;
+                s->strip_handler = metadata_strip_read_handler;
             }
             else
             {
                 s->row_handler = tiff_row_read_handler;
                 s->row_handler_user_data = (void *) s;
+                s->strip_handler = tiff_strip_read_handler;
             }
             /*endif*/
         }
@@ -1444,6 +1849,9 @@ static int read_tiff_image(t4_tx_state_t *s)
            practical exception is to conver a superfine resolution image to a fine resolution one,
            or a fine image to a standard resolution one. We could pad slightly short rows or crop
            slightly long one, but lets not bother. */
+        s->row_handler = tiff_row_read_handler;
+        s->row_handler_user_data = (void *) s;
+        s->strip_handler = tiff_strip_read_handler;
         switch (s->tiff.compression)
         {
 #if defined(SPANDSP_SUPPORT_T88)
@@ -1507,7 +1915,19 @@ static int read_tiff_image(t4_tx_state_t *s)
             }
             /*endswitch*/
             break;
-#endif
+#endif
+        case COMPRESSION_CCITT_T4:
+        case COMPRESSION_CCITT_T6:
+            /* Try to work from the run-lengths, rather than a bitmap of the image */
+            if (read_tiff_t4_t6_runs(s) == 0)
+                break;
+            /*endif*/
+            /* Decode the whole image into a buffer */
+            /* Let libtiff handle the decompression */
+            if (read_tiff_decompressed_image(s) < 0)
+                return -1;
+            /*endif*/
+            break;
         default:
             /* Decode the whole image into a buffer */
             /* Let libtiff handle the decompression */
@@ -1544,6 +1964,9 @@ static void tiff_tx_release(t4_tx_state_t *s)
         s->tiff.image_buffer_size = 0;
     }
     /*endif*/
+    t4_runs_buffer_release(&s->tiff.runs);
+    t4_tx_page_index_release(&s->tiff.local_page_index);
+    s->tiff.page_index = NULL;
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -1554,9 +1977,14 @@ static int set_row_read_handler(t4_tx_state_t *s, t4_row_read_handler_t handler,
     case T4_COMPRESSION_T4_1D:
     case T4_COMPRESSION_T4_2D:
     case T4_COMPRESSION_T6:
+        /* When the image itself is being played out, and it is available as run-lengths,
+           feed those straight to the encoder. */
+        t4_t6_encode_set_run_read_handler(&s->encoder.t4_t6, (handler == s->row_handler)  ?  s->run_handler  :  NULL, user_data);
+        t4_t6_encode_set_strip_read_handler(&s->encoder.t4_t6, (handler == s->row_handler)  ?  s->strip_handler  :  NULL, user_data);
         return t4_t6_encode_set_row_read_handler(&s->encoder.t4_t6, handler, user_data);
     case T4_COMPRESSION_T85:
     case T4_COMPRESSION_T85_L0:
+        t85_encode_set_strip_read_handler(&s->encoder.t85, (handler == s->row_handler)  ?  s->strip_handler  :  NULL, user_data);
         return t85_encode_set_row_read_handler(&s->encoder.t85, handler, user_data);
 #if defined(SPANDSP_SUPPORT_T88)
     case T4_COMPRESSION_T88:
@@ -1564,6 +1992,9 @@ static int set_row_read_handler(t4_tx_state_t *s, t4_row_read_handler_t handler,
 #endif
     case T4_COMPRESSION_T42_T81:
     case T4_COMPRESSION_SYCC_T81:
+        /* The T.42 encoder will not change to strips once the image is under way, so after a
+           page header the image continues a row at a time. */
+        t42_encode_set_strip_read_handler(&s->encoder.t42, (handler == s->row_handler)  ?  s->strip_handler  :  NULL, user_data);
         return t42_encode_set_row_read_handler(&s->encoder.t42, handler, user_data);
     case T4_COMPRESSION_T43:
         return t43_encode_set_row_read_handler(&s->encoder.t43, handler, user_data);
@@ -1843,18 +2274,83 @@ static int header_row_read_handler(void *user_data, uint8_t buf[], size_t len)
 }
 /*- End of function --------------------------------------------------------*/
 
+static int get_pre_encoded_page(t4_tx_state_t *s)
+{
+    const uint8_t *buf;
+    size_t len;
+    int compression;
+    int image_width;
+    int image_length;
+    int resolution_code;
+
+    if (s->pre_encoded_page_handler == NULL)
+        return -1;
+    /*endif*/
+    if (s->pre_encoded_page_handler(s->pre_encoded_page_user_data,
+                                    s->current_page,
+                                    &compression,
+                                    &image_width,
+                                    &image_length,
+                                    &resolution_code,
+                                    &buf,
+                                    &len))
+    {
+        return -1;
+    }
+    /*endif*/
+    return t4_tx_set_pre_encoded_page(s, compression, image_width, image_length, resolution_code, buf, len);
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) t4_tx_next_page_has_different_format(t4_tx_state_t *s)
 {
+    const t4_tx_page_index_t *index;
+    const uint8_t *buf;
+    size_t len;
+    int compression;
+    int image_width;
+    int image_length;
+    int resolution_code;
+
     span_log(&s->logging, SPAN_LOG_FLOW, "Checking for the existence of page %d\n", s->current_page + 1);
     if (s->current_page >= s->stop_page)
         return -1;
     /*endif*/
     if (s->tiff.file)
     {
-        if (!TIFFSetDirectory(s->tiff.tiff_file, (tdir_t) s->current_page + 1))
+        /* The answer comes from the page index, so libtiff stays on the current page */
+        if ((index = get_page_index(s)) == NULL  ||  s->current_page + 1 >= index->pages)
+            return -1;
+        /*endif*/
+        return test_tiff_directory_info(s, &index->page[s->current_page + 1]);
+    }
+    /*endif*/
+    if (s->pre_encoded_page_handler)
+    {
+        if (s->pre_encoded_page_handler(s->pre_encoded_page_user_data,
+                                        s->current_page + 1,
+                                        &compression,
+                                        &image_width,
+                                        &image_length,
+                                        &resolution_code,
+                                        &buf,
+                                        &len))
+        {
             return -1;
+        }
         /*endif*/
-        return test_tiff_directory_info(s);
+        /* A pre-encoded page is sent exactly as it is, so a change of compression also
+           needs the format to be renegotiated. */
+        if (compression != s->pre_encoded_compression
+            ||
+            image_width != s->tiff.image_width
+            ||
+            resolution_code != s->tiff.resolution_code)
+        {
+            return 1;
+        }
+        /*endif*/
+        return 0;
     }
     /*endif*/
     return -1;
@@ -1865,6 +2361,8 @@ SPAN_DECLARE(int) t4_tx_set_row_read_handler(t4_tx_state_t *s, t4_row_read_handl
 {
     s->row_handler = handler;
     s->row_handler_user_data = user_data;
+    s->run_handler = NULL;
+    s->strip_handler = NULL;
     return set_row_read_handler(s, handler, user_data);
 }
 /*- End of function --------------------------------------------------------*/
@@ -2016,6 +2514,28 @@ SPAN_DECLARE(int) t4_tx_set_tx_image_format(t4_tx_state_t *s,
     int res;
     int supported_colour_compressions;
 
+    if (s->tiff.file == NULL  &&  s->pre_encoded_buf == NULL  &&  s->pre_encoded_page_handler)
+    {
+        if (get_pre_encoded_page(s))
+        {
+            span_log(&s->logging, SPAN_LOG_FLOW, "Pre-encoded page %d is not available\n", s->current_page);
+            return T4_IMAGE_FORMAT_INCOMPATIBLE;
+        }
+        /*endif*/
+    }
+    /*endif*/
+    if (s->pre_encoded_buf)
+    {
+        /* An already compressed page can only be sent as it is. */
+        if (!(supported_compressions & s->pre_encoded_compression))
+        {
+            span_log(&s->logging, SPAN_LOG_FLOW, "Pre-encoded page compression %s is not allowed\n", t4_compression_to_str(s->pre_encoded_compression));
+            return T4_IMAGE_FORMAT_INCOMPATIBLE;
+        }
+        /*endif*/
+        supported_compressions = s->pre_encoded_compression;
+    }
+    /*endif*/
     supported_colour_compressions = supported_compressions & (T4_COMPRESSION_T42_T81 | T4_COMPRESSION_T43 | T4_COMPRESSION_T45 | T4_COMPRESSION_SYCC_T81);
     compression = -1;
     s->metadata.image_type = s->tiff.image_type;
@@ -2255,6 +2775,30 @@ SPAN_DECLARE(int) t4_tx_set_tx_image_format(t4_tx_state_t *s,
     if (res != T4_IMAGE_FORMAT_OK)
         return res;
     /*endif*/
+    if (s->pre_encoded_buf)
+    {
+        /* A pre-encoded page cannot be squashed, translated or rescaled, or even have its
+           resolution relabelled between the metric and inch based forms. */
+        if (s->row_squashing_ratio != 1  ||  s->metadata.resolution_code != s->tiff.resolution_code)
+        {
+            span_log(&s->logging, SPAN_LOG_FLOW, "Pre-encoded page resolution %s is not allowed\n", t4_image_resolution_to_str(s->tiff.resolution_code));
+            return T4_IMAGE_FORMAT_NORESSUPPORT;
+        }
+        /*endif*/
+        if (s->metadata.image_width != s->tiff.image_width)
+        {
+            span_log(&s->logging, SPAN_LOG_FLOW, "Pre-encoded page width %d is not allowed\n", s->tiff.image_width);
+            return T4_IMAGE_FORMAT_NOSIZESUPPORT;
+        }
+        /*endif*/
+        if (s->metadata.image_type != s->tiff.image_type)
+        {
+            span_log(&s->logging, SPAN_LOG_FLOW, "Pre-encoded page image type %s is not allowed\n", t4_image_type_to_str(s->tiff.image_type));
+            return T4_IMAGE_FORMAT_INCOMPATIBLE;
+        }
+        /*endif*/
+    }
+    /*endif*/
 
     if (s->metadata.image_type != s->tiff.image_type  ||  s->metadata.image_width != s->tiff.image_width)
     {
@@ -2622,6 +3166,83 @@ SPAN_DECLARE(int) t4_tx_get_pages_in_file(t4_tx_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t4_tx_set_page_index(t4_tx_state_t *s, const t4_tx_page_index_t *index)
+{
+    if (s->tiff.file == NULL  ||  index == NULL  ||  index->pages <= 0)
+        return -1;
+    /*endif*/
+    s->tiff.page_index = index;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(t4_tx_page_index_t *) t4_tx_page_index_init(t4_tx_page_index_t *s, const char *file)
+{
+    TIFF *tiff_file;
+    bool alloced;
+    int res;
+
+    if ((tiff_file = TIFFOpen(file, "r")) == NULL)
+        return NULL;
+    /*endif*/
+    alloced = false;
+    if (s == NULL)
+    {
+        if ((s = (t4_tx_page_index_t *) span_alloc(sizeof(*s))) == NULL)
+        {
+            TIFFClose(tiff_file);
+            return NULL;
+        }
+        /*endif*/
+        alloced = true;
+    }
+    /*endif*/
+    memset(s, 0, sizeof(*s));
+    res = build_page_index(s, tiff_file);
+    TIFFClose(tiff_file);
+    if (res < 0)
+    {
+        t4_tx_page_index_release(s);
+        if (alloced)
+            span_free(s);
+        /*endif*/
+        return NULL;
+    }
+    /*endif*/
+    return s;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t4_tx_page_index_get_pages(const t4_tx_page_index_t *s)
+{
+    return s->pages;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t4_tx_page_index_release(t4_tx_page_index_t *s)
+{
+    if (s->page)
+    {
+        span_free(s->page);
+        s->page = NULL;
+    }
+    /*endif*/
+    s->pages = 0;
+    s->pages_allocated = 0;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t4_tx_page_index_free(t4_tx_page_index_t *s)
+{
+    int ret;
+
+    ret = t4_tx_page_index_release(s);
+    span_free(s);
+    return ret;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) t4_tx_get_current_page_in_file(t4_tx_state_t *s)
 {
     return s->current_page;
@@ -2758,6 +3379,24 @@ SPAN_DECLARE(int) t4_tx_get_bit(t4_tx_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t4_tx_get_bits(t4_tx_state_t *s, uint32_t *bits, int nbits)
+{
+    int i;
+    int bit;
+
+    *bits = 0;
+    for (i = 0;  i < nbits;  i++)
+    {
+        if ((bit = t4_tx_get_bit(s)) < 0)
+            break;
+        /*endif*/
+        *bits |= (uint32_t) bit << i;
+    }
+    /*endfor*/
+    return i;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) t4_tx_get(t4_tx_state_t *s, uint8_t buf[], size_t max_len)
 {
     if (s->no_encoder.buf_len > 0)
@@ -2785,9 +3424,10 @@ SPAN_DECLARE(int) t4_tx_start_page(t4_tx_state_t *s)
     if (s->current_page > s->stop_page)
         return -1;
     /*endif*/
+    s->no_encoder.buf_len = 0;
     if (s->tiff.file)
     {
-        if (!TIFFSetDirectory(s->tiff.tiff_file, (tdir_t) s->current_page))
+        if (set_tiff_directory(s, s->current_page) < 0)
             return -1;
         /*endif*/
         get_tiff_directory_info(s);
@@ -2795,6 +3435,37 @@ SPAN_DECLARE(int) t4_tx_start_page(t4_tx_state_t *s)
             return -1;
         /*endif*/
     }
+    else if (s->pre_encoded_buf  ||  s->pre_encoded_page_handler)
+    {
+        if (s->pre_encoded_buf == NULL)
+        {
+            /* The format was settled for the first page, and later pages were checked
+               against it by t4_tx_next_page_has_different_format. */
+            if (get_pre_encoded_page(s)
+                ||
+                s->pre_encoded_compression != s->metadata.compression
+                ||
+                s->tiff.image_width != s->metadata.image_width
+                ||
+                s->tiff.resolution_code != s->metadata.resolution_code)
+            {
+                span_log(&s->logging, SPAN_LOG_FLOW, "Pre-encoded page %d cannot be sent in the current format\n", s->current_page);
+                return -1;
+            }
+            /*endif*/
+        }
+        /*endif*/
+        /* Play out the application's buffer in place */
+        if (!s->no_encoder.external_buf  &&  s->no_encoder.buf)
+            span_free(s->no_encoder.buf);
+        /*endif*/
+        s->no_encoder.buf = (uint8_t *) s->pre_encoded_buf;
+        s->no_encoder.external_buf = true;
+        s->no_encoder.buf_len = s->pre_encoded_len;
+        s->no_encoder.buf_ptr = 0;
+        s->no_encoder.bit = 0;
+        s->metadata.image_length = s->tiff.image_length;
+    }
     else
     {
         s->metadata.image_length = UINT32_MAX;
@@ -2841,9 +3512,10 @@ SPAN_DECLARE(int) t4_tx_start_page(t4_tx_state_t *s)
     }
     /*endswitch*/
 
-    /* If there is a page header, create that first */
+    /* If there is a page header, create that first. A pre-encoded page goes out as it is,
+       so it cannot have one. */
     //if (s->metadata.image_type == T4_IMAGE_TYPE_BILEVEL  &&  s->header_info  &&  s->header_info[0]  &&  make_header(s) == 0)
-    if (s->header_info  &&  s->header_info[0]  &&  make_header(s) == 0)
+    if (s->pre_encoded_buf == NULL  &&  s->header_info  &&  s->header_info[0]  &&  make_header(s) == 0)
     {
         s->header_row = 0;
         set_row_read_handler(s, header_row_read_handler, (void *) s);
@@ -2867,6 +3539,16 @@ SPAN_DECLARE(int) t4_tx_restart_page(t4_tx_state_t *s)
 
 SPAN_DECLARE(int) t4_tx_end_page(t4_tx_state_t *s)
 {
+    if (s->pre_encoded_buf)
+    {
+        /* The application's buffer may go away once its page is finished with */
+        s->pre_encoded_buf = NULL;
+        s->pre_encoded_len = 0;
+        s->no_encoder.buf = NULL;
+        s->no_encoder.buf_len = 0;
+        s->no_encoder.external_buf = false;
+    }
+    /*endif*/
     s->current_page++;
     return 0;
 }
@@ -2878,19 +3560,38 @@ SPAN_DECLARE(logging_state_t *) t4_tx_get_logging_state(t4_tx_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
-SPAN_DECLARE(t4_tx_state_t *) t4_tx_init(t4_tx_state_t *s, const char *file, int start_page, int stop_page)
+static int start_tiff_input(t4_tx_state_t *s, const char *name)
 {
-    bool alloced;
-
-    alloced = false;
-    if (s == NULL)
+    s->tiff.file = strdup(name);
+    s->tiff.pages_in_file = -1;
+    if (s->tiff.page_index)
     {
-        if ((s = (t4_tx_state_t *) span_alloc(sizeof(*s))) == NULL)
-            return NULL;
+        /* Go straight to the page, rather than along the directory chain */
+        if (set_tiff_directory(s, s->current_page) < 0)
+        {
+            tiff_tx_release(s);
+            return -1;
+        }
         /*endif*/
-        alloced = true;
+    }
+    else if (!TIFFSetDirectory(s->tiff.tiff_file, (tdir_t) s->current_page))
+    {
+        tiff_tx_release(s);
+        return -1;
+    }
+    /*endif*/
+    if (get_tiff_directory_info(s))
+    {
+        tiff_tx_release(s);
+        return -1;
     }
     /*endif*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void tx_init(t4_tx_state_t *s, int start_page, int stop_page)
+{
     memset(s, 0, sizeof(*s));
 #if defined(SPANDSP_SUPPORT_TIFF_FX)
     TIFF_FX_init();
@@ -2907,12 +3608,110 @@ SPAN_DECLARE(t4_tx_state_t *) t4_tx_init(t4_tx_state_t *s, const char *file, int
 
     s->row_handler = tiff_row_read_handler;
     s->row_handler_user_data = (void *) s;
+    s->strip_handler = tiff_strip_read_handler;
 
     s->row_squashing_ratio = 1;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t4_tx_set_pre_encoded_page(t4_tx_state_t *s,
+                                             int compression,
+                                             int image_width,
+                                             int image_length,
+                                             int resolution_code,
+                                             const uint8_t buf[],
+                                             size_t len)
+{
+    /* Pre-encoded pages replace the TIFF file as the source of the document */
+    if (s->tiff.file)
+        return -1;
+    /*endif*/
+    switch (compression)
+    {
+    case T4_COMPRESSION_T4_1D:
+    case T4_COMPRESSION_T4_2D:
+    case T4_COMPRESSION_T6:
+    case T4_COMPRESSION_T85:
+    case T4_COMPRESSION_T85_L0:
+        break;
+    default:
+        return -1;
+    }
+    /*endswitch*/
+    if (buf == NULL  ||  len == 0  ||  len > INT_MAX  ||  image_width <= 0  ||  image_length <= 0)
+        return -1;
+    /*endif*/
+    s->pre_encoded_buf = buf;
+    s->pre_encoded_len = len;
+    s->pre_encoded_compression = compression;
+    /* Describe the page as though it came from a file, so the usual negotiation of the
+       image format applies to it. */
+    s->tiff.image_type = T4_IMAGE_TYPE_BILEVEL;
+    s->tiff.image_width = image_width;
+    s->tiff.image_length = image_length;
+    s->tiff.resolution_code = resolution_code;
+    s->tiff.x_resolution = code_to_x_resolution(resolution_code);
+    s->tiff.y_resolution = code_to_y_resolution(resolution_code);
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) t4_tx_set_pre_encoded_page_handler(t4_tx_state_t *s,
+                                                     t4_tx_pre_encoded_page_handler_t handler,
+                                                     void *user_data)
+{
+    if (s->tiff.file)
+        return -1;
+    /*endif*/
+    s->pre_encoded_page_handler = handler;
+    s->pre_encoded_page_user_data = user_data;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(t4_tx_state_t *) t4_tx_init_from_memory(t4_tx_state_t *s, const uint8_t buf[], size_t len, int start_page, int stop_page)
+{
+    bool alloced;
+
+    alloced = false;
+    if (s == NULL)
+    {
+        if ((s = (t4_tx_state_t *) span_alloc(sizeof(*s))) == NULL)
+            return NULL;
+        /*endif*/
+        alloced = true;
+    }
+    /*endif*/
+    tx_init(s, start_page, stop_page);
+    if (open_tiff_input_memory(s, buf, len) < 0  ||  start_tiff_input(s, "<memory>") < 0)
+    {
+        if (alloced)
+            span_free(s);
+        /*endif*/
+        return NULL;
+    }
+    /*endif*/
+    return s;
+}
+/*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(t4_tx_state_t *) t4_tx_init(t4_tx_state_t *s, const char *file, int start_page, int stop_page)
+{
+    bool alloced;
+
+    alloced = false;
+    if (s == NULL)
+    {
+        if ((s = (t4_tx_state_t *) span_alloc(sizeof(*s))) == NULL)
+            return NULL;
+        /*endif*/
+        alloced = true;
+    }
+    /*endif*/
+    tx_init(s, start_page, stop_page);
     if (file)
     {
-        if (open_tiff_input_file(s, file) < 0)
+        if (open_tiff_input_file(s, file) < 0  ||  start_tiff_input(s, file) < 0)
         {
             if (alloced)
                 span_free(s);
@@ -2920,19 +3719,40 @@ SPAN_DECLARE(t4_tx_state_t *) t4_tx_init(t4_tx_state_t *s, const char *file, int
             return NULL;
         }
         /*endif*/
-        s->tiff.file = strdup(file);
-        s->tiff.pages_in_file = -1;
-        if (!TIFFSetDirectory(s->tiff.tiff_file, (tdir_t) s->current_page)
-            ||
-            get_tiff_directory_info(s))
-        {
-            tiff_tx_release(s);
-            if (alloced)
-                span_free(s);
-            /*endif*/
+    }
+    /*endif*/
+    return s;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(t4_tx_state_t *) t4_tx_init_with_page_index(t4_tx_state_t *s,
+                                                         const char *file,
+                                                         const t4_tx_page_index_t *index,
+                                                         int start_page,
+                                                         int stop_page)
+{
+    bool alloced;
+
+    if (file == NULL  ||  index == NULL  ||  index->pages <= 0)
+        return NULL;
+    /*endif*/
+    alloced = false;
+    if (s == NULL)
+    {
+        if ((s = (t4_tx_state_t *) span_alloc(sizeof(*s))) == NULL)
             return NULL;
-        }
         /*endif*/
+        alloced = true;
+    }
+    /*endif*/
+    tx_init(s, start_page, stop_page);
+    s->tiff.page_index = index;
+    if (open_tiff_input_file(s, file) < 0  ||  start_tiff_input(s, file) < 0)
+    {
+        if (alloced)
+            span_free(s);
+        /*endif*/
+        return NULL;
     }
     /*endif*/
     return s;
@@ -2956,6 +3776,11 @@ SPAN_DECLARE(int) t4_tx_release(t4_tx_state_t *s)
         s->colour_map = NULL;
     }
     /*endif*/
+    if (s->no_encoder.buf  &&  !s->no_encoder.external_buf)
+        span_free(s->no_encoder.buf);
+    /*endif*/
+    s->no_encoder.buf = NULL;
+    s->no_encoder.buf_len = 0;
     return release_encoder(s);
 }
 /*- End of function --------------------------------------------------------*/
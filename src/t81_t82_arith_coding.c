@@ -41,10 +41,13 @@
 
 #include "spandsp/telephony.h"
 #include "spandsp/alloc.h"
+#include "spandsp/bit_operations.h"
 #include "spandsp/t81_t82_arith_coding.h"
 
 #include "spandsp/private/t81_t82_arith_coding.h"
 
+#include "t81_t82_arith_coding_local.h"
+
 /* T.82 defines the QM-coder at a level very close to actual code. Therefore
    this file closely mirrors the routine names, variable names, and flow
    described in T.82. QM-Coder is supposed to be the same in some other image
@@ -59,12 +62,7 @@ enum
 };
 
 /* This table is from T.82 table 24 - Probability estimation table */
-static const struct probability_estimation_s
-{
-    uint16_t lsz;
-    uint8_t nlps;   /* The SWITCH bit is packed into the top of this byte */
-    uint8_t nmps;
-} prob[113] =
+const struct t81_t82_probability_estimation_s t81_t82_prob[113] =
 {
     {0x5A1D,   1 + 128,   1},
     {0x2586,  14,         2},
@@ -190,7 +188,7 @@ static __inline__ void output_stuffed_byte(t81_t82_arith_encode_state_t *s, int
 }
 /*- End of function --------------------------------------------------------*/
 
-static __inline__ void byteout(t81_t82_arith_encode_state_t *s)
+void t81_t82_arith_encode_byteout(t81_t82_arith_encode_state_t *s)
 {
     uint32_t temp;
 
@@ -232,59 +230,9 @@ static __inline__ void byteout(t81_t82_arith_encode_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
-static __inline__ void renorme(t81_t82_arith_encode_state_t *s)
-{
-    /* T.82 figure 25 - RENORME */
-    do
-    {
-        s->a <<= 1;
-        s->c <<= 1;
-        s->ct--;
-        if (s->ct == 0)
-            byteout(s);
-        /*endif*/
-    }
-    while (s->a < 0x8000);
-}
-/*- End of function --------------------------------------------------------*/
-
 SPAN_DECLARE(void) t81_t82_arith_encode(t81_t82_arith_encode_state_t *s, int cx, int pix)
 {
-    uint32_t ss;
-
-    /* T.82 figure 22 - ENCODE */
-    ss = s->st[cx] & 0x7F;
-    if (((pix << 7) ^ s->st[cx]) & 0x80)
-    {
-        /* T.82 figure 23 - CODELPS */
-        s->a -= prob[ss].lsz;
-        if (s->a >= prob[ss].lsz)
-        {
-            s->c += s->a;
-            s->a = prob[ss].lsz;
-        }
-        /*endif*/
-        s->st[cx] = (s->st[cx] & 0x80) ^ prob[ss].nlps;
-        renorme(s);
-    }
-    else
-    {
-        /* T.82 figure 24 - CODEMPS */
-        s->a -= prob[ss].lsz;
-        if (s->a < 0x8000)
-        {
-            if (s->a < prob[ss].lsz)
-            {
-                s->c += s->a;
-                s->a = prob[ss].lsz;
-            }
-            /*endif*/
-            s->st[cx] = (s->st[cx] & 0x80) | prob[ss].nmps;
-            renorme(s);
-        }
-        /*endif*/
-    }
-    /*endif*/
+    qm_encode(s, cx, pix);
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -394,12 +342,12 @@ SPAN_DECLARE(int) t81_t82_arith_encode_free(t81_t82_arith_encode_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
-SPAN_DECLARE(int) t81_t82_arith_decode(t81_t82_arith_decode_state_t *s, int cx)
+int t81_t82_arith_decode_renorm(t81_t82_arith_decode_state_t *s)
 {
-    uint32_t ss;
-    int pix;
+    int shift;
 
-    /* T.82 figure 35 - RENORMD */
+    /* T.82 figure 35 - RENORMD, shifting in bulk up to the point where the next
+       byte is needed, rather than one bit at a time. */
     while (s->a < 0x8000  ||  s->startup)
     {
         while (s->ct <= 8  &&  s->ct >= 0)
@@ -407,10 +355,12 @@ SPAN_DECLARE(int) t81_t82_arith_decode(t81_t82_arith_decode_state_t *s, int cx)
             /* First we can move a new byte into s->c */
             if (s->pscd_ptr >= s->pscd_end)
                 return -1;
+            /*endif*/
             if (s->pscd_ptr[0] == T81_T82_ESC)
             {
                 if (s->pscd_ptr + 1 >= s->pscd_end)
                     return -1;
+                /*endif*/
                 if (s->pscd_ptr[1] == T81_T82_STUFF)
                 {
                     s->c |= (0xFF << (8 - s->ct));
@@ -427,7 +377,9 @@ SPAN_DECLARE(int) t81_t82_arith_decode(t81_t82_arith_decode_state_t *s, int cx)
                         s->nopadding = false;
                         return -2;
                     }
+                    /*endif*/
                 }
+                /*endif*/
             }
             else
             {
@@ -437,64 +389,31 @@ SPAN_DECLARE(int) t81_t82_arith_decode(t81_t82_arith_decode_state_t *s, int cx)
             /*endif*/
         }
         /*endwhile*/
-        s->a <<= 1;
-        s->c <<= 1;
+        /* During startup we shift until A reaches 0x10000. Otherwise we shift until
+           it reaches 0x8000. */
+        shift = (s->startup)  ?  (16 - top_bit(s->a))  :  (15 - top_bit(s->a));
         if (s->ct >= 0)
-            s->ct--;
+        {
+            if (shift > s->ct - 8)
+                shift = s->ct - 8;
+            /*endif*/
+            s->ct -= shift;
+        }
         /*endif*/
+        s->a <<= shift;
+        s->c <<= shift;
         if (s->a == 0x10000)
             s->startup = false;
         /*endif*/
     }
     /*endwhile*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
 
-    /* T.82 figure 32 - DECODE */
-    ss = s->st[cx] & 0x7F;
-    if ((s->c >> 16) >= (s->a -= prob[ss].lsz))
-    {
-        /* T.82 figure 33 - LPS_EXCHANGE */
-        if (s->a < prob[ss].lsz)
-        {
-            s->c -= (s->a << 16);
-            s->a = prob[ss].lsz;
-            pix = s->st[cx] >> 7;
-            s->st[cx] = (s->st[cx] & 0x80) | prob[ss].nmps;
-        }
-        else
-        {
-            s->c -= (s->a << 16);
-            s->a = prob[ss].lsz;
-            pix = 1 - (s->st[cx] >> 7);
-            s->st[cx] = (s->st[cx]& 0x80) ^ prob[ss].nlps;
-        }
-        /*endif*/
-    }
-    else
-    {
-        if (s->a < 0x8000)
-        {
-            /* T.82 figure 34 - MPS_EXCHANGE */
-            if (s->a < prob[ss].lsz)
-            {
-                pix = 1 - (s->st[cx] >> 7);
-                s->st[cx] = (s->st[cx] & 0x80) ^ prob[ss].nlps;
-            }
-            else
-            {
-                pix = s->st[cx] >> 7;
-                s->st[cx] = (s->st[cx] & 0x80) | prob[ss].nmps;
-            }
-            /*endif*/
-        }
-        else
-        {
-            pix = s->st[cx] >> 7;
-        }
-        /*endif*/
-    }
-    /*endif*/
-
-    return pix;
+SPAN_DECLARE(int) t81_t82_arith_decode(t81_t82_arith_decode_state_t *s, int cx)
+{
+    return qm_decode(s, cx);
 }
 /*- End of function --------------------------------------------------------*/
 
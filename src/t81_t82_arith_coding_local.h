@@ -0,0 +1,237 @@
+/*
+ * SpanDSP - a series of DSP components for telephony
+ *
+ * t81_t82_arith_coding_local.h - ITU T.81 and T.82 QM-coder arithmetic encoding
+ *                                and decoding, for inlining into the image codecs
+ *
+ * Written by Steve Underwood <steveu@coppice.org>
+ *
+ * Copyright (C) 2009 Steve Underwood
+ *
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 2.1,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*! \file */
+
+#if !defined(_T81_T82_ARITH_CODING_LOCAL_H_)
+#define _T81_T82_ARITH_CODING_LOCAL_H_
+
+/* The image codecs code one symbol per pixel, so the per symbol part of the QM-coder
+   is kept here, where it can be inlined into their pixel loops. The less frequent
+   byte level work stays out of line, in t81_t82_arith_coding.c. */
+
+/* T.82 table 24 - Probability estimation table */
+struct t81_t82_probability_estimation_s
+{
+    uint16_t lsz;
+    uint8_t nlps;   /* The SWITCH bit is packed into the top of this byte */
+    uint8_t nmps;
+};
+
+extern const struct t81_t82_probability_estimation_s t81_t82_prob[113];
+
+void t81_t82_arith_encode_byteout(t81_t82_arith_encode_state_t *s);
+
+int t81_t82_arith_decode_renorm(t81_t82_arith_decode_state_t *s);
+
+static __inline__ void qm_renorme(t81_t82_arith_encode_state_t *s)
+{
+    int shift;
+
+    /* T.82 figure 25 - RENORME, performing all the shifts up to the next byte
+       boundary in one step, rather than one bit at a time. */
+    shift = 15 - top_bit(s->a);
+    while (shift >= s->ct)
+    {
+        s->a <<= s->ct;
+        s->c <<= s->ct;
+        shift -= s->ct;
+        t81_t82_arith_encode_byteout(s);
+    }
+    /*endwhile*/
+    s->a <<= shift;
+    s->c <<= shift;
+    s->ct -= shift;
+}
+/*- End of function --------------------------------------------------------*/
+
+static __inline__ void qm_encode(t81_t82_arith_encode_state_t *s, int cx, int pix)
+{
+    const struct t81_t82_probability_estimation_s *p;
+    int st;
+
+    /* T.82 figure 22 - ENCODE */
+    st = s->st[cx];
+    p = &t81_t82_prob[st & 0x7F];
+    s->a -= p->lsz;
+    if (((pix << 7) ^ st) & 0x80)
+    {
+        /* T.82 figure 23 - CODELPS */
+        if (s->a >= p->lsz)
+        {
+            s->c += s->a;
+            s->a = p->lsz;
+        }
+        /*endif*/
+        s->st[cx] = (st & 0x80) ^ p->nlps;
+        qm_renorme(s);
+    }
+    else if (s->a < 0x8000)
+    {
+        /* T.82 figure 24 - CODEMPS */
+        if (s->a < p->lsz)
+        {
+            s->c += s->a;
+            s->a = p->lsz;
+        }
+        /*endif*/
+        s->st[cx] = (st & 0x80) | p->nmps;
+        qm_renorme(s);
+    }
+    /*endif*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static __inline__ void qm_encode_run(t81_t82_arith_encode_state_t *s, int cx, int pix, uint32_t len)
+{
+    const struct t81_t82_probability_estimation_s *p;
+    uint32_t n;
+    int st;
+
+    /* Encode a run of identical symbols in a single context. While the symbols are the
+       MPS, and A stays above 0x8000, each one only subtracts LSZ from A, so a whole
+       stretch of them can be dealt with in one step. */
+    while (len > 0)
+    {
+        st = s->st[cx];
+        if (((pix << 7) ^ st) & 0x80)
+        {
+            qm_encode(s, cx, pix);
+            len--;
+            continue;
+        }
+        /*endif*/
+        p = &t81_t82_prob[st & 0x7F];
+        n = (s->a - 0x8000)/p->lsz;
+        if (n >= len)
+        {
+            s->a -= len*p->lsz;
+            break;
+        }
+        /*endif*/
+        s->a -= n*p->lsz;
+        /* The next symbol needs a renormalisation */
+        qm_encode(s, cx, pix);
+        len -= (n + 1);
+    }
+    /*endwhile*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static __inline__ uint32_t qm_decode_mps_run(t81_t82_arith_decode_state_t *s, int cx, uint32_t len, uint32_t step)
+{
+    const struct t81_t82_probability_estimation_s *p;
+    uint32_t lim;
+    uint32_t n;
+
+    /* Find how many of the next symbols, up to len, in a single context must decode
+       as the MPS with no exchange and no renormalisation, and skip over them. Only
+       whole multiples of step symbols are taken. This may be fewer than could really
+       be decoded that way, so the caller must be able to carry on symbol by symbol
+       with qm_decode(). */
+    if (s->a < 0x8000  ||  s->startup)
+        return 0;
+    /*endif*/
+    p = &t81_t82_prob[s->st[cx] & 0x7F];
+    lim = (s->c >> 16) + 1;
+    if (lim < 0x8000)
+        lim = 0x8000;
+    /*endif*/
+    if (s->a < lim)
+        return 0;
+    /*endif*/
+    n = (s->a - lim)/p->lsz;
+    if (n > len)
+        n = len;
+    /*endif*/
+    n -= n%step;
+    s->a -= n*p->lsz;
+    return n;
+}
+/*- End of function --------------------------------------------------------*/
+
+static __inline__ int qm_decode(t81_t82_arith_decode_state_t *s, int cx)
+{
+    const struct t81_t82_probability_estimation_s *p;
+    int st;
+    int pix;
+
+    if (s->a < 0x8000  ||  s->startup)
+    {
+        /* T.82 figure 35 - RENORMD */
+        if ((pix = t81_t82_arith_decode_renorm(s)) < 0)
+            return pix;
+        /*endif*/
+    }
+    /*endif*/
+
+    /* T.82 figure 32 - DECODE */
+    st = s->st[cx];
+    p = &t81_t82_prob[st & 0x7F];
+    s->a -= p->lsz;
+    if ((s->c >> 16) >= s->a)
+    {
+        /* T.82 figure 33 - LPS_EXCHANGE */
+        s->c -= (s->a << 16);
+        if (s->a < p->lsz)
+        {
+            pix = st >> 7;
+            s->st[cx] = (st & 0x80) | p->nmps;
+        }
+        else
+        {
+            pix = 1 - (st >> 7);
+            s->st[cx] = (st & 0x80) ^ p->nlps;
+        }
+        /*endif*/
+        s->a = p->lsz;
+    }
+    else
+    {
+        pix = st >> 7;
+        if (s->a < 0x8000)
+        {
+            /* T.82 figure 34 - MPS_EXCHANGE */
+            if (s->a < p->lsz)
+            {
+                pix = 1 - pix;
+                s->st[cx] = (st & 0x80) ^ p->nlps;
+            }
+            else
+            {
+                s->st[cx] = (st & 0x80) | p->nmps;
+            }
+            /*endif*/
+        }
+        /*endif*/
+    }
+    /*endif*/
+    return pix;
+}
+/*- End of function --------------------------------------------------------*/
+
+#endif
+/*- End of file ------------------------------------------------------------*/
@@ -41,6 +41,7 @@
 
 #include "spandsp/telephony.h"
 #include "spandsp/alloc.h"
+#include "spandsp/bit_operations.h"
 #include "spandsp/unaligned.h"
 #include "spandsp/logging.h"
 #include "spandsp/async.h"
@@ -54,6 +55,91 @@
 #include "spandsp/private/t81_t82_arith_coding.h"
 #include "spandsp/private/t85.h"
 
+#include "t81_t82_arith_coding_local.h"
+
+static uint32_t white_bytes(t85_decode_state_t *s, uint8_t *hp[3], uint32_t b)
+{
+    uint32_t full_bytes;
+    uint32_t n;
+    int row1;
+    int row2;
+
+    /* Find how many whole bytes of pixels, starting from byte b of the row, have only
+       white pixels in the rows above within their templates. If the pixels decoded
+       in the row so far leave the start of the template white too, all these pixels
+       are coded in context zero, for as long as they decode as white. This assumes
+       the default AT pixel position. */
+    row1 = (s->p[1] >= 0);
+    row2 = (s->p[2] >= 0  &&  !(s->options & T85_LRLTWO));
+    if ((s->options & T85_LRLTWO))
+    {
+        if ((s->row_h[0] & 0x0F)  ||  (b > 0  &&  row1  &&  (hp[1][-1] & 0x07)))
+            return 0;
+    }
+    else
+    {
+        if ((s->row_h[0] & 0x03)
+            ||
+            (b > 0  &&  ((row1  &&  (hp[1][-1] & 0x03))  ||  (row2  &&  (hp[2][-1] & 0x01)))))
+        {
+            return 0;
+        }
+    }
+    full_bytes = s->xd >> 3;
+    for (n = 0;  b + n < full_bytes;  n++)
+    {
+        if ((row1  &&  hp[1][n])  ||  (row2  &&  hp[2][n]))
+            break;
+    }
+    /* The last byte of the run can see the first two pixels of the following byte
+       in the rows above. */
+    if (n > 0  &&  b + n < s->bytes_per_row)
+    {
+        if ((row1  &&  (hp[1][n] & 0xC0))  ||  (row2  &&  (hp[2][n] & 0x80)))
+            n--;
+    }
+    return n;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int flush_strip(t85_decode_state_t *s)
+{
+    int rows;
+
+    if ((rows = s->strip_rows) == 0)
+        return 0;
+    /*endif*/
+    s->strip_rows = 0;
+    return s->strip_write_handler(s->strip_write_user_data, s->strip_buf, s->bytes_per_row, s->bytes_per_row, rows);
+}
+/*- End of function --------------------------------------------------------*/
+
+static int put_row(t85_decode_state_t *s, const uint8_t row[])
+{
+    uint8_t *buf;
+    int size;
+
+    if (s->strip_write_handler == NULL)
+        return s->row_write_handler(s->row_write_user_data, row, s->bytes_per_row);
+    /*endif*/
+    size = T4_STRIP_ROWS*s->bytes_per_row;
+    if (size > s->strip_buf_size)
+    {
+        if ((buf = (uint8_t *) span_realloc(s->strip_buf, size)) == NULL)
+            return -1;
+        /*endif*/
+        s->strip_buf = buf;
+        s->strip_buf_size = size;
+    }
+    /*endif*/
+    memcpy(&s->strip_buf[s->strip_rows*s->bytes_per_row], row, s->bytes_per_row);
+    if (++s->strip_rows < T4_STRIP_ROWS  &&  s->y + 1 < s->yd)
+        return 0;
+    /*endif*/
+    return flush_strip(s);
+}
+/*- End of function --------------------------------------------------------*/
+
 /* Decode some PSCD bytes, output the decoded rows as they are completed. Return
    the number of bytes which have actually been read. This will be less than len
    if a marker segment was part of the data or if the final byte was 0xFF, meaning
@@ -62,6 +148,7 @@ static size_t decode_pscd(t85_decode_state_t *s, const uint8_t data[], size_t le
 {
     uint8_t *hp[3];
     int32_t o;
+    uint32_t n;
     int cx;
     int i;
     int pix;
@@ -92,7 +179,7 @@ static size_t decode_pscd(t85_decode_state_t *s, const uint8_t data[], size_t le
         /* Typical prediction */
         if ((s->options & T85_TPBON)  &&  s->pseudo)
         {
-            slntp = t81_t82_arith_decode(&s->s, (s->options & T85_LRLTWO)  ?  TPB2CX  :  TPB3CX);
+            slntp = qm_decode(&s->s, (s->options & T85_LRLTWO)  ?  TPB2CX  :  TPB3CX);
             if (slntp < 0)
                 return s->s.pscd_ptr - data;
             s->lntp = !(slntp ^ s->lntp);
@@ -104,7 +191,7 @@ static size_t decode_pscd(t85_decode_state_t *s, const uint8_t data[], size_t le
                     /* First row of page or (following SDRST) of stripe */
                     for (i = 0;  i < s->bytes_per_row;  i++)
                         hp[0][i] = 0;
-                    s->interrupt = s->row_write_handler(s->row_write_user_data, hp[0], s->bytes_per_row);
+                    s->interrupt = put_row(s, hp[0]);
                     /* Rotate the ring buffer that holds the last few rows */
                     s->p[2] = s->p[1];
                     s->p[1] = s->p[0];
@@ -113,7 +200,7 @@ static size_t decode_pscd(t85_decode_state_t *s, const uint8_t data[], size_t le
                 }
                 else
                 {
-                    s->interrupt = s->row_write_handler(s->row_write_user_data, hp[1], s->bytes_per_row);
+                    s->interrupt = put_row(s, hp[1]);
                     /* Duplicate the last row in the ring buffer */
                     s->p[2] = s->p[1];
                 }
@@ -135,6 +222,34 @@ static size_t decode_pscd(t85_decode_state_t *s, const uint8_t data[], size_t le
         {
             if ((s->x & 7) == 0)
             {
+                /* Take runs of white in context zero as a whole, while the coder can be
+                   sure of them without renormalising. */
+                if (s->tx == 0
+                    &&
+                    (s->s.st[0] & 0x80) == 0
+                    &&
+                    (n = white_bytes(s, hp, s->x >> 3)) > 0
+                    &&
+                    (n = qm_decode_mps_run(&s->s, 0, n << 3, 8) >> 3) > 0)
+                {
+                    memset(hp[0], 0, n);
+                    s->x += (n << 3);
+                    hp[0] += n;
+                    hp[1] += n;
+                    hp[2] += n;
+                    /* Bring the row registers to where the pixel by pixel decoding of
+                       the run would have left them. */
+                    s->row_h[0] = (n < 4)  ?  (s->row_h[0] << (n << 3))  :  0;
+                    s->row_h[1] = (n < 4)  ?  (s->row_h[1] << (n << 3))  :  0;
+                    s->row_h[2] = (n < 4)  ?  (s->row_h[2] << (n << 3))  :  0;
+                    if (s->x < s->bytes_per_row*8  &&  s->p[1] >= 0)
+                    {
+                        s->row_h[1] |= (uint32_t) hp[1][0] << 8;
+                        if (s->p[2] >= 0)
+                            s->row_h[2] |= (uint32_t) hp[2][0] << 8;
+                    }
+                    continue;
+                }
                 if (s->x < (s->bytes_per_row - 1)*8  &&  s->p[1] >= 0)
                 {
                     s->row_h[1] |= hp[1][1];
@@ -168,7 +283,7 @@ static size_t decode_pscd(t85_decode_state_t *s, const uint8_t data[], size_t le
                     {
                         cx |= ((s->row_h[1] >> 9) & 0x3F0);
                     }
-                    pix = t81_t82_arith_decode(&s->s, cx);
+                    pix = qm_decode(&s->s, cx);
                     if (pix < 0)
                         return s->s.pscd_ptr - data;
                     s->row_h[0] = (s->row_h[0] << 1) | pix;
@@ -202,7 +317,7 @@ static size_t decode_pscd(t85_decode_state_t *s, const uint8_t data[], size_t le
                     {
                         cx |= ((s->row_h[1] >> 11) & 0x07C);
                     }
-                    pix = t81_t82_arith_decode(&s->s, cx);
+                    pix = qm_decode(&s->s, cx);
                     if (pix < 0)
                         return s->s.pscd_ptr - data;
                     s->row_h[0] = (s->row_h[0] << 1) | pix;
@@ -216,7 +331,7 @@ static size_t decode_pscd(t85_decode_state_t *s, const uint8_t data[], size_t le
             hp[2]++;
         }
         *(hp[0] - 1) <<= (s->bytes_per_row*8 - s->xd);
-        s->interrupt = s->row_write_handler(s->row_write_user_data, &s->row_buf[s->p[0]*s->bytes_per_row], s->bytes_per_row);
+        s->interrupt = put_row(s, &s->row_buf[s->p[0]*s->bytes_per_row]);
         s->x = 0;
         s->pseudo = true;
         /* Shuffle the row buffers */
@@ -426,7 +541,7 @@ SPAN_DECLARE(void) t85_decode_rx_status(t85_decode_state_t *s, int status)
 }
 /*- End of function --------------------------------------------------------*/
 
-SPAN_DECLARE(int) t85_decode_put(t85_decode_state_t *s, const uint8_t data[], size_t len)
+static int decode_put(t85_decode_state_t *s, const uint8_t data[], size_t len)
 {
     int ret;
     uint32_t y;
@@ -797,6 +912,24 @@ SPAN_DECLARE(int) t85_decode_put(t85_decode_state_t *s, const uint8_t data[], si
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t85_decode_put(t85_decode_state_t *s, const uint8_t data[], size_t len)
+{
+    int ret;
+
+    ret = decode_put(s, data, len);
+    /* A NEWLEN can cut the image short after its last row was decoded, so make sure
+       nothing is left in the strip when the image is done. */
+    if (s->strip_write_handler  &&  (ret != T4_DECODE_MORE_DATA  ||  s->y >= s->yd))
+    {
+        if (flush_strip(s))
+            s->interrupt = true;
+        /*endif*/
+    }
+    /*endif*/
+    return ret;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) t85_decode_set_row_write_handler(t85_decode_state_t *s,
                                                    t4_row_write_handler_t handler,
                                                    void *user_data)
@@ -807,6 +940,17 @@ SPAN_DECLARE(int) t85_decode_set_row_write_handler(t85_decode_state_t *s,
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t85_decode_set_strip_write_handler(t85_decode_state_t *s,
+                                                     t4_strip_write_handler_t handler,
+                                                     void *user_data)
+{
+    s->strip_write_handler = handler;
+    s->strip_write_user_data = user_data;
+    s->strip_rows = 0;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) t85_decode_set_comment_handler(t85_decode_state_t *s,
                                                  uint32_t max_comment_len,
                                                  t4_row_write_handler_t handler,
@@ -866,6 +1010,7 @@ SPAN_DECLARE(int) t85_decode_new_plane(t85_decode_state_t *s)
     s->lntp = false;
     s->interrupt = false;
     s->end_of_data = 0;
+    s->strip_rows = 0;
     if (s->comment)
     {
         span_free(s->comment);
@@ -921,6 +1066,7 @@ SPAN_DECLARE(int) t85_decode_restart(t85_decode_state_t *s)
     s->lntp = false;
     s->interrupt = false;
     s->end_of_data = 0;
+    s->strip_rows = 0;
     if (s->comment)
     {
         span_free(s->comment);
@@ -981,6 +1127,13 @@ SPAN_DECLARE(int) t85_decode_release(t85_decode_state_t *s)
         s->comment = NULL;
     }
     /*endif*/
+    if (s->strip_buf)
+    {
+        span_free(s->strip_buf);
+        s->strip_buf = NULL;
+        s->strip_buf_size = 0;
+    }
+    /*endif*/
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
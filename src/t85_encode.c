@@ -41,6 +41,7 @@
 
 #include "spandsp/telephony.h"
 #include "spandsp/alloc.h"
+#include "spandsp/bit_operations.h"
 #include "spandsp/unaligned.h"
 #include "spandsp/logging.h"
 #include "spandsp/async.h"
@@ -54,6 +55,8 @@
 #include "spandsp/private/t81_t82_arith_coding.h"
 #include "spandsp/private/t85.h"
 
+#include "t81_t82_arith_coding_local.h"
+
 /* Image length update status */
 enum
 {
@@ -229,6 +232,96 @@ SPAN_DECLARE(void) t85_encode_set_options(t85_encode_state_t *s,
 }
 /*- End of function --------------------------------------------------------*/
 
+static uint32_t white_bytes(const uint8_t *hp[3], uint32_t b, uint32_t full_bytes, uint32_t bytes_per_row, int two_rows)
+{
+    uint32_t n;
+
+    /* Find how many whole bytes of pixels, starting from byte b of the row, are white
+       and have nothing but white pixels in their templates. All the pixels in such a
+       run code as the same symbol in context zero. This assumes the default AT pixel
+       position. */
+    if (b > 0)
+    {
+        if (two_rows)
+        {
+            if ((hp[0][-1] & 0x0F)  ||  (hp[1][-1] & 0x07))
+                return 0;
+            /*endif*/
+        }
+        else
+        {
+            if ((hp[0][-1] & 0x03)  ||  (hp[1][-1] & 0x03)  ||  (hp[2][-1] & 0x01))
+                return 0;
+            /*endif*/
+        }
+        /*endif*/
+    }
+    /*endif*/
+    for (n = 0;  b + n < full_bytes;  n++)
+    {
+        if (hp[0][n]  ||  hp[1][n]  ||  (!two_rows  &&  hp[2][n]))
+            break;
+        /*endif*/
+    }
+    /*endfor*/
+    /* The last byte of the run can see the first two pixels of the following byte
+       in the rows above. */
+    if (n > 0  &&  b + n < bytes_per_row)
+    {
+        if ((hp[1][n] & 0xC0)  ||  (!two_rows  &&  (hp[2][n] & 0x80)))
+            n--;
+        /*endif*/
+    }
+    /*endif*/
+    return n;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int read_row(t85_encode_state_t *s, uint8_t buf[], size_t bytes_per_row)
+{
+    uint8_t *t;
+    int size;
+    int max_rows;
+
+    if (s->strip_read_handler == NULL)
+        return s->row_read_handler(s->row_read_user_data, buf, bytes_per_row);
+    /*endif*/
+    if (s->strip_row >= s->strip_rows)
+    {
+        if (s->strip_ended)
+            return 0;
+        /*endif*/
+        size = T4_STRIP_ROWS*bytes_per_row;
+        if (size > s->strip_buf_size)
+        {
+            if ((t = (uint8_t *) span_realloc(s->strip_buf, size)) == NULL)
+                return 0;
+            /*endif*/
+            s->strip_buf = t;
+            s->strip_buf_size = size;
+        }
+        /*endif*/
+        s->strip_row = 0;
+        /* Never ask for rows beyond the end of the image */
+        max_rows = (s->yd - s->y < T4_STRIP_ROWS)  ?  (s->yd - s->y)  :  T4_STRIP_ROWS;
+        if ((s->strip_rows = s->strip_read_handler(s->strip_read_user_data, s->strip_buf, bytes_per_row, bytes_per_row, max_rows)) <= 0)
+        {
+            s->strip_rows = 0;
+            return 0;
+        }
+        /*endif*/
+        if (s->strip_rows < max_rows)
+            s->strip_ended = true;
+        else
+            s->strip_rows = max_rows;
+        /*endif*/
+    }
+    /*endif*/
+    memcpy(buf, &s->strip_buf[bytes_per_row*s->strip_row++], bytes_per_row);
+    return bytes_per_row;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int get_next_row(t85_encode_state_t *s)
 {
     uint8_t buf[20];
@@ -237,6 +330,7 @@ static int get_next_row(t85_encode_state_t *s)
     uint8_t *z;
     uint32_t row_h[3];
     uint32_t j;
+    uint32_t n;
     int32_t o;
     uint32_t a;
     uint32_t p;
@@ -246,6 +340,7 @@ static int get_next_row(t85_encode_state_t *s)
     uint32_t cl_min;
     uint32_t cl_max;
     int ltp;
+    int white_runs;
     int cx;
     int t_max;
     int i;
@@ -275,7 +370,7 @@ static int get_next_row(t85_encode_state_t *s)
     }
     else
     {
-        if (s->row_read_handler(s->row_read_user_data, s->prev_row[0], bytes_per_row) <= 0)
+        if (read_row(s, s->prev_row[0], bytes_per_row) <= 0)
         {
             /* The source has stopped feeding us rows early. Try to clip the image
                to the current size. */
@@ -333,9 +428,9 @@ static int get_next_row(t85_encode_state_t *s)
     {
         /* Look for a match between the rows */
         ltp = (memcmp(s->prev_row[0], s->prev_row[1], bytes_per_row) == 0);
-        t81_t82_arith_encode(&s->s,
-                             (s->options & T85_LRLTWO)  ?  TPB2CX  :  TPB3CX,
-                             (ltp == s->prev_ltp));
+        qm_encode(&s->s,
+                  (s->options & T85_LRLTWO)  ?  TPB2CX  :  TPB3CX,
+                  (ltp == s->prev_ltp));
         s->prev_ltp = ltp;
     }
     /*endif*/
@@ -351,9 +446,38 @@ static int get_next_row(t85_encode_state_t *s)
         row_h[1] = (uint32_t) hp[1][0] << 8;
         row_h[2] = (uint32_t) hp[2][0] << 8;
 
+        /* Runs of white are only taken as a whole when the AT pixel is in its default
+           place, and no ATMOVE analysis, which needs to see every pixel, is in progress. */
+        white_runs = (s->tx == 0  &&  s->new_tx >= 0);
+
         /* Encode row */
         for (j = 0;  j < s->xd;  )
         {
+            if (white_runs
+                &&
+                (n = white_bytes(hp, j >> 3, s->xd >> 3, bytes_per_row, s->options & T85_LRLTWO)) > 0)
+            {
+                qm_encode_run(&s->s, 0, 0, n << 3);
+                j += (n << 3);
+                hp[0] += n;
+                hp[1] += n;
+                hp[2] += n;
+                /* Bring the row registers to where the pixel by pixel coding of the
+                   run would have left them. */
+                row_h[0] = (n < 4)  ?  (row_h[0] << (n << 3))  :  0;
+                row_h[1] = (n < 4)  ?  (row_h[1] << (n << 3))  :  0;
+                row_h[2] = (n < 4)  ?  (row_h[2] << (n << 3))  :  0;
+                if (j <= (bytes_per_row - 1)*8)
+                {
+                    row_h[1] |= (uint32_t) hp[1][0] << 8;
+                    row_h[2] |= (uint32_t) hp[2][0] << 8;
+                }
+                /*endif*/
+                if (j >= s->xd)
+                    break;
+                /*endif*/
+            }
+            /*endif*/
             row_h[0] |= hp[0][0];
             if (j < (bytes_per_row - 1)*8)
             {
@@ -386,7 +510,7 @@ static int get_next_row(t85_encode_state_t *s)
                     }
                     /*endif*/
                     p = (row_h[0] >> 8) & 1;
-                    t81_t82_arith_encode(&s->s, cx, p);
+                    qm_encode(&s->s, cx, p);
 
                     /* Update the statistics for adaptive template changes,
                        if this analysis is in progress. */
@@ -442,7 +566,7 @@ static int get_next_row(t85_encode_state_t *s)
                     }
                     /*endif*/
                     p = (row_h[0] >> 8) & 1;
-                    t81_t82_arith_encode(&s->s, cx, p);
+                    qm_encode(&s->s, cx, p);
 
                     /* Update the statistics for adaptive template changes,
                        if this analysis is in progress. */
@@ -693,6 +817,19 @@ SPAN_DECLARE(int) t85_encode_set_row_read_handler(t85_encode_state_t *s,
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) t85_encode_set_strip_read_handler(t85_encode_state_t *s,
+                                                    t4_strip_read_handler_t handler,
+                                                    void *user_data)
+{
+    s->strip_read_handler = handler;
+    s->strip_read_user_data = user_data;
+    s->strip_rows = 0;
+    s->strip_row = 0;
+    s->strip_ended = false;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(logging_state_t *) t85_encode_get_logging_state(t85_encode_state_t *s)
 {
     return &s->logging;
@@ -730,6 +867,9 @@ SPAN_DECLARE(int) t85_encode_restart(t85_encode_state_t *s, uint32_t image_width
     s->bitstream_len = 0;
     s->fill_with_white = false;
     s->compressed_image_size = 0;
+    s->strip_rows = 0;
+    s->strip_row = 0;
+    s->strip_ended = false;
 
     t81_t82_arith_encode_init(&s->s, output_byte, s);
     return 0;
@@ -790,6 +930,13 @@ SPAN_DECLARE(int) t85_encode_release(t85_encode_state_t *s)
         s->bitstream_len = 0;
     }
     /*endif*/
+    if (s->strip_buf)
+    {
+        span_free(s->strip_buf);
+        s->strip_buf = NULL;
+        s->strip_buf_size = 0;
+    }
+    /*endif*/
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
@@ -39,11 +39,14 @@
 #include <spandsp/stdbool.h>
 #endif
 
-#define SPANDSP_EXPOSE_INTERNAL_STRUCTURES
+#include "spandsp/telephony.h"
+#include "spandsp/alloc.h"
+#include "spandsp/unaligned.h"
+#include "spandsp/logging.h"
+#include "spandsp/udptl.h"
 
-#include "spandsp.h"
-
-#include "udptl.h"
+#include "spandsp/private/logging.h"
+#include "spandsp/private/udptl.h"
 
 static int decode_length(const uint8_t *buf, int limit, int *len, int *pvalue)
 {
@@ -125,6 +128,37 @@ static int decode_open_type(const uint8_t *buf, int limit, int *len, const uint8
 }
 /*- End of function --------------------------------------------------------*/
 
+static __inline__ int open_type_len(int num_octets)
+{
+    /* The encoded length of an open type, for the lengths we ever send. A zero length
+       open type is sent as a single zero byte (10.1) */
+    if (num_octets == 0)
+        return 2;
+    /*endif*/
+    return (num_octets < 0x80)  ?  (num_octets + 1)  :  (num_octets + 2);
+}
+/*- End of function --------------------------------------------------------*/
+
+static void xor_buf(uint8_t dst[], const uint8_t src[], int len)
+{
+    uint64_t a;
+    uint64_t b;
+    int i;
+
+    for (i = 0;  i <= len - (int) sizeof(a);  i += sizeof(a))
+    {
+        memcpy(&a, &dst[i], sizeof(a));
+        memcpy(&b, &src[i], sizeof(b));
+        a ^= b;
+        memcpy(&dst[i], &a, sizeof(a));
+    }
+    /*endfor*/
+    for (  ;  i < len;  i++)
+        dst[i] ^= src[i];
+    /*endfor*/
+}
+/*- End of function --------------------------------------------------------*/
+
 static int encode_length(uint8_t *buf, int *len, int value)
 {
     int multiplier;
@@ -230,11 +264,16 @@ SPAN_DECLARE(int) udptl_rx_packet(udptl_state_t *s, const uint8_t buf[], int len
         return -1;
     /*endif*/
     /* Our buffers cannot tolerate overlength packets */
-    if (msg_len > LOCAL_FAX_MAX_DATAGRAM)
+    if (msg_len > UDPTL_MAX_DATAGRAM)
         return -1;
     /*endif*/
-    /* Update any missed slots in the buffer */
-    for (i = s->rx_seq_no;  seq_no > i;  i++)
+    /* Update any missed slots in the buffer. After a long gap only the last lap of the
+       buffer matters. */
+    i = s->rx_seq_no;
+    if (seq_no - i > UDPTL_BUF_MASK + 1)
+        i = seq_no - (UDPTL_BUF_MASK + 1);
+    /*endif*/
+    for (  ;  seq_no > i;  i++)
     {
         x = i & UDPTL_BUF_MASK;
         s->rx[x].buf_len = -1;
@@ -348,6 +387,11 @@ SPAN_DECLARE(int) udptl_rx_packet(udptl_state_t *s, const uint8_t buf[], int len
             return -1;
         /*endif*/
         entries = buf[ptr++];
+        /* Our buffers cannot tolerate more entries, or a wider reach back through the
+           packet history */
+        if (entries > UDPTL_MAX_FEC_ENTRIES  ||  span*entries > UDPTL_BUF_MASK + 1)
+            return -1;
+        /*endif*/
         s->rx[x].fec_entries = entries;
 
         /* Decode the elements */
@@ -357,7 +401,7 @@ SPAN_DECLARE(int) udptl_rx_packet(udptl_state_t *s, const uint8_t buf[], int len
             if ((stat = decode_open_type(buf, len, &ptr, &data, &s->rx[x].fec_len[i])) != 0)
                 return -1;
             /*endif*/
-            if (s->rx[x].fec_len[i] > LOCAL_FAX_MAX_DATAGRAM)
+            if (s->rx[x].fec_len[i] > UDPTL_MAX_DATAGRAM)
                 return -1;
             /*endif*/
 
@@ -395,17 +439,16 @@ SPAN_DECLARE(int) udptl_rx_packet(udptl_state_t *s, const uint8_t buf[], int len
                 /*endfor*/
                 if (which >= 0)
                 {
-                    /* Repairable */
-                    for (j = 0;  j < s->rx[l].fec_len[m];  j++)
+                    /* Repairable. The missing packet is the FEC entry XORed with all the
+                       other packets it covers. */
+                    memcpy(s->rx[which].buf, s->rx[l].fec[m], s->rx[l].fec_len[m]);
+                    for (k = (limit - s->rx[l].fec_span*s->rx[l].fec_entries) & UDPTL_BUF_MASK;
+                         k != limit;
+                         k = (k + s->rx[l].fec_entries) & UDPTL_BUF_MASK)
                     {
-                        s->rx[which].buf[j] = s->rx[l].fec[m][j];
-                        for (k = (limit - s->rx[l].fec_span*s->rx[l].fec_entries) & UDPTL_BUF_MASK;
-                             k != limit;
-                             k = (k + s->rx[l].fec_entries) & UDPTL_BUF_MASK)
-                        {
-                            s->rx[which].buf[j] ^= (s->rx[k].buf_len > j)  ?  s->rx[k].buf[j]  :  0;
-                        }
-                        /*endfor*/
+                        if (s->rx[k].buf_len > 0)
+                            xor_buf(s->rx[which].buf, s->rx[k].buf, (s->rx[k].buf_len < s->rx[l].fec_len[m])  ?  s->rx[k].buf_len  :  s->rx[l].fec_len[m]);
+                        /*endif*/
                     }
                     /*endfor*/
                     s->rx[which].buf_len = s->rx[l].fec_len[m];
@@ -452,9 +495,28 @@ SPAN_DECLARE(int) udptl_rx_packet(udptl_state_t *s, const uint8_t buf[], int len
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) udptl_rx_packets(udptl_state_t *s, const uint8_t *bufs[], const int lens[], int packets)
+{
+    int good;
+    int i;
+
+    good = 0;
+    for (i = 0;  i < packets;  i++)
+    {
+        if (udptl_rx_packet(s, bufs[i], lens[i]) < 0)
+            span_log(&s->logging, SPAN_LOG_FLOW, "Bad UDPTL packet, len %d\n", lens[i]);
+        else
+            good++;
+        /*endif*/
+    }
+    /*endfor*/
+    return good;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) udptl_build_packet(udptl_state_t *s, uint8_t buf[], const uint8_t msg[], int msg_len)
 {
-    uint8_t fec[LOCAL_FAX_MAX_DATAGRAM];
+    uint8_t fec[UDPTL_MAX_DATAGRAM];
     int i;
     int j;
     int seq;
@@ -466,11 +528,10 @@ SPAN_DECLARE(int) udptl_build_packet(udptl_state_t *s, uint8_t buf[], const uint
     int limit;
     int high_tide;
     int len_before_entries;
-    int previous_len;
 
     /* UDPTL cannot cope with zero length messages, and our buffering for redundancy limits their
        maximum length. */
-    if (msg_len < 1  ||  msg_len > LOCAL_FAX_MAX_DATAGRAM)
+    if (msg_len < 1  ||  msg_len > UDPTL_MAX_DATAGRAM)
         return -1;
     /*endif*/
     seq = s->tx_seq_no & 0xFFFF;
@@ -524,23 +585,21 @@ SPAN_DECLARE(int) udptl_build_packet(udptl_state_t *s, uint8_t buf[], const uint
         /* Encode the elements */
         for (m = 0;  m < entries;  m++)
         {
-            previous_len = len;
             j = (entry - m - 1) & UDPTL_BUF_MASK;
-            if (encode_open_type(buf, &len, s->tx[j].buf, s->tx[j].buf_len) < 0)
-                return -1;
-            /*endif*/
-
-            /* If we have exceeded the far end's max datagram size, don't include this last chunk,
-               and stop trying to add more. */
-            if (len > s->far_max_datagram_size)
+            /* If this would exceed the far end's max datagram size, don't include it, and stop
+               trying to add more. Checking first means the caller's buffer need only be as
+               big as the far end's datagrams. */
+            if (len + open_type_len(s->tx[j].buf_len) > s->far_max_datagram_size)
             {
-                len = previous_len;
                 if (encode_length(buf, &len_before_entries, m) < 0)
                     return -1;
                 /*endif*/
                 break;
             }
             /*endif*/
+            if (encode_open_type(buf, &len, s->tx[j].buf, s->tx[j].buf_len) < 0)
+                return -1;
+            /*endif*/
         }
         /*endfor*/
         break;
@@ -568,44 +627,35 @@ SPAN_DECLARE(int) udptl_build_packet(udptl_state_t *s, uint8_t buf[], const uint
         buf[len++] = (uint8_t) entries;
         for (m = 0;  m < entries;  m++)
         {
-            previous_len = len;
             /* Make an XOR'ed entry the maximum length */
             limit = (entry + m) & UDPTL_BUF_MASK;
             high_tide = 0;
             for (i = (limit - span*entries) & UDPTL_BUF_MASK;  i != limit;  i = (i + entries) & UDPTL_BUF_MASK)
             {
                 if (high_tide < s->tx[i].buf_len)
-                {
-                    for (j = 0;  j < high_tide;  j++)
-                        fec[j] ^= s->tx[i].buf[j];
-                    /*endfor*/
-                    for (  ;  j < s->tx[i].buf_len;  j++)
-                        fec[j] = s->tx[i].buf[j];
-                    /*endfor*/
                     high_tide = s->tx[i].buf_len;
-                }
-                else
-                {
-                    for (j = 0;  j < s->tx[i].buf_len;  j++)
-                        fec[j] ^= s->tx[i].buf[j];
-                    /*endfor*/
-                }
                 /*endif*/
             }
             /*endfor*/
-            if (encode_open_type(buf, &len, fec, high_tide) < 0)
-                return -1;
-            /*endif*/
-
-            /* If we have exceeded the far end's max datagram size, don't include this last chunk,
-               and stop trying to add more. */
-            if (len > s->far_max_datagram_size)
+            /* If this would exceed the far end's max datagram size, don't include it, and stop
+               trying to add more. */
+            if (len + open_type_len(high_tide) > s->far_max_datagram_size)
             {
-                len = previous_len;
                 buf[len_before_entries] = (uint8_t) m;
                 break;
             }
             /*endif*/
+            memset(fec, 0, high_tide);
+            for (i = (limit - span*entries) & UDPTL_BUF_MASK;  i != limit;  i = (i + entries) & UDPTL_BUF_MASK)
+            {
+                if (s->tx[i].buf_len > 0)
+                    xor_buf(fec, s->tx[i].buf, s->tx[i].buf_len);
+                /*endif*/
+            }
+            /*endfor*/
+            if (encode_open_type(buf, &len, fec, high_tide) < 0)
+                return -1;
+            /*endif*/
         }
         /*endfor*/
         break;
@@ -616,6 +666,26 @@ SPAN_DECLARE(int) udptl_build_packet(udptl_state_t *s, uint8_t buf[], const uint
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(int) udptl_build_packets(udptl_state_t *s,
+                                      uint8_t *bufs[],
+                                      int lens[],
+                                      const uint8_t *msgs[],
+                                      const int msg_lens[],
+                                      int packets)
+{
+    int i;
+
+    for (i = 0;  i < packets;  i++)
+    {
+        if ((lens[i] = udptl_build_packet(s, bufs[i], msgs[i], msg_lens[i])) < 0)
+            break;
+        /*endif*/
+    }
+    /*endfor*/
+    return i;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(int) udptl_set_error_correction(udptl_state_t *s,
                                              int ec_scheme,
                                              int span,
@@ -641,6 +711,21 @@ SPAN_DECLARE(int) udptl_set_error_correction(udptl_state_t *s,
     if (entries >= 0)
         s->error_correction_entries = entries;
     /*endif*/
+    /* Keep within what the packet history can supply */
+    if (s->error_correction_scheme == UDPTL_ERROR_CORRECTION_FEC)
+    {
+        if (s->error_correction_entries > UDPTL_MAX_FEC_ENTRIES)
+            s->error_correction_entries = UDPTL_MAX_FEC_ENTRIES;
+        /*endif*/
+        if (s->error_correction_entries > 0  &&  s->error_correction_span*s->error_correction_entries > UDPTL_BUF_MASK + 1)
+            s->error_correction_span = (UDPTL_BUF_MASK + 1)/s->error_correction_entries;
+        /*endif*/
+    }
+    else if (s->error_correction_entries > UDPTL_BUF_MASK)
+    {
+        s->error_correction_entries = UDPTL_BUF_MASK;
+    }
+    /*endif*/
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
@@ -713,13 +798,12 @@ SPAN_DECLARE(udptl_state_t *) udptl_init(udptl_state_t *s,
     /*endif*/
     memset(s, 0, sizeof(*s));
     span_log_init(&s->logging, SPAN_LOG_NONE, NULL);
+    span_log_set_protocol(&s->logging, "UDPTL");
 
-    s->error_correction_scheme = ec_scheme;
-    s->error_correction_span = span;
-    s->error_correction_entries = entries;
+    udptl_set_error_correction(s, ec_scheme, span, entries);
 
-    s->far_max_datagram_size = LOCAL_FAX_MAX_DATAGRAM;
-    s->local_max_datagram_size = LOCAL_FAX_MAX_DATAGRAM;
+    s->far_max_datagram_size = UDPTL_MAX_DATAGRAM;
+    s->local_max_datagram_size = UDPTL_MAX_DATAGRAM;
 
     memset(&s->rx, 0, sizeof(s->rx));
     memset(&s->tx, 0, sizeof(s->tx));
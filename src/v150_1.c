@@ -4327,14 +4327,18 @@ SPAN_DECLARE(v150_1_state_t *) v150_1_init(v150_1_state_t *s,
                                            v150_1_spe_signal_handler_t spe_signal_handler,
                                            void *spe_signal_handler_user_data)
 {
+    bool alloced;
+
     if (sprt_tx_packet_handler == NULL  ||  rx_data_handler == NULL  ||  rx_status_report_handler == NULL)
         return NULL;
     /*endif*/
+    alloced = false;
     if (s == NULL)
     {
         if ((s = (v150_1_state_t *) span_alloc(sizeof(*s))) == NULL)
             return NULL;
         /*endif*/
+        alloced = true;
     }
     /*endif*/
     memset(s, 0, sizeof(*s));
@@ -4442,19 +4446,26 @@ SPAN_DECLARE(v150_1_state_t *) v150_1_init(v150_1_state_t *s,
                     sse_tx_packet_handler,
                     sse_tx_packet_user_data);
 
-    sprt_init(&s->sprt,
-              s->near.parms.sprt_subsession_id,
-              s->near.parms.sprt_payload_type,
-              s->far.parms.sprt_payload_type,
-              NULL /* Use default params */,
-              sprt_tx_packet_handler,
-              sprt_tx_packet_handler_user_data,
-              process_rx_sprt_msg,
-              s,
-              update_sprt_timer,
-              s,
-              sprt_status_handler,
-              s);
+    if (sprt_init(&s->sprt,
+                  s->near.parms.sprt_subsession_id,
+                  s->near.parms.sprt_payload_type,
+                  s->far.parms.sprt_payload_type,
+                  NULL /* Use default params */,
+                  sprt_tx_packet_handler,
+                  sprt_tx_packet_handler_user_data,
+                  process_rx_sprt_msg,
+                  s,
+                  update_sprt_timer,
+                  s,
+                  sprt_status_handler,
+                  s) == NULL)
+    {
+        if (alloced)
+            span_free(s);
+        /*endif*/
+        return NULL;
+    }
+    /*endif*/
 
     return s;
 }
@@ -4462,7 +4473,7 @@ SPAN_DECLARE(v150_1_state_t *) v150_1_init(v150_1_state_t *s,
 
 SPAN_DECLARE(int) v150_1_release(v150_1_state_t *s)
 {
-    return 0;
+    return sprt_release(&s->sprt);
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -378,6 +378,36 @@ static __inline__ void put_bit(v17_rx_state_t *s, int bit)
 }
 /*- End of function --------------------------------------------------------*/
 
+static __inline__ void put_bits(v17_rx_state_t *s, int raw_bits, int nbits)
+{
+    int i;
+    uint32_t bits;
+
+    if (s->put_bits == NULL)
+    {
+        for (i = 0;  i < nbits;  i++)
+        {
+            put_bit(s, raw_bits);
+            raw_bits >>= 1;
+        }
+        /*endfor*/
+        return;
+    }
+    /*endif*/
+    /* Descramble the whole symbol, and pass it on in one go */
+    bits = 0;
+    for (i = 0;  i < nbits;  i++)
+    {
+        bits |= (uint32_t) descramble(s, raw_bits) << i;
+        raw_bits >>= 1;
+    }
+    /*endfor*/
+    if (s->training_stage == TRAINING_STAGE_NORMAL_OPERATION)
+        s->put_bits(s->put_bits_user_data, bits, nbits);
+    /*endif*/
+}
+/*- End of function --------------------------------------------------------*/
+
 #if defined(SPANDSP_USE_FIXED_POINTx)
 static __inline__ uint32_t dist_sq(const complexi32_t *x, const complexi32_t *y)
 {
@@ -469,8 +499,7 @@ static int decode_baud(v17_rx_state_t *s, complexf_t *z)
         constellation_state = constel_map_4800[re][im];
         raw = v32bis_4800_differential_decoder[s->diff][constellation_state];
         s->diff = constellation_state;
-        put_bit(s, raw);
-        put_bit(s, raw >> 1);
+        put_bits(s, raw, 2);
         return constellation_state;
     }
     /*endif*/
@@ -579,12 +608,7 @@ static int decode_baud(v17_rx_state_t *s, complexf_t *z)
     /* Differentially decode */
     raw = (nearest & 0x3C) | v17_differential_decoder[s->diff][nearest & 0x03];
     s->diff = nearest & 0x03;
-    for (i = 0;  i < s->bits_per_symbol;  i++)
-    {
-        put_bit(s, raw);
-        raw >>= 1;
-    }
-    /*endfor*/
+    put_bits(s, raw, s->bits_per_symbol);
     return constellation_state;
 }
 /*- End of function --------------------------------------------------------*/
@@ -1347,6 +1371,15 @@ SPAN_DECLARE(void) v17_rx_set_put_bit(v17_rx_state_t *s, span_put_bit_func_t put
 {
     s->put_bit = put_bit;
     s->put_bit_user_data = user_data;
+    s->put_bits = NULL;
+    s->put_bits_user_data = NULL;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(void) v17_rx_set_put_bits(v17_rx_state_t *s, span_put_bits_func_t put_bits, void *user_data)
+{
+    s->put_bits = put_bits;
+    s->put_bits_user_data = user_data;
 }
 /*- End of function --------------------------------------------------------*/
 
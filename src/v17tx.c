@@ -238,12 +238,25 @@ static int fake_get_bit(void *user_data)
 }
 /*- End of function --------------------------------------------------------*/
 
+static void end_of_data(v17_tx_state_t *s)
+{
+    /* End of real data. Switch to the fake get_bit routine, until we
+       have shut down completely. */
+    if (s->status_handler)
+        s->status_handler(s->status_user_data, SIG_STATUS_END_OF_DATA);
+    /*endif*/
+    s->current_get_bit = fake_get_bit;
+    s->in_training = true;
+}
+/*- End of function --------------------------------------------------------*/
+
 #if defined(SPANDSP_USE_FIXED_POINT)
 static __inline__ complexi16_t getbaud(v17_tx_state_t *s)
 #else
 static __inline__ complexf_t getbaud(v17_tx_state_t *s)
 #endif
 {
+    uint32_t in_bits;
     int i;
     int bit;
     int bits;
@@ -291,23 +304,39 @@ static __inline__ complexf_t getbaud(v17_tx_state_t *s)
     }
     /*endif*/
     bits = 0;
-    for (i = 0;  i < s->bits_per_symbol;  i++)
+    if (!s->in_training  &&  s->get_bits)
     {
-        if ((bit = s->current_get_bit(s->get_bit_user_data)) == SIG_STATUS_END_OF_DATA)
+        /* Get all the bits for this symbol in one go. A short count marks the end of
+           the real data, and the rest of the symbol is filled with 1's. */
+        in_bits = 0;
+        if ((i = s->get_bits(s->get_bits_user_data, &in_bits, s->bits_per_symbol)) < s->bits_per_symbol)
         {
-            /* End of real data. Switch to the fake get_bit routine, until we
-               have shut down completely. */
-            if (s->status_handler)
-                s->status_handler(s->status_user_data, SIG_STATUS_END_OF_DATA);
-            /*endif*/
-            s->current_get_bit = fake_get_bit;
-            s->in_training = true;
-            bit = 1;
+            end_of_data(s);
+            in_bits |= (0xFFFFFFFFU << i);
         }
         /*endif*/
-        bits |= (scramble(s, bit) << i);
+        for (i = 0;  i < s->bits_per_symbol;  i++)
+        {
+            bits |= (scramble(s, in_bits & 1) << i);
+            in_bits >>= 1;
+        }
+        /*endfor*/
     }
-    /*endfor*/
+    else
+    {
+        for (i = 0;  i < s->bits_per_symbol;  i++)
+        {
+            if ((bit = s->current_get_bit(s->get_bit_user_data)) == SIG_STATUS_END_OF_DATA)
+            {
+                end_of_data(s);
+                bit = 1;
+            }
+            /*endif*/
+            bits |= (scramble(s, bit) << i);
+        }
+        /*endfor*/
+    }
+    /*endif*/
     return s->constellation[diff_and_convolutional_encode(s, bits)];
 }
 /*- End of function --------------------------------------------------------*/
@@ -392,6 +421,15 @@ SPAN_DECLARE(void) v17_tx_set_get_bit(v17_tx_state_t *s, span_get_bit_func_t get
     /*endif*/
     s->get_bit = get_bit;
     s->get_bit_user_data = user_data;
+    s->get_bits = NULL;
+    s->get_bits_user_data = NULL;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(void) v17_tx_set_get_bits(v17_tx_state_t *s, span_get_bits_func_t get_bits, void *user_data)
+{
+    s->get_bits = get_bits;
+    s->get_bits_user_data = user_data;
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -434,6 +434,36 @@ static __inline__ void put_bit(v27ter_rx_state_t *s, int bit)
 }
 /*- End of function --------------------------------------------------------*/
 
+static __inline__ void put_bits(v27ter_rx_state_t *s, int raw_bits, int nbits)
+{
+    int i;
+    uint32_t bits;
+
+    if (s->put_bits == NULL)
+    {
+        for (i = 0;  i < nbits;  i++)
+        {
+            put_bit(s, raw_bits);
+            raw_bits >>= 1;
+        }
+        /*endfor*/
+        return;
+    }
+    /*endif*/
+    /* Descramble the whole symbol, and pass it on in one go */
+    bits = 0;
+    for (i = 0;  i < nbits;  i++)
+    {
+        bits |= (uint32_t) descramble(s, raw_bits) << i;
+        raw_bits >>= 1;
+    }
+    /*endfor*/
+    if (s->training_stage == TRAINING_STAGE_NORMAL_OPERATION)
+        s->put_bits(s->put_bits_user_data, bits, nbits);
+    /*endif*/
+}
+/*- End of function --------------------------------------------------------*/
+
 #if defined(SPANDSP_USE_FIXED_POINT)
 static void decode_baud(v27ter_rx_state_t *s, complexi16_t *z)
 #else
@@ -455,8 +485,7 @@ static void decode_baud(v27ter_rx_state_t *s, complexf_t *z)
     {
         nearest = find_quadrant(z);
         raw_bits = phase_steps_2400[(nearest - s->constellation_state) & 3];
-        put_bit(s, raw_bits);
-        put_bit(s, raw_bits >> 1);
+        put_bits(s, raw_bits, 2);
         s->constellation_state = nearest;
         nearest <<= 1;
     }
@@ -464,9 +493,7 @@ static void decode_baud(v27ter_rx_state_t *s, complexf_t *z)
     {
         nearest = find_octant(z);
         raw_bits = phase_steps_4800[(nearest - s->constellation_state) & 7];
-        put_bit(s, raw_bits);
-        put_bit(s, raw_bits >> 1);
-        put_bit(s, raw_bits >> 2);
+        put_bits(s, raw_bits, 3);
         s->constellation_state = nearest;
     }
     /*endif*/
@@ -1072,6 +1099,15 @@ SPAN_DECLARE(void) v27ter_rx_set_put_bit(v27ter_rx_state_t *s, span_put_bit_func
 {
     s->put_bit = put_bit;
     s->put_bit_user_data = user_data;
+    s->put_bits = NULL;
+    s->put_bits_user_data = NULL;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(void) v27ter_rx_set_put_bits(v27ter_rx_state_t *s, span_put_bits_func_t put_bits, void *user_data)
+{
+    s->put_bits = put_bits;
+    s->put_bits_user_data = user_data;
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -100,6 +100,18 @@ static int fake_get_bit(void *user_data)
 }
 /*- End of function --------------------------------------------------------*/
 
+static void end_of_data(v27ter_tx_state_t *s)
+{
+    /* End of real data. Switch to the fake get_bit routine, until we
+       have shut down completely. */
+    if (s->status_handler)
+        s->status_handler(s->status_user_data, SIG_STATUS_END_OF_DATA);
+    /*endif*/
+    s->current_get_bit = fake_get_bit;
+    s->in_training = true;
+}
+/*- End of function --------------------------------------------------------*/
+
 static __inline__ int scramble(v27ter_tx_state_t *s, int in_bit)
 {
     int out_bit;
@@ -131,13 +143,7 @@ static __inline__ int get_scrambled_bit(v27ter_tx_state_t *s)
 
     if ((bit = s->current_get_bit(s->get_bit_user_data)) == SIG_STATUS_END_OF_DATA)
     {
-        /* End of real data. Switch to the fake get_bit routine, until we
-           have shut down completely. */
-        if (s->status_handler)
-            s->status_handler(s->status_user_data, SIG_STATUS_END_OF_DATA);
-        /*endif*/
-        s->current_get_bit = fake_get_bit;
-        s->in_training = true;
+        end_of_data(s);
         bit = 1;
     }
     /*endif*/
@@ -145,6 +151,39 @@ static __inline__ int get_scrambled_bit(v27ter_tx_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
+static __inline__ int get_scrambled_bits(v27ter_tx_state_t *s, int nbits)
+{
+    uint32_t in_bits;
+    int bits;
+    int i;
+
+    /* The bits are returned with the first one in time in the most significant position. */
+    bits = 0;
+    if (s->in_training  ||  s->get_bits == NULL)
+    {
+        for (i = 0;  i < nbits;  i++)
+            bits = (bits << 1) | get_scrambled_bit(s);
+        /*endfor*/
+        return bits;
+    }
+    /*endif*/
+    in_bits = 0;
+    if ((i = s->get_bits(s->get_bits_user_data, &in_bits, nbits)) < nbits)
+    {
+        end_of_data(s);
+        in_bits |= (0xFFFFFFFFU << i);
+    }
+    /*endif*/
+    for (i = 0;  i < nbits;  i++)
+    {
+        bits = (bits << 1) | scramble(s, in_bits & 1);
+        in_bits >>= 1;
+    }
+    /*endfor*/
+    return bits;
+}
+/*- End of function --------------------------------------------------------*/
+
 #if defined(SPANDSP_USE_FIXED_POINT)
 static complexi16_t getbaud(v27ter_tx_state_t *s)
 #else
@@ -237,15 +276,12 @@ static complexf_t getbaud(v27ter_tx_state_t *s)
     /* 4800bps uses 8 phases. 2400bps uses 4 phases. */
     if (s->bit_rate == 4800)
     {
-        bits = get_scrambled_bit(s);
-        bits = (bits << 1) | get_scrambled_bit(s);
-        bits = (bits << 1) | get_scrambled_bit(s);
+        bits = get_scrambled_bits(s, 3);
         bits = phase_steps_4800[bits];
     }
     else
     {
-        bits = get_scrambled_bit(s);
-        bits = (bits << 1) | get_scrambled_bit(s);
+        bits = get_scrambled_bits(s, 2);
         bits = phase_steps_2400[bits];
     }
     /*endif*/
@@ -379,6 +415,15 @@ SPAN_DECLARE(void) v27ter_tx_set_get_bit(v27ter_tx_state_t *s, span_get_bit_func
     /*endif*/
     s->get_bit = get_bit;
     s->get_bit_user_data = user_data;
+    s->get_bits = NULL;
+    s->get_bits_user_data = NULL;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(void) v27ter_tx_set_get_bits(v27ter_tx_state_t *s, span_get_bits_func_t get_bits, void *user_data)
+{
+    s->get_bits = get_bits;
+    s->get_bits_user_data = user_data;
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -396,6 +396,36 @@ static __inline__ void put_bit(v29_rx_state_t *s, int bit)
 }
 /*- End of function --------------------------------------------------------*/
 
+static __inline__ void put_bits(v29_rx_state_t *s, int raw_bits, int nbits)
+{
+    int i;
+    uint32_t bits;
+
+    if (s->put_bits == NULL)
+    {
+        for (i = 0;  i < nbits;  i++)
+        {
+            put_bit(s, raw_bits);
+            raw_bits >>= 1;
+        }
+        /*endfor*/
+        return;
+    }
+    /*endif*/
+    /* Descramble the whole symbol, and pass it on in one go */
+    bits = 0;
+    for (i = 0;  i < nbits;  i++)
+    {
+        bits |= (uint32_t) descramble(s, raw_bits) << i;
+        raw_bits >>= 1;
+    }
+    /*endfor*/
+    if (s->training_stage == TRAINING_STAGE_NORMAL_OPERATION)
+        s->put_bits(s->put_bits_user_data, bits, nbits);
+    /*endif*/
+}
+/*- End of function --------------------------------------------------------*/
+
 #if defined(SPANDSP_USE_FIXED_POINT)
 static void decode_baud(v29_rx_state_t *s, complexi16_t *z)
 #else
@@ -412,7 +442,6 @@ static void decode_baud(v29_rx_state_t *s, complexf_t *z)
     };
     int nearest;
     int raw_bits;
-    int i;
     int re;
     int im;
 
@@ -421,8 +450,7 @@ static void decode_baud(v29_rx_state_t *s, complexf_t *z)
         /* 4800 is a special case. */
         nearest = find_quadrant(z) << 1;
         raw_bits = phase_steps_4800[((nearest - s->constellation_state) >> 1) & 3];
-        put_bit(s, raw_bits);
-        put_bit(s, raw_bits >> 1);
+        put_bits(s, raw_bits, 2);
     }
     else
     {
@@ -447,22 +475,18 @@ static void decode_baud(v29_rx_state_t *s, complexf_t *z)
         nearest = space_map_9600[re][im];
         if (s->bit_rate == 9600)
         {
-            /* Send out the top (amplitude) bit. */
-            put_bit(s, nearest >> 3);
+            /* Send out the top (amplitude) bit first, followed by the phase bits. */
+            raw_bits = phase_steps_9600[(nearest - s->constellation_state) & 7];
+            put_bits(s, ((nearest >> 3) & 1) | (raw_bits << 1), 4);
         }
         else
         {
             /* We can reuse the space map for 9600, but drop the top bit. */
             nearest &= 7;
+            raw_bits = phase_steps_9600[(nearest - s->constellation_state) & 7];
+            put_bits(s, raw_bits, 3);
         }
         /*endif*/
-        raw_bits = phase_steps_9600[(nearest - s->constellation_state) & 7];
-        for (i = 0;  i < 3;  i++)
-        {
-            put_bit(s, raw_bits);
-            raw_bits >>= 1;
-        }
-        /*endfor*/
     }
     /*endif*/
 
@@ -1000,6 +1024,15 @@ SPAN_DECLARE(void) v29_rx_set_put_bit(v29_rx_state_t *s, span_put_bit_func_t put
 {
     s->put_bit = put_bit;
     s->put_bit_user_data = user_data;
+    s->put_bits = NULL;
+    s->put_bits_user_data = NULL;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(void) v29_rx_set_put_bits(v29_rx_state_t *s, span_put_bits_func_t put_bits, void *user_data)
+{
+    s->put_bits = put_bits;
+    s->put_bits_user_data = user_data;
 }
 /*- End of function --------------------------------------------------------*/
 
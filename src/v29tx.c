@@ -100,26 +100,72 @@ static int fake_get_bit(void *user_data)
 }
 /*- End of function --------------------------------------------------------*/
 
+static void end_of_data(v29_tx_state_t *s)
+{
+    /* End of real data. Switch to the fake get_bit routine, until we
+       have shut down completely. */
+    if (s->status_handler)
+        s->status_handler(s->status_user_data, SIG_STATUS_END_OF_DATA);
+    /*endif*/
+    s->current_get_bit = fake_get_bit;
+    s->in_training = true;
+}
+/*- End of function --------------------------------------------------------*/
+
+static __inline__ int scramble(v29_tx_state_t *s, int in_bit)
+{
+    int out_bit;
+
+    out_bit = (in_bit ^ (s->scramble_reg >> (18 - 1)) ^ (s->scramble_reg >> (23 - 1))) & 1;
+    s->scramble_reg = (s->scramble_reg << 1) | out_bit;
+    return out_bit;
+}
+/*- End of function --------------------------------------------------------*/
+
 static __inline__ int get_scrambled_bit(v29_tx_state_t *s)
 {
     int bit;
-    int out_bit;
 
     if ((bit = s->current_get_bit(s->get_bit_user_data)) == SIG_STATUS_END_OF_DATA)
     {
-        /* End of real data. Switch to the fake get_bit routine, until we
-           have shut down completely. */
-        if (s->status_handler)
-            s->status_handler(s->status_user_data, SIG_STATUS_END_OF_DATA);
-        /*endif*/
-        s->current_get_bit = fake_get_bit;
-        s->in_training = true;
+        end_of_data(s);
         bit = 1;
     }
     /*endif*/
-    out_bit = (bit ^ (s->scramble_reg >> (18 - 1)) ^ (s->scramble_reg >> (23 - 1))) & 1;
-    s->scramble_reg = (s->scramble_reg << 1) | out_bit;
-    return out_bit;
+    return scramble(s, bit);
+}
+/*- End of function --------------------------------------------------------*/
+
+static __inline__ int get_scrambled_bits(v29_tx_state_t *s, int nbits)
+{
+    uint32_t in_bits;
+    int bits;
+    int i;
+
+    /* The bits are returned with the first one in time in the most significant position. */
+    bits = 0;
+    if (s->in_training  ||  s->get_bits == NULL)
+    {
+        for (i = 0;  i < nbits;  i++)
+            bits = (bits << 1) | get_scrambled_bit(s);
+        /*endfor*/
+        return bits;
+    }
+    /*endif*/
+    in_bits = 0;
+    if ((i = s->get_bits(s->get_bits_user_data, &in_bits, nbits)) < nbits)
+    {
+        end_of_data(s);
+        in_bits |= (0xFFFFFFFFU << i);
+    }
+    /*endif*/
+    for (i = 0;  i < nbits;  i++)
+    {
+        bits = (bits << 1) | scramble(s, in_bits & 1);
+        in_bits >>= 1;
+    }
+    /*endfor*/
+    return bits;
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -202,20 +248,17 @@ static __inline__ complexf_t getbaud(v29_tx_state_t *s)
        7200bps uses only the first half of the full constellation.
        4800bps uses the smaller constellation. */
     amp = 0;
-    /* We only use an amplitude bit at 9600bps */
-    if (s->bit_rate == 9600  &&  get_scrambled_bit(s))
-        amp = 8;
-    /*endif*/
-    bits = get_scrambled_bit(s);
-    bits = (bits << 1) | get_scrambled_bit(s);
     if (s->bit_rate == 4800)
     {
+        bits = get_scrambled_bits(s, 2);
         bits = phase_steps_4800[bits];
     }
     else
     {
-        bits = (bits << 1) | get_scrambled_bit(s);
-        bits = phase_steps_9600[bits];
+        /* We only use an amplitude bit at 9600bps. It is the first bit of the symbol. */
+        bits = get_scrambled_bits(s, (s->bit_rate == 9600)  ?  4  :  3);
+        amp = bits & 8;
+        bits = phase_steps_9600[bits & 7];
     }
     /*endif*/
     s->constellation_state = (s->constellation_state + bits) & 7;
@@ -344,6 +387,15 @@ SPAN_DECLARE(void) v29_tx_set_get_bit(v29_tx_state_t *s, span_get_bit_func_t get
     /*endif*/
     s->get_bit = get_bit;
     s->get_bit_user_data = user_data;
+    s->get_bits = NULL;
+    s->get_bits_user_data = NULL;
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(void) v29_tx_set_get_bits(v29_tx_state_t *s, span_get_bits_func_t get_bits, void *user_data)
+{
+    s->get_bits = get_bits;
+    s->get_bits_user_data = user_data;
 }
 /*- End of function --------------------------------------------------------*/
 
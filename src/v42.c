@@ -1436,6 +1436,73 @@ SPAN_DECLARE(int) v42_tx_bit(void *user_data)
 }
 /*- End of function --------------------------------------------------------*/
 
+SPAN_DECLARE(void) v42_rx_put(void *user_data, const uint8_t buf[], int len)
+{
+    v42_state_t *s;
+    int i;
+    int j;
+
+    s = (v42_state_t *) user_data;
+    for (i = 0;  i < len;  i++)
+    {
+        if (s->lapm.state != LAPM_DETECT)
+        {
+            /* Once LAPM is running, HDLC can take whole octets */
+            hdlc_rx_put(&s->lapm.hdlc_rx, &buf[i], len - i);
+            break;
+        }
+        /*endif*/
+        /* The negotiation might end part way through an octet */
+        for (j = 7;  j >= 0;  j--)
+            v42_rx_bit(s, (buf[i] >> j) & 1);
+        /*endfor*/
+    }
+    /*endfor*/
+}
+/*- End of function --------------------------------------------------------*/
+
+SPAN_DECLARE(int) v42_tx_get(void *user_data, uint8_t buf[], int max_len)
+{
+    v42_state_t *s;
+    int i;
+    int j;
+    int n;
+    int byte;
+
+    s = (v42_state_t *) user_data;
+    for (i = 0;  i < max_len;  i += n)
+    {
+        if (s->lapm.state == LAPM_DETECT  ||  s->lapm.hdlc_tx.bits)
+        {
+            /* Negotiation, or a partly sent HDLC octet left by v42_tx_bit(), has to go bit by bit */
+            for (byte = 0, j = 0;  j < 8;  j++)
+                byte = (byte << 1) | v42_tx_bit(s);
+            /*endfor*/
+            buf[i] = (uint8_t) byte;
+            n = 1;
+            continue;
+        }
+        /*endif*/
+        /* Take whole octets from HDLC, stopping at the octet in which the timer expires */
+        n = max_len - i;
+        if (s->bit_timer  &&  n > (s->bit_timer + 7)/8)
+            n = (s->bit_timer + 7)/8;
+        /*endif*/
+        if ((n = hdlc_tx_get(&s->lapm.hdlc_tx, &buf[i], n)) <= 0)
+            break;
+        /*endif*/
+        if (s->bit_timer  &&  (s->bit_timer -= 8*n) <= 0)
+        {
+            s->bit_timer = 0;
+            s->bit_timer_func(s);
+        }
+        /*endif*/
+    }
+    /*endfor*/
+    return i;
+}
+/*- End of function --------------------------------------------------------*/
+
 SPAN_DECLARE(bool) v42_set_local_busy_status(v42_state_t *s, bool busy)
 {
     bool previous_busy;
@@ -162,7 +162,8 @@ static void dictionary_init(v42bis_comp_state_t *s)
 {
     int i;
 
-    memset(s->dict, 0, sizeof(s->dict));
+    memset(s->dict, 0, sizeof(s->dict[0])*s->v42bis_parm_n2);
+    memset(s->hash, 0, sizeof(s->hash[0])*(s->hash_mask + 1));
     for (i = 0;  i < V42BIS_N4;  i++)
         s->dict[i + V42BIS_N6].node_octet = i;
     s->v42bis_parm_c1 = V42BIS_N5;
@@ -182,18 +183,25 @@ static void dictionary_init(v42bis_comp_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
+static __inline__ int hash_chain(v42bis_comp_state_t *s, uint16_t at, uint8_t octet)
+{
+    /* Multiplicative hashing of the parent and octet pair */
+    return ((((uint32_t) at << 8 | octet)*2654435761U) >> 16) & s->hash_mask;
+}
+/*- End of function --------------------------------------------------------*/
+
 static uint16_t match_octet(v42bis_comp_state_t *s, uint16_t at, uint8_t octet)
 {
     uint16_t e;
 
     if (at == 0)
         return octet + V42BIS_N6;
-    e = s->dict[at].child;
-    while (e)
+    if (s->dict[at].children == 0)
+        return 0;
+    for (e = s->hash[hash_chain(s, at, octet)];  e;  e = s->dict[e].hash_next)
     {
-        if (s->dict[e].node_octet == octet)
+        if (s->dict[e].parent == at  &&  s->dict[e].node_octet == octet)
             return e;
-        e = s->dict[e].next;
     }
     return 0;
 }
@@ -203,14 +211,17 @@ static uint16_t add_octet_to_dictionary(v42bis_comp_state_t *s, uint16_t at, uin
 {
     uint16_t newx;
     uint16_t next;
-    uint16_t e;
+    uint16_t *e;
+    int chain;
 
     newx = s->v42bis_parm_c1;
     s->dict[newx].node_octet = octet;
     s->dict[newx].parent = at;
-    s->dict[newx].child = 0;
-    s->dict[newx].next = s->dict[at].child;
-    s->dict[at].child = newx;
+    s->dict[newx].children = 0;
+    chain = hash_chain(s, at, octet);
+    s->dict[newx].hash_next = s->hash[chain];
+    s->hash[chain] = newx;
+    s->dict[at].children++;
     next = newx;
     /* 6.5 Recovering a dictionary entry to use next */
     do
@@ -219,23 +230,16 @@ static uint16_t add_octet_to_dictionary(v42bis_comp_state_t *s, uint16_t at, uin
         if (++next == s->v42bis_parm_n2)
             next = V42BIS_N5;
     }
-    while (s->dict[next].child);
+    while (s->dict[next].children);
     /* 6.5(c) We need to reuse a leaf node */
     if (s->dict[next].parent)
     {
         /* 6.5(d) Detach the leaf node from its parent, and re-use it */
-        e = s->dict[next].parent;
-        if (s->dict[e].child == next)
-        {
-            s->dict[e].child = s->dict[next].next;
-        }
-        else
-        {
-            e = s->dict[e].child;
-            while (s->dict[e].next != next)
-                e = s->dict[e].next;
-            s->dict[e].next = s->dict[next].next;
-        }
+        s->dict[s->dict[next].parent].children--;
+        e = &s->hash[hash_chain(s, s->dict[next].parent, s->dict[next].node_octet)];
+        while (*e != next)
+            e = &s->dict[*e].hash_next;
+        *e = s->dict[next].hash_next;
     }
     s->v42bis_parm_c1 = next;
     return newx;
@@ -250,7 +254,7 @@ static void send_string(v42bis_comp_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
-static void expand_codeword_to_string(v42bis_comp_state_t *s, uint16_t code)
+static int expand_codeword_to_string(v42bis_comp_state_t *s, uint16_t code)
 {
     int i;
     uint16_t p;
@@ -258,6 +262,8 @@ static void expand_codeword_to_string(v42bis_comp_state_t *s, uint16_t code)
     /* Work out the length */
     for (i = 0, p = code;  p;  i++)
         p = s->dict[p].parent;
+    if (s->string_length + i > s->v42bis_parm_n7)
+        return -1;
     s->string_length += i;
     /* Now expand the known length of string */
     i = s->string_length - 1;
@@ -266,6 +272,7 @@ static void expand_codeword_to_string(v42bis_comp_state_t *s, uint16_t code)
         s->string[i--] = s->dict[p].node_octet;
         p = s->dict[p].parent;
     }
+    return 0;
 }
 /*- End of function --------------------------------------------------------*/
 
@@ -408,9 +415,22 @@ static int v42bis_comp_init(v42bis_comp_state_t *s,
                             void *user_data,
                             int max_output_len)
 {
+    int hash_size;
+    uint8_t *buf;
+
     memset(s, 0, sizeof(*s));
     s->v42bis_parm_n2 = p1;
     s->v42bis_parm_n7 = p2;
+    /* Allocate the dictionary, its hash table and the string buffer as a single block, sized
+       for the negotiated parameters. A hash table of at least N2 chains keeps the chains short. */
+    for (hash_size = V42BIS_MIN_DICTIONARY_SIZE;  hash_size < p1;  hash_size <<= 1)
+        ;
+    s->hash_mask = hash_size - 1;
+    if ((buf = (uint8_t *) span_alloc(sizeof(s->dict[0])*p1 + sizeof(s->hash[0])*hash_size + p2)) == NULL)
+        return -1;
+    s->dict = (v42bis_dict_node_t *) buf;
+    s->hash = (uint16_t *) &buf[sizeof(s->dict[0])*p1];
+    s->string = &buf[sizeof(s->dict[0])*p1 + sizeof(s->hash[0])*hash_size];
     s->handler = handler;
     s->user_data = user_data;
     s->max_output_len = (max_output_len < V42BIS_MAX_OUTPUT_LENGTH)  ?  max_output_len  :  V42BIS_MAX_OUTPUT_LENGTH;
@@ -423,6 +443,13 @@ static int v42bis_comp_init(v42bis_comp_state_t *s,
 static int comp_exit(v42bis_comp_state_t *s)
 {
     s->v42bis_parm_n2 = 0;
+    if (s->dict)
+    {
+        span_free(s->dict);
+        s->dict = NULL;
+        s->hash = NULL;
+        s->string = NULL;
+    }
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
@@ -659,9 +686,10 @@ SPAN_DECLARE(int) v42bis_decompress(v42bis_state_t *ss, const uint8_t buf[], int
                 continue;
             }
             /* Regular codeword */
-            if (code == s->v42bis_parm_c1)
+            if (code == s->v42bis_parm_c1  ||  code >= s->v42bis_parm_n2)
+                return -1;
+            if (expand_codeword_to_string(s, code))
                 return -1;
-            expand_codeword_to_string(s, code);
             if (s->update_at)
             {
                 ch = s->string[0];
@@ -728,25 +756,34 @@ SPAN_DECLARE(v42bis_state_t *) v42bis_init(v42bis_state_t *s,
                                            int max_decode_len)
 {
     int ret;
+    bool alloced;
 
-    if (negotiated_p1 < V42BIS_MIN_DICTIONARY_SIZE  ||  negotiated_p1 > 65535)
+    if (negotiated_p1 < V42BIS_MIN_DICTIONARY_SIZE  ||  negotiated_p1 > V42BIS_MAX_CODEWORDS)
         return NULL;
     if (negotiated_p2 < V42BIS_MIN_STRING_SIZE  ||  negotiated_p2 > V42BIS_MAX_STRING_SIZE)
         return NULL;
+    alloced = false;
     if (s == NULL)
     {
         if ((s = (v42bis_state_t *) span_alloc(sizeof(*s))) == NULL)
             return NULL;
+        alloced = true;
     }
     memset(s, 0, sizeof(*s));
     span_log_init(&s->logging, SPAN_LOG_NONE, NULL);
     span_log_set_protocol(&s->logging, "V.42bis");
 
     if ((ret = v42bis_comp_init(&s->compress, negotiated_p1, negotiated_p2, encode_handler, encode_user_data, max_encode_len)))
+    {
+        if (alloced)
+            span_free(s);
         return NULL;
+    }
     if ((ret = v42bis_comp_init(&s->decompress, negotiated_p1, negotiated_p2, decode_handler, decode_user_data, max_decode_len)))
     {
         comp_exit(&s->compress);
+        if (alloced)
+            span_free(s);
         return NULL;
     }
     s->compress.v42bis_parm_p0 = negotiated_p0 & 2;
@@ -758,14 +795,15 @@ SPAN_DECLARE(v42bis_state_t *) v42bis_init(v42bis_state_t *s,
 
 SPAN_DECLARE(int) v42bis_release(v42bis_state_t *s)
 {
+    comp_exit(&s->compress);
+    comp_exit(&s->decompress);
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
 
 SPAN_DECLARE(int) v42bis_free(v42bis_state_t *s)
 {
-    comp_exit(&s->compress);
-    comp_exit(&s->decompress);
+    v42bis_release(s);
     span_free(s);
     return 0;
 }
@@ -130,6 +130,105 @@ static void test_put_async_byte(void *user_data, int byte)
 }
 /*- End of function --------------------------------------------------------*/
 
+static void test_log_async_byte(void *user_data, int byte)
+{
+    unsigned int *hash;
+
+    hash = (unsigned int *) user_data;
+    *hash = *hash*31 + byte;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int test_packed_bits(int data_bits, int parity, int stop_bits)
+{
+    static uint8_t stream[100000];
+    async_rx_state_t rx_async_b;
+    uint32_t bits;
+    unsigned int hash_a;
+    unsigned int hash_b;
+    int v14;
+    int len;
+    int i;
+    int j;
+
+    printf("Test with packed bits, %d data bits, parity %d, %d stop bits\n", data_bits, parity, stop_bits);
+    /* Loop characters through the packed bit interfaces, in groups of varying size */
+    async_tx_init(&tx_async, data_bits, parity, stop_bits, false, test_get_async_byte, NULL);
+    async_rx_init(&rx_async, data_bits, parity, stop_bits, false, test_put_async_byte, NULL);
+    tx_async_chars = 0;
+    rx_async_chars = 0;
+    rx_async_char_mask = (data_bits >= 8)  ?  0xFF  :  (0xFF >> (8 - data_bits));
+    for (len = 1;  rx_async_chars < 1000;  len = len%32 + 1)
+    {
+        if (async_tx_get_bits(&tx_async, &bits, len) != len)
+        {
+            printf("Test failed.\n");
+            return -1;
+        }
+        /*endif*/
+        async_rx_put_bits(&rx_async, bits, len);
+    }
+    /*endfor*/
+    printf("Chars=%d/%d, PE=%d, FE=%d\n", tx_async_chars, rx_async_chars, rx_async.parity_errors, rx_async.framing_errors);
+    if (tx_async_chars - rx_async_chars > 1
+        ||
+        rx_async.parity_errors
+        ||
+        rx_async.framing_errors)
+    {
+        printf("Test failed.\n");
+        return -1;
+    }
+    /*endif*/
+
+    /* A random bit stream, full of parity and framing errors, must be treated the same
+       way by the bit at a time and the packed bit receivers. */
+    for (i = 0;  i < 100000;  i++)
+        stream[i] = (rand()%5 == 0)  ?  0  :  ((rand() & 3) != 0);
+    /*endfor*/
+    for (v14 = 0;  v14 < 2;  v14++)
+    {
+        hash_a = 0;
+        hash_b = 0;
+        async_rx_init(&rx_async, data_bits, parity, stop_bits, v14, test_log_async_byte, &hash_a);
+        async_rx_init(&rx_async_b, data_bits, parity, stop_bits, v14, test_log_async_byte, &hash_b);
+        for (i = 0;  i < 100000;  i++)
+            async_rx_put_bit(&rx_async, stream[i]);
+        /*endfor*/
+        for (i = 0, len = 1;  i < 100000;  i += len, len = len%32 + 1)
+        {
+            if (len > 100000 - i)
+                len = 100000 - i;
+            /*endif*/
+            bits = 0;
+            for (j = 0;  j < len;  j++)
+                bits |= (uint32_t) stream[i + j] << j;
+            /*endfor*/
+            async_rx_put_bits(&rx_async_b, bits, len);
+        }
+        /*endfor*/
+        printf("Random bits%s: PE=%d/%d, FE=%d/%d\n",
+               (v14)  ?  " with V.14"  :  "",
+               rx_async.parity_errors,
+               rx_async_b.parity_errors,
+               rx_async.framing_errors,
+               rx_async_b.framing_errors);
+        if (hash_a != hash_b
+            ||
+            rx_async.parity_errors != rx_async_b.parity_errors
+            ||
+            rx_async.framing_errors != rx_async_b.framing_errors)
+        {
+            printf("Test failed.\n");
+            return -1;
+        }
+        /*endif*/
+    }
+    /*endfor*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 int main(int argc, char *argv[])
 {
     int bit;
@@ -302,6 +401,20 @@ int main(int argc, char *argv[])
     }
     /*endif*/
 
+    if (test_packed_bits(8, ASYNC_PARITY_NONE, 1)
+        ||
+        test_packed_bits(7, ASYNC_PARITY_EVEN, 1)
+        ||
+        test_packed_bits(8, ASYNC_PARITY_ODD, 2)
+        ||
+        test_packed_bits(5, ASYNC_PARITY_NONE, 2)
+        ||
+        test_packed_bits(9, ASYNC_PARITY_MARK, 1))
+    {
+        exit(2);
+    }
+    /*endif*/
+
     printf("Tests passed.\n");
     return 0;
 }
@@ -88,7 +88,6 @@ The T.31 and TSB85 parts are incomplete right now.
 
 #include "spandsp.h"
 #include "spandsp-sim.h"
-#include "udptl.h"
 
 #if defined(ENABLE_GUI)
 #include "media_monitor.h"
@@ -101,6 +100,7 @@ The T.31 and TSB85 parts are incomplete right now.
 
 #define INPUT_TIFF_FILE_NAME    "../test-data/itu/fax/itutests.tif"
 #define OUTPUT_TIFF_FILE_NAME   "fax_tests.tif"
+#define ECM_TIFF_FILE_NAME      "fax_tests_ecm.tif"
 #define INPUT_WAVE_FILE_NAME    "fax_cap.wav"
 #define OUTPUT_WAVE_FILE_NAME   "fax_tests.wav"
 
@@ -601,6 +601,474 @@ static void t33_tests(void)
 }
 /*- End of function --------------------------------------------------------*/
 
+#define DEADLINE_QUEUE_LEN      32
+
+struct deadline_terminal_s
+{
+    t38_terminal_state_t *t38_state;
+    t30_state_t *t30_state;
+    /*! The time at which the terminal was last given the time, in samples */
+    span_sample_timer_t serviced;
+    int tx_seq_no;
+    bool completed;
+    bool phase_e_reached;
+    bool succeeded;
+} deadline_term[2];
+
+struct
+{
+    int dest;
+    int seq_no;
+    int len;
+    uint8_t buf[1024];
+} deadline_queue[DEADLINE_QUEUE_LEN];
+int deadline_queue_len;
+
+static int deadline_tx_packet_handler(t38_core_state_t *s, void *user_data, const uint8_t *buf, int len, int count)
+{
+    int i;
+
+    /* Hold each packet until the sending terminal has returned, so the far terminal can
+       be brought up to date before it sees the packet. Repeats add nothing on a lossless
+       path, so only one copy is kept. */
+    i = (intptr_t) user_data;
+    if (deadline_queue_len >= DEADLINE_QUEUE_LEN  ||  len > (int) sizeof(deadline_queue[0].buf))
+    {
+        printf("Deadline test packet queue overflow\n");
+        exit(2);
+    }
+    /*endif*/
+    deadline_queue[deadline_queue_len].dest = i ^ 1;
+    deadline_queue[deadline_queue_len].seq_no = deadline_term[i].tx_seq_no;
+    deadline_queue[deadline_queue_len].len = len;
+    memcpy(deadline_queue[deadline_queue_len].buf, buf, len);
+    deadline_queue_len++;
+    deadline_term[i].tx_seq_no = (deadline_term[i].tx_seq_no + 1) & 0xFFFF;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void deadline_phase_e_handler(void *user_data, int result)
+{
+    int i;
+
+    i = (intptr_t) user_data;
+    printf("%c: Phase E handler - (%d) %s\n", i + 'A', result, t30_completion_code_to_str(result));
+    deadline_term[i].succeeded = (result == T30_ERR_OK);
+    deadline_term[i].phase_e_reached = true;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void deadline_service(int i, span_sample_timer_t now, int *calls)
+{
+    if (!deadline_term[i].completed)
+    {
+        deadline_term[i].completed = t38_terminal_send_timeout(deadline_term[i].t38_state, now - deadline_term[i].serviced);
+        (*calls)++;
+    }
+    /*endif*/
+    deadline_term[i].serviced = now;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int deadline_fax(const char *input_tiff_file_name, bool use_ecm, bool polled)
+{
+    span_sample_timer_t now;
+    span_sample_timer_t next;
+    span_sample_timer_t due[2];
+    t30_stats_t t30_stats;
+    logging_state_t *logging;
+    int expected_pages;
+    int calls;
+    int timeout;
+    int t30_timeout;
+    int i;
+    int j;
+
+    for (i = 0;  i < 2;  i++)
+    {
+        memset(&deadline_term[i], 0, sizeof(deadline_term[i]));
+        if ((deadline_term[i].t38_state = t38_terminal_init(NULL, (i == 0), deadline_tx_packet_handler, (void *) (intptr_t) i)) == NULL)
+        {
+            fprintf(stderr, "    Cannot start the T.38 terminal instance\n");
+            exit(2);
+        }
+        /*endif*/
+        deadline_term[i].t30_state = t38_terminal_get_t30_state(deadline_term[i].t38_state);
+        logging = t38_terminal_get_logging_state(deadline_term[i].t38_state);
+        span_log_set_level(logging, SPAN_LOG_DEBUG | SPAN_LOG_SHOW_PROTOCOL | SPAN_LOG_SHOW_TAG);
+        span_log_set_tag(logging, (i == 0)  ?  "A"  :  "B");
+        logging = t30_get_logging_state(deadline_term[i].t30_state);
+        span_log_set_level(logging, SPAN_LOG_DEBUG | SPAN_LOG_SHOW_PROTOCOL | SPAN_LOG_SHOW_TAG);
+        span_log_set_tag(logging, (i == 0)  ?  "A"  :  "B");
+        t30_set_phase_e_handler(deadline_term[i].t30_state, deadline_phase_e_handler, (void *) (intptr_t) i);
+        t30_set_ecm_capability(deadline_term[i].t30_state, use_ecm);
+        t30_set_supported_compressions(deadline_term[i].t30_state,
+                                       T4_COMPRESSION_T4_1D
+                                     | T4_COMPRESSION_T4_2D
+                                     | T4_COMPRESSION_T6
+                                     | T4_COMPRESSION_T85
+                                     | T4_COMPRESSION_T85_L0);
+    }
+    /*endfor*/
+    t30_set_tx_file(deadline_term[0].t30_state, input_tiff_file_name, -1, -1);
+    t30_set_rx_file(deadline_term[1].t30_state, output_tiff_file_name, -1);
+    deadline_queue_len = 0;
+
+    now = 0;
+    calls = 0;
+    while (!deadline_term[0].completed  ||  !deadline_term[1].completed)
+    {
+        if (polled)
+        {
+            now += SAMPLES_PER_CHUNK;
+            for (i = 0;  i < 2;  i++)
+                deadline_service(i, now, &calls);
+            /*endfor*/
+        }
+        else
+        {
+            /* Only wake a terminal when it says it needs servicing */
+            next = -1;
+            for (i = 0;  i < 2;  i++)
+            {
+                due[i] = -1;
+                if (deadline_term[i].completed)
+                    continue;
+                /*endif*/
+                timeout = t38_terminal_next_send_timeout(deadline_term[i].t38_state);
+                t30_timeout = t30_timer_next_expiry(deadline_term[i].t30_state);
+                if (t30_timeout >= 0  &&  (timeout < 0  ||  timeout > t30_timeout))
+                {
+                    printf("%c: Next service in %d samples, but a T.30 timer expires in %d\n", i + 'A', timeout, t30_timeout);
+                    exit(2);
+                }
+                /*endif*/
+                if (timeout < 0)
+                    continue;
+                /*endif*/
+                due[i] = deadline_term[i].serviced + timeout;
+                if (next < 0  ||  due[i] < next)
+                    next = due[i];
+                /*endif*/
+            }
+            /*endfor*/
+            if (next < 0)
+            {
+                printf("Both terminals are waiting, with nothing timed, at sample %" PRId64 "\n", (int64_t) now);
+                exit(2);
+            }
+            /*endif*/
+            now = next;
+            for (i = 0;  i < 2;  i++)
+            {
+                if (due[i] == now)
+                    deadline_service(i, now, &calls);
+                /*endif*/
+            }
+            /*endfor*/
+        }
+        /*endif*/
+        /* Deliver what was sent. A terminal is brought up to date before it sees a packet,
+           and anything sent in response is delivered at the same instant. */
+        for (j = 0;  j < deadline_queue_len;  j++)
+        {
+            i = deadline_queue[j].dest;
+            if (deadline_term[i].serviced != now)
+                deadline_service(i, now, &calls);
+            /*endif*/
+            t38_core_rx_ifp_packet(t38_terminal_get_t38_core_state(deadline_term[i].t38_state),
+                                   deadline_queue[j].buf,
+                                   deadline_queue[j].len,
+                                   deadline_queue[j].seq_no);
+        }
+        /*endfor*/
+        deadline_queue_len = 0;
+        if (now > 8000LL*60*30)
+        {
+            printf("The call did not complete\n");
+            exit(2);
+        }
+        /*endif*/
+    }
+    /*endwhile*/
+    printf("%s: %d service calls over %" PRId64 " samples\n", (polled)  ?  "Polled"  :  "Deadline driven", calls, (int64_t) now);
+
+    expected_pages = get_tiff_total_pages(input_tiff_file_name);
+    for (i = 0;  i < 2;  i++)
+    {
+        if (!deadline_term[i].phase_e_reached  ||  !deadline_term[i].succeeded)
+        {
+            printf("%c: The call failed\n", i + 'A');
+            exit(2);
+        }
+        /*endif*/
+        t30_get_transfer_statistics(deadline_term[i].t30_state, &t30_stats);
+        if ((i == 0  &&  t30_stats.pages_tx != expected_pages)
+            ||
+            (i == 1  &&  t30_stats.pages_rx != expected_pages))
+        {
+            printf("%c: Expected %d pages to be transferred\n", i + 'A', expected_pages);
+            exit(2);
+        }
+        /*endif*/
+        t38_terminal_free(deadline_term[i].t38_state);
+    }
+    /*endfor*/
+    return calls;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void deadline_tests(const char *input_tiff_file_name, bool use_ecm)
+{
+    int polled_calls;
+    int deadline_calls;
+
+    printf("Deadline driven T.38 terminal tests\n");
+    /* Run the deadline driven call last, so its image is the one left in the output file */
+    polled_calls = deadline_fax(input_tiff_file_name, use_ecm, true);
+    deadline_calls = deadline_fax(input_tiff_file_name, use_ecm, false);
+    if (deadline_calls >= polled_calls)
+    {
+        printf("Deadline driven operation did not reduce the number of service calls\n");
+        exit(2);
+    }
+    /*endif*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static int ecm_pending_steps;
+static uint8_t ecm_last_tx_fcf;
+static uint8_t ecm_delivered[4096];
+static int ecm_delivered_len;
+
+static void ecm_set_rx_type(void *user_data, int type, int bit_rate, int short_train, int use_hdlc)
+{
+}
+/*- End of function --------------------------------------------------------*/
+
+static void ecm_set_tx_type(void *user_data, int type, int bit_rate, int short_train, int use_hdlc)
+{
+    switch (type)
+    {
+    case T30_MODEM_PAUSE:
+    case T30_MODEM_CED:
+    case T30_MODEM_CNG:
+        ecm_pending_steps++;
+        break;
+    }
+    /*endswitch*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static void ecm_send_hdlc(void *user_data, const uint8_t *msg, int len)
+{
+    if (msg  &&  len >= 3)
+        ecm_last_tx_fcf = msg[2] & 0xFE;
+    /*endif*/
+    ecm_pending_steps++;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int ecm_put_handler(void *user_data, const uint8_t buf[], int len)
+{
+    if (ecm_delivered_len + len > (int) sizeof(ecm_delivered))
+    {
+        printf("ECM block test delivered too much data\n");
+        exit(2);
+    }
+    /*endif*/
+    memcpy(&ecm_delivered[ecm_delivered_len], buf, len);
+    ecm_delivered_len += len;
+    return T4_DECODE_MORE_DATA;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void ecm_settle(t30_state_t *s)
+{
+    /* Act as a front end which completes everything it is asked to send at once */
+    while (ecm_pending_steps > 0)
+    {
+        ecm_pending_steps--;
+        t30_front_end_status(s, T30_FRONT_END_SEND_STEP_COMPLETE);
+    }
+    /*endwhile*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static void ecm_rx_frame(t30_state_t *s, const uint8_t *msg, int len)
+{
+    t30_hdlc_accept(s, msg, len, true);
+    ecm_settle(s);
+}
+/*- End of function --------------------------------------------------------*/
+
+static void ecm_rx_fcd(t30_state_t *s, int frame_no, int len)
+{
+    uint8_t buf[4 + 256];
+
+    /* Fill each frame with its own number plus one, so misplaced data shows up */
+    buf[0] = 0xFF;
+    buf[1] = 0x03;
+    buf[2] = T4_FCD;
+    buf[3] = frame_no;
+    memset(&buf[4], frame_no + 1, len);
+    t30_hdlc_accept(s, buf, 4 + len, true);
+}
+/*- End of function --------------------------------------------------------*/
+
+static void ecm_rx_pps(t30_state_t *s, int fcf2, int page, int block, int frames)
+{
+    static const uint8_t rcp[] = {0xFF, 0x03, T4_RCP};
+    uint8_t pps[7];
+    int i;
+
+    for (i = 0;  i < 3;  i++)
+        t30_hdlc_accept(s, rcp, 3, true);
+    /*endfor*/
+    t30_hdlc_accept(s, NULL, SIG_STATUS_CARRIER_DOWN, true);
+    ecm_settle(s);
+    pps[0] = 0xFF;
+    pps[1] = 0x13;
+    pps[2] = T30_PPS | 1;
+    pps[3] = fcf2;
+    pps[4] = page;
+    pps[5] = block;
+    pps[6] = frames - 1;
+    ecm_rx_frame(s, pps, 7);
+}
+/*- End of function --------------------------------------------------------*/
+
+static void ecm_check(const char *step, int fcf, int delivered_len)
+{
+    printf("%s - sent %s, %d octets passed on\n", step, t30_frametype(ecm_last_tx_fcf), ecm_delivered_len);
+    if (ecm_last_tx_fcf != fcf  ||  ecm_delivered_len != delivered_len)
+    {
+        printf("Expected %s, with %d octets passed on\n", t30_frametype(fcf), delivered_len);
+        exit(2);
+    }
+    /*endif*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static void ecm_check_data(int start, int len, int fill)
+{
+    int i;
+
+    for (i = start;  i < start + len;  i++)
+    {
+        if (ecm_delivered[i] != fill)
+        {
+            printf("Wrong data passed on at octet %d\n", i);
+            exit(2);
+        }
+        /*endif*/
+    }
+    /*endfor*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static void ecm_block_tests(void)
+{
+    t30_state_t *s;
+    logging_state_t *logging;
+    uint8_t tcf[900];
+    int i;
+    /* Receive fax, V.27ter 4800bps, 0ms scan line time, ECM with 256 octet frames */
+    static const uint8_t dcs[] = {0xFF, 0x13, T30_DCS | 1, 0x00, 0x0A, 0xF0, 0x04};
+    static const uint8_t ctc[] = {0xFF, 0x13, T30_CTC | 1, 0x00, 0x0C};
+    static const uint8_t eor[] = {0xFF, 0x13, T30_EOR | 1, T30_NULL};
+    static const uint8_t dcn[] = {0xFF, 0x13, T30_DCN | 1};
+
+    printf("ECM block reception tests\n");
+    ecm_pending_steps = 0;
+    ecm_last_tx_fcf = 0;
+    ecm_delivered_len = 0;
+    if ((s = t30_init(NULL, false, ecm_set_rx_type, NULL, ecm_set_tx_type, NULL, ecm_send_hdlc, NULL)) == NULL)
+    {
+        fprintf(stderr, "    Cannot start the T.30 instance\n");
+        exit(2);
+    }
+    /*endif*/
+    logging = t30_get_logging_state(s);
+    span_log_set_level(logging, SPAN_LOG_DEBUG | SPAN_LOG_SHOW_PROTOCOL | SPAN_LOG_SHOW_TAG);
+    span_log_set_tag(logging, "ECM");
+    t30_set_ecm_capability(s, true);
+    t30_set_rx_file(s, ECM_TIFF_FILE_NAME, -1);
+    t30_set_document_put_handler(s, ecm_put_handler, NULL);
+    t30_restart(s, false);
+    ecm_settle(s);
+    ecm_rx_frame(s, dcs, sizeof(dcs));
+    memset(tcf, 0, sizeof(tcf));
+    t30_non_ecm_put(s, NULL, SIG_STATUS_TRAINING_SUCCEEDED);
+    t30_non_ecm_put(s, tcf, sizeof(tcf));
+    t30_non_ecm_put(s, NULL, SIG_STATUS_CARRIER_DOWN);
+    ecm_settle(s);
+    ecm_check("TCF", T30_CFR, 0);
+
+    /* Nothing is passed on before the PPS. When a resent frame completes the block, the
+       whole block is passed on at once, and the PPS which follows adds nothing. */
+    t30_hdlc_accept(s, NULL, SIG_STATUS_TRAINING_SUCCEEDED, true);
+    ecm_rx_fcd(s, 0, 256);
+    ecm_rx_fcd(s, 1, 256);
+    ecm_rx_fcd(s, 3, 256);
+    ecm_rx_pps(s, T30_NULL, 0, 0, 4);
+    ecm_check("Block 0, frame 2 missing", T30_PPR, 0);
+    t30_hdlc_accept(s, NULL, SIG_STATUS_TRAINING_SUCCEEDED, true);
+    ecm_rx_fcd(s, 2, 256);
+    ecm_check("Block 0, frame 2 resent", T30_PPR, 4*256);
+    ecm_rx_pps(s, T30_NULL, 0, 0, 1);
+    ecm_check("Block 0, PPS", T30_MCF, 4*256);
+    for (i = 0;  i < 4;  i++)
+        ecm_check_data(i*256, 256, i + 1);
+    /*endfor*/
+
+    /* The far end missed our MCF, and repeats the last burst of block 0 */
+    t30_hdlc_accept(s, NULL, SIG_STATUS_TRAINING_SUCCEEDED, true);
+    ecm_rx_fcd(s, 2, 256);
+    ecm_rx_pps(s, T30_NULL, 0, 0, 1);
+    ecm_check("Block 0 repeated", T30_MCF, 4*256);
+
+    /* Frames arriving after a CTC are held until a PPS says which block they are for */
+    t30_hdlc_accept(s, NULL, SIG_STATUS_TRAINING_SUCCEEDED, true);
+    ecm_rx_fcd(s, 0, 256);
+    ecm_rx_fcd(s, 2, 100);
+    ecm_rx_pps(s, T30_NULL, 0, 1, 3);
+    ecm_check("Block 1, frame 1 missing", T30_PPR, 4*256);
+    ecm_rx_frame(s, ctc, sizeof(ctc));
+    ecm_check("Block 1, CTC", T30_CTR, 4*256);
+    t30_hdlc_accept(s, NULL, SIG_STATUS_TRAINING_SUCCEEDED, true);
+    ecm_rx_fcd(s, 1, 256);
+    ecm_check("Block 1, frame 1 resent", T30_CTR, 4*256);
+    ecm_rx_pps(s, T30_NULL, 0, 1, 1);
+    ecm_check("Block 1, PPS", T30_MCF, 6*256 + 100);
+    ecm_check_data(4*256, 256, 1);
+    ecm_check_data(5*256, 256, 2);
+    ecm_check_data(6*256, 100, 3);
+
+    /* A block abandoned by EOR is discarded, and the block is then sent afresh */
+    t30_hdlc_accept(s, NULL, SIG_STATUS_TRAINING_SUCCEEDED, true);
+    ecm_rx_fcd(s, 0, 256);
+    ecm_rx_fcd(s, 1, 256);
+    ecm_rx_pps(s, T30_NULL, 0, 2, 4);
+    ecm_check("Block 2, frames 2 and 3 missing", T30_PPR, 6*256 + 100);
+    ecm_rx_frame(s, eor, sizeof(eor));
+    ecm_check("Block 2, EOR", T30_ERR, 6*256 + 100);
+    t30_hdlc_accept(s, NULL, SIG_STATUS_TRAINING_SUCCEEDED, true);
+    ecm_rx_fcd(s, 0, 64);
+    ecm_rx_fcd(s, 1, 64);
+    ecm_rx_fcd(s, 2, 10);
+    ecm_rx_pps(s, T30_EOP, 0, 2, 3);
+    ecm_check("Block 2 sent afresh", T30_MCF, 6*256 + 100 + 64 + 64 + 10);
+    ecm_check_data(6*256 + 100, 64, 1);
+    ecm_check_data(6*256 + 164, 64, 2);
+    ecm_check_data(6*256 + 228, 10, 3);
+
+    ecm_rx_frame(s, dcn, sizeof(dcn));
+    t30_free(s);
+}
+/*- End of function --------------------------------------------------------*/
+
 int main(int argc, char *argv[])
 {
     int16_t silence[SAMPLES_PER_CHUNK];
@@ -616,6 +1084,7 @@ int main(int argc, char *argv[])
     bool use_ecm;
     bool use_tep;
     bool use_polled_mode;
+    bool use_deadlines;
     bool use_transmit_on_idle;
     bool feedback_audio;
     int t38_version;
@@ -679,6 +1148,7 @@ int main(int argc, char *argv[])
     feedback_audio = false;
     use_transmit_on_idle = true;
     use_polled_mode = false;
+    use_deadlines = false;
     supported_modems = T30_SUPPORT_V27TER | T30_SUPPORT_V29 | T30_SUPPORT_V17;
     page_header_info = NULL;
     page_header_tz = NULL;
@@ -704,7 +1174,7 @@ int main(int argc, char *argv[])
     xml_test_name[0] = "MRGN01";
     xml_test_name[1] = "MRGN01";
     xml_step = 0;
-    while ((opt = getopt(argc, argv, "7b:c:Cd:D:efFgH:i:Ilm:M:n:p:Ps:S:tT:u:v:x:X:z:")) != -1)
+    while ((opt = getopt(argc, argv, "7b:c:Cd:D:efFgH:i:Ilm:M:n:p:Ps:S:tT:u:v:wx:X:z:")) != -1)
     {
         switch (opt)
         {
@@ -879,6 +1349,9 @@ int main(int argc, char *argv[])
         case 'v':
             t38_version = atoi(optarg);
             break;
+        case 'w':
+            use_deadlines = true;
+            break;
         case 'x':
             xml_test_name[xml_step] = optarg;
             xml_step ^= 1;
@@ -910,6 +1383,14 @@ int main(int argc, char *argv[])
         printf("Using ECM\n");
     /*endif*/
 
+    if (use_deadlines)
+    {
+        deadline_tests(input_tiff_file_name, use_ecm);
+        printf("Tests passed\n");
+        exit(0);
+    }
+    /*endif*/
+
     wave_handle = NULL;
     if (log_audio)
     {
@@ -1779,6 +2260,7 @@ int main(int argc, char *argv[])
     }
     /*endif*/
     t33_tests();
+    ecm_block_tests();
     printf("Tests passed\n");
     return 0;
 }
@@ -141,6 +141,13 @@ TIFFCMP=tiffcmp
 #    run_colour_fax_test
 #done
 
+# T.38 terminals woken only when they report they need servicing
+for OPTS in "-w" "-w -e"
+do
+    FILE="${ITUTESTS_DIR}/itutests.tif"
+    run_fax_test
+done
+
 # Bi-level tests
 for OPTS in "-p FAX-FAX" "-p FAX-FAX -e" "-p T38-T38" "-p T38-T38 -e" "-p FAX-T38gateway-T38gateway-FAX" "-p FAX-T38gateway-T38gateway-FAX -e" "-p T38-T38gateway-FAX" "-p T38-T38gateway-FAX -e" "-p FAX-T38gateway-T38" "-p FAX-T38gateway-T38 -e"
 do
@@ -41,6 +41,7 @@
 #include <assert.h>
 #include <math.h>
 #include <errno.h>
+#include <time.h>
 
 #define SPANDSP_EXPOSE_INTERNAL_STRUCTURES
 
@@ -48,6 +49,10 @@
 
 #define INPUT_TIFF_FILE_NAME    "../test-data/local/lenna-colour.tif"
 
+/* An A4 page scanned at 300 DPI */
+#define A4_300DPI_WIDTH         2480
+#define A4_300DPI_LENGTH        3508
+
 typedef struct
 {
     const uint8_t *image;
@@ -292,6 +297,22 @@ static int row_read(void *user_data, uint8_t buf[], size_t len)
 }
 /*- End of function --------------------------------------------------------*/
 
+static int strip_read(void *user_data, uint8_t buf[], size_t len, size_t stride, int max_rows)
+{
+    int rows;
+
+    for (rows = 0;  rows < max_rows;  rows++)
+    {
+        if (row_read(user_data, buf, len) != len)
+            break;
+        /*endif*/
+        buf += stride;
+    }
+    /*endfor*/
+    return rows;
+}
+/*- End of function --------------------------------------------------------*/
+
 static void get_bilevel_image(image_translate_state_t *s, int compare)
 {
     int i;
@@ -685,6 +706,188 @@ static void grow_tests_colour8(void)
 }
 /*- End of function --------------------------------------------------------*/
 
+static void ordered_dither_tests(void)
+{
+    image_translate_state_t *s;
+    uint8_t image[3*50*50];
+    image_descriptor_t im;
+
+    printf("Ordered dithering from a 8 bit per sample gray scale to bi-level\n");
+    create_undithered_50_by_50(&im, image, 1);
+    s = image_translate_init(NULL, T4_IMAGE_TYPE_BILEVEL, -1, -1, T4_IMAGE_TYPE_GRAY_8BIT, im.width, im.length, row_read, &im);
+    if (image_translate_set_dither(s, IMAGE_TRANSLATE_DITHER_ORDERED))
+    {
+        printf("Failed to select ordered dithering\n");
+        exit(2);
+    }
+    /*endif*/
+    get_bilevel_image(s, false);
+
+    printf("Ordered dithering from a 3x8 bit per sample colour to bi-level, with resizing\n");
+    create_undithered_50_by_50(&im, image, 3);
+    s = image_translate_init(s, T4_IMAGE_TYPE_BILEVEL, 200, -1, T4_IMAGE_TYPE_COLOUR_8BIT, im.width, im.length, row_read, &im);
+    image_translate_set_dither(s, IMAGE_TRANSLATE_DITHER_ORDERED);
+    get_bilevel_image(s, false);
+    image_translate_free(s);
+}
+/*- End of function --------------------------------------------------------*/
+
+static void image_source_test(const char *name, int output_format, int output_width, int input_format, int bytes_per_pixel)
+{
+    image_translate_state_t *s1;
+    image_translate_state_t *s2;
+    image_translate_state_t *s3;
+    image_descriptor_t im;
+    image_descriptor_t im3;
+    uint8_t image[6*50*50];
+    uint8_t row_buf1[6*200];
+    uint8_t row_buf2[6*200];
+    uint8_t row_buf3[6*200];
+    int len1;
+    int len2;
+    int rows3;
+    int rows;
+
+    printf("Translating straight from memory - %s\n", name);
+    create_undithered_50_by_50(&im, image, bytes_per_pixel);
+    im3 = im;
+    /* Translate the image through the row read handler, straight from memory, and through
+       the strip read handler, side by side, and check every row comes out the same. */
+    s1 = image_translate_init(NULL, output_format, output_width, -1, input_format, im.width, im.length, row_read, &im);
+    s2 = image_translate_init(NULL, output_format, output_width, -1, input_format, im.width, im.length, NULL, NULL);
+    image_translate_set_image_source(s2, image, 0);
+    s3 = image_translate_init(NULL, output_format, output_width, -1, input_format, im.width, im.length, NULL, NULL);
+    image_translate_set_strip_read_handler(s3, strip_read, &im3);
+    rows = 0;
+    do
+    {
+        memset(row_buf1, 0, sizeof(row_buf1));
+        memset(row_buf2, 0, sizeof(row_buf2));
+        memset(row_buf3, 0, sizeof(row_buf3));
+        len1 = image_translate_row(s1, row_buf1, sizeof(row_buf1));
+        len2 = image_translate_row(s2, row_buf2, sizeof(row_buf2));
+        rows3 = image_translate_strip(s3, row_buf3, sizeof(row_buf3), sizeof(row_buf3), 1);
+        if (len1 != len2  ||  memcmp(row_buf1, row_buf2, len1))
+        {
+            printf("Row %d differs - %d %d\n", rows, len1, len2);
+            exit(2);
+        }
+        /*endif*/
+        if (rows3 != (len1 > 0)  ||  memcmp(row_buf1, row_buf3, len1))
+        {
+            printf("Row %d differs when read in strips\n", rows);
+            exit(2);
+        }
+        /*endif*/
+        rows++;
+    }
+    while (len1 > 0);
+    if (rows != image_translate_get_output_length(s1) + 1)
+    {
+        printf("Got %d rows, expected %d\n", rows - 1, image_translate_get_output_length(s1));
+        exit(2);
+    }
+    /*endif*/
+    image_translate_free(s1);
+    image_translate_free(s2);
+    image_translate_free(s3);
+}
+/*- End of function --------------------------------------------------------*/
+
+static void image_source_tests(void)
+{
+    image_source_test("colour to bi-level", T4_IMAGE_TYPE_BILEVEL, -1, T4_IMAGE_TYPE_COLOUR_8BIT, 3);
+    image_source_test("colour to bi-level, resized", T4_IMAGE_TYPE_BILEVEL, 200, T4_IMAGE_TYPE_COLOUR_8BIT, 3);
+    image_source_test("16 bit gray to bi-level", T4_IMAGE_TYPE_BILEVEL, -1, T4_IMAGE_TYPE_GRAY_12BIT, 2);
+    image_source_test("gray to gray, resized", T4_IMAGE_TYPE_GRAY_8BIT, 200, T4_IMAGE_TYPE_GRAY_8BIT, 1);
+    image_source_test("gray to colour", T4_IMAGE_TYPE_COLOUR_8BIT, -1, T4_IMAGE_TYPE_GRAY_8BIT, 1);
+    image_source_test("16 bit colour to 16 bit colour, resized", T4_IMAGE_TYPE_COLOUR_12BIT, 200, T4_IMAGE_TYPE_COLOUR_12BIT, 6);
+}
+/*- End of function --------------------------------------------------------*/
+
+static void throughput_test(const char *name, int output_format, int input_format, int bytes_per_pixel, int dither, bool from_memory)
+{
+    image_translate_state_t *s;
+    image_descriptor_t im;
+    uint8_t *image;
+    uint8_t *row_buf;
+    struct timespec start;
+    struct timespec end;
+    int row_len;
+    int rows;
+    int i;
+    int j;
+
+    if ((image = malloc(A4_300DPI_WIDTH*A4_300DPI_LENGTH*bytes_per_pixel)) == NULL)
+    {
+        printf("Failed to allocate the image\n");
+        exit(2);
+    }
+    /*endif*/
+    /* A smooth diagonal gradient, with some fine detail, so neither the dithering nor
+       the resizing has an easy time */
+    for (i = 0;  i < A4_300DPI_LENGTH;  i++)
+    {
+        for (j = 0;  j < A4_300DPI_WIDTH*bytes_per_pixel;  j++)
+            image[i*A4_300DPI_WIDTH*bytes_per_pixel + j] = ((i + j/bytes_per_pixel)/24 + ((i ^ j) & 0x0F)) & 0xFF;
+        /*endfor*/
+    }
+    /*endfor*/
+    im.image = image;
+    im.width = A4_300DPI_WIDTH;
+    im.length = A4_300DPI_LENGTH;
+    im.current_row = 0;
+    im.bytes_per_pixel = bytes_per_pixel;
+    s = image_translate_init(NULL, output_format, T4_WIDTH_R8_A4, -1, input_format, im.width, im.length, row_read, &im);
+    image_translate_set_dither(s, dither);
+    if (from_memory)
+        image_translate_set_image_source(s, image, 0);
+    /*endif*/
+    row_len = (output_format == T4_IMAGE_TYPE_BILEVEL)  ?  (s->output_width + 7)/8  :  s->output_width*3;
+    if ((row_buf = malloc(row_len)) == NULL)
+    {
+        printf("Failed to allocate the row buffer\n");
+        exit(2);
+    }
+    /*endif*/
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (rows = 0;  image_translate_row(s, row_buf, row_len) > 0;  rows++)
+        ;
+    /*endfor*/
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (rows != s->output_length)
+    {
+        printf("%s - got %d rows, expected %d\n", name, rows, s->output_length);
+        exit(2);
+    }
+    /*endif*/
+    printf("%-40s %dx%d to %dx%d in %.1fms\n",
+           name,
+           A4_300DPI_WIDTH,
+           A4_300DPI_LENGTH,
+           s->output_width,
+           s->output_length,
+           (end.tv_sec - start.tv_sec)*1000.0 + (end.tv_nsec - start.tv_nsec)/1000000.0);
+    image_translate_free(s);
+    free(row_buf);
+    free(image);
+}
+/*- End of function --------------------------------------------------------*/
+
+static void throughput_tests(void)
+{
+    printf("Throughput of A4 300DPI pages, reduced to 1728 pixels wide\n");
+    throughput_test("Gray to gray", T4_IMAGE_TYPE_GRAY_8BIT, T4_IMAGE_TYPE_GRAY_8BIT, 1, IMAGE_TRANSLATE_DITHER_FLOYD_STEINBERG, false);
+    throughput_test("Colour to colour", T4_IMAGE_TYPE_COLOUR_8BIT, T4_IMAGE_TYPE_COLOUR_8BIT, 3, IMAGE_TRANSLATE_DITHER_FLOYD_STEINBERG, false);
+    throughput_test("Gray to bi-level, Floyd-Steinberg", T4_IMAGE_TYPE_BILEVEL, T4_IMAGE_TYPE_GRAY_8BIT, 1, IMAGE_TRANSLATE_DITHER_FLOYD_STEINBERG, false);
+    throughput_test("Gray to bi-level, ordered", T4_IMAGE_TYPE_BILEVEL, T4_IMAGE_TYPE_GRAY_8BIT, 1, IMAGE_TRANSLATE_DITHER_ORDERED, false);
+    throughput_test("Colour to bi-level, Floyd-Steinberg", T4_IMAGE_TYPE_BILEVEL, T4_IMAGE_TYPE_COLOUR_8BIT, 3, IMAGE_TRANSLATE_DITHER_FLOYD_STEINBERG, false);
+    throughput_test("Colour to bi-level, ordered", T4_IMAGE_TYPE_BILEVEL, T4_IMAGE_TYPE_COLOUR_8BIT, 3, IMAGE_TRANSLATE_DITHER_ORDERED, false);
+    throughput_test("Colour to bi-level, F-S, from memory", T4_IMAGE_TYPE_BILEVEL, T4_IMAGE_TYPE_COLOUR_8BIT, 3, IMAGE_TRANSLATE_DITHER_FLOYD_STEINBERG, true);
+    throughput_test("Colour to bi-level, ordered, from memory", T4_IMAGE_TYPE_BILEVEL, T4_IMAGE_TYPE_COLOUR_8BIT, 3, IMAGE_TRANSLATE_DITHER_ORDERED, true);
+}
+/*- End of function --------------------------------------------------------*/
+
 static int row_read2(void *user_data, uint8_t buf[], size_t len)
 {
     image_translate_state_t *s;
@@ -893,6 +1096,12 @@ int main(int argc, char **argv)
 #if 1
     grow_tests_colour8();
 #endif
+#if 1
+    ordered_dither_tests();
+#endif
+#if 1
+    image_source_tests();
+#endif
 #if 1
     lenna_tests(0, 0, "lenna-bw.tif");
     lenna_tests(200, 0, "lenna-bw-200.tif");
@@ -900,6 +1109,9 @@ int main(int argc, char **argv)
     lenna_tests(1728, 2, "lenna-bw-1728-superfine.tif");
     lenna_tests(1728, -1, "lenna-colour-1728.tif");
     lenna_tests(1728, -2, "lenna-gray-1728.tif");
+#endif
+#if 1
+    throughput_tests();
 #endif
     printf("Tests passed.\n");
     return 0;
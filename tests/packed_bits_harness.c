@@ -0,0 +1,170 @@
+/*
+ * SpanDSP - a series of DSP components for telephony
+ *
+ * packed_bits_harness.c - Compare the per-bit and packed bit interfaces
+ *                         of a modem transmitter and receiver pair.
+ *
+ * Copyright (C) 2026 The SpanDSP contributors
+ *
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "spandsp.h"
+#include "packed_bits_harness.h"
+
+#define PACKED_TEST_BLOCK_LEN   160
+#define PACKED_TEST_BITS        10000
+#define PACKED_TEST_SAMPLES     100000
+
+static uint8_t packed_test_source[PACKED_TEST_BITS];
+static int packed_test_tx_ptr;
+static uint8_t packed_test_rx_bits[2][2*PACKED_TEST_BITS];
+static int packed_test_rx_len[2];
+static int16_t packed_test_audio[2][PACKED_TEST_SAMPLES];
+static int packed_test_audio_len[2];
+static int packed_test_pass;
+
+static int packed_test_getbit(void *user_data)
+{
+    if (packed_test_tx_ptr >= PACKED_TEST_BITS)
+        return SIG_STATUS_END_OF_DATA;
+    /*endif*/
+    return packed_test_source[packed_test_tx_ptr++];
+}
+/*- End of function --------------------------------------------------------*/
+
+static int packed_test_getbits(void *user_data, uint32_t *bits, int nbits)
+{
+    int i;
+
+    *bits = 0;
+    for (i = 0;  i < nbits  &&  packed_test_tx_ptr < PACKED_TEST_BITS;  i++)
+        *bits |= (uint32_t) packed_test_source[packed_test_tx_ptr++] << i;
+    /*endfor*/
+    return i;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void packed_test_putbit(void *user_data, int bit)
+{
+    if (bit < 0)
+        return;
+    /*endif*/
+    if (packed_test_rx_len[packed_test_pass] < 2*PACKED_TEST_BITS)
+        packed_test_rx_bits[packed_test_pass][packed_test_rx_len[packed_test_pass]++] = (uint8_t) bit;
+    /*endif*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static void packed_test_putbits(void *user_data, uint32_t bits, int nbits)
+{
+    int i;
+
+    for (i = 0;  i < nbits;  i++)
+    {
+        packed_test_putbit(user_data, bits & 1);
+        bits >>= 1;
+    }
+    /*endfor*/
+}
+/*- End of function --------------------------------------------------------*/
+
+int packed_bits_tests(const packed_bits_modem_t *modem, int bit_rate, bool tep)
+{
+    void *tx;
+    void *rx;
+    int16_t *amp;
+    int len;
+    int pass;
+    int i;
+
+    /* Run the same data through the modem pair twice, using the per-bit interfaces and then
+       the packed ones. The audio and the received bits should be identical. */
+    printf("Comparing the per-bit and packed bit interfaces at %dbps\n", bit_rate);
+    for (i = 0;  i < PACKED_TEST_BITS;  i++)
+        packed_test_source[i] = rand() & 1;
+    /*endfor*/
+    for (pass = 0;  pass < 2;  pass++)
+    {
+        packed_test_pass = pass;
+        packed_test_tx_ptr = 0;
+        packed_test_rx_len[pass] = 0;
+        packed_test_audio_len[pass] = 0;
+        tx = modem->tx_init(bit_rate, tep, packed_test_getbit, (pass)  ?  packed_test_getbits  :  NULL, NULL);
+        rx = modem->rx_init(bit_rate, packed_test_putbit, (pass)  ?  packed_test_putbits  :  NULL, NULL);
+        for (;;)
+        {
+            if (packed_test_audio_len[pass] + PACKED_TEST_BLOCK_LEN > PACKED_TEST_SAMPLES)
+            {
+                printf("    The transmitter did not stop\n");
+                return -1;
+            }
+            /*endif*/
+            amp = &packed_test_audio[pass][packed_test_audio_len[pass]];
+            if ((len = modem->tx(tx, amp, PACKED_TEST_BLOCK_LEN)) <= 0)
+                break;
+            /*endif*/
+            modem->rx(rx, amp, len);
+            packed_test_audio_len[pass] += len;
+        }
+        /*endfor*/
+        modem->tx_free(tx);
+        modem->rx_free(rx);
+    }
+    /*endfor*/
+    if (packed_test_audio_len[0] != packed_test_audio_len[1]
+        ||
+        memcmp(packed_test_audio[0], packed_test_audio[1], packed_test_audio_len[0]*sizeof(int16_t)))
+    {
+        printf("    The transmitted audio differs\n");
+        return -1;
+    }
+    /*endif*/
+    if (packed_test_rx_len[0] != packed_test_rx_len[1]
+        ||
+        memcmp(packed_test_rx_bits[0], packed_test_rx_bits[1], packed_test_rx_len[0]))
+    {
+        printf("    The received bits differ\n");
+        return -1;
+    }
+    /*endif*/
+    /* Make sure the data really got through */
+    for (i = 0;  i + PACKED_TEST_BITS <= packed_test_rx_len[1];  i++)
+    {
+        if (memcmp(&packed_test_rx_bits[1][i], packed_test_source, PACKED_TEST_BITS) == 0)
+            break;
+        /*endif*/
+    }
+    /*endfor*/
+    if (i + PACKED_TEST_BITS > packed_test_rx_len[1])
+    {
+        printf("    The data was not received\n");
+        return -1;
+    }
+    /*endif*/
+    printf("    %d samples and %d received bits are identical\n", packed_test_audio_len[0], packed_test_rx_len[0]);
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+/*- End of file ------------------------------------------------------------*/
@@ -0,0 +1,62 @@
+/*
+ * SpanDSP - a series of DSP components for telephony
+ *
+ * packed_bits_harness.h - Compare the per-bit and packed bit interfaces
+ *                         of a modem transmitter and receiver pair.
+ *
+ * Copyright (C) 2026 The SpanDSP contributors
+ *
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*! \file */
+
+#if !defined(_SPANDSP_PACKED_BITS_HARNESS_H_)
+#define _SPANDSP_PACKED_BITS_HARNESS_H_
+
+/*! The calls needed to drive one type of modem through the comparison. Each modem's
+    test program supplies small wrappers around its own functions. */
+typedef struct
+{
+    /*! Create a transmitter. If get_bits is not NULL it is set after get_bit. */
+    void *(*tx_init)(int bit_rate, bool tep, span_get_bit_func_t get_bit, span_get_bits_func_t get_bits, void *user_data);
+    int (*tx)(void *s, int16_t amp[], int len);
+    void (*tx_free)(void *s);
+    /*! Create a receiver. If put_bits is not NULL it is set after put_bit. */
+    void *(*rx_init)(int bit_rate, span_put_bit_func_t put_bit, span_put_bits_func_t put_bits, void *user_data);
+    int (*rx)(void *s, const int16_t amp[], int len);
+    void (*rx_free)(void *s);
+} packed_bits_modem_t;
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+/*! Send the same random data through a modem pair twice, using the per-bit interfaces
+    and then the packed ones.
+    \param modem The calls which drive the modem.
+    \param bit_rate The bit rate to test.
+    \param tep True to send TEP.
+    \return 0 if the audio and the received bits are identical, and the data got through. */
+int packed_bits_tests(const packed_bits_modem_t *modem, int bit_rate, bool tep);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
+/*- End of file ------------------------------------------------------------*/
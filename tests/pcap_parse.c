@@ -61,7 +61,6 @@
 #define SPANDSP_EXPOSE_INTERNAL_STRUCTURES
 
 #include "spandsp.h"
-#include "udptl.h"
 #include "pcap_parse.h"
 
 #if defined(__HPUX)  ||  defined(__DARWIN)  ||  defined(__CYGWIN__)  ||  defined(__FreeBSD__)
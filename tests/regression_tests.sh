@@ -547,8 +547,26 @@ then
     echo t4_tests failed!
     exit $RETVAL
 fi
+rm -f t4_tests_receive.tif
+./t4_tests -b 10 -M >$STDOUT_DEST 2>$STDERR_DEST
+RETVAL=$?
+if [ $RETVAL != 0 ]
+then
+    echo t4_tests failed!
+    exit $RETVAL
+fi
 echo t4_tests completed OK
 
+rm -f t4_convert_tests_receive.tif t4_convert_tests_t6.tif
+./t4_convert_tests >$STDOUT_DEST 2>$STDERR_DEST
+RETVAL=$?
+if [ $RETVAL != 0 ]
+then
+    echo t4_convert_tests failed!
+    exit $RETVAL
+fi
+echo t4_convert_tests completed OK
+
 rm -f t4_t6_tests_receive.tif
 ./t4_t6_tests >$STDOUT_DEST 2>$STDERR_DEST
 RETVAL=$?
@@ -634,6 +652,15 @@ then
 fi
 echo tsb85_tests.sh completed OK
 
+./udptl_tests >$STDOUT_DEST 2>$STDERR_DEST
+RETVAL=$?
+if [ $RETVAL != 0 ]
+then
+    echo udptl_tests failed!
+    exit $RETVAL
+fi
+echo udptl_tests completed OK
+
 for OPTS in "-b 14400 -s -42 -n -66" "-b 12000 -s -42 -n -61" "-b 9600 -s -42 -n -59" "-b 7200 -s -42 -n -56"
 do
     ./v17_tests ${OPTS} >$STDOUT_DEST 2>$STDERR_DEST
@@ -703,6 +730,13 @@ then
     echo v42_tests failed!
     exit $RETVAL
 fi
+./v42_tests -o >$STDOUT_DEST 2>$STDERR_DEST
+RETVAL=$?
+if [ $RETVAL != 0 ]
+then
+    echo v42_tests -o failed!
+    exit $RETVAL
+fi
 echo v42_tests completed OK
 
 ./v42bis_tests.sh >/dev/null
@@ -379,6 +379,126 @@ static void status_handler(void *user_data, int status)
 }
 /*- End of function --------------------------------------------------------*/
 
+static const uint8_t retry_msg[] = "Retry test message";
+static span_timestamp_t retry_now;
+static int retry_packets_sent;
+static int retry_packets_at_report;
+static int retry_reports;
+static bool retry_free_on_report;
+static sprt_state_t *retry_state;
+
+static int retry_tx_packet_handler(void *user_data, const uint8_t pkt[], int len)
+{
+    /* Only count packets carrying the message, and not ACK or keepalive only ones */
+    if (len > (int) sizeof(retry_msg)  &&  memcmp(&pkt[len - sizeof(retry_msg)], retry_msg, sizeof(retry_msg)) == 0)
+        retry_packets_sent++;
+    /*endif*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int retry_rx_delivery_handler(void *user_data, int channel, int seq_no, const uint8_t msg[], int len)
+{
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static span_timestamp_t retry_timer_handler(void *user_data, span_timestamp_t timeout)
+{
+    return retry_now;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void retry_status_handler(void *user_data, int status)
+{
+    printf("SPRT status event %d after %d sends\n", status, retry_packets_sent);
+    if (status == SPRT_STATUS_EXCESS_RETRIES)
+    {
+        retry_reports++;
+        retry_packets_at_report = retry_packets_sent;
+        if (retry_free_on_report)
+        {
+            /* The application is allowed to tear down the context in response to this */
+            sprt_free(retry_state);
+            retry_state = NULL;
+        }
+        /*endif*/
+    }
+    /*endif*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static int retry_tests(bool free_on_report)
+{
+    int max_tries;
+    int i;
+
+    printf("Retry test, %s the context when the retries run out\n", (free_on_report)  ?  "freeing"  :  "keeping");
+    retry_now = 1000000;
+    retry_packets_sent = 0;
+    retry_packets_at_report = 0;
+    retry_reports = 0;
+    retry_free_on_report = free_on_report;
+    if ((retry_state = sprt_init(NULL,
+                                 0,
+                                 120,
+                                 120,
+                                 NULL /* Use default params */,
+                                 retry_tx_packet_handler,
+                                 NULL,
+                                 retry_rx_delivery_handler,
+                                 NULL,
+                                 retry_timer_handler,
+                                 NULL,
+                                 retry_status_handler,
+                                 NULL)) == NULL)
+    {
+        fprintf(stderr, "    Cannot start SPRT\n");
+        return -1;
+    }
+    /*endif*/
+    max_tries = 3;
+    sprt_set_local_tc_max_tries(retry_state, SPRT_TCID_RELIABLE_SEQUENCED, max_tries);
+    if (sprt_tx(retry_state, SPRT_TCID_RELIABLE_SEQUENCED, retry_msg, sizeof(retry_msg)))
+    {
+        fprintf(stderr, "    Cannot send a message\n");
+        return -1;
+    }
+    /*endif*/
+    /* Nothing is ever acknowledged, so follow the timer until it stops, or the context is gone */
+    for (i = 0;  i < 100  &&  retry_state;  i++)
+    {
+        if ((retry_now = sprt_get_next_timeout(retry_state)) == 0)
+            break;
+        /*endif*/
+        sprt_timer_expired(retry_state, retry_now);
+    }
+    /*endfor*/
+    if (retry_state)
+    {
+        /* The keepalive timer keeps running, but the message must not be sent again */
+        if (retry_packets_sent != 1 + max_tries)
+        {
+            fprintf(stderr, "    The message was sent again after the retries ran out\n");
+            return -1;
+        }
+        /*endif*/
+        sprt_free(retry_state);
+        retry_state = NULL;
+    }
+    /*endif*/
+    /* The original send, and a retransmission for each try, with the last try sent before
+       the failure is reported */
+    if (retry_reports != 1  ||  retry_packets_at_report != 1 + max_tries)
+    {
+        fprintf(stderr, "    %d reports, after %d sends\n", retry_reports, retry_packets_at_report);
+        return -1;
+    }
+    /*endif*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int sprt_tests(bool calling_party)
 {
     int i;
@@ -473,6 +593,12 @@ int main(int argc, char *argv[])
     }
     /*endwhile*/
 
+    if (retry_tests(false))
+        exit(2);
+    /*endif*/
+    if (retry_tests(true))
+        exit(2);
+    /*endif*/
     if (sprt_tests(calling_party))
         exit(2);
     /*endif*/
@@ -71,6 +71,11 @@ static int msg_list_ptr2;
 static uint8_t concat[1000000];
 static int concat_len;
 
+static uint8_t ring[4][1024];
+static int ring_ptr;
+static const uint8_t *ring_last;
+static int ring_len;
+
 static int rx_missing_attack_handler(t38_core_state_t *s, void *user_data, int rx_seq_no, int expected_seq_no)
 {
     //printf("Hit missing\n");
@@ -149,6 +154,28 @@ static int tx_concat_packet_handler(t38_core_state_t *s, void *user_data, const
 }
 /*- End of function --------------------------------------------------------*/
 
+static uint8_t *tx_ring_buffer_handler(t38_core_state_t *s, void *user_data, int len)
+{
+    if (len > (int) sizeof(ring[0]))
+        return NULL;
+    /*endif*/
+    ring_last = ring[ring_ptr];
+    ring_ptr = (ring_ptr + 1) & 3;
+    return (uint8_t *) ring_last;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int tx_ring_packet_handler(t38_core_state_t *s, void *user_data, const uint8_t *buf, int len, int count)
+{
+    /* The packet should have been built in the buffer we supplied */
+    if (user_data  &&  buf != ring_last)
+        succeeded = false;
+    /*endif*/
+    ring_len = len;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int encode_decode_tests(t38_core_state_t *a, t38_core_state_t *b)
 {
     t38_data_field_t field[MAX_FIELDS];
@@ -493,6 +520,182 @@ static int encode_then_decode_tests(t38_core_state_t *a, t38_core_state_t *b)
 }
 /*- End of function --------------------------------------------------------*/
 
+static int buffer_tests(t38_core_state_t *s)
+{
+    static const int protocols[2] = {T38_TRANSPORT_UDPTL, T38_TRANSPORT_TCP_TPKT};
+    t38_data_field_t field[2];
+    uint8_t buf[1024];
+    int len;
+    int i;
+
+    for (i = 0;  i < 2;  i++)
+    {
+        if (t38_core_init(s,
+                          rx_indicator_attack_handler,
+                          rx_data_attack_handler,
+                          rx_missing_attack_handler,
+                          NULL,
+                          tx_ring_packet_handler,
+                          (void *) ring) == NULL)
+        {
+            fprintf(stderr, "Cannot start the T.38 core\n");
+            return -1;
+        }
+        /*endif*/
+        t38_set_t38_version(s, t38_version);
+        t38_set_data_transport_protocol(s, protocols[i]);
+        t38_set_tx_buffer_handler(s, tx_ring_buffer_handler, NULL);
+
+        field[0].field_type = T38_FIELD_T4_NON_ECM_DATA;
+        field[0].field = field_body[0];
+        field[0].field_len = 444;
+        field[1].field_type = T38_FIELD_T4_NON_ECM_SIG_END;
+        field[1].field = field_body[1];
+        field[1].field_len = 333;
+
+        /* The precomputed length must be exact */
+        if ((len = t38_core_encode_data(s, NULL, 0, T38_DATA_V17_14400, field, 2)) <= 0
+            ||
+            t38_core_encode_data(s, buf, len - 1, T38_DATA_V17_14400, field, 2) >= 0
+            ||
+            t38_core_encode_data(s, buf, len, T38_DATA_V17_14400, field, 2) != len)
+        {
+            printf("Data packet length precomputation failed\n");
+            return -1;
+        }
+        /*endif*/
+        /* The packet sent should match the one encoded */
+        ring_len = 0;
+        if (t38_core_send_data_multi_field(s, T38_DATA_V17_14400, field, 2, T38_PACKET_CATEGORY_IMAGE_DATA) < 0
+            ||
+            ring_len != len
+            ||
+            memcmp(ring_last, buf, len))
+        {
+            printf("Data packet not built in the supplied buffer\n");
+            return -1;
+        }
+        /*endif*/
+
+        if ((len = t38_core_encode_indicator(s, NULL, 0, T38_IND_CNG)) <= 0
+            ||
+            t38_core_encode_indicator(s, buf, len - 1, T38_IND_CNG) >= 0
+            ||
+            t38_core_encode_indicator(s, buf, len, T38_IND_CNG) != len)
+        {
+            printf("Indicator packet length precomputation failed\n");
+            return -1;
+        }
+        /*endif*/
+        ring_len = 0;
+        if (t38_core_send_indicator(s, T38_IND_CNG) < 0
+            ||
+            ring_len != len
+            ||
+            memcmp(ring_last, buf, len))
+        {
+            printf("Indicator packet not built in the supplied buffer\n");
+            return -1;
+        }
+        /*endif*/
+
+        /* A packet too big for the supplied buffer, or for the internal one, should be
+           refused rather than overrun the buffer */
+        field[0].field_len = 1500;
+        if (t38_core_send_data_multi_field(s, T38_DATA_V17_14400, field, 1, T38_PACKET_CATEGORY_IMAGE_DATA) >= 0)
+        {
+            printf("Oversized data packet accepted\n");
+            return -1;
+        }
+        /*endif*/
+        t38_set_tx_buffer_handler(s, NULL, NULL);
+        if (t38_core_send_data_multi_field(s, T38_DATA_V17_14400, field, 1, T38_PACKET_CATEGORY_IMAGE_DATA) >= 0)
+        {
+            printf("Oversized data packet accepted\n");
+            return -1;
+        }
+        /*endif*/
+    }
+    /*endfor*/
+    if (!succeeded)
+        return -1;
+    /*endif*/
+    printf("Buffer tests OK\n");
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int batch_tests(t38_core_state_t *s)
+{
+    static uint8_t pkt[40][16];
+    const uint8_t *bufs[80];
+    int lens[80];
+    uint16_t seq_nos[80];
+    t38_data_field_t field;
+    int pkt_len[40];
+    int n;
+    int i;
+    int j;
+
+    if (t38_core_init(s,
+                      rx_indicator_handler,
+                      rx_data_handler,
+                      rx_missing_handler,
+                      NULL,
+                      tx_packet_handler,
+                      NULL) == NULL)
+    {
+        fprintf(stderr, "Cannot start the T.38 core\n");
+        return -1;
+    }
+    /*endif*/
+    t38_set_t38_version(s, t38_version);
+    ok_data_packets = 0;
+    bad_data_packets = 0;
+    missing_packets = 0;
+    msg_list_ptr = 0;
+    msg_list_ptr2 = 0;
+    field.field_type = T38_FIELD_T4_NON_ECM_DATA;
+    field.field = field_body[0];
+    field.field_len = 4;
+    for (i = 0;  i < 40;  i++)
+    {
+        msg_list[msg_list_ptr++] = i%4;
+        msg_list[msg_list_ptr++] = T38_FIELD_T4_NON_ECM_DATA;
+        pkt_len[i] = t38_core_encode_data(s, pkt[i], sizeof(pkt[i]), i%4, &field, 1);
+    }
+    /*endfor*/
+    /* Deliver the packets in batches of 8, each batch in reverse order and with every
+       packet repeated, starting with sequence numbers just short of the rollover. */
+    for (i = 0;  i < 40;  i += 8)
+    {
+        n = 0;
+        for (j = i + 7;  j >= i;  j--)
+        {
+            bufs[n] = pkt[j];
+            lens[n] = pkt_len[j];
+            seq_nos[n++] = (uint16_t) (0xFFF0 + j);
+            bufs[n] = pkt[j];
+            lens[n] = pkt_len[j];
+            seq_nos[n++] = (uint16_t) (0xFFF0 + j);
+        }
+        /*endfor*/
+        if (t38_core_rx_ifp_packets(s, bufs, lens, seq_nos, n) != n)
+        {
+            printf("Batch of packets rejected\n");
+            return -1;
+        }
+        /*endif*/
+    }
+    /*endfor*/
+    printf("Batched data packets: OK = %d, bad = %d, missing = %d\n", ok_data_packets, bad_data_packets, missing_packets);
+    if (ok_data_packets != 40  ||  bad_data_packets != 0  ||  missing_packets != 0)
+        return -1;
+    /*endif*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int attack_tests(t38_core_state_t *s, int packets)
 {
     int i;
@@ -597,6 +800,22 @@ int main(int argc, char *argv[])
         }
         /*endif*/
 
+        /* Receive reordered and repeated packets in batches */
+        if (batch_tests(&t38_core_bx))
+        {
+            printf("Batch tests failed\n");
+            exit(2);
+        }
+        /*endif*/
+
+        /* Encode into buffers supplied by the application */
+        if (buffer_tests(&t38_core_ax))
+        {
+            printf("Buffer tests failed\n");
+            exit(2);
+        }
+        /*endif*/
+
         if ((t38_core_a = t38_core_init(&t38_core_ax,
                                         rx_indicator_attack_handler,
                                         rx_data_attack_handler,
@@ -45,7 +45,6 @@
 
 #include "spandsp.h"
 #include "spandsp-sim.h"
-#include "udptl.h"
 
 #include "fax_utils.h"
 #include "pcap_parse.h"
@@ -114,6 +114,216 @@ static int t85_comment_handler(void *user_data, const uint8_t buf[], size_t len)
 }
 /*- End of function --------------------------------------------------------*/
 
+static int colour_conversion_tests(void)
+{
+    lab_params_t lab;
+    uint8_t *in;
+    uint8_t *out_precise;
+    uint8_t *out_fast;
+    uint64_t start;
+    uint64_t precise_time;
+    uint64_t fast_time;
+    int pixels;
+    int mismatches;
+    int diff;
+    int max_diff;
+    int direction;
+    int i;
+
+    /* Compare the table driven and direct conversions between sRGB and ITU Lab, for
+       every value of R and G (or L and a) with every 4th value of B (or b). */
+    pixels = 256*256*64;
+    in = malloc(3*pixels);
+    out_precise = malloc(3*pixels);
+    out_fast = malloc(3*pixels);
+    if (in == NULL  ||  out_precise == NULL  ||  out_fast == NULL)
+        return -1;
+    /*endif*/
+    for (i = 0;  i < pixels;  i++)
+    {
+        in[3*i] = (i >> 14) & 0xFF;
+        in[3*i + 1] = (i >> 6) & 0xFF;
+        in[3*i + 2] = (i << 2) & 0xFF;
+    }
+    /*endfor*/
+    memset(&lab, 0, sizeof(lab));
+    set_lab_illuminant(&lab, 96.422f, 100.000f,  82.521f);
+    set_lab_gamut(&lab, 0, 100, -85, 85, -75, 125, false);
+    max_diff = 0;
+    for (direction = 0;  direction < 2;  direction++)
+    {
+        set_lab_precise_conversion(&lab, true);
+        start = rdtscll();
+        if (direction == 0)
+            srgb_to_lab(&lab, out_precise, in, pixels);
+        else
+            lab_to_srgb(&lab, out_precise, in, pixels);
+        /*endif*/
+        precise_time = rdtscll() - start;
+        set_lab_precise_conversion(&lab, false);
+        start = rdtscll();
+        if (direction == 0)
+            srgb_to_lab(&lab, out_fast, in, pixels);
+        else
+            lab_to_srgb(&lab, out_fast, in, pixels);
+        /*endif*/
+        fast_time = rdtscll() - start;
+        mismatches = 0;
+        for (i = 0;  i < 3*pixels;  i++)
+        {
+            diff = abs(out_precise[i] - out_fast[i]);
+            if (diff)
+            {
+                mismatches++;
+                if (diff > max_diff)
+                    max_diff = diff;
+                /*endif*/
+            }
+            /*endif*/
+        }
+        /*endfor*/
+        printf("%s - %d pixels, precise %" PRIu64 ", fast %" PRIu64 " (%.2f times faster), %d values differ\n",
+               (direction == 0)  ?  "sRGB to Lab"  :  "Lab to sRGB",
+               pixels,
+               precise_time,
+               fast_time,
+               (double) precise_time/(double) fast_time,
+               mismatches);
+    }
+    /*endfor*/
+    free(in);
+    free(out_precise);
+    free(out_fast);
+    /* The fast conversions may round slightly differently, but should never be further out */
+    if (max_diff > 1)
+    {
+        printf("The fast and precise conversions differ by up to %d\n", max_diff);
+        return -1;
+    }
+    /*endif*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+#define STRIP_TEST_WIDTH    200
+#define STRIP_TEST_LENGTH   50
+
+static uint8_t strip_test_image[3*STRIP_TEST_WIDTH*STRIP_TEST_LENGTH];
+static uint8_t strip_test_rows_out[3*STRIP_TEST_WIDTH*STRIP_TEST_LENGTH];
+static uint8_t strip_test_strips_out[3*STRIP_TEST_WIDTH*STRIP_TEST_LENGTH];
+static int strip_test_row;
+static int strip_test_rows_written;
+static int strip_test_strip_rows_written;
+static int strip_test_ends;
+static bool strip_test_written_after_end;
+
+static int strip_test_row_read_handler(void *user_data, uint8_t buf[], size_t len)
+{
+    if (strip_test_row >= STRIP_TEST_LENGTH)
+        return 0;
+    /*endif*/
+    memcpy(buf, &strip_test_image[strip_test_row*len], len);
+    strip_test_row++;
+    return len;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int strip_test_row_write_handler(void *user_data, const uint8_t buf[], size_t len)
+{
+    if (len == 0  ||  strip_test_rows_written >= STRIP_TEST_LENGTH)
+        return 0;
+    /*endif*/
+    memcpy(&strip_test_rows_out[strip_test_rows_written*len], buf, len);
+    strip_test_rows_written++;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int strip_test_strip_write_handler(void *user_data, const uint8_t buf[], size_t len, size_t stride, int rows)
+{
+    int i;
+
+    if (rows == 0)
+    {
+        strip_test_ends++;
+        return 0;
+    }
+    /*endif*/
+    if (strip_test_ends)
+        strip_test_written_after_end = true;
+    /*endif*/
+    for (i = 0;  i < rows  &&  strip_test_strip_rows_written < STRIP_TEST_LENGTH;  i++)
+        memcpy(&strip_test_strips_out[strip_test_strip_rows_written++*len], &buf[i*stride], len);
+    /*endfor*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int strip_tests(void)
+{
+    t42_encode_state_t *t42_enc;
+    t42_decode_state_t *t42_dec;
+    uint8_t *compressed;
+    int compressed_len;
+    int len;
+    int i;
+
+    /* Decode the same image a row at a time, and a strip at a time. The image length is
+       not a multiple of the strip size, so the last strip is a short one. */
+    printf("Decoding a strip of rows at a time\n");
+    for (i = 0;  i < 3*STRIP_TEST_WIDTH*STRIP_TEST_LENGTH;  i++)
+        strip_test_image[i] = (uint8_t) ((i*7) ^ (i/(3*STRIP_TEST_WIDTH)));
+    /*endfor*/
+    if ((compressed = malloc(1000000)) == NULL)
+        return -1;
+    /*endif*/
+    strip_test_row = 0;
+    t42_enc = t42_encode_init(NULL, STRIP_TEST_WIDTH, STRIP_TEST_LENGTH, strip_test_row_read_handler, NULL);
+    t42_encode_set_image_type(t42_enc, T4_IMAGE_TYPE_COLOUR_8BIT);
+    compressed_len = 0;
+    while ((len = t42_encode_get(t42_enc, &compressed[compressed_len], 1000000 - compressed_len)) > 0)
+        compressed_len += len;
+    /*endwhile*/
+    t42_encode_free(t42_enc);
+
+    strip_test_rows_written = 0;
+    t42_dec = t42_decode_init(NULL, strip_test_row_write_handler, NULL);
+    t42_decode_put(t42_dec, compressed, compressed_len);
+    t42_decode_put(t42_dec, NULL, 0);
+    t42_decode_free(t42_dec);
+
+    strip_test_strip_rows_written = 0;
+    strip_test_ends = 0;
+    strip_test_written_after_end = false;
+    t42_dec = t42_decode_init(NULL, strip_test_row_write_handler, NULL);
+    t42_decode_set_strip_write_handler(t42_dec, strip_test_strip_write_handler, NULL);
+    t42_decode_put(t42_dec, compressed, compressed_len);
+    t42_decode_put(t42_dec, NULL, 0);
+    t42_decode_free(t42_dec);
+    free(compressed);
+
+    if (strip_test_rows_written != STRIP_TEST_LENGTH  ||  strip_test_strip_rows_written != STRIP_TEST_LENGTH)
+    {
+        printf("Decoded %d rows singly, and %d in strips\n", strip_test_rows_written, strip_test_strip_rows_written);
+        return -1;
+    }
+    /*endif*/
+    if (memcmp(strip_test_rows_out, strip_test_strips_out, 3*STRIP_TEST_WIDTH*STRIP_TEST_LENGTH))
+    {
+        printf("The rows decoded in strips differ\n");
+        return -1;
+    }
+    /*endif*/
+    if (strip_test_ends != 1  ||  strip_test_written_after_end)
+    {
+        printf("The end of the image was reported %d times\n", strip_test_ends);
+        return -1;
+    }
+    /*endif*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 int main(int argc, char *argv[])
 {
     TIFF *tif;
@@ -165,6 +375,19 @@ int main(int argc, char *argv[])
     TIFF_FX_init();
 #endif
 
+    if (colour_conversion_tests())
+    {
+        printf("Tests failed\n");
+        return 1;
+    }
+    /*endif*/
+    if (strip_tests())
+    {
+        printf("Tests failed\n");
+        return 1;
+    }
+    /*endif*/
+
     /* The default luminant is D50 */
     set_lab_illuminant(&lab_param, 96.422f, 100.000f,  82.521f);
     set_lab_gamut(&lab_param, 0, 100, -85, 85, -75, 125, false);
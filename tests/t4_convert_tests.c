@@ -0,0 +1,248 @@
+/*
+ * SpanDSP - a series of DSP components for telephony
+ *
+ * t4_convert_tests.c - Tests for the multi-page FAX image file converter.
+ *
+ * Copyright (C) 2026 The SpanDSP contributors
+ *
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*! \file */
+
+/*! \page t4_convert_tests_page Multi-page FAX image conversion tests
+\section t4_convert_tests_page_sec_1 What does it do
+These tests convert a multi-page FAX image file to each of the bi-level compressions, using
+one thread and several threads, and check every page of the new files has exactly the same
+image as the original.
+*/
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "spandsp.h"
+
+#define IN_FILE_NAME    "../test-data/itu/fax/itutests.tif"
+#define OUT_FILE_NAME   "t4_convert_tests_receive.tif"
+#define T6_FILE_NAME    "t4_convert_tests_t6.tif"
+
+static int read_page(TIFF *tif, uint8_t **image, uint32_t *width, uint32_t *length)
+{
+    uint16_t photometric;
+    int bytes_per_row;
+    uint32_t row;
+    int i;
+
+    if (!TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, width)
+        ||
+        !TIFFGetField(tif, TIFFTAG_IMAGELENGTH, length))
+    {
+        return -1;
+    }
+    photometric = PHOTOMETRIC_MINISWHITE;
+    TIFFGetField(tif, TIFFTAG_PHOTOMETRIC, &photometric);
+    bytes_per_row = (*width + 7)/8;
+    if ((*image = malloc(bytes_per_row*(*length))) == NULL)
+        return -1;
+    for (row = 0;  row < *length;  row++)
+    {
+        if (TIFFReadScanline(tif, *image + row*bytes_per_row, row, 0) < 0)
+            return -1;
+    }
+    if (photometric != PHOTOMETRIC_MINISWHITE)
+    {
+        for (i = 0;  i < bytes_per_row*(*length);  i++)
+            (*image)[i] ^= 0xFF;
+    }
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int compare_files(const char *file_a, const char *file_b)
+{
+    TIFF *tif_a;
+    TIFF *tif_b;
+    uint8_t *image_a;
+    uint8_t *image_b;
+    uint32_t width_a;
+    uint32_t width_b;
+    uint32_t length_a;
+    uint32_t length_b;
+    int pages;
+    int bad;
+
+    if ((tif_a = TIFFOpen(file_a, "r")) == NULL)
+        return -1;
+    if ((tif_b = TIFFOpen(file_b, "r")) == NULL)
+    {
+        TIFFClose(tif_a);
+        return -1;
+    }
+    bad = 0;
+    pages = 0;
+    do
+    {
+        if (read_page(tif_a, &image_a, &width_a, &length_a)
+            ||
+            read_page(tif_b, &image_b, &width_b, &length_b))
+        {
+            printf("Page %d could not be read\n", pages);
+            bad++;
+            break;
+        }
+        if (width_a != width_b  ||  length_a != length_b)
+        {
+            printf("Page %d is %u x %u in %s, and %u x %u in %s\n", pages, width_a, length_a, file_a, width_b, length_b, file_b);
+            bad++;
+        }
+        else if (memcmp(image_a, image_b, length_a*((width_a + 7)/8)))
+        {
+            printf("Page %d has a different image in %s and %s\n", pages, file_a, file_b);
+            bad++;
+        }
+        free(image_a);
+        free(image_b);
+        pages++;
+    }
+    while (TIFFReadDirectory(tif_a)  &&  TIFFReadDirectory(tif_b));
+    if (TIFFReadDirectory(tif_a)  ||  TIFFReadDirectory(tif_b))
+    {
+        printf("The files have different numbers of pages\n");
+        bad++;
+    }
+    TIFFClose(tif_a);
+    TIFFClose(tif_b);
+    return (bad)  ?  -1  :  pages;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int convert(const char *in_file, const char *out_file, int compression, int threads, bool log)
+{
+    t4_convert_state_t *s;
+    logging_state_t *logging;
+    struct timespec start;
+    struct timespec end;
+    int pages;
+
+    if ((s = t4_convert_init(NULL, in_file, out_file, compression)) == NULL)
+    {
+        printf("Failed to init the converter\n");
+        return -1;
+    }
+    if (log)
+    {
+        logging = t4_convert_get_logging_state(s);
+        span_log_set_level(logging, SPAN_LOG_SHOW_SEVERITY | SPAN_LOG_SHOW_PROTOCOL | SPAN_LOG_FLOW);
+    }
+    t4_convert_set_threads(s, threads);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pages = t4_convert_run(s);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    t4_convert_free(s);
+    printf("%s to %s with %d thread(s) - %d pages in %.1fms\n",
+           in_file,
+           t4_compression_to_str(compression),
+           threads,
+           pages,
+           (end.tv_sec - start.tv_sec)*1000.0 + (end.tv_nsec - start.tv_nsec)/1000000.0);
+    return pages;
+}
+/*- End of function --------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+    static const int compressions[] =
+    {
+        T4_COMPRESSION_T4_1D,
+        T4_COMPRESSION_T4_2D,
+        T4_COMPRESSION_T6,
+        T4_COMPRESSION_T85,
+        T4_COMPRESSION_T85_L0,
+        -1
+    };
+    static const int thread_counts[] =
+    {
+        1,
+        4,
+        -1
+    };
+    const char *in_file_name;
+    const char *check_file;
+    bool log;
+    int opt;
+    int i;
+    int j;
+
+    in_file_name = IN_FILE_NAME;
+    log = false;
+    while ((opt = getopt(argc, argv, "i:l")) != -1)
+    {
+        switch (opt)
+        {
+        case 'i':
+            in_file_name = optarg;
+            break;
+        case 'l':
+            log = true;
+            break;
+        default:
+            //usage();
+            exit(2);
+            break;
+        }
+    }
+
+    for (i = 0;  compressions[i] >= 0;  i++)
+    {
+        for (j = 0;  thread_counts[j] >= 0;  j++)
+        {
+            unlink(OUT_FILE_NAME);
+            if (convert(in_file_name, OUT_FILE_NAME, compressions[i], thread_counts[j], log) <= 0)
+            {
+                printf("Tests failed\n");
+                exit(2);
+            }
+            check_file = OUT_FILE_NAME;
+            if (compressions[i] == T4_COMPRESSION_T85  ||  compressions[i] == T4_COMPRESSION_T85_L0)
+            {
+                /* libtiff cannot read T.85 images, so convert the file back to T.6 to check it */
+                unlink(T6_FILE_NAME);
+                if (convert(OUT_FILE_NAME, T6_FILE_NAME, T4_COMPRESSION_T6, thread_counts[j], log) <= 0)
+                {
+                    printf("Tests failed\n");
+                    exit(2);
+                }
+                check_file = T6_FILE_NAME;
+            }
+            if (compare_files(in_file_name, check_file) <= 0)
+            {
+                printf("Tests failed\n");
+                exit(2);
+            }
+        }
+    }
+    printf("Tests passed\n");
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+/*- End of file ------------------------------------------------------------*/
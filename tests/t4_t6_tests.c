@@ -50,6 +50,8 @@ in ITU specifications T.4 and T.6.
 t4_t6_encode_state_t *send_state;
 t4_t6_decode_state_t *receive_state;
 
+int strip_rows_written;
+
 /* The following are some test cases from T.4 */
 #define FILL_70      "                                                                      "
 #define FILL_80      "                                                                                "
@@ -93,6 +95,19 @@ static const char t4_t6_test_patterns[TEST_ROWS][XSIZE + 1] =
     /* Line end codes to V(0) H(7,0). */
 };
 
+/* Enough space for a count, plus every possible change of colour, in every row of the test image */
+#define MAX_RUN_ENTRIES     (TEST_ROWS*(XSIZE + 2))
+
+uint32_t run_store[MAX_RUN_ENTRIES];
+int run_store_len;
+int run_store_ptr;
+
+uint8_t damaged_run_row[XSIZE/8];
+int damaged_run_rows;
+int damaged_rows;
+int damaged_rows_lost;
+int damaged_row_mismatches;
+
 #if 0
 static void dump_image_as_xxx(const uint8_t buf[], int bytes_per_row, int len)
 {
@@ -196,6 +211,199 @@ static int row_write_handler(void *user_data, const uint8_t buf[], size_t len)
 }
 /*- End of function --------------------------------------------------------*/
 
+static int strip_read_handler(void *user_data, uint8_t buf[], size_t len, size_t stride, int max_rows)
+{
+    int rows;
+
+    for (rows = 0;  rows < max_rows;  rows++)
+    {
+        if (row_read_handler(user_data, &buf[rows*stride], len) == 0)
+            break;
+        /*endif*/
+    }
+    /*endfor*/
+    return rows;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int strip_write_handler(void *user_data, const uint8_t buf[], size_t len, size_t stride, int rows)
+{
+    int i;
+
+    for (i = 0;  i < rows;  i++)
+        row_write_handler(user_data, &buf[i*stride], len);
+    /*endfor*/
+    strip_rows_written += rows;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int run_write_handler(void *user_data, const uint32_t runs[], int steps)
+{
+    /* Keep the rows of runs, so they can be fed straight back into an encoder */
+    if (runs == NULL)
+        return 0;
+    /*endif*/
+    if (steps <= 0  ||  runs[steps - 1] != XSIZE)
+    {
+        printf("Bad run list for row - %d steps\n", steps);
+        exit(2);
+    }
+    /*endif*/
+    if (run_store_len + steps + 1 > MAX_RUN_ENTRIES)
+        return -1;
+    /*endif*/
+    run_store[run_store_len++] = steps;
+    memcpy(&run_store[run_store_len], runs, steps*sizeof(uint32_t));
+    run_store_len += steps;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int run_read_handler(void *user_data, uint32_t runs[], int max_steps)
+{
+    int steps;
+
+    if (run_store_ptr >= run_store_len)
+        return 0;
+    /*endif*/
+    steps = run_store[run_store_ptr++];
+    memcpy(runs, &run_store[run_store_ptr], steps*sizeof(uint32_t));
+    run_store_ptr += steps;
+    return steps;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void pattern_row(int row, uint8_t buf[], size_t len)
+{
+    const char *s;
+    int i;
+    int j;
+
+    s = t4_t6_test_patterns[row%TEST_ROWS];
+    memset(buf, 0, len);
+    for (i = 0;  i < len;  i++)
+    {
+        for (j = 0;  j < 8;  j++)
+        {
+            if (*s++ != ' ')
+                buf[i] |= (0x80 >> j);
+            /*endif*/
+        }
+        /*endfor*/
+    }
+    /*endfor*/
+}
+/*- End of function --------------------------------------------------------*/
+
+static int damaged_run_write_handler(void *user_data, const uint32_t runs[], int steps)
+{
+    int i;
+    uint32_t j;
+
+    /* Paint the row, so it can be compared with the same row from the row handler */
+    if (runs == NULL)
+        return 0;
+    /*endif*/
+    memset(damaged_run_row, 0, sizeof(damaged_run_row));
+    for (i = 1;  i < steps;  i += 2)
+    {
+        for (j = runs[i - 1];  j < runs[i];  j++)
+            damaged_run_row[j >> 3] |= (0x80 >> (j & 7));
+        /*endfor*/
+    }
+    /*endfor*/
+    damaged_run_rows++;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int damaged_row_write_handler(void *user_data, const uint8_t buf[], size_t len)
+{
+    uint8_t ref[XSIZE/8];
+
+    if (len == 0)
+        return 0;
+    /*endif*/
+    if (memcmp(buf, damaged_run_row, len))
+    {
+        printf("Row %d differs as runs and as a bitmap\n", damaged_rows);
+        damaged_row_mismatches++;
+    }
+    /*endif*/
+    pattern_row(damaged_rows, ref, len);
+    if (memcmp(buf, ref, len))
+        damaged_rows_lost++;
+    /*endif*/
+    damaged_rows++;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int test_damaged_rows(int compression)
+{
+    t4_t6_encode_state_t *send;
+    t4_t6_decode_state_t *receive;
+    uint8_t image[16384];
+    int image_len;
+    int len;
+
+    /* Check the bad row policy is the same for rows delivered as bitmaps, and as runs */
+    send = t4_t6_encode_init(NULL, compression, XSIZE, -1, row_read_handler, NULL);
+    image_len = 0;
+    while ((len = t4_t6_encode_get(send, &image[image_len], sizeof(image) - image_len)) > 0)
+        image_len += len;
+    /*endwhile*/
+    t4_t6_encode_free(send);
+    image[image_len/3] ^= 0x5A;
+    image[2*image_len/3] ^= 0x24;
+
+    receive = t4_t6_decode_init(NULL, compression, XSIZE, damaged_row_write_handler, NULL);
+    t4_t6_decode_set_run_write_handler(receive, damaged_run_write_handler, NULL);
+    damaged_rows = 0;
+    damaged_run_rows = 0;
+    damaged_rows_lost = 0;
+    damaged_row_mismatches = 0;
+    if (t4_t6_decode_put(receive, image, image_len) != T4_DECODE_OK)
+        t4_t6_decode_put(receive, NULL, 0);
+    /*endif*/
+    t4_t6_decode_free(receive);
+    printf("Damaged %s image - %d rows, %d damaged\n", t4_compression_to_str(compression), damaged_rows, damaged_rows_lost);
+    if (damaged_rows_lost == 0  ||  damaged_run_rows != damaged_rows  ||  damaged_row_mismatches)
+        return -1;
+    /*endif*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int transfer_page(t4_t6_encode_state_t *send, t4_t6_decode_state_t *receive)
+{
+    uint8_t chunk_buf[1024];
+    int end_marks;
+    int len;
+
+    end_marks = 0;
+    do
+    {
+        len = t4_t6_encode_get(send, chunk_buf, 123);
+        if (len == 0)
+        {
+            if (++end_marks > 50)
+            {
+                printf("Receiver missed the end of page mark\n");
+                return -1;
+            }
+            /*endif*/
+            chunk_buf[0] = 0xFF;
+            len = 1;
+        }
+        /*endif*/
+    }
+    while (t4_t6_decode_put(receive, chunk_buf, len) != T4_DECODE_OK);
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int detect_page_end(int bit, int page_ended)
 {
     static int consecutive_eols;
@@ -300,6 +508,8 @@ int main(int argc, char *argv[])
     int end_marks;
     int compression;
     int compression_step;
+    int i;
+    int j;
     int min_row_bits;
     int opt;
     int tests_failed;
@@ -463,6 +673,91 @@ int main(int argc, char *argv[])
     /*endfor*/
     t4_t6_encode_free(send_state);
     t4_t6_decode_free(receive_state);
+#endif
+#if 1
+    printf("Testing image_function->compress->decompress->runs->compress->decompress->image_function\n");
+    /* Transcode between each pair of compression schemes, without the image ever being turned into
+       a bitmap in the middle. */
+    for (i = 0;  compression_sequence[i] >= 0;  i++)
+    {
+        for (j = 0;  compression_sequence[j] >= 0;  j++)
+        {
+            printf("Transcoding %s to %s\n", t4_compression_to_str(compression_sequence[i]), t4_compression_to_str(compression_sequence[j]));
+            send_state = t4_t6_encode_init(NULL, compression_sequence[i], XSIZE, -1, row_read_handler, NULL);
+            t4_t6_encode_set_min_bits_per_row(send_state, min_row_bits);
+            receive_state = t4_t6_decode_init(NULL, compression_sequence[i], XSIZE, NULL, NULL);
+            t4_t6_decode_set_run_write_handler(receive_state, run_write_handler, NULL);
+            run_store_len = 0;
+            if (transfer_page(send_state, receive_state))
+                tests_failed++;
+            /*endif*/
+            if (t4_t6_decode_get_image_length(receive_state) != TEST_ROWS)
+            {
+                printf("Decoded %d rows, rather than %d\n", t4_t6_decode_get_image_length(receive_state), TEST_ROWS);
+                tests_failed++;
+            }
+            /*endif*/
+            t4_t6_encode_free(send_state);
+            t4_t6_decode_free(receive_state);
+
+            send_state = t4_t6_encode_init(NULL, compression_sequence[j], XSIZE, -1, NULL, NULL);
+            t4_t6_encode_set_run_read_handler(send_state, run_read_handler, NULL);
+            t4_t6_encode_set_min_bits_per_row(send_state, min_row_bits);
+            receive_state = t4_t6_decode_init(NULL, compression_sequence[j], XSIZE, row_write_handler, NULL);
+            run_store_ptr = 0;
+            if (transfer_page(send_state, receive_state))
+                tests_failed++;
+            /*endif*/
+            if (t4_t6_decode_get_image_length(receive_state) != TEST_ROWS)
+            {
+                printf("Decoded %d rows, rather than %d\n", t4_t6_decode_get_image_length(receive_state), TEST_ROWS);
+                tests_failed++;
+            }
+            /*endif*/
+            t4_t6_encode_free(send_state);
+            t4_t6_decode_free(receive_state);
+        }
+        /*endfor*/
+    }
+    /*endfor*/
+#endif
+#if 1
+    printf("Testing image_function->compress->decompress->image_function, a strip of rows at a time\n");
+    for (i = 0;  compression_sequence[i] >= 0;  i++)
+    {
+        printf("Strips through %s\n", t4_compression_to_str(compression_sequence[i]));
+        send_state = t4_t6_encode_init(NULL, compression_sequence[i], XSIZE, -1, NULL, NULL);
+        t4_t6_encode_set_strip_read_handler(send_state, strip_read_handler, NULL);
+        t4_t6_encode_set_min_bits_per_row(send_state, min_row_bits);
+        receive_state = t4_t6_decode_init(NULL, compression_sequence[i], XSIZE, NULL, NULL);
+        t4_t6_decode_set_strip_write_handler(receive_state, strip_write_handler, NULL);
+        strip_rows_written = 0;
+        if (transfer_page(send_state, receive_state))
+            tests_failed++;
+        /*endif*/
+        if (strip_rows_written != TEST_ROWS  ||  t4_t6_decode_get_image_length(receive_state) != TEST_ROWS)
+        {
+            printf("Decoded %d rows, rather than %d\n", strip_rows_written, TEST_ROWS);
+            tests_failed++;
+        }
+        /*endif*/
+        t4_t6_encode_free(send_state);
+        t4_t6_decode_free(receive_state);
+    }
+    /*endfor*/
+#endif
+#if 1
+    printf("Testing damaged images decode the same as rows and as runs\n");
+    for (i = 0;  compression_sequence[i] >= 0;  i++)
+    {
+        if (compression_sequence[i] != T4_COMPRESSION_T6  &&  test_damaged_rows(compression_sequence[i]))
+        {
+            printf("Damaged rows differ as runs and as a bitmap\n");
+            tests_failed++;
+        }
+        /*endif*/
+    }
+    /*endfor*/
 #endif
     if (tests_failed > 0)
     {
@@ -101,6 +101,358 @@ static void display_page_stats(t4_rx_state_t *s)
 }
 /*- End of function --------------------------------------------------------*/
 
+static bool refuse_some_writes = true;
+
+static int tiff_write_handler(void *user_data, const uint8_t buf[], size_t len, size_t offset)
+{
+    static int calls = 0;
+    FILE *file;
+
+    /* Turn away every third offer, to check that deferred data is offered again */
+    if (refuse_some_writes  &&  (++calls % 3) == 0)
+        return -1;
+    /*endif*/
+    file = (FILE *) user_data;
+    if (fseek(file, offset, SEEK_SET) < 0  ||  fwrite(buf, 1, len, file) != len)
+        return -1;
+    /*endif*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+typedef struct
+{
+    int compression;
+    int image_width;
+    int image_length;
+    int resolution_code;
+    uint8_t *buf;
+    int len;
+} pre_encoded_page_t;
+
+static pre_encoded_page_t pre_encoded_pages[3];
+
+static int pre_encoded_page_handler(void *user_data,
+                                    int page,
+                                    int *compression,
+                                    int *image_width,
+                                    int *image_length,
+                                    int *resolution_code,
+                                    const uint8_t **buf,
+                                    size_t *len)
+{
+    pre_encoded_page_t *pages;
+
+    if (page < 0  ||  page >= 3)
+        return -1;
+    /*endif*/
+    pages = (pre_encoded_page_t *) user_data;
+    *compression = pages[page].compression;
+    *image_width = pages[page].image_width;
+    *image_length = pages[page].image_length;
+    *resolution_code = pages[page].resolution_code;
+    *buf = pages[page].buf;
+    *len = pages[page].len;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int encode_first_page(const char *in_file_name, int compression, pre_encoded_page_t *page)
+{
+    t4_tx_state_t *state;
+    t4_stats_t stats;
+    int len;
+
+    if ((state = t4_tx_init(NULL, in_file_name, 0, 0)) == NULL)
+        return -1;
+    /*endif*/
+    t4_tx_set_min_bits_per_row(state, 0);
+    if (t4_tx_set_tx_image_format(state,
+                                  compression,
+                                  T4_SUPPORT_WIDTH_215MM | T4_SUPPORT_LENGTH_UNLIMITED,
+                                  T4_RESOLUTION_R8_STANDARD | T4_RESOLUTION_R8_FINE | T4_RESOLUTION_R8_SUPERFINE,
+                                  0) < 0
+        ||
+        t4_tx_start_page(state))
+    {
+        t4_tx_free(state);
+        return -1;
+    }
+    /*endif*/
+    page->buf = malloc(1000000);
+    page->len = 0;
+    while ((len = t4_tx_get(state, &page->buf[page->len], 1000000 - page->len)) > 0)
+        page->len += len;
+    /*endwhile*/
+    t4_tx_get_transfer_statistics(state, &stats);
+    page->compression = compression;
+    page->image_width = t4_tx_get_tx_image_width(state);
+    page->image_length = stats.length;
+    page->resolution_code = t4_tx_get_tx_resolution(state);
+    t4_tx_free(state);
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int send_pre_encoded_page(t4_tx_state_t *state, const pre_encoded_page_t *page)
+{
+    uint8_t buf[1000];
+    int len;
+    int total;
+
+    /* The page should come out exactly as it went in */
+    if (t4_tx_start_page(state))
+        return -1;
+    /*endif*/
+    total = 0;
+    while ((len = t4_tx_get(state, buf, sizeof(buf))) > 0)
+    {
+        if (total + len > page->len  ||  memcmp(buf, &page->buf[total], len))
+            return -1;
+        /*endif*/
+        total += len;
+    }
+    /*endwhile*/
+    return (total == page->len)  ?  0  :  -1;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int test_pre_encoded_pages(const char *in_file_name)
+{
+    t4_tx_state_t *state;
+    int res;
+    int i;
+
+    printf("Testing pre-encoded pages\n");
+    if (encode_first_page(in_file_name, T4_COMPRESSION_T6, &pre_encoded_pages[0])
+        ||
+        encode_first_page(in_file_name, T4_COMPRESSION_T4_2D, &pre_encoded_pages[2]))
+    {
+        printf("Failed to encode '%s'\n", in_file_name);
+        return -1;
+    }
+    /*endif*/
+    pre_encoded_pages[1] = pre_encoded_pages[0];
+
+    /* A single page, supplied directly, can only be sent in exactly its own format */
+    state = t4_tx_init(NULL, NULL, -1, -1);
+    if (t4_tx_set_pre_encoded_page(state,
+                                   pre_encoded_pages[0].compression,
+                                   pre_encoded_pages[0].image_width,
+                                   pre_encoded_pages[0].image_length,
+                                   pre_encoded_pages[0].resolution_code,
+                                   pre_encoded_pages[0].buf,
+                                   pre_encoded_pages[0].len))
+    {
+        printf("Pre-encoded page refused\n");
+        return -1;
+    }
+    /*endif*/
+    if ((res = t4_tx_set_tx_image_format(state,
+                                         T4_COMPRESSION_T4_2D,
+                                         T4_SUPPORT_WIDTH_215MM | T4_SUPPORT_LENGTH_UNLIMITED,
+                                         -1,
+                                         0)) != T4_IMAGE_FORMAT_INCOMPATIBLE)
+    {
+        printf("Pre-encoded page accepted with the wrong compression - %d\n", res);
+        return -1;
+    }
+    /*endif*/
+    /* Every resolution but the page's own is offered, so the nearest would be the other form
+       of a metric/inch resolution pair, or a squashed one */
+    if ((res = t4_tx_set_tx_image_format(state,
+                                         T4_COMPRESSION_T6,
+                                         T4_SUPPORT_WIDTH_215MM | T4_SUPPORT_LENGTH_UNLIMITED,
+                                         ~pre_encoded_pages[0].resolution_code,
+                                         0)) != T4_IMAGE_FORMAT_NORESSUPPORT)
+    {
+        printf("Pre-encoded page accepted with the wrong resolution - %d\n", res);
+        return -1;
+    }
+    /*endif*/
+    if ((res = t4_tx_set_tx_image_format(state,
+                                         T4_COMPRESSION_T4_2D | T4_COMPRESSION_T6,
+                                         T4_SUPPORT_WIDTH_215MM | T4_SUPPORT_LENGTH_UNLIMITED,
+                                         -1,
+                                         0)) != T4_IMAGE_FORMAT_OK)
+    {
+        printf("Pre-encoded page refused - %d\n", res);
+        return -1;
+    }
+    /*endif*/
+    if (t4_tx_get_tx_compression(state) != T4_COMPRESSION_T6
+        ||
+        send_pre_encoded_page(state, &pre_encoded_pages[0]))
+    {
+        printf("Pre-encoded page not sent as it is\n");
+        return -1;
+    }
+    /*endif*/
+    t4_tx_end_page(state);
+    if (t4_tx_next_page_has_different_format(state) != -1)
+    {
+        printf("Pre-encoded page found after the last one\n");
+        return -1;
+    }
+    /*endif*/
+    t4_tx_free(state);
+
+    /* A document supplied a page at a time. The first two pages share a format, and the third
+       has a different compression, so it should need a new document. */
+    state = t4_tx_init(NULL, NULL, -1, -1);
+    t4_tx_set_pre_encoded_page_handler(state, pre_encoded_page_handler, pre_encoded_pages);
+    if (t4_tx_set_tx_image_format(state,
+                                  T4_COMPRESSION_T4_2D | T4_COMPRESSION_T6,
+                                  T4_SUPPORT_WIDTH_215MM | T4_SUPPORT_LENGTH_UNLIMITED,
+                                  -1,
+                                  0) != T4_IMAGE_FORMAT_OK)
+    {
+        printf("Pre-encoded document refused\n");
+        return -1;
+    }
+    /*endif*/
+    for (i = 0;  i < 2;  i++)
+    {
+        if (send_pre_encoded_page(state, &pre_encoded_pages[i]))
+        {
+            printf("Pre-encoded page %d not sent as it is\n", i);
+            return -1;
+        }
+        /*endif*/
+        if (t4_tx_next_page_has_different_format(state) != i)
+        {
+            printf("Pre-encoded page %d followed by the wrong format\n", i);
+            return -1;
+        }
+        /*endif*/
+        t4_tx_end_page(state);
+    }
+    /*endfor*/
+    t4_tx_free(state);
+    state = t4_tx_init(NULL, NULL, 2, -1);
+    t4_tx_set_pre_encoded_page_handler(state, pre_encoded_page_handler, pre_encoded_pages);
+    if (t4_tx_set_tx_image_format(state,
+                                  T4_COMPRESSION_T4_2D | T4_COMPRESSION_T6,
+                                  T4_SUPPORT_WIDTH_215MM | T4_SUPPORT_LENGTH_UNLIMITED,
+                                  -1,
+                                  0) != T4_IMAGE_FORMAT_OK
+        ||
+        t4_tx_get_tx_compression(state) != T4_COMPRESSION_T4_2D
+        ||
+        send_pre_encoded_page(state, &pre_encoded_pages[2])
+        ||
+        t4_tx_next_page_has_different_format(state) != -1)
+    {
+        printf("Last pre-encoded page not sent as it is\n");
+        return -1;
+    }
+    /*endif*/
+    t4_tx_free(state);
+    free(pre_encoded_pages[0].buf);
+    free(pre_encoded_pages[2].buf);
+    printf("Pre-encoded pages OK\n");
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int refuse_all_writes_handler(void *user_data, const uint8_t buf[], size_t len, size_t offset)
+{
+    return -1;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int accept_all_writes_handler(void *user_data, const uint8_t buf[], size_t len, size_t offset)
+{
+    *((size_t *) user_data) += len;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int receive_first_page(t4_rx_state_t *rx, const char *in_file_name)
+{
+    t4_tx_state_t *tx;
+    uint8_t buf[1000];
+    int len;
+
+    if ((tx = t4_tx_init(NULL, in_file_name, 0, 0)) == NULL)
+        return -1;
+    /*endif*/
+    if (t4_tx_set_tx_image_format(tx,
+                                  T4_COMPRESSION_T4_2D,
+                                  T4_SUPPORT_WIDTH_215MM | T4_SUPPORT_LENGTH_UNLIMITED,
+                                  -1,
+                                  0) < 0
+        ||
+        t4_tx_start_page(tx))
+    {
+        t4_tx_free(tx);
+        return -1;
+    }
+    /*endif*/
+    t4_rx_set_rx_encoding(rx, T4_COMPRESSION_T4_2D);
+    t4_rx_set_x_resolution(rx, t4_tx_get_tx_x_resolution(tx));
+    t4_rx_set_y_resolution(rx, t4_tx_get_tx_y_resolution(tx));
+    t4_rx_set_image_width(rx, t4_tx_get_tx_image_width(tx));
+    t4_rx_start_page(rx);
+    while ((len = t4_tx_get(tx, buf, sizeof(buf))) > 0)
+        t4_rx_put(rx, buf, len);
+    /*endwhile*/
+    t4_tx_free(tx);
+    return t4_rx_end_page(rx);
+}
+/*- End of function --------------------------------------------------------*/
+
+static int test_memory_output_failures(const char *in_file_name)
+{
+    t4_rx_state_t *rx;
+    uint8_t *image;
+    size_t image_len;
+    size_t accepted;
+
+    printf("Testing failures of output to memory\n");
+    /* A document which outgrows the memory limit is incomplete */
+    rx = t4_rx_init_to_memory(NULL, T4_COMPRESSION_T4_2D);
+    t4_rx_set_memory_limit(rx, 1000);
+    receive_first_page(rx, in_file_name);
+    if (t4_rx_get_memory_image(rx, &image, &image_len) == 0)
+    {
+        printf("Image larger than the memory limit reported as complete\n");
+        return -1;
+    }
+    /*endif*/
+    t4_rx_free(rx);
+
+    /* A document whose end is refused by the TIFF write handler is incomplete */
+    rx = t4_rx_init_to_memory(NULL, T4_COMPRESSION_T4_2D);
+    t4_rx_set_tiff_write_handler(rx, refuse_all_writes_handler, NULL);
+    if (receive_first_page(rx, in_file_name))
+    {
+        printf("Failed to receive a page\n");
+        return -1;
+    }
+    /*endif*/
+    if (t4_rx_free(rx) == 0)
+    {
+        printf("Refused end of file reported as complete\n");
+        return -1;
+    }
+    /*endif*/
+
+    /* ...and one whose end is accepted is complete */
+    rx = t4_rx_init_to_memory(NULL, T4_COMPRESSION_T4_2D);
+    accepted = 0;
+    t4_rx_set_tiff_write_handler(rx, accept_all_writes_handler, &accepted);
+    if (receive_first_page(rx, in_file_name)  ||  t4_rx_free(rx)  ||  accepted == 0)
+    {
+        printf("Accepted end of file reported as incomplete\n");
+        return -1;
+    }
+    /*endif*/
+    printf("Failures of output to memory OK\n");
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int detect_non_ecm_page_end(int bit, int page_ended)
 {
     static int consecutive_eols;
@@ -242,6 +594,12 @@ int main(int argc, char *argv[])
     bool add_page_headers;
     bool overlay_page_headers;
     bool dump_as_xxx;
+    bool use_memory;
+    t4_tx_page_index_t *page_index;
+    uint8_t *image;
+    uint8_t *streamed_image;
+    size_t image_len;
+    FILE *out_file;
     unsigned int last_pkt_no;
     unsigned int pkt_no;
     int page_ended;
@@ -264,7 +622,10 @@ int main(int argc, char *argv[])
     block_size = 1;
     bit_error_rate = 0;
     dump_as_xxx = false;
-    while ((opt = getopt(argc, argv, "b:c:d:ehHrR:i:m:t:xX:Y:")) != -1)
+    use_memory = false;
+    page_index = NULL;
+    image = NULL;
+    while ((opt = getopt(argc, argv, "b:c:d:ehHMrR:i:m:t:xX:Y:")) != -1)
     {
         switch (opt)
         {
@@ -367,6 +728,9 @@ int main(int argc, char *argv[])
         case 'm':
             min_row_bits = atoi(optarg);
             break;
+        case 'M':
+            use_memory = true;
+            break;
         case 't':
             page_header_tz = optarg;
             break;
@@ -528,10 +892,50 @@ int main(int argc, char *argv[])
     }
     else
     {
+        if (test_pre_encoded_pages(in_file_name)  ||  test_memory_output_failures(in_file_name))
+        {
+            printf("Tests failed\n");
+            exit(2);
+        }
+        /*endif*/
 #if 1
         printf("Testing TIFF->compress->decompress->TIFF cycle\n");
-        /* Send end gets TIFF from a file */
-        if ((send_state = t4_tx_init(NULL, in_file_name, -1, -1)) == NULL)
+        if (use_memory)
+        {
+            /* Send end gets TIFF from a copy of the file held in memory */
+            if ((file = fopen(in_file_name, "rb")) == NULL)
+            {
+                printf("Failed to open '%s'\n", in_file_name);
+                exit(2);
+            }
+            /*endif*/
+            fseek(file, 0, SEEK_END);
+            image_len = ftell(file);
+            fseek(file, 0, SEEK_SET);
+            if ((image = malloc(image_len)) == NULL  ||  fread(image, 1, image_len, file) != image_len)
+            {
+                printf("Failed to read '%s'\n", in_file_name);
+                exit(2);
+            }
+            /*endif*/
+            fclose(file);
+            send_state = t4_tx_init_from_memory(NULL, image, image_len, -1, -1);
+        }
+        else
+        {
+            /* Send end gets TIFF from a file, with its pages indexed separately, as they
+               would be for a file sent many times */
+            if ((page_index = t4_tx_page_index_init(NULL, in_file_name)) == NULL)
+            {
+                printf("Failed to index '%s'\n", in_file_name);
+                exit(2);
+            }
+            /*endif*/
+            printf("'%s' has %d pages\n", in_file_name, t4_tx_page_index_get_pages(page_index));
+            send_state = t4_tx_init_with_page_index(NULL, in_file_name, page_index, -1, -1);
+        }
+        /*endif*/
+        if (send_state == NULL)
         {
             printf("Failed to init T.4 send\n");
             exit(2);
@@ -541,13 +945,31 @@ int main(int argc, char *argv[])
         t4_tx_set_min_bits_per_row(send_state, min_row_bits);
         t4_tx_set_local_ident(send_state, "111 2222 3333");
 
-        /* Receive end puts TIFF to a new file. */
-        if ((receive_state = t4_rx_init(NULL, OUT_FILE_NAME, T4_COMPRESSION_T4_2D)) == NULL)
+        /* Receive end puts TIFF to a new file, or to memory. */
+        out_file = NULL;
+        if (use_memory)
+            receive_state = t4_rx_init_to_memory(NULL, T4_COMPRESSION_T4_2D);
+        else
+            receive_state = t4_rx_init(NULL, OUT_FILE_NAME, T4_COMPRESSION_T4_2D);
+        /*endif*/
+        if (receive_state == NULL)
         {
             printf("Failed to init T.4 rx for '%s'\n", OUT_FILE_NAME);
             exit(2);
         }
         /*endif*/
+        if (use_memory)
+        {
+            /* Stream the file out a page at a time, as it is received */
+            if ((out_file = fopen(OUT_FILE_NAME, "wb+")) == NULL)
+            {
+                printf("Failed to open '%s'\n", OUT_FILE_NAME);
+                exit(2);
+            }
+            /*endif*/
+            t4_rx_set_tiff_write_handler(receive_state, tiff_write_handler, out_file);
+        }
+        /*endif*/
         span_log_set_level(t4_rx_get_logging_state(receive_state), SPAN_LOG_SHOW_SEVERITY | SPAN_LOG_SHOW_PROTOCOL | SPAN_LOG_SHOW_TAG | SPAN_LOG_FLOW);
 
         /* Now send and receive all the pages in the source TIFF file */
@@ -716,6 +1138,45 @@ int main(int argc, char *argv[])
         }
         /*endfor*/
         t4_tx_free(send_state);
+        if (page_index)
+            t4_tx_page_index_free(page_index);
+        /*endif*/
+        if (use_memory)
+        {
+            free(image);
+            /* The streamed file should match the complete image in memory. The end of the
+               file must be accepted when it is offered. */
+            refuse_some_writes = false;
+            if (t4_rx_get_memory_image(receive_state, &image, &image_len))
+            {
+                printf("Failed to get the received image\n");
+                exit(2);
+            }
+            /*endif*/
+            fflush(out_file);
+            fseek(out_file, 0, SEEK_END);
+            if ((size_t) ftell(out_file) != image_len)
+            {
+                printf("Streamed file is %ld bytes. It should be %lu bytes\n", ftell(out_file), (unsigned long int) image_len);
+                tests_failed++;
+            }
+            else
+            {
+                streamed_image = malloc(image_len);
+                fseek(out_file, 0, SEEK_SET);
+                if (fread(streamed_image, 1, image_len, out_file) != image_len  ||  memcmp(streamed_image, image, image_len))
+                {
+                    printf("Streamed file does not match the image in memory\n");
+                    tests_failed++;
+                }
+                /*endif*/
+                free(streamed_image);
+            }
+            /*endif*/
+            fclose(out_file);
+            span_free(image);
+        }
+        /*endif*/
         t4_rx_free(receive_state);
         /* And we should now have a matching received TIFF file. Note this will only match
            at the image level. TIFF files allow a lot of ways to express the same thing,
@@ -93,6 +93,32 @@ static int row_write_handler(void *user_data, const uint8_t buf[], size_t len)
 }
 /*- End of function --------------------------------------------------------*/
 
+static int strip_read_handler(void *user_data, uint8_t buf[], size_t len, size_t stride, int max_rows)
+{
+    int rows;
+
+    for (rows = 0;  rows < max_rows;  rows++)
+    {
+        if (row_read_handler(user_data, &buf[rows*stride], len) <= 0)
+            break;
+        /*endif*/
+    }
+    /*endfor*/
+    return rows;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int strip_write_handler(void *user_data, const uint8_t buf[], size_t len, size_t stride, int rows)
+{
+    int i;
+
+    for (i = 0;  i < rows;  i++)
+        row_write_handler(user_data, &buf[i*stride], len);
+    /*endfor*/
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
 static int comment_handler(void *user_data, const uint8_t buf[], size_t len)
 {
     if (buf)
@@ -200,6 +226,7 @@ static int test_cycle(const char *test_id,
     size_t cnt_a;
     size_t cnt_b;
     uint8_t *decoded_image;
+    uint8_t chunk[100];
 
     printf("%s: TPBON=%d, LRLTWO=%d, Mx=%d, L0=%" PRIu32 "\n",
            test_id,
@@ -351,6 +378,88 @@ static int test_cycle(const char *test_id,
     t85_decode_free(t85_dec);
     printf("Test passed\n");
 
+    printf("%s.4: Encode and decode a strip of rows at a time\n", test_id);
+    if ((optionsx & T85_VLENGTH))
+    {
+        t85_enc = t85_encode_init(NULL, width, height + 10, NULL, NULL);
+        clip_to_row = height;
+    }
+    else
+    {
+        t85_enc = t85_encode_init(NULL, width, height, NULL, NULL);
+        clip_to_row = 0;
+    }
+    /*endif*/
+    t85_encode_set_strip_read_handler(t85_enc, strip_read_handler, NULL);
+    read_row = 0;
+    t85_encode_set_options(t85_enc, l0, mx, options);
+    if (comment)
+        t85_encode_comment(t85_enc, comment, strlen((const char *) comment) + 1);
+    /*endif*/
+    /* The BIE must be exactly the same as the one produced row by row */
+    l = 0;
+    while ((len = t85_encode_get(t85_enc, chunk, sizeof(chunk))) > 0)
+    {
+        if (l + len > testbuf_len  ||  memcmp(chunk, &testbuf[l], len))
+        {
+            printf("BIE mismatch near byte %ld\n", l);
+            printf("Test failed\n");
+            exit(2);
+        }
+        /*endif*/
+        l += len;
+        if (comment  &&  l == 1000)
+            t85_encode_comment(t85_enc, comment, strlen((const char *) comment) + 1);
+        /*endif*/
+    }
+    /*endwhile*/
+    t85_encode_free(t85_enc);
+    if (l != testbuf_len)
+    {
+        printf("BIE has %ld bytes, rather than %lu\n", l, (unsigned long int) testbuf_len);
+        printf("Test failed\n");
+        exit(2);
+    }
+    /*endif*/
+    if ((decoded_image = (uint8_t *) malloc(image_size)) == NULL)
+    {
+        fprintf(stderr, "Out of memory!\n");
+        exit(2);
+    }
+    /*endif*/
+    t85_dec = t85_decode_init(NULL, NULL, NULL);
+    t85_decode_set_strip_write_handler(t85_dec, strip_write_handler, decoded_image);
+    write_row = 0;
+    result = T4_DECODE_MORE_DATA;
+    for (l = 0;  l < testbuf_len;  l += 100)
+    {
+        result = t85_decode_put(t85_dec, &testbuf[l], (testbuf_len - l < 100)  ?  (testbuf_len - l)  :  100);
+        if (result != T4_DECODE_MORE_DATA)
+            break;
+        /*endif*/
+    }
+    /*endfor*/
+    if (result == T4_DECODE_MORE_DATA)
+        result = t85_decode_put(t85_dec, NULL, 0);
+    /*endif*/
+    if (result != T4_DECODE_OK  ||  write_row != height)
+    {
+        printf("Decode result %d. %d lines decoded.\n", result, write_row);
+        printf("Test failed\n");
+        exit(2);
+    }
+    /*endif*/
+    if (memcmp(decoded_image, image, image_size))
+    {
+        printf("Image mismatch\n");
+        printf("Test failed\n");
+        exit(2);
+    }
+    /*endif*/
+    free(decoded_image);
+    t85_decode_free(t85_dec);
+    printf("Test passed\n");
+
     return 0;
 }
 /*- End of function --------------------------------------------------------*/
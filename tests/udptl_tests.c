@@ -0,0 +1,303 @@
+/*
+ * SpanDSP - a series of DSP components for telephony
+ *
+ * udptl_tests.c - Tests for the UDPTL packet handling module.
+ *
+ * Copyright (C) 2026 The SpanDSP contributors
+ *
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*! \file */
+
+/*! \page udptl_tests_page UDPTL tests
+\section udptl_tests_page_sec_1 What does it do?
+These tests pass a stream of IFP packets through a pair of UDPTL contexts, losing some of
+the UDPTL packets on the way, and check the IFP packets which come out. This is done for
+each error recovery scheme, and with the packets handled one at a time and in batches.
+*/
+
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "spandsp.h"
+
+#define PACKETS         1000
+#define BATCH_SIZE      8
+#define MAX_FAR_DATAGRAM    (4*UDPTL_MAX_DATAGRAM)
+
+static uint8_t sent[PACKETS][UDPTL_MAX_DATAGRAM];
+static int sent_len[PACKETS];
+static int received[PACKETS];
+static int bad_packets;
+
+static int rx_packet_handler(void *user_data, const uint8_t msg[], int len, int seq_no)
+{
+    bool padding_allowed;
+    int i;
+
+    /* A packet repaired by FEC comes back zero padded to the length of the longest packet
+       it was protected with. */
+    padding_allowed = (user_data != NULL);
+    if (seq_no < 0
+        ||
+        seq_no >= PACKETS
+        ||
+        len < sent_len[seq_no]
+        ||
+        (len > sent_len[seq_no]  &&  !padding_allowed)
+        ||
+        memcmp(msg, sent[seq_no], sent_len[seq_no]))
+    {
+        printf("Packet %d, len %d is not what was sent\n", seq_no, len);
+        bad_packets++;
+        return -1;
+    }
+    /*endif*/
+    for (i = sent_len[seq_no];  i < len;  i++)
+    {
+        if (msg[i])
+        {
+            printf("Packet %d, len %d is not correctly padded\n", seq_no, len);
+            bad_packets++;
+            return -1;
+        }
+        /*endif*/
+    }
+    /*endfor*/
+    received[seq_no]++;
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int tx_packet_handler(void *user_data, const uint8_t msg[], int len, int seq_no)
+{
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int test_stream(const char *name, int ec_scheme, int span, int entries, int far_max, int loss_period, int loss_burst, bool batch)
+{
+    udptl_state_t *tx;
+    udptl_state_t *rx;
+    uint8_t pkts[BATCH_SIZE][MAX_FAR_DATAGRAM];
+    const uint8_t *bufs[BATCH_SIZE];
+    int lens[BATCH_SIZE];
+    int batched;
+    int lost;
+    int missing;
+    int len;
+    int max_len;
+    int i;
+    int j;
+
+    tx = udptl_init(NULL, ec_scheme, span, entries, tx_packet_handler, NULL);
+    rx = udptl_init(NULL, ec_scheme, span, entries, rx_packet_handler, (ec_scheme == UDPTL_ERROR_CORRECTION_FEC)  ?  (void *) rx_packet_handler  :  NULL);
+    if (tx == NULL  ||  rx == NULL)
+    {
+        printf("Failed to init UDPTL\n");
+        return -1;
+    }
+    /*endif*/
+    udptl_set_far_max_datagram(tx, far_max);
+    memset(received, 0, sizeof(received));
+    bad_packets = 0;
+    srand(1234);
+    lost = 0;
+    batched = 0;
+    for (i = 0;  i < PACKETS;  i++)
+    {
+        sent_len[i] = 1 + rand()%(UDPTL_MAX_DATAGRAM/2);
+        for (j = 0;  j < sent_len[i];  j++)
+            sent[i][j] = rand();
+        /*endfor*/
+        if ((len = udptl_build_packet(tx, pkts[batched], sent[i], sent_len[i])) < 0)
+        {
+            printf("Failed to build packet %d\n", i);
+            return -1;
+        }
+        /*endif*/
+        max_len = (far_max > sent_len[i] + UDPTL_MAX_PACKET_OVERHEAD)  ?  far_max  :  sent_len[i] + UDPTL_MAX_PACKET_OVERHEAD;
+        if (len > max_len)
+        {
+            printf("Packet %d is %d bytes long\n", i, len);
+            return -1;
+        }
+        /*endif*/
+        /* Lose a burst of packets from the middle of each period */
+        if (loss_period  &&  i%loss_period >= loss_period/2  &&  i%loss_period < loss_period/2 + loss_burst)
+        {
+            lost++;
+            continue;
+        }
+        /*endif*/
+        if (batch)
+        {
+            bufs[batched] = pkts[batched];
+            lens[batched] = len;
+            if (++batched >= BATCH_SIZE)
+            {
+                if (udptl_rx_packets(rx, bufs, lens, batched) != batched)
+                {
+                    printf("Bad packet in batch\n");
+                    return -1;
+                }
+                /*endif*/
+                batched = 0;
+            }
+            /*endif*/
+        }
+        else
+        {
+            if (udptl_rx_packet(rx, pkts[0], len) < 0)
+            {
+                printf("Bad packet %d\n", i);
+                return -1;
+            }
+            /*endif*/
+        }
+        /*endif*/
+    }
+    /*endfor*/
+    if (batched  &&  udptl_rx_packets(rx, bufs, lens, batched) != batched)
+    {
+        printf("Bad packet in batch\n");
+        return -1;
+    }
+    /*endif*/
+    missing = 0;
+    for (i = 0;  i < PACKETS;  i++)
+    {
+        if (received[i] > 1)
+        {
+            printf("Packet %d was received %d times\n", i, received[i]);
+            bad_packets++;
+        }
+        else if (received[i] == 0)
+        {
+            missing++;
+        }
+        /*endif*/
+    }
+    /*endfor*/
+    printf("%-30s %s - %d lost, %d unrecovered\n", name, (batch)  ?  "batched"  :  "singly ", lost, missing);
+    udptl_free(tx);
+    udptl_free(rx);
+    if (bad_packets)
+        return -1;
+    /*endif*/
+    return missing;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int test_bad_packets(void)
+{
+    udptl_state_t *tx;
+    udptl_state_t *rx;
+    uint8_t pkt[UDPTL_MAX_DATAGRAM + UDPTL_MAX_PACKET_OVERHEAD];
+    uint8_t msg[100];
+    int len;
+    int i;
+
+    tx = udptl_init(NULL, UDPTL_ERROR_CORRECTION_FEC, 3, 3, tx_packet_handler, NULL);
+    rx = udptl_init(NULL, UDPTL_ERROR_CORRECTION_FEC, 3, 3, rx_packet_handler, NULL);
+    memset(msg, 0x55, sizeof(msg));
+    for (i = 0;  i < 20;  i++)
+        len = udptl_build_packet(tx, pkt, msg, sizeof(msg));
+    /*endfor*/
+    /* Every truncation of a good packet should be rejected */
+    for (i = 0;  i < len;  i++)
+    {
+        if (udptl_rx_packet(rx, pkt, i) >= 0)
+        {
+            printf("Truncated packet of %d bytes accepted\n", i);
+            return -1;
+        }
+        /*endif*/
+    }
+    /*endfor*/
+    /* Claim more FEC entries than we can hold */
+    pkt[2 + 1 + sizeof(msg) + 3] = UDPTL_MAX_FEC_ENTRIES + 1;
+    if (udptl_rx_packet(rx, pkt, len) >= 0)
+    {
+        printf("Packet with too many FEC entries accepted\n");
+        return -1;
+    }
+    /*endif*/
+    udptl_free(tx);
+    udptl_free(rx);
+    printf("Bad packets rejected\n");
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+    int batch;
+
+    for (batch = 0;  batch < 2;  batch++)
+    {
+        if (test_stream("No error correction", UDPTL_ERROR_CORRECTION_NONE, 0, 0, UDPTL_MAX_DATAGRAM, 0, 0, batch) != 0)
+        {
+            printf("Tests failed\n");
+            exit(2);
+        }
+        /*endif*/
+        /* With no error correction, every lost packet stays lost */
+        if (test_stream("No error correction, lossy", UDPTL_ERROR_CORRECTION_NONE, 0, 0, UDPTL_MAX_DATAGRAM, 10, 1, batch) != PACKETS/10)
+        {
+            printf("Tests failed\n");
+            exit(2);
+        }
+        /*endif*/
+        if (test_stream("Redundancy, lossy", UDPTL_ERROR_CORRECTION_REDUNDANCY, 0, 3, MAX_FAR_DATAGRAM, 10, 3, batch) != 0)
+        {
+            printf("Tests failed\n");
+            exit(2);
+        }
+        /*endif*/
+        /* Small datagrams squeeze out some of the redundant packets, so only single
+           losses can be relied on to be recovered. */
+        if (test_stream("Redundancy, small datagrams", UDPTL_ERROR_CORRECTION_REDUNDANCY, 0, 3, 600, 10, 1, batch) != 0)
+        {
+            printf("Tests failed\n");
+            exit(2);
+        }
+        /*endif*/
+        if (test_stream("FEC, lossy", UDPTL_ERROR_CORRECTION_FEC, 3, 3, MAX_FAR_DATAGRAM, 10, 1, batch) != 0)
+        {
+            printf("Tests failed\n");
+            exit(2);
+        }
+        /*endif*/
+    }
+    /*endfor*/
+    if (test_bad_packets())
+    {
+        printf("Tests failed\n");
+        exit(2);
+    }
+    /*endif*/
+    printf("Tests passed\n");
+    return 0;
+}
+/*- End of function --------------------------------------------------------*/
+/*- End of file ------------------------------------------------------------*/
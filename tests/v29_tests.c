@@ -67,6 +67,7 @@ display of modem status is maintained.
 
 #include "spandsp.h"
 #include "spandsp-sim.h"
+#include "packed_bits_harness.h"
 
 #if defined(ENABLE_GUI)
 #include "modem_monitor.h"
@@ -317,6 +318,62 @@ static void fpe_trap_setup(void)
 /*- End of function --------------------------------------------------------*/
 #endif
 
+static void *packed_tx_init(int bit_rate, bool tep, span_get_bit_func_t get_bit, span_get_bits_func_t get_bits, void *user_data)
+{
+    v29_tx_state_t *s;
+
+    if ((s = v29_tx_init(NULL, bit_rate, tep, get_bit, user_data))  &&  get_bits)
+        v29_tx_set_get_bits(s, get_bits, user_data);
+    /*endif*/
+    return s;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int packed_tx(void *s, int16_t amp[], int len)
+{
+    return v29_tx((v29_tx_state_t *) s, amp, len);
+}
+/*- End of function --------------------------------------------------------*/
+
+static void packed_tx_free(void *s)
+{
+    v29_tx_free((v29_tx_state_t *) s);
+}
+/*- End of function --------------------------------------------------------*/
+
+static void *packed_rx_init(int bit_rate, span_put_bit_func_t put_bit, span_put_bits_func_t put_bits, void *user_data)
+{
+    v29_rx_state_t *s;
+
+    if ((s = v29_rx_init(NULL, bit_rate, put_bit, user_data))  &&  put_bits)
+        v29_rx_set_put_bits(s, put_bits, user_data);
+    /*endif*/
+    return s;
+}
+/*- End of function --------------------------------------------------------*/
+
+static int packed_rx(void *s, const int16_t amp[], int len)
+{
+    return v29_rx((v29_rx_state_t *) s, amp, len);
+}
+/*- End of function --------------------------------------------------------*/
+
+static void packed_rx_free(void *s)
+{
+    v29_rx_free((v29_rx_state_t *) s);
+}
+/*- End of function --------------------------------------------------------*/
+
+static const packed_bits_modem_t packed_modem =
+{
+    packed_tx_init,
+    packed_tx,
+    packed_tx_free,
+    packed_rx_init,
+    packed_rx,
+    packed_rx_free
+};
+
 int main(int argc, char *argv[])
 {
     v29_rx_state_t *rx;
@@ -414,6 +471,17 @@ int main(int argc, char *argv[])
     fpe_trap_setup();
 #endif
 
+    if (decode_test_file == NULL)
+    {
+        if (packed_bits_tests(&packed_modem, test_bps, tep))
+        {
+            printf("Tests failed.\n");
+            exit(2);
+        }
+        /*endif*/
+    }
+    /*endif*/
+
     if (log_audio)
     {
         if ((outhandle = sf_open_telephony_write(OUT_FILE_NAME, 1)) == NULL)
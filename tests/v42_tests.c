@@ -28,7 +28,7 @@
 /*! \page v42_tests_page V.42 tests
 \section v42_tests_page_sec_1 What does it do?
 These tests connect two instances of V.42 back to back. V.42 frames are
-then exchanged between them.
+then exchanged between them, either a bit at a time, or in blocks of octets.
 */
 
 #if defined(HAVE_CONFIG_H)
@@ -154,14 +154,18 @@ int main(int argc, char *argv[])
 {
     int i;
     int bit;
-    bool insert_caller_bit_errors;
-    bool insert_answerer_bit_errors;
+    int len;
+    uint8_t buf[4];
+    int insert_caller_bit_errors;
+    int insert_answerer_bit_errors;
+    bool octet_mode;
     int opt;
 
-    insert_caller_bit_errors = false;
-    insert_answerer_bit_errors = false;
+    insert_caller_bit_errors = 0;
+    insert_answerer_bit_errors = 0;
     variable_length = false;
-    while ((opt = getopt(argc, argv, "bv")) != -1)
+    octet_mode = false;
+    while ((opt = getopt(argc, argv, "bov")) != -1)
     {
         switch (opt)
         {
@@ -169,6 +173,9 @@ int main(int argc, char *argv[])
             insert_caller_bit_errors = 11000;
             insert_answerer_bit_errors = 10000;
             break;
+        case 'o':
+            octet_mode = true;
+            break;
         case 'v':
             variable_length = true;
             break;
@@ -193,6 +200,26 @@ int main(int argc, char *argv[])
     span_log_set_level(v42_get_logging_state(answerer), SPAN_LOG_SHOW_SEVERITY | SPAN_LOG_SHOW_PROTOCOL | SPAN_LOG_SHOW_TAG | SPAN_LOG_DEBUG);
     span_log_set_tag(v42_get_logging_state(answerer), "answerer");
 
+    if (octet_mode)
+    {
+        for (i = 0;  i < 1000000;  i += 8*sizeof(buf))
+        {
+            /* Corrupt the first bit of any block which spans a multiple of the error interval */
+            len = v42_tx_get(caller, buf, sizeof(buf));
+            if (insert_caller_bit_errors  &&  len > 0  &&  i/insert_caller_bit_errors != (i + 8*len)/insert_caller_bit_errors)
+                buf[0] ^= 0x80;
+            /*endif*/
+            v42_rx_put(answerer, buf, len);
+            len = v42_tx_get(answerer, buf, sizeof(buf));
+            if (insert_answerer_bit_errors  &&  len > 0  &&  i/insert_answerer_bit_errors != (i + 8*len)/insert_answerer_bit_errors)
+                buf[0] ^= 0x80;
+            /*endif*/
+            v42_rx_put(caller, buf, len);
+        }
+        /*endfor*/
+        return 0;
+    }
+    /*endif*/
     for (i = 0;  i < 1000000;  i++)
     {
         bit = v42_tx_bit(caller);